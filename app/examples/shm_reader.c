@@ -0,0 +1,193 @@
+/*
+ * Minimal reader of the frames exported by scrcpy --shm-sink.
+ *
+ * It waits for each new frame, computes the mean luma of the frame directly
+ * from the shared memory (without copy), and periodically prints the frame
+ * handoff latency (between the publication by scrcpy and the wake up of the
+ * reader).
+ *
+ * Build (from the app/ directory):
+ *
+ *     cc -std=c11 -O2 -Isrc examples/shm_reader.c -o shm_reader -lrt
+ *
+ * Usage:
+ *
+ *     scrcpy --shm-sink=/scrcpy
+ *     ./shm_reader /scrcpy
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "shm_frame.h"
+
+#define REPORT_INTERVAL_NS 2000000000 // 2 seconds
+
+struct latency_stats {
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    uint64_t skipped; // frames published but never seen
+    uint64_t torn; // frames overwritten while being read
+};
+
+static uint64_t
+now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+stats_reset(struct latency_stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->min_ns = UINT64_MAX;
+}
+
+static void
+stats_print(const struct latency_stats *stats) {
+    if (!stats->count) {
+        printf("no frame\n");
+        return;
+    }
+    printf("%" PRIu64 " frames, latency min/avg/max: %.1f/%.1f/%.1f us, "
+           "skipped: %" PRIu64 ", torn: %" PRIu64 "\n", stats->count,
+           stats->min_ns / 1000.0, stats->sum_ns / 1000.0 / stats->count,
+           stats->max_ns / 1000.0, stats->skipped, stats->torn);
+}
+
+// Wait until futex differs from the value, or a timeout (1 second)
+static void
+wait_frame(struct sc_shm_frame_header *header, uint32_t value) {
+    atomic_fetch_add(&header->waiters, 1);
+    if (atomic_load(&header->futex) == value) {
+        struct timespec timeout = {1, 0};
+        syscall(SYS_futex, &header->futex, FUTEX_WAIT, value, &timeout, NULL,
+                0);
+    }
+    atomic_fetch_sub(&header->waiters, 1);
+}
+
+// Process the frame in place, return false if it was overwritten meanwhile
+static bool
+process_frame(struct sc_shm_frame_header *header, uint64_t frame,
+              double *mean_luma, uint64_t *publish_time_ns) {
+    struct sc_shm_frame_slot *slot =
+        &header->slots[(frame - 1) % header->slot_count];
+
+    uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if (seq & 1 || slot->frame != frame) {
+        return false;
+    }
+
+    *publish_time_ns = slot->publish_time_ns;
+
+    const uint8_t *data = (const uint8_t *) header + slot->data_offset;
+    const uint8_t *luma = data + slot->plane_offsets[0];
+    uint32_t linesize = slot->plane_linesizes[0];
+    uint64_t sum = 0;
+    for (uint32_t y = 0; y < slot->height; ++y) {
+        for (uint32_t x = 0; x < slot->width; ++x) {
+            sum += luma[y * linesize + x];
+        }
+    }
+    uint64_t pixels = (uint64_t) slot->width * slot->height;
+    *mean_luma = pixels ? (double) sum / pixels : 0;
+
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&slot->seq, memory_order_relaxed) == seq;
+}
+
+int
+main(int argc, char *argv[]) {
+    const char *name = argc > 1 ? argv[1] : "/scrcpy";
+
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd == -1) {
+        fprintf(stderr, "Could not open %s: %s\n", name, strerror(errno));
+        return 1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1
+            || (size_t) st.st_size < sizeof(struct sc_shm_frame_header)) {
+        fprintf(stderr, "Invalid shared memory: %s\n", name);
+        return 1;
+    }
+
+    // PROT_WRITE is required to register as a waiter
+    void *map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                     0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Could not map %s: %s\n", name, strerror(errno));
+        return 1;
+    }
+
+    struct sc_shm_frame_header *header = map;
+    if (atomic_load_explicit(&header->magic, memory_order_acquire)
+                != SC_SHM_FRAME_MAGIC
+            || header->version != SC_SHM_FRAME_VERSION) {
+        fprintf(stderr, "Unexpected shared memory header: %s\n", name);
+        return 1;
+    }
+
+    struct latency_stats stats;
+    stats_reset(&stats);
+    uint64_t next_report = now_ns() + REPORT_INTERVAL_NS;
+    uint64_t last_seen = atomic_load(&header->last_frame);
+    double mean_luma = 0;
+
+    while (!atomic_load(&header->closed)) {
+        uint32_t futex = atomic_load(&header->futex);
+        uint64_t frame = atomic_load_explicit(&header->last_frame,
+                                              memory_order_acquire);
+        if (frame == last_seen) {
+            wait_frame(header, futex);
+            continue;
+        }
+
+        uint64_t wake_time = now_ns();
+        uint64_t publish_time;
+        if (process_frame(header, frame, &mean_luma, &publish_time)) {
+            uint64_t latency = wake_time - publish_time;
+            ++stats.count;
+            stats.sum_ns += latency;
+            if (latency < stats.min_ns) {
+                stats.min_ns = latency;
+            }
+            if (latency > stats.max_ns) {
+                stats.max_ns = latency;
+            }
+        } else {
+            ++stats.torn;
+        }
+        if (last_seen && frame > last_seen + 1) {
+            stats.skipped += frame - last_seen - 1;
+        }
+        last_seen = frame;
+
+        if (wake_time >= next_report) {
+            printf("[mean luma %.1f] ", mean_luma);
+            stats_print(&stats);
+            stats_reset(&stats);
+            next_report = wake_time + REPORT_INTERVAL_NS;
+        }
+    }
+
+    printf("scrcpy closed the shared memory\n");
+    munmap(map, st.st_size);
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "camera_motion.h"
+
+void
+sc_camera_motion_init(struct sc_camera_motion *cm, sc_tick period) {
+    cm->x = 0;
+    cm->y = 0;
+    cm->period = period;
+    cm->last_deadline = 0;
+}
+
+void
+sc_camera_motion_reset(struct sc_camera_motion *cm, struct sc_point center) {
+    cm->x = center.x;
+    cm->y = center.y;
+}
+
+static bool
+is_near_edge(float value, uint16_t size) {
+    float margin = size * SC_CAMERA_MOTION_EDGE_MARGIN;
+    return value < margin || value > size - margin;
+}
+
+bool
+sc_camera_motion_move(struct sc_camera_motion *cm, float dx, float dy,
+                      struct sc_size frame_size, struct sc_point center) {
+    float x = cm->x + dx;
+    float y = cm->y + dy;
+
+    bool recenter = is_near_edge(x, frame_size.width)
+                 || is_near_edge(y, frame_size.height);
+    if (recenter) {
+        // The motion is not lost, it is applied from the center
+        x = center.x + dx;
+        y = center.y + dy;
+    }
+
+    cm->x = x;
+    cm->y = y;
+    return recenter;
+}
+
+static int32_t
+round_to_int(float value) {
+    return (int32_t) (value < 0 ? value - 0.5f : value + 0.5f);
+}
+
+struct sc_point
+sc_camera_motion_get_point(const struct sc_camera_motion *cm) {
+    return (struct sc_point) {
+        .x = round_to_int(cm->x),
+        .y = round_to_int(cm->y),
+    };
+}
+
+sc_tick
+sc_camera_motion_next_deadline(struct sc_camera_motion *cm, sc_tick now) {
+    if (cm->last_deadline > now) {
+        // A MOVE event is pending, replace it
+        return cm->last_deadline;
+    }
+
+    sc_tick deadline = cm->last_deadline + cm->period;
+    if (deadline < now) {
+        deadline = now;
+    }
+    cm->last_deadline = deadline;
+    return deadline;
+}
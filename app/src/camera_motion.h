@@ -0,0 +1,67 @@
+#ifndef SC_CAMERA_MOTION_H
+#define SC_CAMERA_MOTION_H
+
+#include "common.h"
+
+#include <stdbool.h>
+
+#include "coords.h"
+#include "util/tick.h"
+
+// The virtual finger is recentered when it gets closer to an edge of the
+// frame than this fraction of the frame size
+#define SC_CAMERA_MOTION_EDGE_MARGIN 0.1f
+
+/**
+ * Position of the virtual finger moving the camera in joystick mode
+ *
+ * The relative mouse motions are accumulated with a sub-pixel precision, and
+ * the MOVE events are emitted at a fixed maximum rate.
+ */
+struct sc_camera_motion {
+    // Position of the virtual finger, in frame coordinates
+    float x;
+    float y;
+    // Minimal delay between two MOVE events (0 for no limit)
+    sc_tick period;
+    // Deadline of the last MOVE event emitted
+    sc_tick last_deadline;
+};
+
+void
+sc_camera_motion_init(struct sc_camera_motion *cm, sc_tick period);
+
+/**
+ * Put the virtual finger at `center`
+ */
+void
+sc_camera_motion_reset(struct sc_camera_motion *cm, struct sc_point center);
+
+/**
+ * Accumulate a relative motion
+ *
+ * If the virtual finger gets too close to an edge, it is moved back to
+ * `center` before applying the motion, and this function returns true: the
+ * caller must lift the finger and put it down again at `center`.
+ */
+bool
+sc_camera_motion_move(struct sc_camera_motion *cm, float dx, float dy,
+                      struct sc_size frame_size, struct sc_point center);
+
+/**
+ * Return the position of the virtual finger, rounded to the nearest pixel
+ */
+struct sc_point
+sc_camera_motion_get_point(const struct sc_camera_motion *cm);
+
+/**
+ * Return the time at which the MOVE event for the current position must be
+ * sent
+ *
+ * If a MOVE event is already scheduled later than `now`, its deadline is
+ * returned, so that the new position replaces it.
+ */
+sc_tick
+sc_camera_motion_next_deadline(struct sc_camera_motion *cm, sc_tick now);
+
+#endif
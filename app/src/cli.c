@@ -1,10 +1,13 @@
 #include "cli.h"
 
 #include <assert.h>
+#include <errno.h>
 #include <getopt.h>
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "options.h"
@@ -52,6 +55,28 @@
 #define OPT_NO_CLIPBOARD_AUTOSYNC  1032
 #define OPT_TCPIP                  1033
 #define OPT_RAW_KEY_EVENTS         1034
+#define OPT_RECORD_QUEUE_POLICY    1035
+#define OPT_RECORD_QUEUE_SIZE      1036
+#define OPT_RECORD_QUEUE_PACKETS   1037
+#define OPT_TIMELAPSE              1038
+#define OPT_TIMELAPSE_INTERVAL     1039
+#define OPT_TIMELAPSE_THRESHOLD    1040
+#define OPT_TIMELAPSE_CRF          1041
+#define OPT_SHM_SINK               1042
+#define OPT_V4L2_PIXEL_FORMAT      1043
+#define OPT_V4L2_SIZE              1044
+#define OPT_LATENCY_PROBE          1045
+#define OPT_INPUT_RECORD           1046
+#define OPT_INPUT_REPLAY           1047
+#define OPT_INPUT_REPLAY_SPEED     1048
+#define OPT_KEYMAP                 1049
+#define OPT_KEYMAP_PROFILE         1050
+#define OPT_CAMERA_RATE            1051
+#define OPT_ADAPTIVE_BIT_RATE      1052
+#define OPT_LOW_LATENCY            1053
+#define OPT_MULTIPLEX              1054
+#define OPT_RESUME                 1055
+#define OPT_UDP                    1056
 
 struct sc_option {
     char shortopt;
@@ -77,6 +102,18 @@ struct sc_getopt_adapter {
 };
 
 static const struct sc_option options[] = {
+    {
+        .longopt_id = OPT_ADAPTIVE_BIT_RATE,
+        .longopt = "adaptive-bit-rate",
+        .argdesc = "min:max",
+        .optional_arg = true,
+        .text = "Periodically report the reception of the video stream to "
+                "the device, so that it adapts the bit-rate to the network "
+                "conditions, between min and max (in bits/s, with the same "
+                "suffixes as --bit-rate).\n"
+                "The encoding starts at the --bit-rate value.\n"
+                "Default is 1M:<bit-rate>.",
+    },
     {
         .longopt_id = OPT_ALWAYS_ON_TOP,
         .longopt = "always-on-top",
@@ -90,6 +127,15 @@ static const struct sc_option options[] = {
                 "Unit suffixes are supported: 'K' (x1000) and 'M' (x1000000).\n"
                 "Default is " STR(DEFAULT_BIT_RATE) ".",
     },
+    {
+        .longopt_id = OPT_CAMERA_RATE,
+        .longopt = "camera-rate",
+        .argdesc = "value",
+        .text = "Limit the rate of the camera move events sent in joystick "
+                "mode, in events per second (0 for no limit). The mouse "
+                "motions received in between are accumulated.\n"
+                "Default is 120.",
+    },
     {
         .longopt_id = OPT_CODEC_OPTIONS,
         .longopt = "codec-options",
@@ -180,6 +226,57 @@ static const struct sc_option options[] = {
         .longopt = "help",
         .text = "Print this help.",
     },
+    {
+        .longopt_id = OPT_INPUT_RECORD,
+        .longopt = "input-record",
+        .argdesc = "file",
+        .text = "Record the input events sent to the device, with their "
+                "timing, to a file (to be replayed with --input-replay).",
+    },
+    {
+        .longopt_id = OPT_INPUT_REPLAY,
+        .longopt = "input-replay",
+        .argdesc = "file",
+        .text = "Replay the input events recorded by --input-record.\n"
+                "The timing error of the replay is logged at the end.",
+    },
+    {
+        .longopt_id = OPT_INPUT_REPLAY_SPEED,
+        .longopt = "input-replay-speed",
+        .argdesc = "value",
+        .text = "Set the speed factor of --input-replay (2 replays twice as "
+                "fast as the original timing), or \"max\" to replay the "
+                "events as fast as possible.\n"
+                "Default is 1.",
+    },
+    {
+        .longopt_id = OPT_KEYMAP,
+        .longopt = "keymap",
+        .argdesc = "file",
+        .text = "Load the key mappings of the joystick mode (MOD+q) from "
+                "a keymap file, containing one or several named profiles.\n"
+                "By default, a built-in keymap is used.",
+    },
+    {
+        .longopt_id = OPT_KEYMAP_PROFILE,
+        .longopt = "keymap-profile",
+        .argdesc = "name",
+        .text = "Select the keymap profile to use in joystick mode.\n"
+                "The profile may also be switched with MOD+Shift+q.\n"
+                "Default is the first profile of the keymap.",
+    },
+    {
+        .longopt_id = OPT_LATENCY_PROBE,
+        .longopt = "latency-probe",
+        .argdesc = "ms",
+        .optional_arg = true,
+        .text = "Periodically send a ping to the device through the control "
+                "channel, and log the percentiles of the round-trip times.\n"
+                "The argument is the interval between pings, in "
+                "milliseconds.\n"
+                "Default is 100.\n"
+                "The probe may also be enabled/disabled with MOD+l.",
+    },
     {
         .longopt_id = OPT_LEGACY_PASTE,
         .longopt = "legacy-paste",
@@ -202,6 +299,16 @@ static const struct sc_option options[] = {
                 "Passing the option without argument is equivalent to passing "
                 "\"initial\".",
     },
+    {
+        .longopt_id = OPT_LOW_LATENCY,
+        .longopt = "low-latency",
+        .text = "Configure the device encoder for the lowest latency, among "
+                "the features it supports (encoding latency, realtime "
+                "priority, low-latency mode, intra refresh, baseline profile "
+                "without B-frames).\n"
+                "The options explicitly set by --codec-options take "
+                "precedence.",
+    },
     {
         .longopt_id = OPT_MAX_FPS,
         .longopt = "max-fps",
@@ -218,6 +325,14 @@ static const struct sc_option options[] = {
                 "is preserved.\n"
                 "Default is 0 (unlimited).",
     },
+    {
+        .longopt_id = OPT_MULTIPLEX,
+        .longopt = "multiplex",
+        .text = "Transmit the video and the control messages over a single "
+                "connection, instead of one connection each.\n"
+                "This halves the connection setup, and only one tunnel needs "
+                "to be kept open (useful over slow wireless connections).",
+    },
     {
         .longopt_id = OPT_NO_CLIPBOARD_AUTOSYNC,
         .longopt = "no-clipboard-autosync",
@@ -302,6 +417,34 @@ static const struct sc_option options[] = {
         .argdesc = "format",
         .text = "Force recording format (either mp4 or mkv).",
     },
+    {
+        .longopt_id = OPT_RECORD_QUEUE_PACKETS,
+        .longopt = "record-queue-packets",
+        .argdesc = "value",
+        .text = "Set the maximum number of packets waiting to be written to "
+                "the recording file.\n"
+                "Default is 1024.",
+    },
+    {
+        .longopt_id = OPT_RECORD_QUEUE_POLICY,
+        .longopt = "record-queue-policy",
+        .argdesc = "value",
+        .text = "Select the behavior when the recording queue is full (see "
+                "--record-queue-size and --record-queue-packets).\n"
+                "Possible values are \"block\" (wait for the recorder, which "
+                "delays mirroring), \"drop\" (drop packets until the next "
+                "keyframe) and \"fail\" (stop mirroring and recording).\n"
+                "Default is block.",
+    },
+    {
+        .longopt_id = OPT_RECORD_QUEUE_SIZE,
+        .longopt = "record-queue-size",
+        .argdesc = "value",
+        .text = "Set the maximum size of the packets waiting to be written to "
+                "the recording file, in bytes. The value may be suffixed by "
+                "'K' (x1000) or 'M' (x1000000).\n"
+                "Default is 64M.",
+    },
     {
         .longopt_id = OPT_RENDER_DRIVER,
         .longopt = "render-driver",
@@ -317,6 +460,16 @@ static const struct sc_option options[] = {
         .longopt_id = OPT_RENDER_EXPIRED_FRAMES,
         .longopt = "render-expired-frames",
     },
+    {
+        .longopt_id = OPT_RESUME,
+        .longopt = "resume",
+        .text = "Do not end the session when the connection is lost: the "
+                "server keeps running on the device for 10 seconds, while the "
+                "client tries to reconnect. The video resumes from a new key "
+                "frame, the window, the recording and the v4l2 sink stay open "
+                "across the gap.\n"
+                "This enables --multiplex and --force-adb-forward.",
+    },
     {
         .longopt_id = OPT_ROTATION,
         .longopt = "rotation",
@@ -332,6 +485,17 @@ static const struct sc_option options[] = {
         .text = "The device serial number. Mandatory only if several devices "
                 "are connected to adb.",
     },
+#ifdef HAVE_SHM_SINK
+    {
+        .longopt_id = OPT_SHM_SINK,
+        .longopt = "shm-sink",
+        .argdesc = "/name",
+        .text = "Publish the decoded frames (YUV 4:2:0) to a POSIX shared "
+                "memory object, for local consumers.\n"
+                "The layout is described in app/src/shm_frame.h, and a "
+                "reader example is provided in app/examples/shm_reader.c.",
+    },
+#endif
     {
         .longopt_id = OPT_SHORTCUT_MOD,
         .longopt = "shortcut-mod",
@@ -357,6 +521,43 @@ static const struct sc_option options[] = {
                 "on exit.\n"
                 "It only shows physical touches (not clicks from scrcpy).",
     },
+    {
+        .longopt_id = OPT_TIMELAPSE,
+        .longopt = "timelapse",
+        .argdesc = "file.mp4",
+        .text = "Record a time-lapse of the screen to file, re-encoded with "
+                "libx264 (or libopenh264 if FFmpeg has no libx264 "
+                "support).\n"
+                "The frames are selected by --timelapse-interval and/or "
+                "--timelapse-threshold (by default, one frame out of 60).\n"
+                "The format is determined by the file extension (.mp4 or "
+                ".mkv).",
+    },
+    {
+        .longopt_id = OPT_TIMELAPSE_CRF,
+        .longopt = "timelapse-crf",
+        .argdesc = "value",
+        .text = "Set the constant rate factor (quality) of the time-lapse "
+                "encoder, between 0 (lossless) and 51 (worst). With "
+                "libopenh264, it is used as a constant QP.\n"
+                "Default is 23.",
+    },
+    {
+        .longopt_id = OPT_TIMELAPSE_INTERVAL,
+        .longopt = "timelapse-interval",
+        .argdesc = "n",
+        .text = "Capture one frame every n frames in the time-lapse.",
+    },
+    {
+        .longopt_id = OPT_TIMELAPSE_THRESHOLD,
+        .longopt = "timelapse-threshold",
+        .argdesc = "value",
+        .text = "Capture a frame in the time-lapse only if it differs from "
+                "the last captured frame by more than value (the mean "
+                "absolute difference of luma samples, between 0 and 255).\n"
+                "If --timelapse-interval is also set, only the frames "
+                "selected by the interval are considered.",
+    },
     {
         .longopt_id = OPT_TUNNEL_HOST,
         .longopt = "tunnel-host",
@@ -376,6 +577,16 @@ static const struct sc_option options[] = {
                 "Default is 0 (not forced): the local port used for "
                 "establishing the tunnel will be used.",
     },
+    {
+        .longopt_id = OPT_UDP,
+        .longopt = "udp",
+        .text = "Receive the video over UDP (RTP with forward error "
+                "correction) instead of the adb tunnel, to avoid the "
+                "head-of-line blocking of TCP on a lossy network. The control "
+                "messages still use the adb tunnel.\n"
+                "The device must be connected over TCP/IP (see --tcpip), and "
+                "reachable on UDP port 27183.",
+    },
 #ifdef HAVE_V4L2
     {
         .longopt_id = OPT_V4L2_SINK,
@@ -395,6 +606,21 @@ static const struct sc_option options[] = {
                 "V4L2 sink.\n"
                 "Default is 0 (no buffering).",
     },
+    {
+        .longopt_id = OPT_V4L2_PIXEL_FORMAT,
+        .longopt = "v4l2-pixel-format",
+        .argdesc = "format",
+        .text = "Set the pixel format of the V4L2 sink: \"yuv420\", \"yuyv\" "
+                "or \"nv12\".\n"
+                "Default is \"yuv420\" (the decoder format, no conversion).",
+    },
+    {
+        .longopt_id = OPT_V4L2_SIZE,
+        .longopt = "v4l2-size",
+        .argdesc = "WxH",
+        .text = "Scale the frames of the V4L2 sink to the given size.\n"
+                "Default is the video size (no scaling).",
+    },
 #endif
     {
         .shortopt = 'V',
@@ -522,6 +748,15 @@ static const struct sc_shortcut shortcuts[] = {
         .shortcuts = { "MOD+Down" },
         .text = "Click on VOLUME_DOWN",
     },
+    {
+        .shortcuts = { "MOD+Shift+Up" },
+        .text = "Switch to the next video preset (higher resolution and "
+                "frame rate)",
+    },
+    {
+        .shortcuts = { "MOD+Shift+Down" },
+        .text = "Switch to the previous video preset (lower latency)",
+    },
     {
         .shortcuts = { "MOD+p" },
         .text = "Click on POWER (turn screen on/off)",
@@ -571,6 +806,20 @@ static const struct sc_shortcut shortcuts[] = {
         .shortcuts = { "MOD+i" },
         .text = "Enable/disable FPS counter (print frames/second in logs)",
     },
+    {
+        .shortcuts = { "MOD+l" },
+        .text = "Enable/disable latency probe (print control round-trip "
+                "times in logs)",
+    },
+    {
+        .shortcuts = { "MOD+q" },
+        .text = "Enable/disable joystick mode (map keys and mouse to touch "
+                "events, see --keymap)",
+    },
+    {
+        .shortcuts = { "MOD+Shift+q" },
+        .text = "Switch to the next keymap profile",
+    },
     {
         .shortcuts = { "Ctrl+click-and-move" },
         .text = "Pinch-to-zoom from the center of the screen",
@@ -898,6 +1147,35 @@ parse_bit_rate(const char *s, uint32_t *bit_rate) {
     return true;
 }
 
+static bool
+parse_adaptive_bit_rate(const char *s, uint32_t *min, uint32_t *max) {
+    if (!s) {
+        // Without argument, use the default bounds
+        return true;
+    }
+
+    const char *sep = strchr(s, ':');
+    char min_str[32];
+    size_t min_len = sep ? (size_t) (sep - s) : 0;
+    if (!sep || min_len >= sizeof(min_str)) {
+        LOGE("Could not parse adaptive bit-rate (expected min:max): %s", s);
+        return false;
+    }
+    memcpy(min_str, s, min_len);
+    min_str[min_len] = '\0';
+
+    if (!parse_bit_rate(min_str, min) || !parse_bit_rate(sep + 1, max)) {
+        return false;
+    }
+
+    if (!*min || *min > *max) {
+        LOGE("Invalid adaptive bit-rate range: %s", s);
+        return false;
+    }
+
+    return true;
+}
+
 static bool
 parse_max_size(const char *s, uint16_t *max_size) {
     long value;
@@ -922,6 +1200,18 @@ parse_max_fps(const char *s, uint16_t *max_fps) {
     return true;
 }
 
+static bool
+parse_camera_rate(const char *s, uint16_t *camera_rate) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 0, 1000, "camera rate");
+    if (!ok) {
+        return false;
+    }
+
+    *camera_rate = (uint16_t) value;
+    return true;
+}
+
 static bool
 parse_buffering_time(const char *s, sc_tick *tick) {
     long value;
@@ -935,6 +1225,46 @@ parse_buffering_time(const char *s, sc_tick *tick) {
     return true;
 }
 
+static bool
+parse_input_replay_speed(const char *s, float *speed) {
+    if (!strcmp(s, "max")) {
+        *speed = 0;
+        return true;
+    }
+
+    char *endptr;
+    errno = 0;
+    float value = strtof(s, &endptr);
+    if (*s == '\0' || *endptr != '\0' || errno == ERANGE || !(value > 0)
+            || value > 1000) {
+        LOGE("Invalid input replay speed: %s (expected a positive number or "
+             "\"max\")", s);
+        return false;
+    }
+
+    *speed = value;
+    return true;
+}
+
+static bool
+parse_latency_probe_interval(const char *s, sc_tick *interval) {
+    if (!s) {
+        // Without argument, use the default interval
+        *interval = 0;
+        return true;
+    }
+
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 1, 0x7FFFFFFF,
+                                "latency probe interval");
+    if (!ok) {
+        return false;
+    }
+
+    *interval = SC_TICK_FROM_MS(value);
+    return true;
+}
+
 static bool
 parse_lock_video_orientation(const char *s,
                              enum sc_lock_video_orientation *lock_mode) {
@@ -1188,6 +1518,134 @@ parse_record_format(const char *optarg, enum sc_record_format *format) {
     return false;
 }
 
+static bool
+parse_record_queue_policy(const char *optarg,
+                          enum sc_record_queue_policy *policy) {
+    if (!strcmp(optarg, "block")) {
+        *policy = SC_RECORD_QUEUE_POLICY_BLOCK;
+        return true;
+    }
+    if (!strcmp(optarg, "drop")) {
+        *policy = SC_RECORD_QUEUE_POLICY_DROP;
+        return true;
+    }
+    if (!strcmp(optarg, "fail")) {
+        *policy = SC_RECORD_QUEUE_POLICY_FAIL;
+        return true;
+    }
+    LOGE("Unsupported record queue policy: %s (expected block, drop or fail)",
+         optarg);
+    return false;
+}
+
+static bool
+parse_record_queue_size(const char *s, uint32_t *size) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, true, 1, 0x7FFFFFFF,
+                                "record queue size");
+    if (!ok) {
+        return false;
+    }
+
+    *size = (uint32_t) value;
+    return true;
+}
+
+static bool
+parse_record_queue_packets(const char *s, uint32_t *packets) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 1, 0x7FFFFFFF,
+                                "record queue packets");
+    if (!ok) {
+        return false;
+    }
+
+    *packets = (uint32_t) value;
+    return true;
+}
+
+static bool
+parse_timelapse_interval(const char *s, uint16_t *interval) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 1, 0xFFFF,
+                                "time-lapse interval");
+    if (!ok) {
+        return false;
+    }
+
+    *interval = (uint16_t) value;
+    return true;
+}
+
+static bool
+parse_timelapse_threshold(const char *s, uint8_t *threshold) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 0, 255,
+                                "time-lapse threshold");
+    if (!ok) {
+        return false;
+    }
+
+    *threshold = (uint8_t) value;
+    return true;
+}
+
+static bool
+parse_timelapse_crf(const char *s, uint8_t *crf) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 0, 51, "time-lapse crf");
+    if (!ok) {
+        return false;
+    }
+
+    *crf = (uint8_t) value;
+    return true;
+}
+
+#ifdef HAVE_V4L2
+static bool
+parse_v4l2_pixel_format(const char *optarg,
+                        enum sc_v4l2_pixel_format *format) {
+    if (!strcmp(optarg, "yuv420")) {
+        *format = SC_V4L2_PIXEL_FORMAT_YUV420;
+        return true;
+    }
+    if (!strcmp(optarg, "yuyv")) {
+        *format = SC_V4L2_PIXEL_FORMAT_YUYV;
+        return true;
+    }
+    if (!strcmp(optarg, "nv12")) {
+        *format = SC_V4L2_PIXEL_FORMAT_NV12;
+        return true;
+    }
+    LOGE("Unsupported V4L2 pixel format: %s (expected yuv420, yuyv or nv12)",
+         optarg);
+    return false;
+}
+
+static bool
+parse_v4l2_size(const char *s, uint16_t *width, uint16_t *height) {
+    long values[2];
+    size_t count = sc_str_parse_integers(s, 'x', 2, values);
+    if (count != 2) {
+        LOGE("Could not parse V4L2 size: %s (expected WxH)", s);
+        return false;
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        if (values[i] < 1 || values[i] > 0xFFFF) {
+            LOGE("Could not parse V4L2 size: value (%ld) out-of-range "
+                 "(1; %d)", values[i], 0xFFFF);
+            return false;
+        }
+    }
+
+    *width = values[0];
+    *height = values[1];
+    return true;
+}
+#endif
+
 static bool
 parse_ip(const char *optarg, uint32_t *ipv4) {
     return net_parse_ipv4(optarg, ipv4);
@@ -1253,6 +1711,44 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                     return false;
                 }
                 break;
+            case OPT_RECORD_QUEUE_POLICY:
+                if (!parse_record_queue_policy(optarg,
+                                               &opts->record_queue_policy)) {
+                    return false;
+                }
+                break;
+            case OPT_RECORD_QUEUE_SIZE:
+                if (!parse_record_queue_size(optarg,
+                                             &opts->record_queue_size)) {
+                    return false;
+                }
+                break;
+            case OPT_RECORD_QUEUE_PACKETS:
+                if (!parse_record_queue_packets(optarg,
+                                                &opts->record_queue_packets)) {
+                    return false;
+                }
+                break;
+            case OPT_TIMELAPSE:
+                opts->timelapse_filename = optarg;
+                break;
+            case OPT_TIMELAPSE_INTERVAL:
+                if (!parse_timelapse_interval(optarg,
+                                              &opts->timelapse_interval)) {
+                    return false;
+                }
+                break;
+            case OPT_TIMELAPSE_THRESHOLD:
+                if (!parse_timelapse_threshold(optarg,
+                                               &opts->timelapse_threshold)) {
+                    return false;
+                }
+                break;
+            case OPT_TIMELAPSE_CRF:
+                if (!parse_timelapse_crf(optarg, &opts->timelapse_crf)) {
+                    return false;
+                }
+                break;
             case 'h':
                 args->help = true;
                 break;
@@ -1275,6 +1771,18 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                     return false;
                 }
                 break;
+            case OPT_LOW_LATENCY:
+                opts->low_latency = true;
+                break;
+            case OPT_MULTIPLEX:
+                opts->multiplex = true;
+                break;
+            case OPT_RESUME:
+                opts->resume = true;
+                break;
+            case OPT_UDP:
+                opts->udp = true;
+                break;
             case OPT_TUNNEL_HOST:
                 if (!parse_ip(optarg, &opts->tunnel_host)) {
                     return false;
@@ -1383,6 +1891,19 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             case OPT_NO_KEY_REPEAT:
                 opts->forward_key_repeat = false;
                 break;
+            case OPT_ADAPTIVE_BIT_RATE:
+                if (!parse_adaptive_bit_rate(optarg,
+                                             &opts->adaptive_bit_rate_min,
+                                             &opts->adaptive_bit_rate_max)) {
+                    return false;
+                }
+                opts->adaptive_bit_rate = true;
+                break;
+            case OPT_CAMERA_RATE:
+                if (!parse_camera_rate(optarg, &opts->camera_rate)) {
+                    return false;
+                }
+                break;
             case OPT_CODEC_OPTIONS:
                 opts->codec_options = optarg;
                 break;
@@ -1406,6 +1927,31 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             case OPT_LEGACY_PASTE:
                 opts->legacy_paste = true;
                 break;
+            case OPT_INPUT_RECORD:
+                opts->input_record_filename = optarg;
+                break;
+            case OPT_INPUT_REPLAY:
+                opts->input_replay_filename = optarg;
+                break;
+            case OPT_INPUT_REPLAY_SPEED:
+                if (!parse_input_replay_speed(optarg,
+                                              &opts->input_replay_speed)) {
+                    return false;
+                }
+                break;
+            case OPT_KEYMAP:
+                opts->keymap_filename = optarg;
+                break;
+            case OPT_KEYMAP_PROFILE:
+                opts->keymap_profile = optarg;
+                break;
+            case OPT_LATENCY_PROBE:
+                if (!parse_latency_probe_interval(optarg,
+                        &opts->latency_probe_interval)) {
+                    return false;
+                }
+                opts->latency_probe = true;
+                break;
             case OPT_POWER_OFF_ON_CLOSE:
                 opts->power_off_on_close = true;
                 break;
@@ -1430,6 +1976,28 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                     return false;
                 }
                 break;
+            case OPT_V4L2_PIXEL_FORMAT:
+                if (!parse_v4l2_pixel_format(optarg,
+                                             &opts->v4l2_pixel_format)) {
+                    return false;
+                }
+                break;
+            case OPT_V4L2_SIZE:
+                if (!parse_v4l2_size(optarg, &opts->v4l2_width,
+                                     &opts->v4l2_height)) {
+                    return false;
+                }
+                break;
+#endif
+#ifdef HAVE_SHM_SINK
+            case OPT_SHM_SINK:
+                if (optarg[0] != '/' || strchr(optarg + 1, '/')) {
+                    LOGE("Invalid shared memory name: %s (expected /name)",
+                         optarg);
+                    return false;
+                }
+                opts->shm_sink_name = optarg;
+                break;
 #endif
             default:
                 // getopt prints the error message on stderr
@@ -1451,13 +2019,26 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
         return false;
     }
 
+    bool has_frame_sink = false;
 #ifdef HAVE_V4L2
-    if (!opts->display && !opts->record_filename && !opts->v4l2_device) {
-        LOGE("-N/--no-display requires either screen recording (-r/--record)"
-             " or sink to v4l2loopback device (--v4l2-sink)");
+    has_frame_sink |= !!opts->v4l2_device;
+#endif
+#ifdef HAVE_SHM_SINK
+    has_frame_sink |= !!opts->shm_sink_name;
+#endif
+    if (!opts->display && !opts->record_filename && !opts->timelapse_filename
+            && !has_frame_sink) {
+#if defined(HAVE_V4L2) || defined(HAVE_SHM_SINK)
+        LOGE("-N/--no-display requires either screen recording (-r/--record"
+             " or --timelapse) or a frame sink (--v4l2-sink or --shm-sink)");
+#else
+        LOGE("-N/--no-display requires screen recording (-r/--record or "
+             "--timelapse)");
+#endif
         return false;
     }
 
+#ifdef HAVE_V4L2
     if (opts->v4l2_device && opts->lock_video_orientation
                              == SC_LOCK_VIDEO_ORIENTATION_UNLOCKED) {
         LOGI("Video orientation is locked for v4l2 sink. "
@@ -1469,13 +2050,28 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
         LOGE("V4L2 buffer value without V4L2 sink\n");
         return false;
     }
-#else
-    if (!opts->display && !opts->record_filename) {
-        LOGE("-N/--no-display requires screen recording (-r/--record)");
+
+    if (!opts->v4l2_device
+            && (opts->v4l2_pixel_format != SC_V4L2_PIXEL_FORMAT_YUV420
+                || opts->v4l2_width)) {
+        LOGE("V4L2 pixel format or size without V4L2 sink");
         return false;
     }
 #endif
 
+    if (opts->udp && opts->resume) {
+        // The video stream over UDP is not bound to the connection
+        LOGE("Could not resume the video stream over UDP");
+        return false;
+    }
+
+    if (opts->resume) {
+        // A single connection is resumed, and it is always initiated by the
+        // client, so that it does not wait for the device indefinitely
+        opts->multiplex = true;
+        opts->force_adb_forward = true;
+    }
+
     if ((opts->tunnel_host || opts->tunnel_port) && !opts->force_adb_forward) {
         LOGI("Tunnel host/port is set, "
              "--force-adb-forward automatically enabled.");
@@ -1497,6 +2093,24 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
         }
     }
 
+    if (opts->timelapse_filename) {
+        opts->timelapse_format = guess_record_format(opts->timelapse_filename);
+        if (!opts->timelapse_format) {
+            LOGE("No format specified for \"%s\" (expected .mp4 or .mkv)",
+                 opts->timelapse_filename);
+            return false;
+        }
+
+        if (!opts->timelapse_interval && !opts->timelapse_threshold) {
+            // capture one frame out of 60 by default
+            opts->timelapse_interval = 60;
+        }
+    } else if (opts->timelapse_interval || opts->timelapse_threshold) {
+        LOGE("Time-lapse interval or threshold specified without "
+             "--timelapse");
+        return false;
+    }
+
     if (!opts->control && opts->turn_screen_off) {
         LOGE("Could not request to turn screen off if control is disabled");
         return false;
@@ -1507,6 +2121,50 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
         return false;
     }
 
+    if (!opts->control && opts->latency_probe) {
+        LOGE("Could not probe latency if control is disabled");
+        return false;
+    }
+
+    if (!opts->control
+            && (opts->input_record_filename || opts->input_replay_filename)) {
+        LOGE("Could not record or replay input if control is disabled");
+        return false;
+    }
+
+    if (opts->adaptive_bit_rate) {
+        if (!opts->control) {
+            // The stream stats are sent through the control channel
+            LOGE("Could not adapt the bit-rate if control is disabled");
+            return false;
+        }
+
+        if (!opts->adaptive_bit_rate_max) {
+            if (opts->bit_rate < opts->adaptive_bit_rate_min) {
+                LOGE("The bit-rate (%" PRIu32 ") must not be lower than the "
+                     "minimal adaptive bit-rate (%" PRIu32 ")",
+                     opts->bit_rate, opts->adaptive_bit_rate_min);
+                return false;
+            }
+            opts->adaptive_bit_rate_max = opts->bit_rate;
+        }
+    }
+
+    if (!opts->control && (opts->keymap_filename || opts->keymap_profile)) {
+        LOGE("Could not use a keymap if control is disabled");
+        return false;
+    }
+
+    if (opts->input_record_filename && opts->input_replay_filename) {
+        LOGE("Incompatible options: --input-record and --input-replay");
+        return false;
+    }
+
+    if (opts->input_replay_speed != 1 && !opts->input_replay_filename) {
+        LOGE("Input replay speed specified without --input-replay");
+        return false;
+    }
+
     return true;
 }
 
@@ -69,7 +69,4 @@ sc_clock_update(struct sc_clock *clock, sc_tick system, sc_tick stream);
 sc_tick
 sc_clock_to_system_time(struct sc_clock *clock, sc_tick stream);
 
-int
-sc_msleep(long msec);
-
 #endif
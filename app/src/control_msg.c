@@ -88,6 +88,64 @@ to_fixed_point_16(float f) {
     return (uint16_t) u;
 }
 
+static void
+read_position(const uint8_t *buf, struct sc_position *position) {
+    position->point.x = (int32_t) buffer_read32be(&buf[0]);
+    position->point.y = (int32_t) buffer_read32be(&buf[4]);
+    position->screen_size.width = buffer_read16be(&buf[8]);
+    position->screen_size.height = buffer_read16be(&buf[10]);
+}
+
+static float
+from_fixed_point_16(uint16_t u) {
+    // 0xffff is the max value, it represents 1.0
+    return u == 0xffff ? 1.0f : u / 0x1p16f;
+}
+
+// s is not necessarily nul-terminated
+static bool
+text_init(struct control_msg_text *text, const char *s, size_t len) {
+    char *dst;
+    if (len <= CONTROL_MSG_TEXT_INLINE_MAX_LENGTH) {
+        dst = text->inline_text;
+        text->heap = NULL;
+    } else {
+        dst = malloc(len + 1);
+        if (!dst) {
+            LOG_OOM();
+            return false;
+        }
+        text->heap = dst;
+        text->inline_text[0] = '\0';
+    }
+
+    memcpy(dst, s, len);
+    dst[len] = '\0';
+    return true;
+}
+
+bool
+control_msg_text_init(struct control_msg_text *text, const char *s) {
+    return text_init(text, s, strlen(s));
+}
+
+// read length (4 bytes) + string (non nul-terminated)
+// return the number of bytes consumed (0 for not available, -1 on error)
+static ssize_t
+read_text(const unsigned char *buf, size_t len, struct control_msg_text *text) {
+    if (len < 4) {
+        return 0;
+    }
+    size_t text_len = buffer_read32be(buf);
+    if (text_len > len - 4) {
+        return 0;
+    }
+    if (!text_init(text, (const char *) &buf[4], text_len)) {
+        return -1;
+    }
+    return 4 + text_len;
+}
+
 size_t
 control_msg_serialize(const struct control_msg *msg, unsigned char *buf) {
     buf[0] = msg->type;
@@ -99,9 +157,9 @@ control_msg_serialize(const struct control_msg *msg, unsigned char *buf) {
             buffer_write32be(&buf[10], msg->inject_keycode.metastate);
             return 14;
         case CONTROL_MSG_TYPE_INJECT_TEXT: {
-            size_t len =
-                write_string(msg->inject_text.text,
-                             CONTROL_MSG_INJECT_TEXT_MAX_LENGTH, &buf[1]);
+            const char *text = control_msg_text_get(&msg->inject_text.text);
+            size_t len = write_string(text, CONTROL_MSG_INJECT_TEXT_MAX_LENGTH,
+                                      &buf[1]);
             return 1 + len;
         }
         case CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT:
@@ -129,7 +187,8 @@ control_msg_serialize(const struct control_msg *msg, unsigned char *buf) {
         case CONTROL_MSG_TYPE_SET_CLIPBOARD: {
             buffer_write64be(&buf[1], msg->set_clipboard.sequence);
             buf[9] = !!msg->set_clipboard.paste;
-            size_t len = write_string(msg->set_clipboard.text,
+            const char *text = control_msg_text_get(&msg->set_clipboard.text);
+            size_t len = write_string(text,
                                       CONTROL_MSG_CLIPBOARD_TEXT_MAX_LENGTH,
                                       &buf[10]);
             return 10 + len;
@@ -137,10 +196,24 @@ control_msg_serialize(const struct control_msg *msg, unsigned char *buf) {
         case CONTROL_MSG_TYPE_SET_SCREEN_POWER_MODE:
             buf[1] = msg->set_screen_power_mode.mode;
             return 2;
+        case CONTROL_MSG_TYPE_PING:
+            buffer_write64be(&buf[1], msg->ping.timestamp);
+            return 9;
+        case CONTROL_MSG_TYPE_STREAM_STATS:
+            buffer_write32be(&buf[1], msg->stream_stats.throughput);
+            buffer_write32be(&buf[5], msg->stream_stats.queue_delay);
+            buffer_write32be(&buf[9], msg->stream_stats.jitter);
+            buffer_write16be(&buf[13], msg->stream_stats.skipped_frames);
+            return 15;
+        case CONTROL_MSG_TYPE_SET_VIDEO_SETTINGS:
+            buffer_write16be(&buf[1], msg->set_video_settings.max_size);
+            buffer_write16be(&buf[3], msg->set_video_settings.max_fps);
+            return 5;
         case CONTROL_MSG_TYPE_EXPAND_NOTIFICATION_PANEL:
         case CONTROL_MSG_TYPE_EXPAND_SETTINGS_PANEL:
         case CONTROL_MSG_TYPE_COLLAPSE_PANELS:
         case CONTROL_MSG_TYPE_ROTATE_DEVICE:
+        case CONTROL_MSG_TYPE_REQUEST_KEY_FRAME:
             // no additional data
             return 1;
         default:
@@ -149,6 +222,111 @@ control_msg_serialize(const struct control_msg *msg, unsigned char *buf) {
     }
 }
 
+ssize_t
+control_msg_deserialize(const unsigned char *buf, size_t len,
+                        struct control_msg *msg) {
+    if (!len) {
+        return 0; // not available
+    }
+
+    msg->type = buf[0];
+    switch (msg->type) {
+        case CONTROL_MSG_TYPE_INJECT_KEYCODE:
+            if (len < 14) {
+                return 0;
+            }
+            msg->inject_keycode.action = buf[1];
+            msg->inject_keycode.keycode = buffer_read32be(&buf[2]);
+            msg->inject_keycode.repeat = buffer_read32be(&buf[6]);
+            msg->inject_keycode.metastate = buffer_read32be(&buf[10]);
+            return 14;
+        case CONTROL_MSG_TYPE_INJECT_TEXT: {
+            ssize_t r = read_text(&buf[1], len - 1, &msg->inject_text.text);
+            return r > 0 ? 1 + r : r;
+        }
+        case CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT:
+            if (len < 28) {
+                return 0;
+            }
+            msg->inject_touch_event.action = buf[1];
+            msg->inject_touch_event.pointer_id = buffer_read64be(&buf[2]);
+            read_position(&buf[10], &msg->inject_touch_event.position);
+            msg->inject_touch_event.pressure =
+                from_fixed_point_16(buffer_read16be(&buf[22]));
+            msg->inject_touch_event.buttons = buffer_read32be(&buf[24]);
+            return 28;
+        case CONTROL_MSG_TYPE_INJECT_SCROLL_EVENT:
+            if (len < 21) {
+                return 0;
+            }
+            read_position(&buf[1], &msg->inject_scroll_event.position);
+            msg->inject_scroll_event.hscroll =
+                (int32_t) buffer_read32be(&buf[13]);
+            msg->inject_scroll_event.vscroll =
+                (int32_t) buffer_read32be(&buf[17]);
+            return 21;
+        case CONTROL_MSG_TYPE_BACK_OR_SCREEN_ON:
+            if (len < 2) {
+                return 0;
+            }
+            msg->back_or_screen_on.action = buf[1];
+            return 2;
+        case CONTROL_MSG_TYPE_GET_CLIPBOARD:
+            if (len < 2) {
+                return 0;
+            }
+            msg->get_clipboard.copy_key = buf[1];
+            return 2;
+        case CONTROL_MSG_TYPE_SET_CLIPBOARD: {
+            if (len < 10) {
+                return 0;
+            }
+            msg->set_clipboard.sequence = buffer_read64be(&buf[1]);
+            msg->set_clipboard.paste = !!buf[9];
+            ssize_t r = read_text(&buf[10], len - 10, &msg->set_clipboard.text);
+            return r > 0 ? 10 + r : r;
+        }
+        case CONTROL_MSG_TYPE_SET_SCREEN_POWER_MODE:
+            if (len < 2) {
+                return 0;
+            }
+            msg->set_screen_power_mode.mode = buf[1];
+            return 2;
+        case CONTROL_MSG_TYPE_PING:
+            if (len < 9) {
+                return 0;
+            }
+            msg->ping.timestamp = buffer_read64be(&buf[1]);
+            return 9;
+        case CONTROL_MSG_TYPE_STREAM_STATS:
+            if (len < 15) {
+                return 0;
+            }
+            msg->stream_stats.throughput = buffer_read32be(&buf[1]);
+            msg->stream_stats.queue_delay = buffer_read32be(&buf[5]);
+            msg->stream_stats.jitter = buffer_read32be(&buf[9]);
+            msg->stream_stats.skipped_frames = buffer_read16be(&buf[13]);
+            return 15;
+        case CONTROL_MSG_TYPE_SET_VIDEO_SETTINGS:
+            if (len < 5) {
+                return 0;
+            }
+            msg->set_video_settings.max_size = buffer_read16be(&buf[1]);
+            msg->set_video_settings.max_fps = buffer_read16be(&buf[3]);
+            return 5;
+        case CONTROL_MSG_TYPE_EXPAND_NOTIFICATION_PANEL:
+        case CONTROL_MSG_TYPE_EXPAND_SETTINGS_PANEL:
+        case CONTROL_MSG_TYPE_COLLAPSE_PANELS:
+        case CONTROL_MSG_TYPE_ROTATE_DEVICE:
+        case CONTROL_MSG_TYPE_REQUEST_KEY_FRAME:
+            // no additional data
+            return 1;
+        default:
+            LOGW("Unknown message type: %u", (unsigned) msg->type);
+            return -1; // error, we cannot recover
+    }
+}
+
 void
 control_msg_log(const struct control_msg *msg) {
 #define LOG_CMSG(fmt, ...) LOGV("input: " fmt, ## __VA_ARGS__)
@@ -161,7 +339,8 @@ control_msg_log(const struct control_msg *msg) {
                      (long) msg->inject_keycode.metastate);
             break;
         case CONTROL_MSG_TYPE_INJECT_TEXT:
-            LOG_CMSG("text \"%s\"", msg->inject_text.text);
+            LOG_CMSG("text \"%s\"",
+                     control_msg_text_get(&msg->inject_text.text));
             break;
         case CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT: {
             int action = msg->inject_touch_event.action
@@ -210,7 +389,7 @@ control_msg_log(const struct control_msg *msg) {
             LOG_CMSG("clipboard %" PRIu64_ " %s \"%s\"",
                      msg->set_clipboard.sequence,
                      msg->set_clipboard.paste ? "paste" : "nopaste",
-                     msg->set_clipboard.text);
+                     control_msg_text_get(&msg->set_clipboard.text));
             break;
         case CONTROL_MSG_TYPE_SET_SCREEN_POWER_MODE:
             LOG_CMSG("power mode %s",
@@ -228,6 +407,24 @@ control_msg_log(const struct control_msg *msg) {
         case CONTROL_MSG_TYPE_ROTATE_DEVICE:
             LOG_CMSG("rotate device");
             break;
+        case CONTROL_MSG_TYPE_PING:
+            LOG_CMSG("ping %" PRIu64_, msg->ping.timestamp);
+            break;
+        case CONTROL_MSG_TYPE_STREAM_STATS:
+            LOG_CMSG("stream stats throughput=%" PRIu32 " queue_delay=%" PRIu32
+                     " jitter=%" PRIu32 " skipped=%" PRIu16,
+                     msg->stream_stats.throughput,
+                     msg->stream_stats.queue_delay, msg->stream_stats.jitter,
+                     msg->stream_stats.skipped_frames);
+            break;
+        case CONTROL_MSG_TYPE_SET_VIDEO_SETTINGS:
+            LOG_CMSG("video settings max_size=%" PRIu16 " max_fps=%" PRIu16,
+                     msg->set_video_settings.max_size,
+                     msg->set_video_settings.max_fps);
+            break;
+        case CONTROL_MSG_TYPE_REQUEST_KEY_FRAME:
+            LOG_CMSG("request key frame");
+            break;
         default:
             LOG_CMSG("unknown type: %u", (unsigned) msg->type);
             break;
@@ -238,10 +435,10 @@ void
 control_msg_destroy(struct control_msg *msg) {
     switch (msg->type) {
         case CONTROL_MSG_TYPE_INJECT_TEXT:
-            free(msg->inject_text.text);
+            free(msg->inject_text.text.heap);
             break;
         case CONTROL_MSG_TYPE_SET_CLIPBOARD:
-            free(msg->set_clipboard.text);
+            free(msg->set_clipboard.text.heap);
             break;
         default:
             // do nothing
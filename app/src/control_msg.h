@@ -6,6 +6,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <unistd.h>
 
 #include "android/input.h"
 #include "android/keycodes.h"
@@ -16,6 +17,8 @@
 #define CONTROL_MSG_INJECT_TEXT_MAX_LENGTH 300
 // type: 1 byte; paste flag: 1 byte; length: 4 bytes
 #define CONTROL_MSG_CLIPBOARD_TEXT_MAX_LENGTH (CONTROL_MSG_MAX_SIZE - 6)
+// texts up to this length are stored inline, without any allocation
+#define CONTROL_MSG_TEXT_INLINE_MAX_LENGTH CONTROL_MSG_INJECT_TEXT_MAX_LENGTH
 
 #define POINTER_ID_MOUSE UINT64_C(-1)
 #define POINTER_ID_VIRTUAL_FINGER UINT64_C(-2)
@@ -33,6 +36,10 @@ enum control_msg_type {
     CONTROL_MSG_TYPE_SET_CLIPBOARD,
     CONTROL_MSG_TYPE_SET_SCREEN_POWER_MODE,
     CONTROL_MSG_TYPE_ROTATE_DEVICE,
+    CONTROL_MSG_TYPE_PING,
+    CONTROL_MSG_TYPE_STREAM_STATS,
+    CONTROL_MSG_TYPE_SET_VIDEO_SETTINGS,
+    CONTROL_MSG_TYPE_REQUEST_KEY_FRAME,
 };
 
 enum screen_power_mode {
@@ -47,6 +54,12 @@ enum get_clipboard_copy_key {
     GET_CLIPBOARD_COPY_KEY_CUT,
 };
 
+// A text stored inline if it is short enough, on the heap otherwise
+struct control_msg_text {
+    char *heap; // owned, to be freed by free(), NULL if the text is inline
+    char inline_text[CONTROL_MSG_TEXT_INLINE_MAX_LENGTH + 1];
+};
+
 struct control_msg {
     enum control_msg_type type;
     union {
@@ -57,7 +70,7 @@ struct control_msg {
             enum android_metastate metastate;
         } inject_keycode;
         struct {
-            char *text; // owned, to be freed by free()
+            struct control_msg_text text;
         } inject_text;
         struct {
             enum android_motionevent_action action;
@@ -80,20 +93,51 @@ struct control_msg {
         } get_clipboard;
         struct {
             uint64_t sequence;
-            char *text; // owned, to be freed by free()
+            struct control_msg_text text;
             bool paste;
         } set_clipboard;
         struct {
             enum screen_power_mode mode;
         } set_screen_power_mode;
+        struct {
+            uint64_t timestamp; // echoed back by the device in a pong
+        } ping;
+        struct {
+            uint32_t throughput; // in bytes per second
+            uint32_t queue_delay; // in microseconds
+            uint32_t jitter; // in microseconds
+            uint16_t skipped_frames; // since the previous stats
+        } stream_stats;
+        struct {
+            uint16_t max_size; // 0 for the device size
+            uint16_t max_fps; // 0 for unlimited
+        } set_video_settings;
     };
 };
 
+// Copy text into a control message text
+//
+// The text is stored inline if it fits, so no allocation occurs for short
+// texts (typically typed characters).
+bool
+control_msg_text_init(struct control_msg_text *text, const char *s);
+
+static inline const char *
+control_msg_text_get(const struct control_msg_text *text) {
+    return text->heap ? text->heap : text->inline_text;
+}
+
 // buf size must be at least CONTROL_MSG_MAX_SIZE
 // return the number of bytes written
 size_t
 control_msg_serialize(const struct control_msg *msg, unsigned char *buf);
 
+// Inverse of control_msg_serialize() (used to replay recorded messages)
+// return the number of bytes consumed (0 for no msg available, -1 on error)
+ssize_t
+control_msg_deserialize(const unsigned char *buf, size_t len,
+                        struct control_msg *msg);
+
 void
 control_msg_log(const struct control_msg *msg);
 
@@ -1,22 +1,46 @@
 #include "controller.h"
 
 #include <assert.h>
+#include <inttypes.h>
+#include <stdlib.h>
 
 #include "util/log.h"
 
+// Serialized messages are sent once the batch exceeds this size (or once all
+// the pending messages are serialized)
+#define CONTROLLER_SEND_THRESHOLD (1 << 16) // 64k
+// A message may be serialized as long as the batch is below the threshold
+#define CONTROLLER_SEND_BUFFER_SIZE \
+    (CONTROLLER_SEND_THRESHOLD + CONTROL_MSG_MAX_SIZE)
+
+#define CONTROLLER_TIMER_RESOLUTION SC_TICK_FROM_MS(1)
+
+static struct controller_scheduled_msg *
+to_scheduled_msg(struct sc_timer_wheel_entry *entry) {
+    return container_of(entry, struct controller_scheduled_msg, entry);
+}
+
 bool
 controller_init(struct controller *controller, sc_socket control_socket,
                 struct sc_acksync *acksync) {
     cbuf_init(&controller->queue);
 
+    controller->send_buffer = malloc(CONTROLLER_SEND_BUFFER_SIZE);
+    if (!controller->send_buffer) {
+        LOG_OOM();
+        return false;
+    }
+
     bool ok = receiver_init(&controller->receiver, control_socket, acksync);
     if (!ok) {
+        free(controller->send_buffer);
         return false;
     }
 
     ok = sc_mutex_init(&controller->mutex);
     if (!ok) {
         receiver_destroy(&controller->receiver);
+        free(controller->send_buffer);
         return false;
     }
 
@@ -24,11 +48,32 @@ controller_init(struct controller *controller, sc_socket control_socket,
     if (!ok) {
         receiver_destroy(&controller->receiver);
         sc_mutex_destroy(&controller->mutex);
+        free(controller->send_buffer);
         return false;
     }
 
+    sc_timer_wheel_init(&controller->timer_wheel, CONTROLLER_TIMER_RESOLUTION,
+                        sc_tick_now());
+    controller->free_scheduled = NULL;
+    for (int i = CONTROLLER_SCHEDULED_CAPACITY - 1; i >= 0; --i) {
+        struct controller_scheduled_msg *scheduled = &controller->scheduled[i];
+        scheduled->pending = false;
+        scheduled->entry.next = controller->free_scheduled ?
+                                &controller->free_scheduled->entry : NULL;
+        controller->free_scheduled = scheduled;
+    }
+    for (unsigned i = 0; i < CONTROLLER_MAX_POINTER_HOLDS; ++i) {
+        controller->holds[i].deadline = 0;
+        controller->holds[i].last = NULL;
+    }
+
     controller->control_socket = control_socket;
+    controller->mux = NULL;
+    controller->input_recorder = NULL;
     controller->stopped = false;
+    controller->next_seq = 0;
+    controller->msg_count = 0;
+    controller->send_count = 0;
 
     return true;
 }
@@ -38,73 +83,396 @@ controller_destroy(struct controller *controller) {
     sc_cond_destroy(&controller->msg_cond);
     sc_mutex_destroy(&controller->mutex);
 
-    struct control_msg msg;
-    while (cbuf_take(&controller->queue, &msg)) {
-        control_msg_destroy(&msg);
+    struct controller_msg cmsg;
+    while (cbuf_take(&controller->queue, &cmsg)) {
+        control_msg_destroy(&cmsg.msg);
+    }
+
+    for (unsigned i = 0; i < CONTROLLER_SCHEDULED_CAPACITY; ++i) {
+        if (controller->scheduled[i].pending) {
+            control_msg_destroy(&controller->scheduled[i].msg.msg);
+        }
     }
 
     receiver_destroy(&controller->receiver);
+    free(controller->send_buffer);
 }
 
-bool
-controller_push_msg(struct controller *controller,
-                    const struct control_msg *msg) {
-    if (sc_get_log_level() <= SC_LOG_LEVEL_VERBOSE) {
-        control_msg_log(msg);
+// The pings, the stream stats, the video settings and the key frame requests
+// describe the session, they are not input
+static bool
+is_input(const struct control_msg *msg) {
+    return msg->type != CONTROL_MSG_TYPE_PING
+        && msg->type != CONTROL_MSG_TYPE_STREAM_STATS
+        && msg->type != CONTROL_MSG_TYPE_SET_VIDEO_SETTINGS
+        && msg->type != CONTROL_MSG_TYPE_REQUEST_KEY_FRAME;
+}
+
+static bool
+is_touch_move(const struct control_msg *msg) {
+    return msg->type == CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT
+        && msg->inject_touch_event.action == AMOTION_EVENT_ACTION_MOVE;
+}
+
+// Replace the pending MOVE event of the same pointer (if any) by msg.
+//
+// Only the MOVE events at the end of the queue are considered: the search
+// stops at the first other message, so that a MOVE event is never reordered
+// with a DOWN, an UP or any non-motion message. Reordering MOVE events of
+// different pointers is harmless.
+static bool
+coalesce_touch_move(struct control_msg_queue *queue,
+                    const struct control_msg *msg, uint64_t seq) {
+    assert(is_touch_move(msg));
+
+    size_t size = cbuf_size_(queue);
+    size_t i = queue->head;
+    while (i != queue->tail) {
+        i = (i + size - 1) % size;
+        struct controller_msg *queued = &queue->data[i];
+        if (!is_touch_move(&queued->msg)) {
+            return false;
+        }
+        if (queued->msg.inject_touch_event.pointer_id
+                == msg->inject_touch_event.pointer_id) {
+            // Keep only the latest position (it must not be sent before the
+            // scheduled events of the pointer pushed before it)
+            queued->msg = *msg;
+            queued->seq = seq;
+            return true;
+        }
     }
 
+    return false;
+}
+
+void
+controller_set_input_recorder(struct controller *controller,
+                              struct sc_input_recorder *recorder) {
     sc_mutex_lock(&controller->mutex);
+    controller->input_recorder = recorder;
+    sc_mutex_unlock(&controller->mutex);
+}
+
+static bool
+is_touch_event(const struct control_msg *msg) {
+    return msg->type == CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT;
+}
+
+// Return the hold of the pointer, or NULL if the pointer is not held
+static struct controller_pointer_hold *
+find_hold(struct controller *controller, uint64_t pointer_id, sc_tick now) {
+    for (unsigned i = 0; i < CONTROLLER_MAX_POINTER_HOLDS; ++i) {
+        struct controller_pointer_hold *hold = &controller->holds[i];
+        if (hold->deadline > now && hold->pointer_id == pointer_id) {
+            return hold;
+        }
+    }
+    return NULL;
+}
+
+static struct controller_pointer_hold *
+get_hold(struct controller *controller, uint64_t pointer_id, sc_tick now) {
+    struct controller_pointer_hold *hold =
+        find_hold(controller, pointer_id, now);
+    if (hold) {
+        return hold;
+    }
+
+    // Reuse an expired hold, or else the one expiring first
+    struct controller_pointer_hold *earliest = &controller->holds[0];
+    for (unsigned i = 0; i < CONTROLLER_MAX_POINTER_HOLDS; ++i) {
+        hold = &controller->holds[i];
+        if (hold->deadline < earliest->deadline) {
+            earliest = hold;
+        }
+    }
+
+    earliest->pointer_id = pointer_id;
+    earliest->deadline = 0;
+    earliest->last = NULL;
+    return earliest;
+}
+
+static bool
+push_msg_locked(struct controller *controller, const struct control_msg *msg) {
+    if (controller->input_recorder && is_input(msg)) {
+        // record before coalescing, to keep the exact stream of messages
+        sc_input_recorder_push(controller->input_recorder, msg);
+    }
+
+    uint64_t seq = controller->next_seq++;
+    if (is_touch_move(msg)
+            && coalesce_touch_move(&controller->queue, msg, seq)) {
+        // The queue was not empty, the controller thread is already notified
+        return true;
+    }
+
     bool was_empty = cbuf_is_empty(&controller->queue);
-    bool res = cbuf_push(&controller->queue, *msg);
+    struct controller_msg cmsg = {
+        .msg = *msg,
+        .seq = seq,
+    };
+    bool res = cbuf_push(&controller->queue, cmsg);
     if (was_empty) {
         sc_cond_signal(&controller->msg_cond);
     }
-    sc_mutex_unlock(&controller->mutex);
     return res;
 }
 
 static bool
-process_msg(struct controller *controller, const struct control_msg *msg) {
-    static unsigned char serialized_msg[CONTROL_MSG_MAX_SIZE];
-    size_t length = control_msg_serialize(msg, serialized_msg);
-    if (!length) {
+schedule_msg_locked(struct controller *controller,
+                    const struct control_msg *msg, sc_tick deadline,
+                    struct controller_pointer_hold *hold) {
+    uint64_t seq = controller->next_seq++;
+
+    struct controller_scheduled_msg *last = hold ? hold->last : NULL;
+    if (last && last->pending && is_touch_move(msg)
+            && is_touch_move(&last->msg.msg)
+            && last->msg.msg.inject_touch_event.pointer_id
+                    == msg->inject_touch_event.pointer_id
+            && last->entry.deadline == deadline) {
+        // Keep only the latest position
+        last->msg.msg = *msg;
+        last->msg.seq = seq;
+        return true;
+    }
+
+    struct controller_scheduled_msg *scheduled = controller->free_scheduled;
+    if (!scheduled) {
         return false;
     }
-    ssize_t w =
-        net_send_all(controller->control_socket, serialized_msg, length);
+    controller->free_scheduled = scheduled->entry.next
+                               ? to_scheduled_msg(scheduled->entry.next)
+                               : NULL;
+
+    scheduled->msg.msg = *msg;
+    scheduled->msg.seq = seq;
+    scheduled->pending = true;
+    sc_timer_wheel_add(&controller->timer_wheel, &scheduled->entry, deadline);
+
+    if (hold) {
+        hold->deadline = deadline;
+        hold->last = scheduled;
+    }
+
+    // The controller thread must wait for the new deadline
+    sc_cond_signal(&controller->msg_cond);
+    return true;
+}
+
+bool
+controller_push_msg_at(struct controller *controller,
+                       const struct control_msg *msg, sc_tick deadline) {
+    if (sc_get_log_level() <= SC_LOG_LEVEL_VERBOSE) {
+        control_msg_log(msg);
+    }
+
+    sc_tick now = sc_tick_now();
+
+    sc_mutex_lock(&controller->mutex);
+
+    struct controller_pointer_hold *hold = NULL;
+    if (is_touch_event(msg)) {
+        uint64_t pointer_id = msg->inject_touch_event.pointer_id;
+        hold = find_hold(controller, pointer_id, now);
+        if (hold && hold->deadline > deadline) {
+            // Do not send it before the previous events of the pointer
+            deadline = hold->deadline;
+        } else if (deadline > now) {
+            hold = get_hold(controller, pointer_id, now);
+        }
+    }
+
+    bool res = deadline > now
+             ? schedule_msg_locked(controller, msg, deadline, hold)
+             : push_msg_locked(controller, msg);
+    sc_mutex_unlock(&controller->mutex);
+    return res;
+}
+
+bool
+controller_push_msg(struct controller *controller,
+                    const struct control_msg *msg) {
+    return controller_push_msg_at(controller, msg, 0);
+}
+
+void
+controller_hold_pointer(struct controller *controller, uint64_t pointer_id,
+                        sc_tick deadline) {
+    sc_tick now = sc_tick_now();
+
+    sc_mutex_lock(&controller->mutex);
+    struct controller_pointer_hold *hold =
+        get_hold(controller, pointer_id, now);
+    if (deadline > hold->deadline) {
+        hold->deadline = deadline;
+        // The next MOVE event must not be coalesced with a previous one
+        hold->last = NULL;
+    }
+    sc_mutex_unlock(&controller->mutex);
+}
+
+static bool
+send_buffer(struct controller *controller, size_t length) {
+    ssize_t w = controller->mux
+        ? sc_mux_send_all(controller->mux, SC_MUX_CHANNEL_CONTROL,
+                          controller->send_buffer, length)
+        : net_send_all(controller->control_socket, controller->send_buffer,
+                       length);
+    ++controller->send_count;
     return (size_t) w == length;
 }
 
+static bool
+process_msgs(struct controller *controller, const struct controller_msg *msgs,
+             size_t count) {
+    size_t length = 0;
+    for (size_t i = 0; i < count; ++i) {
+        // There is always room for CONTROL_MSG_MAX_SIZE bytes
+        assert(length <= CONTROLLER_SEND_THRESHOLD);
+        size_t len = control_msg_serialize(&msgs[i].msg,
+                                           &controller->send_buffer[length]);
+        if (!len) {
+            return false;
+        }
+        length += len;
+
+        if (length > CONTROLLER_SEND_THRESHOLD) {
+            if (!send_buffer(controller, length)) {
+                return false;
+            }
+            length = 0;
+        }
+    }
+
+    controller->msg_count += count;
+
+    return !length || send_buffer(controller, length);
+}
+
+// Sort the msgs in the order they were pushed.
+//
+// The pending msgs are (almost) sorted already, and there are few expired
+// scheduled msgs, so an insertion sort is appropriate.
+static void
+sort_msgs(struct controller_msg *msgs, size_t count) {
+    for (size_t i = 1; i < count; ++i) {
+        struct controller_msg cmsg = msgs[i];
+        size_t j = i;
+        while (j && msgs[j - 1].seq > cmsg.seq) {
+            msgs[j] = msgs[j - 1];
+            --j;
+        }
+        msgs[j] = cmsg;
+    }
+}
+
+// Take the expired scheduled msgs and the pending msgs, in the order they
+// were pushed.
+//
+// If the controller thread was blocked past a deadline (e.g. the socket is
+// congested), both may be present, and the scheduled msgs must not be sent
+// before the msgs pushed earlier (e.g. an UP before its DOWN).
+static size_t
+take_msgs(struct controller *controller, struct controller_msg *msgs) {
+    size_t count = 0;
+
+    struct sc_timer_wheel_entry *entry =
+        sc_timer_wheel_expire(&controller->timer_wheel, sc_tick_now());
+    while (entry) {
+        struct controller_scheduled_msg *scheduled = to_scheduled_msg(entry);
+        entry = entry->next;
+
+        if (controller->input_recorder) {
+            // record when the msg is actually sent, to keep its timing
+            sc_input_recorder_push(controller->input_recorder,
+                                   &scheduled->msg.msg);
+        }
+        msgs[count++] = scheduled->msg;
+        scheduled->pending = false;
+        scheduled->entry.next = controller->free_scheduled
+                              ? &controller->free_scheduled->entry : NULL;
+        controller->free_scheduled = scheduled;
+    }
+
+    while (cbuf_take(&controller->queue, &msgs[count])) {
+        ++count;
+    }
+
+    assert(count <= CONTROLLER_QUEUE_SIZE + CONTROLLER_SCHEDULED_CAPACITY);
+    sort_msgs(msgs, count);
+    return count;
+}
+
 static int
 run_controller(void *data) {
     struct controller *controller = data;
 
+    struct controller_msg msgs[CONTROLLER_QUEUE_SIZE
+                               + CONTROLLER_SCHEDULED_CAPACITY];
+
     for (;;) {
         sc_mutex_lock(&controller->mutex);
-        while (!controller->stopped && cbuf_is_empty(&controller->queue)) {
-            sc_cond_wait(&controller->msg_cond, &controller->mutex);
+        size_t count = 0;
+        for (;;) {
+            if (controller->stopped) {
+                break;
+            }
+            // Take all the pending msgs, to send them at once
+            count = take_msgs(controller, msgs);
+            if (count) {
+                break;
+            }
+
+            sc_tick deadline;
+            if (sc_timer_wheel_next_deadline(&controller->timer_wheel,
+                                             &deadline)) {
+                sc_cond_timedwait(&controller->msg_cond, &controller->mutex,
+                                  deadline);
+            } else {
+                sc_cond_wait(&controller->msg_cond, &controller->mutex);
+            }
+        }
+        // The input records are written by this thread, without the mutex
+        // locked, so that pushing a msg never waits for the file
+        struct sc_input_recorder *recorder = controller->input_recorder;
+        if (recorder) {
+            sc_input_recorder_take(recorder);
+        }
+        bool stopped = controller->stopped;
+        sc_mutex_unlock(&controller->mutex);
+
+        if (recorder) {
+            sc_input_recorder_flush(recorder);
         }
-        if (controller->stopped) {
+        if (stopped) {
             // stop immediately, do not process further msgs
-            sc_mutex_unlock(&controller->mutex);
             break;
         }
-        struct control_msg msg;
-        bool non_empty = cbuf_take(&controller->queue, &msg);
-        assert(non_empty);
-        (void) non_empty;
-        sc_mutex_unlock(&controller->mutex);
 
-        bool ok = process_msg(controller, &msg);
-        control_msg_destroy(&msg);
+        bool ok = process_msgs(controller, msgs, count);
+        for (size_t i = 0; i < count; ++i) {
+            control_msg_destroy(&msgs[i].msg);
+        }
         if (!ok) {
             LOGD("Could not write msg to socket");
             break;
         }
     }
+
+    LOGD("Controller: %" PRIu64_ " msgs sent in %" PRIu64_ " writes",
+         controller->msg_count, controller->send_count);
+
     return 0;
 }
 
+void
+controller_set_mux(struct controller *controller, struct sc_mux *mux) {
+    controller->mux = mux;
+    controller->receiver.mux = mux;
+}
+
 bool
 controller_start(struct controller *controller) {
     LOGD("Starting controller thread");
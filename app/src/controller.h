@@ -4,24 +4,73 @@
 #include "common.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "control_msg.h"
+#include "input_record.h"
+#include "mux.h"
 #include "receiver.h"
 #include "util/acksync.h"
 #include "util/cbuf.h"
 #include "util/net.h"
 #include "util/thread.h"
+#include "util/tick.h"
+#include "util/timer_wheel.h"
 
-struct control_msg_queue CBUF(struct control_msg, 64);
+#define CONTROLLER_QUEUE_SIZE 64
+#define CONTROLLER_SCHEDULED_CAPACITY 64
+#define CONTROLLER_MAX_POINTER_HOLDS 16
+
+struct controller_msg {
+    struct control_msg msg;
+    // The order in which the messages were pushed, to send the pending and the
+    // expired scheduled messages in a single order
+    uint64_t seq;
+};
+
+struct control_msg_queue CBUF(struct controller_msg, CONTROLLER_QUEUE_SIZE);
+
+struct controller_scheduled_msg {
+    struct sc_timer_wheel_entry entry;
+    struct controller_msg msg;
+    bool pending;
+};
+
+// The touch events of a pointer must not be sent before the deadline
+struct controller_pointer_hold {
+    uint64_t pointer_id;
+    sc_tick deadline;
+    // The last message scheduled for this pointer, to coalesce MOVE events
+    struct controller_scheduled_msg *last;
+};
 
 struct controller {
     sc_socket control_socket;
+    struct sc_mux *mux; // if set, the socket is multiplexed
     sc_thread thread;
     sc_mutex mutex;
     sc_cond msg_cond;
     bool stopped;
     struct control_msg_queue queue;
     struct receiver receiver;
+
+    // Messages to be sent later, expired by the controller thread (protected
+    // by the mutex)
+    struct sc_timer_wheel timer_wheel;
+    struct controller_scheduled_msg scheduled[CONTROLLER_SCHEDULED_CAPACITY];
+    struct controller_scheduled_msg *free_scheduled; // linked by entry.next
+    struct controller_pointer_hold holds[CONTROLLER_MAX_POINTER_HOLDS];
+    uint64_t next_seq; // protected by the mutex
+
+    // Pending messages are serialized back to back, and sent at once
+    unsigned char *send_buffer;
+
+    // If set, the pushed messages are recorded (protected by the mutex)
+    struct sc_input_recorder *input_recorder;
+
+    // Statistics, only accessed from the controller thread
+    uint64_t msg_count;
+    uint64_t send_count;
 };
 
 bool
@@ -31,6 +80,21 @@ controller_init(struct controller *controller, sc_socket control_socket,
 void
 controller_destroy(struct controller *controller);
 
+// Record all the messages pushed from now on (except pings)
+// Pass NULL to stop recording.
+//
+// The records are written to the file by the controller thread, so the
+// recorder must not be closed before the controller is joined.
+void
+controller_set_input_recorder(struct controller *controller,
+                              struct sc_input_recorder *recorder);
+
+// Send and receive the control messages on the control channel of a
+// multiplexed socket
+// Must be called before controller_start().
+void
+controller_set_mux(struct controller *controller, struct sc_mux *mux);
+
 bool
 controller_start(struct controller *controller);
 
@@ -40,8 +104,26 @@ controller_stop(struct controller *controller);
 void
 controller_join(struct controller *controller);
 
+// Consecutive MOVE events of the same pointer are merged while they are
+// pending, so that a fast input device does not fill the queue
 bool
 controller_push_msg(struct controller *controller,
                     const struct control_msg *msg);
 
+// Push a message to be sent at `deadline` (on the sc_tick_now() clock), without
+// blocking the caller.
+//
+// The touch events of the same pointer are never reordered: a touch event is
+// not sent before the touch events of the same pointer pushed before it.
+bool
+controller_push_msg_at(struct controller *controller,
+                       const struct control_msg *msg, sc_tick deadline);
+
+// Delay the touch events of the pointer pushed from now on until `deadline`,
+// for example to leave time to the device between a DOWN and a MOVE event
+// (this replaces a sleep on the caller thread).
+void
+controller_hold_pointer(struct controller *controller, uint64_t pointer_id,
+                        sc_tick deadline);
+
 #endif
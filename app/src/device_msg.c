@@ -40,6 +40,13 @@ device_msg_deserialize(const unsigned char *buf, size_t len,
             msg->ack_clipboard.sequence = sequence;
             return 9;
         }
+        case DEVICE_MSG_TYPE_PONG: {
+            if (len < 9) {
+                return 0; // not available
+            }
+            msg->pong.timestamp = buffer_read64be(&buf[1]);
+            return 9;
+        }
         default:
             LOGW("Unknown device message type: %d", (int) msg->type);
             return -1; // error, we cannot recover
@@ -21,6 +21,7 @@ fps_counter_init(struct fps_counter *counter) {
 
     counter->thread_started = false;
     atomic_init(&counter->started, 0);
+    atomic_init(&counter->skipped_total, 0);
     // no need to initialize the other fields, they are unused until started
 
     return true;
@@ -170,6 +171,9 @@ fps_counter_add_rendered_frame(struct fps_counter *counter) {
 
 void
 fps_counter_add_skipped_frame(struct fps_counter *counter) {
+    atomic_fetch_add_explicit(&counter->skipped_total, 1,
+                              memory_order_relaxed);
+
     if (!is_started(counter)) {
         return;
     }
@@ -180,3 +184,9 @@ fps_counter_add_skipped_frame(struct fps_counter *counter) {
     ++counter->nr_skipped;
     sc_mutex_unlock(&counter->mutex);
 }
+
+unsigned
+fps_counter_take_skipped_frames(struct fps_counter *counter) {
+    return atomic_exchange_explicit(&counter->skipped_total, 0,
+                                    memory_order_relaxed);
+}
@@ -20,6 +20,10 @@ struct fps_counter {
     // if the FPS counter is disabled, we don't want to lock unnecessarily
     atomic_bool started;
 
+    // skipped frames counted even if the FPS counter is not started, taken
+    // by fps_counter_take_skipped_frames()
+    atomic_uint skipped_total;
+
     // the following fields are protected by the mutex
     bool interrupted;
     unsigned nr_rendered;
@@ -56,4 +60,8 @@ fps_counter_add_rendered_frame(struct fps_counter *counter);
 void
 fps_counter_add_skipped_frame(struct fps_counter *counter);
 
+// Return the number of frames skipped since the previous call
+unsigned
+fps_counter_take_skipped_frames(struct fps_counter *counter);
+
 #endif
@@ -1,16 +1,21 @@
 #include "input_manager.h"
-#include "clock.h"
 
 #include <assert.h>
+#include <inttypes.h>
 #include <SDL2/SDL_keycode.h>
 
 #include "util/log.h"
+#include "util/tick.h"
 
 static const int ACTION_DOWN = 1;
 static const int ACTION_UP = 1 << 1;
 
 #define SC_SDL_SHORTCUT_MODS_MASK (KMOD_CTRL | KMOD_ALT | KMOD_GUI)
 
+// Delay between putting the camera finger down and moving it, otherwise the
+// events may overlap
+#define CAMERA_DOWN_DELAY SC_TICK_FROM_MS(50)
+
 static inline uint16_t
 to_sdl_mod(unsigned mod) {
     uint16_t sdl_mod = 0;
@@ -55,50 +60,27 @@ void
 input_manager_init(struct input_manager *im, struct controller *controller,
                    struct screen *screen, struct sc_key_processor *kp,
                    struct sc_mouse_processor *mp,
+                   struct sc_latency_probe *latency_probe,
+                   const struct sc_keymap *keymap,
                    const struct scrcpy_options *options) {
     assert(!options->control || (kp && kp->ops));
     assert(!options->control || (mp && mp->ops));
+    assert(!options->control || latency_probe);
+    assert(!options->control || keymap);
 
-    im->joystick_pos.x = 340;
-    im->joystick_pos.y = 865;
-    im->js_mv_offset = 250;
+    im->keymap = keymap;
+    im->keymap_profile =
+        keymap ? sc_keymap_find(keymap, options->keymap_profile) : NULL;
+    assert(!keymap || im->keymap_profile);
 
     im->joystick_down.up = false;
     im->joystick_down.down = false;
     im->joystick_down.left = false;
     im->joystick_down.right = false;
 
-    im->ads_btn_pos.x = 2000;
-    im->ads_btn_pos.y = 790;
-
-    im->crouch_btn_pos.x = 2032;
-    im->crouch_btn_pos.y = 973;
-
-    im->jump_btn_pos.x = 2209;
-    im->jump_btn_pos.y = 890;
-
-    im->reload_btn_pos.x = 2255;
-    im->reload_btn_pos.y = 713;
-
-    im->switch_wpn_btn_pos.x = 1290;
-    im->switch_wpn_btn_pos.y = 964;
-
-    im->scorestreak_btn_pos.x = 1013;
-    im->scorestreak_btn_pos.y = 957;
-    im->scorestreak_offset = 120;
-    im->skill_btn_pos.x = 2247;
-    im->skill_btn_pos.y = 405;
-
-    im->chat_btn_pos.x = 2072;
-    im->chat_btn_pos.y = 343;
-
-    im->throwable_btn_pos.x = 1619;
-    im->throwable_btn_pos.y = 932;
-
-    im->camera_pos.x = 1250;
-    im->camera_pos.y = 542;
-    im->camera_sensitivity_normal = 1.25f;
-    im->camera_sensitivity_shooting = 1.25f;
+    sc_tick camera_period = options->camera_rate
+                          ? SC_TICK_FREQ / options->camera_rate : 0;
+    sc_camera_motion_init(&im->camera, camera_period);
 
     im->joystick_mode = false;
     im->vjoystick_moving = false;
@@ -107,6 +89,7 @@ input_manager_init(struct input_manager *im, struct controller *controller,
     im->screen = screen;
     im->kp = kp;
     im->mp = mp;
+    im->latency_probe = latency_probe;
 
     im->control = options->control;
     im->forward_all_clicks = options->forward_all_clicks;
@@ -125,6 +108,21 @@ input_manager_init(struct input_manager *im, struct controller *controller,
 
     im->vfinger_down = false;
 
+    im->video_preset = sc_video_preset_find(options->max_size);
+    im->initial_max_size = options->max_size;
+    im->video_preset_constraint = SC_VIDEO_PRESET_ANY_SIZE;
+#ifdef HAVE_SHM_SINK
+    if (options->shm_sink_name) {
+        im->video_preset_constraint = SC_VIDEO_PRESET_NOT_LARGER;
+    }
+#endif
+#ifdef HAVE_V4L2
+    if (options->v4l2_device && !options->v4l2_width) {
+        // The strongest constraint
+        im->video_preset_constraint = SC_VIDEO_PRESET_SAME_SIZE;
+    }
+#endif
+
     im->last_keycode = SDLK_UNKNOWN;
     im->last_mod = 0;
     im->key_repeat = 0;
@@ -270,21 +268,19 @@ set_device_clipboard(struct controller *controller, bool paste,
         return false;
     }
 
-    char *text_dup = strdup(text);
-    SDL_free(text);
-    if (!text_dup) {
-        LOGW("Could not strdup input text");
-        return false;
-    }
-
     struct control_msg msg;
     msg.type = CONTROL_MSG_TYPE_SET_CLIPBOARD;
     msg.set_clipboard.sequence = sequence;
-    msg.set_clipboard.text = text_dup;
     msg.set_clipboard.paste = paste;
+    bool ok = control_msg_text_init(&msg.set_clipboard.text, text);
+    SDL_free(text);
+    if (!ok) {
+        LOGW("Could not copy clipboard text");
+        return false;
+    }
 
     if (!controller_push_msg(controller, &msg)) {
-        free(text_dup);
+        control_msg_destroy(&msg);
         LOGW("Could not request 'set device clipboard'");
         return false;
     }
@@ -320,6 +316,21 @@ switch_fps_counter_state(struct fps_counter *fps_counter) {
     }
 }
 
+static void
+switch_latency_probe_state(struct sc_latency_probe *latency_probe) {
+    if (sc_latency_probe_is_started(latency_probe)) {
+        // the percentiles are logged on stop
+        sc_latency_probe_stop(latency_probe);
+        LOGI("Latency probe stopped");
+    } else {
+        if (sc_latency_probe_start(latency_probe)) {
+            LOGI("Latency probe started");
+        } else {
+            LOGE("Latency probe starting failed");
+        }
+    }
+}
+
 static void
 clipboard_paste(struct controller *controller) {
     char *text = SDL_GetClipboardText();
@@ -333,18 +344,17 @@ clipboard_paste(struct controller *controller) {
         return;
     }
 
-    char *text_dup = strdup(text);
+    struct control_msg msg;
+    msg.type = CONTROL_MSG_TYPE_INJECT_TEXT;
+    bool ok = control_msg_text_init(&msg.inject_text.text, text);
     SDL_free(text);
-    if (!text_dup) {
-        LOGW("Could not strdup input text");
+    if (!ok) {
+        LOGW("Could not copy clipboard text");
         return;
     }
 
-    struct control_msg msg;
-    msg.type = CONTROL_MSG_TYPE_INJECT_TEXT;
-    msg.inject_text.text = text_dup;
     if (!controller_push_msg(controller, &msg)) {
-        free(text_dup);
+        control_msg_destroy(&msg);
         LOGW("Could not request 'paste clipboard'");
     }
 }
@@ -359,6 +369,48 @@ rotate_device(struct controller *controller) {
     }
 }
 
+static void
+switch_video_preset(struct input_manager *im, bool better) {
+    unsigned index = sc_video_preset_step(im->video_preset, better);
+    if (index == im->video_preset) {
+        LOGI("No %s video preset", better ? "better" : "faster");
+        return;
+    }
+
+    const struct sc_video_preset *preset = &sc_video_presets[index];
+    if (!sc_video_preset_is_allowed(preset, im->initial_max_size,
+                                    im->video_preset_constraint)) {
+        if (im->video_preset_constraint == SC_VIDEO_PRESET_SAME_SIZE) {
+            LOGW("Video presets are disabled: the v4l2 sink cannot change its "
+                 "frame size (use --v4l2-size)");
+        } else {
+            // Only a better preset may increase the frame size
+            assert(better);
+            LOGW("No better video preset: the shared memory sink cannot "
+                 "receive larger frames");
+        }
+        return;
+    }
+
+    struct control_msg msg;
+    msg.type = CONTROL_MSG_TYPE_SET_VIDEO_SETTINGS;
+    msg.set_video_settings.max_size = preset->max_size;
+    msg.set_video_settings.max_fps = preset->max_fps;
+
+    if (!controller_push_msg(im->controller, &msg)) {
+        LOGW("Could not request 'set video settings'");
+        return;
+    }
+
+    im->video_preset = index;
+    if (preset->max_size) {
+        LOGI("Video preset: %" PRIu16 "px, %" PRIu16 " fps", preset->max_size,
+             preset->max_fps);
+    } else {
+        LOGI("Video preset: device size, unlimited fps");
+    }
+}
+
 static void
 rotate_client_left(struct screen *screen) {
     unsigned new_rotation = (screen->rotation + 1) % 4;
@@ -383,10 +435,10 @@ input_manager_process_text_input(struct input_manager *im,
 }
 
 static bool
-simulate_virtual_finger_pid(struct input_manager *im,
-                        enum android_motionevent_action action,
-                        struct sc_point point,
-                        uint64_t pointer_id) {
+simulate_virtual_finger_pid_at(struct input_manager *im,
+                               enum android_motionevent_action action,
+                               struct sc_point point, uint64_t pointer_id,
+                               sc_tick deadline) {
     bool up = action == AMOTION_EVENT_ACTION_UP;
 
     struct control_msg msg;
@@ -398,7 +450,7 @@ simulate_virtual_finger_pid(struct input_manager *im,
     msg.inject_touch_event.pressure = up ? 0.0f : 1.0f;
     msg.inject_touch_event.buttons = 0;
 
-    if (!controller_push_msg(im->controller, &msg)) {
+    if (!controller_push_msg_at(im->controller, &msg, deadline)) {
         LOGW("Could not request 'inject virtual finger event'");
         return false;
     }
@@ -406,6 +458,115 @@ simulate_virtual_finger_pid(struct input_manager *im,
     return true;
 }
 
+static bool
+simulate_virtual_finger_pid(struct input_manager *im,
+                        enum android_motionevent_action action,
+                        struct sc_point point,
+                        uint64_t pointer_id) {
+    return simulate_virtual_finger_pid_at(im, action, point, pointer_id, 0);
+}
+
+static struct sc_point
+camera_center(struct input_manager *im) {
+    return sc_keymap_point_to_frame(im->keymap_profile->camera,
+                                    im->screen->frame_size);
+}
+
+static void
+update_joystick(struct input_manager *im) {
+    const struct sc_keymap_profile *profile = im->keymap_profile;
+    const struct sc_joystick_down *d = &im->joystick_down;
+    struct sc_size frame_size = im->screen->frame_size;
+    struct sc_point center =
+        sc_keymap_point_to_frame(profile->joystick, frame_size);
+
+    if (!d->up && !d->down && !d->left && !d->right) {
+        if (im->vjoystick_moving) {
+            LOGI("Releasing movement");
+            simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_UP, center,
+                                        SC_KEYMAP_POINTER_ID_JOYSTICK);
+            im->vjoystick_moving = false;
+        }
+        return;
+    }
+
+    if (!im->vjoystick_moving) {
+        simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_DOWN, center,
+                                    SC_KEYMAP_POINTER_ID_JOYSTICK);
+        // A delay is required, otherwise the events may overlap (the MOVE
+        // event is sent later by the controller, without blocking)
+        controller_hold_pointer(im->controller, SC_KEYMAP_POINTER_ID_JOYSTICK,
+                                sc_tick_now() + SC_TICK_FROM_MS(35));
+        im->vjoystick_moving = true;
+    }
+
+    // The radius is relative to the height, so that the joystick moves by the
+    // same distance in both directions
+    int32_t offset = (int32_t) (profile->joystick_radius * frame_size.height);
+    struct sc_point point = {
+        .x = center.x + (d->right - d->left) * offset,
+        .y = center.y + (d->down - d->up) * offset,
+    };
+    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_MOVE, point,
+                                SC_KEYMAP_POINTER_ID_JOYSTICK);
+}
+
+static void
+process_keymap_entry(struct input_manager *im,
+                     const struct sc_keymap_entry *entry, bool down) {
+    struct sc_joystick_down *d = &im->joystick_down;
+
+    switch (entry->action) {
+        case SC_KEYMAP_ACTION_TOUCH: {
+            struct sc_point point =
+                sc_keymap_point_to_frame(entry->point, im->screen->frame_size);
+            enum android_motionevent_action action =
+                down ? AMOTION_EVENT_ACTION_DOWN : AMOTION_EVENT_ACTION_UP;
+            simulate_virtual_finger_pid(im, action, point, entry->pointer_id);
+            return;
+        }
+        case SC_KEYMAP_ACTION_JOYSTICK_UP:
+            d->up = down;
+            break;
+        case SC_KEYMAP_ACTION_JOYSTICK_DOWN:
+            d->down = down;
+            break;
+        case SC_KEYMAP_ACTION_JOYSTICK_LEFT:
+            d->left = down;
+            break;
+        case SC_KEYMAP_ACTION_JOYSTICK_RIGHT:
+            d->right = down;
+            break;
+        case SC_KEYMAP_ACTION_JOYSTICK_RECENTER:
+            if (!down) {
+                return;
+            }
+            d->up = false;
+            d->down = false;
+            d->left = false;
+            d->right = false;
+            break;
+        default:
+            assert(!"unexpected keymap action");
+            return;
+    }
+
+    update_joystick(im);
+}
+
+static void
+switch_keymap_profile(struct input_manager *im) {
+    if (im->joystick_mode) {
+        LOGW("Could not switch keymap profile in joystick mode");
+        return;
+    }
+
+    const struct sc_keymap *keymap = im->keymap;
+    unsigned index = im->keymap_profile - keymap->profiles;
+    im->keymap_profile = &keymap->profiles[(index + 1) % keymap->count];
+    LOGI("Keymap profile: %s", im->keymap_profile->name);
+}
+
 static bool
 simulate_virtual_finger(struct input_manager *im,
                         enum android_motionevent_action action,
@@ -471,25 +632,36 @@ input_manager_process_key(struct input_manager *im,
         switch (keycode)
         {
             case SDLK_q:
+                if (control && shift && !repeat && down)
+                {
+                    switch_keymap_profile(im);
+                }
                 // Enable or disable joystick mode
                 if (down && control && !shift && !repeat)
                 {
                     im->joystick_mode = !im->joystick_mode;
 
-                    im->joystick_pos.x = 340;
-                    im->joystick_pos.y = 865;
-                    im->camera_pos.x = 1450;
-                    im->camera_pos.y = 542;
+                    struct sc_point camera_pos;
+                    if (im->joystick_mode) {
+                        camera_pos = camera_center(im);
+                        sc_camera_motion_reset(&im->camera, camera_pos);
+                    } else {
+                        // Release the finger where it is
+                        camera_pos = sc_camera_motion_get_point(&im->camera);
+                    }
 
                     // Toggle camera
                     simulate_virtual_finger_pid(
                         im,
                         im->joystick_mode ? AMOTION_EVENT_ACTION_DOWN : AMOTION_EVENT_ACTION_UP,
-                        im->camera_pos,
-                        2
+                        camera_pos,
+                        SC_KEYMAP_POINTER_ID_CAMERA
                     );
 
-                    sc_msleep(50);
+                    // Delay the camera moves without blocking
+                    controller_hold_pointer(im->controller,
+                                            SC_KEYMAP_POINTER_ID_CAMERA,
+                                            sc_tick_now() + CAMERA_DOWN_DELAY);
 
                     // Mouse trap camera
                     SDL_SetRelativeMouseMode(
@@ -540,14 +712,22 @@ input_manager_process_key(struct input_manager *im,
                 }
                 return;
             case SDLK_DOWN:
-                if (control && !shift)
+                if (control && shift && !repeat && down)
+                {
+                    switch_video_preset(im, false);
+                }
+                else if (control && !shift)
                 {
                     // forward repeated events
                     action_volume_down(controller, action);
                 }
                 return;
             case SDLK_UP:
-                if (control && !shift)
+                if (control && shift && !repeat && down)
+                {
+                    switch_video_preset(im, true);
+                }
+                else if (control && !shift)
                 {
                     // forward repeated events
                     action_volume_up(controller, action);
@@ -620,6 +800,12 @@ input_manager_process_key(struct input_manager *im,
                     switch_fps_counter_state(&im->screen->fps_counter);
                 }
                 return;
+            case SDLK_l:
+                if (control && !shift && !repeat && down)
+                {
+                    switch_latency_probe_state(im->latency_probe);
+                }
+                return;
             case SDLK_n:
                 if (control && !repeat && down)
                 {
@@ -651,283 +837,13 @@ input_manager_process_key(struct input_manager *im,
     // Custom, joystick-mode specifics
     if (im->joystick_mode)
     {
-        switch (keycode) {
-            case SDLK_ESCAPE:
-                // Reset joystick pos to the first value
-                im->joystick_pos.x = 340;
-                im->joystick_pos.y = 865;
-                return;
-            case SDLK_LSHIFT:
-                // Crouch
-                if (down) {
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_DOWN, im->crouch_btn_pos, 3);
-                } else {
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_UP, im->crouch_btn_pos, 3);
-                }
-
-                return;
-            case SDLK_SPACE:
-                // Jump
-                if (down) {
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_DOWN, im->jump_btn_pos, 4);
-                } else {
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_UP, im->jump_btn_pos, 4);
-                }
-
-                return;
-            case SDLK_r:
-                // Reload
-                if (down) {
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_DOWN, im->reload_btn_pos, 5);
-                } else {
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_UP, im->reload_btn_pos, 5);
-                }
-
-                return;
-            case SDLK_e:
-                // Switch weapon
-                if (down) {
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_DOWN, im->switch_wpn_btn_pos, 6);
-                } else {
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_UP, im->switch_wpn_btn_pos, 6);
-                }
-
-                return;
-            case SDLK_1:
-                if (down) {
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_DOWN, im->scorestreak_btn_pos, 7);
-                } else {
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_UP, im->scorestreak_btn_pos, 7);
-                }
-
-                return;
-            case SDLK_2:
-                // Modify scorestrea to substract scorestreak_offset from x
-                if (down) {
-                    im->scorestreak_btn_pos.x -= im->scorestreak_offset;
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_DOWN, im->scorestreak_btn_pos, 8);
-                    im->scorestreak_btn_pos.x += im->scorestreak_offset;
-                } else {
-                    im->scorestreak_btn_pos.x -= im->scorestreak_offset;
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_UP, im->scorestreak_btn_pos, 8);
-                    im->scorestreak_btn_pos.x += im->scorestreak_offset;
-                }
-
-                return;
-            case SDLK_3:
-                // Modify scorestreak to add scorestreak_offset to x
-                if (down) {
-                    im->scorestreak_btn_pos.x -= im->scorestreak_offset * 2;
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_DOWN, im->scorestreak_btn_pos, 9);
-                    im->scorestreak_btn_pos.x += im->scorestreak_offset  * 2;
-                } else {
-                    im->scorestreak_btn_pos.x -= im->scorestreak_offset  * 2;
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_UP, im->scorestreak_btn_pos, 9);
-                    im->scorestreak_btn_pos.x += im->scorestreak_offset  * 2;
-                }
-
-                return;
-            case SDLK_q:
-                // Press the operator skill button
-                if (down) {
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_DOWN, im->skill_btn_pos, 10);
-                } else {
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_UP, im->skill_btn_pos, 10);
-                }
-
-                return;
-            case SDLK_f:
-                // Press the throwable button
-                if (down) {
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_DOWN, im->throwable_btn_pos, 11);
-                } else {
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_UP, im->throwable_btn_pos, 11);
-                }
-
-                return;
-            case SDLK_c:
-                // Press the chat button
-                if (down) {
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_DOWN, im->chat_btn_pos, 12);
-                } else {
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_UP, im->chat_btn_pos, 12);
-                }
-
-                return;
-            case SDLK_w:
-                // Move
-                if (im->vjoystick_moving) {
-                    bool is_up = im->joystick_down.up;
-                    if (!is_up) {
-                        // Combine the positions
-                        im->joystick_pos.y -= im->js_mv_offset;
-                        im->joystick_down.up = true;
-                    }
-                    else if (!down)
-                    {
-                        // Release
-                        im->joystick_pos.y += im->js_mv_offset;
-                        im->joystick_down.up = false;
-                    }
-
-                    if (!is_up || !down) {
-                        simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_MOVE, im->joystick_pos, 1);
-                        return;
-                    }
-                }
-
-                if (down && !im->vjoystick_moving) {
-                    LOGI("Moving forward");
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_DOWN, im->joystick_pos, 1);
-                    sc_msleep(35); // Sleep is required, otherwise the events may overlap
-                    im->joystick_pos.y -= im->js_mv_offset;
-                    im->joystick_down.up = true;
-                    im->joystick_down.started_by = keycode;
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_MOVE, im->joystick_pos, 1);
-                    im->vjoystick_moving = true;
-                    return;
-                }
-
-                if (!down && im->joystick_down.started_by == keycode) {
-                    LOGI("Releasing movement");
-                    im->joystick_pos.x = 340;
-                    im->joystick_pos.y = 865;
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_UP, im->joystick_pos, 1);
-                    im->vjoystick_moving = false;
-
-                    return;
-                }
-
-                return;
-            case SDLK_a:
-                // Move
-                if (im->vjoystick_moving) {
-                    bool is_left = im->joystick_down.left;
-                    if (!is_left) {
-                        // Combine the positions
-                        im->joystick_pos.x -= im->js_mv_offset;
-                        im->joystick_down.left = true;
-                    }
-                    else if (!down)
-                    {
-                        // Release
-                        im->joystick_pos.x += im->js_mv_offset;
-                        im->joystick_down.left = false;
-                    }
-
-                    if (!is_left || !down) {
-                        simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_MOVE, im->joystick_pos, 1);
-                        return;
-                    }
-                }
-
-                if (down && !im->vjoystick_moving) {
-                    LOGI("Moving left");
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_DOWN, im->joystick_pos, 1);
-                    sc_msleep(35); // Sleep is required, otherwise the events may overlap
-                    im->joystick_pos.x -= im->js_mv_offset;
-                    im->joystick_down.left = true;
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_MOVE, im->joystick_pos, 1);
-                    im->vjoystick_moving = true;
-                    return;
-                }
-
-                if (!down && im->joystick_down.started_by == keycode) {
-                    LOGI("Releasing movement");
-                    im->joystick_pos.x = 340;
-                    im->joystick_pos.y = 865;
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_UP, im->joystick_pos, 1);
-                    im->vjoystick_moving = false;
-                    return;
-                }
-
-                return;
-            case SDLK_s:
-                // Move
-                if (im->vjoystick_moving) {
-                    bool is_down = im->joystick_down.down;
-                    if (!is_down) {
-                        // Combine the positions
-                        im->joystick_pos.y += im->js_mv_offset;
-                        im->joystick_down.down = true;
-                    }
-                    else if (!down)
-                    {
-                        // Release
-                        im->joystick_pos.y -= im->js_mv_offset;
-                        im->joystick_down.down = false;
-                    }
-
-                    if (!is_down || !down) {
-                        simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_MOVE, im->joystick_pos, 1);
-                        return;
-                    }
-                }
-
-                if (down && !im->vjoystick_moving) {
-                    LOGI("Moving backward");
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_DOWN, im->joystick_pos, 1);
-                    sc_msleep(35); // Sleep is required, otherwise the events may overlap
-                    im->joystick_pos.y += im->js_mv_offset;
-                    im->joystick_down.down = true;
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_MOVE, im->joystick_pos, 1);
-                    im->vjoystick_moving = true;
-                    return;
-                }
-
-                if (!down && im->joystick_down.started_by == keycode) {
-                    LOGI("Releasing movement");
-                    im->joystick_pos.x = 340;
-                    im->joystick_pos.y = 865;
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_UP, im->joystick_pos, 1);
-                    im->vjoystick_moving = false;
-                    return;
-                }
-
-                return;
-            case SDLK_d:
-                // Move
-                if (im->vjoystick_moving) {
-                    bool is_right = im->joystick_down.right;
-                    if (!is_right) {
-                        // Combine the positions
-                        im->joystick_pos.x += im->js_mv_offset;
-                        im->joystick_down.right = true;
-                    }
-                    else if (!down)
-                    {
-                        // Release
-                        im->joystick_pos.x -= im->js_mv_offset;
-                        im->joystick_down.right = false;
-                    }
-
-                    if (!is_right || !down) {
-                        simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_MOVE, im->joystick_pos, 1);
-                        return;
-                    }
-                }
-
-                if (down && !im->vjoystick_moving) {
-                    LOGI("Moving right");
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_DOWN, im->joystick_pos, 1);
-                    sc_msleep(35); // Sleep is required, otherwise the events may overlap
-                    im->joystick_pos.x += 100;
-                    im->joystick_down.right = true;
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_MOVE, im->joystick_pos, 1);
-                    im->vjoystick_moving = true;
-                    return;
-                }
-
-                if (!down && im->joystick_down.started_by == keycode) {
-                    LOGI("Releasing movement");
-                    im->joystick_pos.x = 340;
-                    im->joystick_pos.y = 865;
-                    simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_UP, im->joystick_pos, 1);
-                    im->vjoystick_moving = false;
-                    return;
-                }
-
-                return;
+        const struct sc_keymap_entry *entry =
+            sc_keymap_profile_get(im->keymap_profile, event->keysym.scancode);
+        if (entry) {
+            if (!repeat) {
+                process_keymap_entry(im, entry, down);
+            }
+            return;
         }
     }
 
@@ -975,26 +891,35 @@ input_manager_process_mouse_motion(struct input_manager *im,
     // Joystick mode specific handling
     if (im->joystick_mode) {
         // In joystick mode, we move the camera
-        im->camera_pos.x += (int) (
-            event->xrel *
-            (im->vjoystick_shooting
-            ? im->camera_sensitivity_shooting
-            : im->camera_sensitivity_normal)
-        );
-
-        im->camera_pos.y += (int) (
-            event->yrel *
-            (im->vjoystick_shooting
-            ? im->camera_sensitivity_shooting
-            : im->camera_sensitivity_normal)
-        );
-
-        simulate_virtual_finger_pid(
-            im,
-            AMOTION_EVENT_ACTION_MOVE,
-            im->camera_pos,
-            2
-        );
+        const struct sc_keymap_profile *profile = im->keymap_profile;
+        float sensitivity = im->vjoystick_shooting
+                          ? profile->camera_fire_sensitivity
+                          : profile->camera_sensitivity;
+
+        struct sc_point last = sc_camera_motion_get_point(&im->camera);
+        struct sc_point center = camera_center(im);
+        bool recenter = sc_camera_motion_move(&im->camera,
+                                              event->xrel * sensitivity,
+                                              event->yrel * sensitivity,
+                                              im->screen->frame_size, center);
+        if (recenter) {
+            // The finger is close to an edge, put it back at the center
+            simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_UP, last,
+                                        SC_KEYMAP_POINTER_ID_CAMERA);
+            simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_DOWN, center,
+                                        SC_KEYMAP_POINTER_ID_CAMERA);
+            controller_hold_pointer(im->controller,
+                                    SC_KEYMAP_POINTER_ID_CAMERA,
+                                    sc_tick_now() + CAMERA_DOWN_DELAY);
+        }
+
+        // Send the MOVE events at a fixed rate: the motions received in the
+        // meantime only update the pending MOVE event
+        sc_tick deadline =
+            sc_camera_motion_next_deadline(&im->camera, sc_tick_now());
+        simulate_virtual_finger_pid_at(im, AMOTION_EVENT_ACTION_MOVE,
+                                       sc_camera_motion_get_point(&im->camera),
+                                       SC_KEYMAP_POINTER_ID_CAMERA, deadline);
 
         return;
     }
@@ -1043,16 +968,22 @@ input_manager_process_mouse_button(struct input_manager *im,
 
     // Joystick mode specifics
     if (im->joystick_mode) {
+        struct sc_point fire =
+            sc_keymap_point_to_frame(im->keymap_profile->fire,
+                                     im->screen->frame_size);
         if (down) {
             // Start shooting
             LOGI("Shooting!");
-            simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_DOWN, im->ads_btn_pos, 13);
+            simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_DOWN, fire, SC_KEYMAP_POINTER_ID_FIRE);
+            // A delay is required before the UP event, otherwise the events
+            // may overlap
+            controller_hold_pointer(im->controller, SC_KEYMAP_POINTER_ID_FIRE,
+                                    sc_tick_now() + SC_TICK_FROM_MS(25));
             im->vjoystick_shooting = true;
         } else {
             // Stop shooting
             LOGI("Stopping fire");
-            sc_msleep(25); // Sleep is required, otherwise the events may overlap
-            simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_UP, im->ads_btn_pos, 13);
+            simulate_virtual_finger_pid(im, AMOTION_EVENT_ACTION_UP, fire, SC_KEYMAP_POINTER_ID_FIRE);
             im->vjoystick_shooting = false;
         }
         return;
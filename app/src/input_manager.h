@@ -7,19 +7,22 @@
 
 #include <SDL2/SDL.h>
 
+#include "camera_motion.h"
 #include "controller.h"
 #include "fps_counter.h"
+#include "keymap.h"
+#include "latency_probe.h"
 #include "options.h"
 #include "screen.h"
 #include "trait/key_processor.h"
 #include "trait/mouse_processor.h"
+#include "video_preset.h"
 
 struct sc_joystick_down {
     bool up;
     bool down;
     bool left;
     bool right;
-    SDL_Keycode started_by;
 };
 
 struct input_manager
@@ -29,24 +32,13 @@ struct input_manager
 
     struct sc_key_processor *kp;
     struct sc_mouse_processor *mp;
+    struct sc_latency_probe *latency_probe; // NULL if control is disabled
 
     // Joystick mode specifics
-    struct sc_point joystick_pos;
-    struct sc_point ads_btn_pos;
-    struct sc_point crouch_btn_pos;
-    struct sc_point jump_btn_pos;
-    struct sc_point reload_btn_pos;
-    struct sc_point switch_wpn_btn_pos;
-    struct sc_point scorestreak_btn_pos;
-    struct sc_point skill_btn_pos;
-    struct sc_point chat_btn_pos; // 2072 343
-    struct sc_point throwable_btn_pos; // 1619 932
+    const struct sc_keymap *keymap; // NULL if control is disabled
+    const struct sc_keymap_profile *keymap_profile;
     struct sc_joystick_down joystick_down;
-    struct sc_point camera_pos;
-    float camera_sensitivity_normal;
-    float camera_sensitivity_shooting;
-    int js_mv_offset;
-    int scorestreak_offset;
+    struct sc_camera_motion camera;
     bool joystick_mode;
     bool vjoystick_moving;
     bool vjoystick_shooting;
@@ -63,6 +55,11 @@ struct input_manager
 
     bool vfinger_down;
 
+    unsigned video_preset; // index in sc_video_presets
+    // The presets must not change the frame size beyond what the sinks handle
+    enum sc_video_preset_constraint video_preset_constraint;
+    uint16_t initial_max_size;
+
     // Tracks the number of identical consecutive shortcut key down events.
     // Not to be confused with event->repeat, which counts the number of
     // system-generated repeated key presses.
@@ -77,6 +74,8 @@ void
 input_manager_init(struct input_manager *im, struct controller *controller,
                    struct screen *screen, struct sc_key_processor *kp,
                    struct sc_mouse_processor *mp,
+                   struct sc_latency_probe *latency_probe,
+                   const struct sc_keymap *keymap,
                    const struct scrcpy_options *options);
 
 bool
@@ -0,0 +1,256 @@
+#include "input_record.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/buffer_util.h"
+#include "util/log.h"
+
+// Enough room for any record
+#define SC_INPUT_RECORD_MAX_SIZE \
+    (SC_INPUT_RECORD_RECORD_HEADER_LENGTH + CONTROL_MSG_MAX_SIZE)
+
+static bool
+sc_input_record_buffer_init(struct sc_input_record_buffer *buffer) {
+    buffer->data = malloc(SC_INPUT_RECORD_MAX_SIZE);
+    if (!buffer->data) {
+        LOG_OOM();
+        return false;
+    }
+
+    buffer->size = 0;
+    buffer->capacity = SC_INPUT_RECORD_MAX_SIZE;
+    return true;
+}
+
+// Make room for one more record
+static bool
+sc_input_record_buffer_reserve(struct sc_input_record_buffer *buffer) {
+    if (buffer->capacity - buffer->size >= SC_INPUT_RECORD_MAX_SIZE) {
+        return true;
+    }
+
+    size_t capacity = buffer->capacity * 2;
+    unsigned char *data = realloc(buffer->data, capacity);
+    if (!data) {
+        LOG_OOM();
+        return false;
+    }
+
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return true;
+}
+
+bool
+sc_input_recorder_open(struct sc_input_recorder *recorder,
+                       const char *filename) {
+    if (!sc_input_record_buffer_init(&recorder->pending)) {
+        return false;
+    }
+
+    if (!sc_input_record_buffer_init(&recorder->writing)) {
+        goto error_free_pending;
+    }
+
+    recorder->file = fopen(filename, "wb");
+    if (!recorder->file) {
+        LOGE("Could not open input record file: %s", filename);
+        goto error_free_writing;
+    }
+
+    unsigned char header[SC_INPUT_RECORD_HEADER_LENGTH];
+    memcpy(header, SC_INPUT_RECORD_MAGIC, SC_INPUT_RECORD_MAGIC_LENGTH);
+    header[SC_INPUT_RECORD_MAGIC_LENGTH] = SC_INPUT_RECORD_VERSION;
+    if (fwrite(header, sizeof(header), 1, recorder->file) != 1) {
+        LOGE("Could not write input record header");
+        fclose(recorder->file);
+        goto error_free_writing;
+    }
+
+    recorder->count = 0;
+    recorder->oom = false;
+    recorder->failed = false;
+
+    LOGI("Recording input to %s", filename);
+    return true;
+
+error_free_writing:
+    free(recorder->writing.data);
+error_free_pending:
+    free(recorder->pending.data);
+
+    return false;
+}
+
+void
+sc_input_recorder_close(struct sc_input_recorder *recorder) {
+    // Write the records not written by the writer yet
+    sc_input_recorder_flush(recorder);
+    sc_input_recorder_take(recorder);
+    sc_input_recorder_flush(recorder);
+
+    if (fclose(recorder->file)) {
+        recorder->failed = true;
+    }
+    if (recorder->failed) {
+        LOGE("Input record is incomplete");
+    } else {
+        LOGI("Input record complete: %u messages", recorder->count);
+    }
+    free(recorder->pending.data);
+    free(recorder->writing.data);
+}
+
+void
+sc_input_recorder_push(struct sc_input_recorder *recorder,
+                       const struct control_msg *msg) {
+    if (recorder->oom) {
+        // the following records would have wrong delays
+        return;
+    }
+
+    struct sc_input_record_buffer *pending = &recorder->pending;
+    if (!sc_input_record_buffer_reserve(pending)) {
+        recorder->oom = true;
+        return;
+    }
+
+    unsigned char *buf = &pending->data[pending->size];
+    size_t len =
+        control_msg_serialize(msg, &buf[SC_INPUT_RECORD_RECORD_HEADER_LENGTH]);
+    if (!len) {
+        // The record would be rejected on replay
+        LOGW("Could not serialize input message (type=%d), not recorded",
+             (int) msg->type);
+        return;
+    }
+
+    sc_tick now = sc_tick_now_precise();
+    // the replay starts on the first message
+    sc_tick delay = recorder->count ? now - recorder->last_timestamp : 0;
+    if (delay > UINT32_MAX) {
+        // more than 71 minutes without any event
+        delay = UINT32_MAX;
+    }
+    recorder->last_timestamp = now;
+
+    buffer_write32be(&buf[0], (uint32_t) delay);
+    buffer_write32be(&buf[4], len);
+    pending->size += SC_INPUT_RECORD_RECORD_HEADER_LENGTH + len;
+
+    ++recorder->count;
+}
+
+void
+sc_input_recorder_take(struct sc_input_recorder *recorder) {
+    // The previous records must have been flushed
+    assert(!recorder->writing.size);
+
+    struct sc_input_record_buffer tmp = recorder->writing;
+    recorder->writing = recorder->pending;
+    recorder->pending = tmp;
+
+    if (recorder->oom) {
+        recorder->failed = true;
+    }
+}
+
+void
+sc_input_recorder_flush(struct sc_input_recorder *recorder) {
+    struct sc_input_record_buffer *writing = &recorder->writing;
+    if (!writing->size) {
+        return;
+    }
+
+    if (!recorder->failed
+            && fwrite(writing->data, writing->size, 1, recorder->file) != 1) {
+        LOGE("Could not write input record");
+        recorder->failed = true;
+    }
+
+    writing->size = 0;
+}
+
+bool
+sc_input_record_reader_open(struct sc_input_record_reader *reader,
+                            const char *filename) {
+    reader->buffer = malloc(CONTROL_MSG_MAX_SIZE);
+    if (!reader->buffer) {
+        LOG_OOM();
+        return false;
+    }
+
+    reader->file = fopen(filename, "rb");
+    if (!reader->file) {
+        LOGE("Could not open input record file: %s", filename);
+        free(reader->buffer);
+        return false;
+    }
+
+    unsigned char header[SC_INPUT_RECORD_HEADER_LENGTH];
+    if (fread(header, sizeof(header), 1, reader->file) != 1
+            || memcmp(header, SC_INPUT_RECORD_MAGIC,
+                      SC_INPUT_RECORD_MAGIC_LENGTH)) {
+        LOGE("Not an input record file: %s", filename);
+        goto error;
+    }
+
+    if (header[SC_INPUT_RECORD_MAGIC_LENGTH] != SC_INPUT_RECORD_VERSION) {
+        LOGE("Unsupported input record version: %u",
+             (unsigned) header[SC_INPUT_RECORD_MAGIC_LENGTH]);
+        goto error;
+    }
+
+    return true;
+
+error:
+    fclose(reader->file);
+    free(reader->buffer);
+    return false;
+}
+
+void
+sc_input_record_reader_close(struct sc_input_record_reader *reader) {
+    fclose(reader->file);
+    free(reader->buffer);
+}
+
+int
+sc_input_record_reader_next(struct sc_input_record_reader *reader,
+                            sc_tick *delay, struct control_msg *msg) {
+    unsigned char header[SC_INPUT_RECORD_RECORD_HEADER_LENGTH];
+    size_t r = fread(header, 1, sizeof(header), reader->file);
+    if (r == 0 && feof(reader->file)) {
+        return 0;
+    }
+    if (r != sizeof(header)) {
+        LOGE("Truncated input record");
+        return -1;
+    }
+
+    uint32_t len = buffer_read32be(&header[4]);
+    if (!len || len > CONTROL_MSG_MAX_SIZE) {
+        LOGE("Invalid input record length: %" PRIu32, len);
+        return -1;
+    }
+
+    if (fread(reader->buffer, len, 1, reader->file) != 1) {
+        LOGE("Truncated input record");
+        return -1;
+    }
+
+    ssize_t consumed = control_msg_deserialize(reader->buffer, len, msg);
+    if (consumed != (ssize_t) len) {
+        if (consumed > 0) {
+            control_msg_destroy(msg);
+        }
+        LOGE("Invalid input record message");
+        return -1;
+    }
+
+    *delay = SC_TICK_FROM_US((sc_tick) buffer_read32be(&header[0]));
+    return 1;
+}
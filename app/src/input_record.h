@@ -0,0 +1,104 @@
+#ifndef SC_INPUT_RECORD_H
+#define SC_INPUT_RECORD_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "control_msg.h"
+#include "util/tick.h"
+
+/**
+ * Input record file format
+ *
+ * The file starts with a header:
+ *
+ *     magic "scrcpyin" (8 bytes) | version (1 byte)
+ *
+ * followed by the records:
+ *
+ *     delay (4 bytes) | length (4 bytes) | serialized control_msg
+ *
+ * The delay is the number of microseconds since the previous record (0 for the
+ * first one). All values are big-endian.
+ */
+
+#define SC_INPUT_RECORD_MAGIC "scrcpyin"
+#define SC_INPUT_RECORD_MAGIC_LENGTH 8
+#define SC_INPUT_RECORD_VERSION 1
+#define SC_INPUT_RECORD_HEADER_LENGTH (SC_INPUT_RECORD_MAGIC_LENGTH + 1)
+#define SC_INPUT_RECORD_RECORD_HEADER_LENGTH 8
+
+// Serialized records, back to back
+struct sc_input_record_buffer {
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+};
+
+struct sc_input_recorder {
+    FILE *file;
+    // Records not taken yet (protected by the controller mutex)
+    struct sc_input_record_buffer pending;
+    // Records taken, to be written to the file by the writer
+    struct sc_input_record_buffer writing;
+    sc_tick last_timestamp; // of the last message pushed
+    unsigned count;
+    bool oom; // protected by the controller mutex
+    bool failed; // only accessed by the writer
+};
+
+bool
+sc_input_recorder_open(struct sc_input_recorder *recorder,
+                       const char *filename);
+
+// Write the remaining records and close the file
+//
+// The writer must not be running anymore.
+void
+sc_input_recorder_close(struct sc_input_recorder *recorder);
+
+// Append a message to the pending records, timestamped with the current time
+//
+// The message is only serialized, the file is written by
+// sc_input_recorder_flush(), so that the caller never blocks on I/O.
+//
+// Not thread-safe (the controller calls it with its mutex locked).
+void
+sc_input_recorder_push(struct sc_input_recorder *recorder,
+                       const struct control_msg *msg);
+
+// Take the pending records, to be written by the next
+// sc_input_recorder_flush()
+//
+// Must be called by the writer, with the same lock as
+// sc_input_recorder_push().
+void
+sc_input_recorder_take(struct sc_input_recorder *recorder);
+
+// Write the records taken by sc_input_recorder_take() to the file
+//
+// Must be called by the writer (a single thread), without the lock.
+void
+sc_input_recorder_flush(struct sc_input_recorder *recorder);
+
+struct sc_input_record_reader {
+    FILE *file;
+    unsigned char *buffer;
+};
+
+bool
+sc_input_record_reader_open(struct sc_input_record_reader *reader,
+                            const char *filename);
+
+void
+sc_input_record_reader_close(struct sc_input_record_reader *reader);
+
+// Read the next message and its delay since the previous one
+// Return 1 on success, 0 at the end of the file, -1 on error.
+int
+sc_input_record_reader_next(struct sc_input_record_reader *reader,
+                            sc_tick *delay, struct control_msg *msg);
+
+#endif
@@ -0,0 +1,198 @@
+#include "input_replay.h"
+
+#include <assert.h>
+
+#include "util/log.h"
+
+#define SC_INPUT_REPLAY_LATE_THRESHOLD SC_TICK_FROM_MS(1)
+
+bool
+sc_input_replay_init(struct sc_input_replay *replay,
+                     struct controller *controller, const char *filename,
+                     float speed) {
+    assert(speed >= 0);
+
+    bool ok = sc_input_record_reader_open(&replay->reader, filename);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_mutex_init(&replay->mutex);
+    if (!ok) {
+        goto error_close_reader;
+    }
+
+    ok = sc_cond_init(&replay->cond);
+    if (!ok) {
+        goto error_destroy_mutex;
+    }
+
+    replay->controller = controller;
+    replay->speed = speed;
+    replay->stopped = false;
+    replay->count = 0;
+    replay->late_count = 0;
+    replay->total_error = 0;
+    replay->max_error = 0;
+
+    return true;
+
+error_destroy_mutex:
+    sc_mutex_destroy(&replay->mutex);
+error_close_reader:
+    sc_input_record_reader_close(&replay->reader);
+
+    return false;
+}
+
+void
+sc_input_replay_destroy(struct sc_input_replay *replay) {
+    sc_cond_destroy(&replay->cond);
+    sc_mutex_destroy(&replay->mutex);
+    sc_input_record_reader_close(&replay->reader);
+}
+
+// Return false if the replay has been stopped
+static bool
+wait_until(struct sc_input_replay *replay, sc_tick target) {
+    sc_mutex_lock(&replay->mutex);
+    for (;;) {
+        if (replay->stopped) {
+            break;
+        }
+
+        sc_tick now = sc_tick_now_precise();
+        if (now >= target) {
+            break;
+        }
+
+        // The condition variable deadline is expressed in the sc_tick_now()
+        // clock, with a millisecond resolution: the last millisecond is
+        // actively waited, for precision
+        sc_tick deadline = sc_tick_now() + (target - now);
+        sc_cond_timedwait(&replay->cond, &replay->mutex, deadline);
+    }
+    bool stopped = replay->stopped;
+    sc_mutex_unlock(&replay->mutex);
+
+    return !stopped;
+}
+
+// Return false if the replay has been stopped
+static bool
+push_msg(struct sc_input_replay *replay, const struct control_msg *msg) {
+    while (!controller_push_msg(replay->controller, msg)) {
+        // The queue is full, let the controller consume some messages
+        sc_tick retry = sc_tick_now_precise() + SC_TICK_FROM_MS(1);
+        if (!wait_until(replay, retry)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void
+update_stats(struct sc_input_replay *replay, sc_tick target, sc_tick now) {
+    sc_tick error = now - target;
+    assert(error >= 0);
+
+    ++replay->count;
+    replay->total_error += error;
+    if (error > replay->max_error) {
+        replay->max_error = error;
+    }
+    if (error > SC_INPUT_REPLAY_LATE_THRESHOLD) {
+        ++replay->late_count;
+    }
+}
+
+static void
+report(struct sc_input_replay *replay, sc_tick duration) {
+    if (!replay->count) {
+        LOGI("Input replay: no message");
+        return;
+    }
+
+    if (!replay->speed) {
+        LOGI("Input replay: %u messages in %.3fs", replay->count,
+             duration / (double) SC_TICK_FREQ);
+        return;
+    }
+
+    double avg_ms = replay->total_error / 1000.0 / replay->count;
+    LOGI("Input replay: %u messages in %.3fs, timing error avg=%.3fms "
+         "max=%.3fms (%u messages more than 1ms late)", replay->count,
+         duration / (double) SC_TICK_FREQ, avg_ms,
+         replay->max_error / 1000.0, replay->late_count);
+}
+
+static int
+run_input_replay(void *data) {
+    struct sc_input_replay *replay = data;
+
+    sc_tick start = sc_tick_now_precise();
+    sc_tick offset = 0; // original time since the first message
+
+    for (;;) {
+        struct control_msg msg;
+        sc_tick delay;
+        int r = sc_input_record_reader_next(&replay->reader, &delay, &msg);
+        if (r <= 0) {
+            // end of file or error (already logged)
+            break;
+        }
+
+        offset += delay;
+
+        sc_tick target;
+        if (replay->speed) {
+            // absolute deadline, so that errors do not accumulate
+            target = start + (sc_tick) (offset / replay->speed);
+            if (!wait_until(replay, target)) {
+                control_msg_destroy(&msg);
+                break;
+            }
+        } else {
+            target = sc_tick_now_precise();
+        }
+
+        if (!push_msg(replay, &msg)) {
+            control_msg_destroy(&msg);
+            break;
+        }
+
+        update_stats(replay, target, sc_tick_now_precise());
+    }
+
+    report(replay, sc_tick_now_precise() - start);
+    LOGD("Input replay stopped");
+    return 0;
+}
+
+bool
+sc_input_replay_start(struct sc_input_replay *replay) {
+    LOGD("Starting input replay thread");
+
+    bool ok = sc_thread_create(&replay->thread, run_input_replay,
+                               "input replay", replay);
+    if (!ok) {
+        LOGC("Could not start input replay thread");
+        return false;
+    }
+
+    return true;
+}
+
+void
+sc_input_replay_stop(struct sc_input_replay *replay) {
+    sc_mutex_lock(&replay->mutex);
+    replay->stopped = true;
+    sc_cond_signal(&replay->cond);
+    sc_mutex_unlock(&replay->mutex);
+}
+
+void
+sc_input_replay_join(struct sc_input_replay *replay) {
+    sc_thread_join(&replay->thread, NULL);
+}
@@ -0,0 +1,57 @@
+#ifndef SC_INPUT_REPLAY_H
+#define SC_INPUT_REPLAY_H
+
+#include "common.h"
+
+#include <stdbool.h>
+
+#include "controller.h"
+#include "input_record.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+/**
+ * Replay an input record (see input_record.h)
+ *
+ * The messages are pushed to the controller at their original timing
+ * (divided by speed), or as fast as possible if speed is 0.
+ *
+ * Each message is scheduled at an absolute deadline, computed from the replay
+ * start time, so that the scheduling errors do not accumulate over long
+ * sessions.
+ */
+struct sc_input_replay {
+    struct controller *controller;
+    struct sc_input_record_reader reader;
+    float speed; // 0 for as fast as possible
+
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond cond;
+    bool stopped; // protected by the mutex
+
+    // statistics, only accessed from the replay thread
+    unsigned count;
+    unsigned late_count; // messages injected more than 1ms late
+    sc_tick total_error;
+    sc_tick max_error;
+};
+
+bool
+sc_input_replay_init(struct sc_input_replay *replay,
+                     struct controller *controller, const char *filename,
+                     float speed);
+
+void
+sc_input_replay_destroy(struct sc_input_replay *replay);
+
+bool
+sc_input_replay_start(struct sc_input_replay *replay);
+
+void
+sc_input_replay_stop(struct sc_input_replay *replay);
+
+void
+sc_input_replay_join(struct sc_input_replay *replay);
+
+#endif
@@ -324,13 +324,12 @@ sc_key_processor_process_text(struct sc_key_processor *kp,
 
     struct control_msg msg;
     msg.type = CONTROL_MSG_TYPE_INJECT_TEXT;
-    msg.inject_text.text = strdup(event->text);
-    if (!msg.inject_text.text) {
-        LOGW("Could not strdup input text");
-        return;
-    }
+    // SDL text events are short, the text is stored inline (no allocation)
+    bool ok = control_msg_text_init(&msg.inject_text.text, event->text);
+    assert(ok && !msg.inject_text.text.heap);
+    (void) ok;
     if (!controller_push_msg(ki->controller, &msg)) {
-        free(msg.inject_text.text);
+        control_msg_destroy(&msg);
         LOGW("Could not request 'inject text'");
     }
 }
@@ -0,0 +1,361 @@
+#include "keymap.h"
+
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL_keyboard.h>
+
+#include "util/log.h"
+#include "util/str.h"
+
+#define SC_KEYMAP_MAX_LINE_LENGTH 255
+#define SC_KEYMAP_MAX_FILE_SIZE (1 << 20)
+
+// The mappings which were hardcoded in the joystick mode, measured on a
+// 2400x1080 frame
+static const char *const SC_KEYMAP_DEFAULT =
+    "[default]\n"
+    "joystick = 0.1417 0.8009 0.2315\n"
+    "camera = 0.6042 0.5019 1.25\n"
+    "fire = 0.8333 0.7315\n"
+    "W = up\n"
+    "A = left\n"
+    "S = down\n"
+    "D = right\n"
+    "Escape = recenter\n"
+    "Left Shift = 0.8467 0.9009\n" // crouch
+    "Space = 0.9204 0.8241\n"      // jump
+    "R = 0.9396 0.6602\n"          // reload
+    "E = 0.5375 0.8926\n"          // switch weapon
+    "1 = 0.4221 0.8861\n"          // scorestreaks
+    "2 = 0.3721 0.8861\n"
+    "3 = 0.3221 0.8861\n"
+    "Q = 0.9363 0.3750\n"          // operator skill
+    "F = 0.6746 0.8630\n"          // throwable
+    "C = 0.8633 0.3176\n";         // chat
+
+static char *
+trim(char *s) {
+    while (isspace((unsigned char) *s)) {
+        ++s;
+    }
+    size_t len = strlen(s);
+    while (len && isspace((unsigned char) s[len - 1])) {
+        s[--len] = '\0';
+    }
+    return s;
+}
+
+// Parse up to `max` floats separated by spaces, return the number of values
+// parsed, or -1 on error
+static int
+parse_floats(const char *s, float *values, int max) {
+    int count = 0;
+    for (;;) {
+        while (isspace((unsigned char) *s)) {
+            ++s;
+        }
+        if (!*s) {
+            return count;
+        }
+        if (count == max) {
+            // too many values
+            return -1;
+        }
+
+        char *endptr;
+        errno = 0;
+        float value = strtof(s, &endptr);
+        if (endptr == s || errno == ERANGE
+                || (*endptr && !isspace((unsigned char) *endptr))) {
+            return -1;
+        }
+        values[count++] = value;
+        s = endptr;
+    }
+}
+
+static bool
+is_normalized(float value) {
+    return value >= 0 && value <= 1;
+}
+
+static bool
+parse_point(const char *s, struct sc_keymap_point *point, float *extra,
+            int extra_count, int min_count) {
+    float values[4];
+    assert(2 + extra_count <= (int) ARRAY_LEN(values));
+    int count = parse_floats(s, values, 2 + extra_count);
+    if (count < min_count || !is_normalized(values[0])
+                          || !is_normalized(values[1])) {
+        return false;
+    }
+
+    point->x = values[0];
+    point->y = values[1];
+    for (int i = 0; i < extra_count; ++i) {
+        if (2 + i < count) {
+            extra[i] = values[2 + i];
+        }
+    }
+    return true;
+}
+
+static void
+profile_init(struct sc_keymap_profile *profile, const char *name) {
+    memset(profile, 0, sizeof(*profile));
+    sc_strncpy(profile->name, name, sizeof(profile->name));
+    profile->joystick = (struct sc_keymap_point) {0.5f, 0.5f};
+    profile->joystick_radius = 0.2f;
+    profile->camera = (struct sc_keymap_point) {0.5f, 0.5f};
+    profile->camera_sensitivity = 1.f;
+    profile->camera_fire_sensitivity = 1.f;
+    profile->fire = (struct sc_keymap_point) {0.5f, 0.5f};
+    // entries[0] is the unmapped entry
+    profile->entry_count = 1;
+}
+
+static bool
+parse_action(const char *s, struct sc_keymap_entry *entry) {
+    static const struct {
+        const char *name;
+        enum sc_keymap_action action;
+    } joystick_actions[] = {
+        {"up", SC_KEYMAP_ACTION_JOYSTICK_UP},
+        {"down", SC_KEYMAP_ACTION_JOYSTICK_DOWN},
+        {"left", SC_KEYMAP_ACTION_JOYSTICK_LEFT},
+        {"right", SC_KEYMAP_ACTION_JOYSTICK_RIGHT},
+        {"recenter", SC_KEYMAP_ACTION_JOYSTICK_RECENTER},
+    };
+
+    for (size_t i = 0; i < ARRAY_LEN(joystick_actions); ++i) {
+        if (!strcmp(s, joystick_actions[i].name)) {
+            entry->action = joystick_actions[i].action;
+            entry->pointer_id = SC_KEYMAP_POINTER_ID_JOYSTICK;
+            return true;
+        }
+    }
+
+    if (!parse_point(s, &entry->point, NULL, 0, 2)) {
+        return false;
+    }
+    entry->action = SC_KEYMAP_ACTION_TOUCH;
+    return true;
+}
+
+static bool
+parse_mapping(struct sc_keymap_profile *profile, const char *key,
+              const char *value) {
+    if (!strcmp(key, "joystick")) {
+        return parse_point(value, &profile->joystick,
+                           &profile->joystick_radius, 1, 3)
+            && profile->joystick_radius > 0 && profile->joystick_radius <= 1;
+    }
+    if (!strcmp(key, "camera")) {
+        float sensitivities[2] = {profile->camera_sensitivity, NAN};
+        if (!parse_point(value, &profile->camera, sensitivities, 2, 2)) {
+            return false;
+        }
+        profile->camera_sensitivity = sensitivities[0];
+        // the sensitivity while firing defaults to the normal sensitivity
+        profile->camera_fire_sensitivity = isnan(sensitivities[1])
+                                         ? sensitivities[0] : sensitivities[1];
+        return true;
+    }
+    if (!strcmp(key, "fire")) {
+        return parse_point(value, &profile->fire, NULL, 0, 2);
+    }
+
+    SDL_Scancode scancode = SDL_GetScancodeFromName(key);
+    if (scancode == SDL_SCANCODE_UNKNOWN) {
+        LOGE("Unknown key: %s", key);
+        return false;
+    }
+    if (profile->index[scancode]) {
+        LOGE("Key already mapped: %s", key);
+        return false;
+    }
+    if (profile->entry_count == SC_KEYMAP_MAX_ENTRIES) {
+        LOGE("Too many keys mapped (max %d)", SC_KEYMAP_MAX_ENTRIES - 1);
+        return false;
+    }
+
+    unsigned index = profile->entry_count;
+    struct sc_keymap_entry *entry = &profile->entries[index];
+    entry->pointer_id = SC_KEYMAP_POINTER_ID_FIRST_KEY + index - 1;
+    if (!parse_action(value, entry)) {
+        return false;
+    }
+
+    profile->index[scancode] = index;
+    ++profile->entry_count;
+    return true;
+}
+
+static bool
+parse_line(struct sc_keymap *keymap, char *line) {
+    char *comment = strchr(line, '#');
+    if (comment) {
+        *comment = '\0';
+    }
+    line = trim(line);
+    if (!*line) {
+        return true;
+    }
+
+    if (*line == '[') {
+        size_t len = strlen(line);
+        if (line[len - 1] != ']') {
+            return false;
+        }
+        line[len - 1] = '\0';
+        const char *name = trim(&line[1]);
+        if (!*name || strlen(name) > SC_KEYMAP_PROFILE_NAME_MAX_LENGTH) {
+            LOGE("Invalid keymap profile name: %s", name);
+            return false;
+        }
+        if (sc_keymap_find(keymap, name)) {
+            LOGE("Duplicate keymap profile: %s", name);
+            return false;
+        }
+        if (keymap->count == SC_KEYMAP_MAX_PROFILES) {
+            LOGE("Too many keymap profiles (max %d)", SC_KEYMAP_MAX_PROFILES);
+            return false;
+        }
+        profile_init(&keymap->profiles[keymap->count++], name);
+        return true;
+    }
+
+    if (!keymap->count) {
+        LOGE("Keymap mapping outside of a profile");
+        return false;
+    }
+
+    char *eq = strchr(line, '=');
+    if (!eq) {
+        return false;
+    }
+    *eq = '\0';
+    const char *key = trim(line);
+    const char *value = trim(eq + 1);
+
+    struct sc_keymap_profile *profile = &keymap->profiles[keymap->count - 1];
+    return parse_mapping(profile, key, value);
+}
+
+bool
+sc_keymap_parse(struct sc_keymap *keymap, const char *data) {
+    keymap->profiles =
+        malloc(SC_KEYMAP_MAX_PROFILES * sizeof(*keymap->profiles));
+    if (!keymap->profiles) {
+        LOG_OOM();
+        return false;
+    }
+    keymap->count = 0;
+
+    char line[SC_KEYMAP_MAX_LINE_LENGTH + 1];
+    unsigned line_number = 0;
+    while (*data) {
+        ++line_number;
+        size_t len = strcspn(data, "\n");
+        if (len > SC_KEYMAP_MAX_LINE_LENGTH) {
+            LOGE("Keymap line %u too long", line_number);
+            goto error;
+        }
+        memcpy(line, data, len);
+        line[len] = '\0';
+        data += len;
+        if (*data == '\n') {
+            ++data;
+        }
+
+        if (!parse_line(keymap, line)) {
+            LOGE("Invalid keymap line %u", line_number);
+            goto error;
+        }
+    }
+
+    if (!keymap->count) {
+        LOGE("No keymap profile");
+        goto error;
+    }
+
+    return true;
+
+error:
+    free(keymap->profiles);
+    return false;
+}
+
+bool
+sc_keymap_init_default(struct sc_keymap *keymap) {
+    bool ok = sc_keymap_parse(keymap, SC_KEYMAP_DEFAULT);
+    // the built-in keymap is valid
+    assert(!ok || keymap->count == 1);
+    return ok;
+}
+
+bool
+sc_keymap_load(struct sc_keymap *keymap, const char *filename) {
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        LOGE("Could not open keymap file: %s", filename);
+        return false;
+    }
+
+    char *data = malloc(SC_KEYMAP_MAX_FILE_SIZE + 1);
+    if (!data) {
+        LOG_OOM();
+        fclose(file);
+        return false;
+    }
+
+    size_t len = fread(data, 1, SC_KEYMAP_MAX_FILE_SIZE + 1, file);
+    bool read_error = ferror(file);
+    fclose(file);
+    if (read_error) {
+        LOGE("Could not read keymap file: %s", filename);
+        free(data);
+        return false;
+    }
+    if (len > SC_KEYMAP_MAX_FILE_SIZE) {
+        LOGE("Keymap file too large: %s", filename);
+        free(data);
+        return false;
+    }
+    data[len] = '\0';
+
+    bool ok = sc_keymap_parse(keymap, data);
+    free(data);
+    if (!ok) {
+        LOGE("Could not load keymap file: %s", filename);
+        return false;
+    }
+
+    LOGD("Keymap loaded: %u profiles", keymap->count);
+    return true;
+}
+
+void
+sc_keymap_destroy(struct sc_keymap *keymap) {
+    free(keymap->profiles);
+}
+
+const struct sc_keymap_profile *
+sc_keymap_find(const struct sc_keymap *keymap, const char *name) {
+    if (!name) {
+        return keymap->count ? &keymap->profiles[0] : NULL;
+    }
+
+    for (unsigned i = 0; i < keymap->count; ++i) {
+        if (!strcmp(keymap->profiles[i].name, name)) {
+            return &keymap->profiles[i];
+        }
+    }
+
+    return NULL;
+}
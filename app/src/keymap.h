@@ -0,0 +1,138 @@
+#ifndef SC_KEYMAP_H
+#define SC_KEYMAP_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <SDL2/SDL_scancode.h>
+
+#include "coords.h"
+
+/**
+ * Mappings from keyboard keys to touch events on the device, used by the
+ * joystick mode.
+ *
+ * A keymap file contains one or several named profiles:
+ *
+ *     [profile_name]
+ *     joystick = 0.1417 0.8009 0.2315   # center x, y and radius
+ *     camera = 0.6042 0.5019 1.25       # center x, y and sensitivity
+ *     fire = 0.8333 0.7315              # left mouse button
+ *     W = up                            # joystick direction
+ *     Escape = recenter                 # release the joystick
+ *     Space = 0.9204 0.8241             # touch x, y
+ *
+ * The keys are SDL scancode names (the physical key, independently of the
+ * keyboard layout). The coordinates are normalized (between 0 and 1), so that
+ * they apply to any device resolution. The joystick radius is relative to the
+ * frame height.
+ */
+
+#define SC_KEYMAP_MAX_PROFILES 16
+#define SC_KEYMAP_PROFILE_NAME_MAX_LENGTH 31
+// Including the unmapped entry at index 0
+#define SC_KEYMAP_MAX_ENTRIES 64
+
+#define SC_KEYMAP_POINTER_ID_JOYSTICK 1
+#define SC_KEYMAP_POINTER_ID_CAMERA 2
+#define SC_KEYMAP_POINTER_ID_FIRE 3
+// The keys mapped to a touch use the following pointer ids
+#define SC_KEYMAP_POINTER_ID_FIRST_KEY 4
+
+enum sc_keymap_action {
+    SC_KEYMAP_ACTION_NONE,
+    SC_KEYMAP_ACTION_TOUCH,
+    SC_KEYMAP_ACTION_JOYSTICK_UP,
+    SC_KEYMAP_ACTION_JOYSTICK_DOWN,
+    SC_KEYMAP_ACTION_JOYSTICK_LEFT,
+    SC_KEYMAP_ACTION_JOYSTICK_RIGHT,
+    SC_KEYMAP_ACTION_JOYSTICK_RECENTER,
+};
+
+// Normalized coordinates, in [0; 1]
+struct sc_keymap_point {
+    float x;
+    float y;
+};
+
+struct sc_keymap_entry {
+    enum sc_keymap_action action;
+    // only for SC_KEYMAP_ACTION_TOUCH
+    struct sc_keymap_point point;
+    uint64_t pointer_id;
+};
+
+struct sc_keymap_profile {
+    char name[SC_KEYMAP_PROFILE_NAME_MAX_LENGTH + 1];
+
+    struct sc_keymap_point joystick;
+    float joystick_radius;
+    struct sc_keymap_point camera;
+    float camera_sensitivity;
+    float camera_fire_sensitivity;
+    struct sc_keymap_point fire;
+
+    // Index in entries for each scancode (0 if the key is not mapped)
+    uint8_t index[SDL_NUM_SCANCODES];
+    struct sc_keymap_entry entries[SC_KEYMAP_MAX_ENTRIES];
+    unsigned entry_count;
+};
+
+struct sc_keymap {
+    struct sc_keymap_profile *profiles;
+    unsigned count;
+};
+
+/**
+ * Initialize the keymap with the built-in profile
+ */
+bool
+sc_keymap_init_default(struct sc_keymap *keymap);
+
+/**
+ * Load the profiles from a keymap file
+ */
+bool
+sc_keymap_load(struct sc_keymap *keymap, const char *filename);
+
+/**
+ * Parse the profiles from the content of a keymap file
+ */
+bool
+sc_keymap_parse(struct sc_keymap *keymap, const char *data);
+
+void
+sc_keymap_destroy(struct sc_keymap *keymap);
+
+/**
+ * Return the profile named `name`, or the first profile if `name` is NULL
+ *
+ * Return NULL if there is no such profile.
+ */
+const struct sc_keymap_profile *
+sc_keymap_find(const struct sc_keymap *keymap, const char *name);
+
+/**
+ * Return the entry mapped to the scancode, or NULL if the key is not mapped
+ */
+static inline const struct sc_keymap_entry *
+sc_keymap_profile_get(const struct sc_keymap_profile *profile,
+                      SDL_Scancode scancode) {
+    if ((unsigned) scancode >= SDL_NUM_SCANCODES) {
+        return NULL;
+    }
+    uint8_t index = profile->index[scancode];
+    return index ? &profile->entries[index] : NULL;
+}
+
+static inline struct sc_point
+sc_keymap_point_to_frame(struct sc_keymap_point point, struct sc_size size) {
+    return (struct sc_point) {
+        .x = (int32_t) (point.x * size.width),
+        .y = (int32_t) (point.y * size.height),
+    };
+}
+
+#endif
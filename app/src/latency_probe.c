@@ -0,0 +1,170 @@
+#include "latency_probe.h"
+
+#include <assert.h>
+
+#include "util/log.h"
+
+#define SC_LATENCY_PROBE_REPORT_INTERVAL SC_TICK_FROM_SEC(5)
+
+bool
+sc_latency_probe_init(struct sc_latency_probe *probe,
+                      struct controller *controller, sc_tick interval) {
+    bool ok = sc_mutex_init(&probe->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&probe->state_cond);
+    if (!ok) {
+        sc_mutex_destroy(&probe->mutex);
+        return false;
+    }
+
+    probe->controller = controller;
+    probe->interval = interval ? interval : SC_LATENCY_PROBE_DEFAULT_INTERVAL;
+    probe->thread_started = false;
+    probe->started = false;
+    probe->interrupted = false;
+
+    return true;
+}
+
+void
+sc_latency_probe_destroy(struct sc_latency_probe *probe) {
+    sc_cond_destroy(&probe->state_cond);
+    sc_mutex_destroy(&probe->mutex);
+}
+
+bool
+sc_latency_probe_ping(struct controller *controller) {
+    struct control_msg msg;
+    msg.type = CONTROL_MSG_TYPE_PING;
+    msg.ping.timestamp = (uint64_t) sc_tick_now_precise();
+
+    if (!controller_push_msg(controller, &msg)) {
+        LOGW("Could not request 'ping'");
+        return false;
+    }
+
+    return true;
+}
+
+static void
+report(struct sc_latency_probe *probe) {
+    struct sc_rtt_percentiles p;
+    bool ok = receiver_take_rtt_percentiles(&probe->controller->receiver, &p);
+    if (!ok) {
+        LOGI("Latency probe: no pong received");
+        return;
+    }
+
+    LOGI("Latency probe: rtt p50=%.2fms p95=%.2fms p99=%.2fms "
+         "(min=%.2fms max=%.2fms, %u pongs)",
+         p.p50 / 1000.0, p.p95 / 1000.0, p.p99 / 1000.0, p.min / 1000.0,
+         p.max / 1000.0, p.count);
+}
+
+static int
+run_latency_probe(void *data) {
+    struct sc_latency_probe *probe = data;
+
+    sc_mutex_lock(&probe->mutex);
+    while (!probe->interrupted) {
+        while (!probe->interrupted && !probe->started) {
+            sc_cond_wait(&probe->state_cond, &probe->mutex);
+        }
+        while (!probe->interrupted && probe->started) {
+            sc_tick now = sc_tick_now();
+            if (now >= probe->next_ping) {
+                sc_latency_probe_ping(probe->controller);
+                // do not send a burst of pings if the thread was late
+                probe->next_ping = now + probe->interval;
+            }
+            if (now >= probe->next_report) {
+                report(probe);
+                probe->next_report = now + SC_LATENCY_PROBE_REPORT_INTERVAL;
+            }
+
+            sc_tick deadline = probe->next_ping < probe->next_report
+                             ? probe->next_ping : probe->next_report;
+            // ignore the reason (timeout or signaled), we just loop anyway
+            sc_cond_timedwait(&probe->state_cond, &probe->mutex, deadline);
+        }
+    }
+    sc_mutex_unlock(&probe->mutex);
+    return 0;
+}
+
+bool
+sc_latency_probe_start(struct sc_latency_probe *probe) {
+    // discard the samples received before
+    struct sc_rtt_percentiles ignored;
+    receiver_take_rtt_percentiles(&probe->controller->receiver, &ignored);
+
+    sc_mutex_lock(&probe->mutex);
+    sc_tick now = sc_tick_now();
+    probe->next_ping = now;
+    probe->next_report = now + SC_LATENCY_PROBE_REPORT_INTERVAL;
+    probe->started = true;
+    sc_mutex_unlock(&probe->mutex);
+    sc_cond_signal(&probe->state_cond);
+
+    // probe->thread_started and probe->thread are always accessed from the
+    // same thread, no need to lock
+    if (!probe->thread_started) {
+        bool ok = sc_thread_create(&probe->thread, run_latency_probe,
+                                   "latency probe", probe);
+        if (!ok) {
+            LOGE("Could not start latency probe thread");
+            return false;
+        }
+
+        probe->thread_started = true;
+    }
+
+    return true;
+}
+
+void
+sc_latency_probe_stop(struct sc_latency_probe *probe) {
+    sc_mutex_lock(&probe->mutex);
+    probe->started = false;
+    sc_mutex_unlock(&probe->mutex);
+    sc_cond_signal(&probe->state_cond);
+
+    // the pongs of the last pings may still be in flight, they will be
+    // discarded on the next start
+    report(probe);
+}
+
+bool
+sc_latency_probe_is_started(struct sc_latency_probe *probe) {
+    sc_mutex_lock(&probe->mutex);
+    bool started = probe->started;
+    sc_mutex_unlock(&probe->mutex);
+    return started;
+}
+
+void
+sc_latency_probe_interrupt(struct sc_latency_probe *probe) {
+    if (!probe->thread_started) {
+        return;
+    }
+
+    sc_mutex_lock(&probe->mutex);
+    probe->interrupted = true;
+    sc_mutex_unlock(&probe->mutex);
+    // wake up blocking wait
+    sc_cond_signal(&probe->state_cond);
+}
+
+void
+sc_latency_probe_join(struct sc_latency_probe *probe) {
+    if (probe->thread_started) {
+        // interrupted must be set by the thread calling join(), so no need to
+        // lock for the assertion
+        assert(probe->interrupted);
+
+        sc_thread_join(&probe->thread, NULL);
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef SC_LATENCY_PROBE_H
+#define SC_LATENCY_PROBE_H
+
+#include "common.h"
+
+#include <stdbool.h>
+
+#include "controller.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+#define SC_LATENCY_PROBE_DEFAULT_INTERVAL SC_TICK_FROM_MS(100)
+
+/**
+ * Measure the round-trip time of the control channel
+ *
+ * While started, a ping is pushed to the controller periodically (so it goes
+ * through the same queue as input events). The device echoes it in a pong,
+ * and the receiver computes the round-trip time. The percentiles are logged
+ * periodically and on stop.
+ */
+struct sc_latency_probe {
+    struct controller *controller;
+    sc_tick interval;
+
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond state_cond;
+
+    bool thread_started;
+
+    // the following fields are protected by the mutex
+    bool started;
+    bool interrupted;
+    sc_tick next_ping;
+    sc_tick next_report;
+};
+
+// If interval is 0, SC_LATENCY_PROBE_DEFAULT_INTERVAL is used
+bool
+sc_latency_probe_init(struct sc_latency_probe *probe,
+                      struct controller *controller, sc_tick interval);
+
+void
+sc_latency_probe_destroy(struct sc_latency_probe *probe);
+
+bool
+sc_latency_probe_start(struct sc_latency_probe *probe);
+
+// Stop sending pings and log the round-trip time percentiles
+void
+sc_latency_probe_stop(struct sc_latency_probe *probe);
+
+bool
+sc_latency_probe_is_started(struct sc_latency_probe *probe);
+
+// request to stop the thread (on quit)
+// must be called before sc_latency_probe_join()
+void
+sc_latency_probe_interrupt(struct sc_latency_probe *probe);
+
+void
+sc_latency_probe_join(struct sc_latency_probe *probe);
+
+// Push a single ping to the controller
+bool
+sc_latency_probe_ping(struct controller *controller);
+
+#endif
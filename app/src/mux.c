@@ -0,0 +1,347 @@
+#include "mux.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "util/buffer_util.h"
+#include "util/log.h"
+
+// Small frames are sent with a single send() (the header is copied along with
+// the payload), larger ones with two (to avoid copying the payload)
+#define SC_MUX_SMALL_FRAME_SIZE 256
+
+bool
+sc_mux_init(struct sc_mux *mux, sc_socket socket) {
+    bool ok = sc_mutex_init(&mux->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&mux->cond);
+    if (!ok) {
+        sc_mutex_destroy(&mux->mutex);
+        return false;
+    }
+
+    ok = sc_mutex_init(&mux->send_mutex);
+    if (!ok) {
+        sc_cond_destroy(&mux->cond);
+        sc_mutex_destroy(&mux->mutex);
+        return false;
+    }
+
+    mux->socket = socket;
+    mux->owns_socket = false;
+    mux->recv_channel = SC_MUX_CHANNEL_VIDEO;
+    mux->recv_remaining = 0;
+    mux->recv_header = false;
+    mux->failed = false;
+    mux->io_count = 0;
+    mux->reconnecting = false;
+    mux->generation = 0;
+    for (unsigned i = 0; i < SC_MUX_CHANNEL_COUNT; ++i) {
+        mux->resumed[i] = false;
+    }
+    mux->cbs = NULL;
+    mux->cbs_userdata = NULL;
+
+    return true;
+}
+
+void
+sc_mux_set_callbacks(struct sc_mux *mux, const struct sc_mux_callbacks *cbs,
+                     void *cbs_userdata) {
+    assert(cbs && cbs->reconnect);
+    mux->cbs = cbs;
+    mux->cbs_userdata = cbs_userdata;
+}
+
+void
+sc_mux_destroy(struct sc_mux *mux) {
+    if (mux->owns_socket) {
+        net_close(mux->socket);
+    }
+    sc_mutex_destroy(&mux->send_mutex);
+    sc_cond_destroy(&mux->cond);
+    sc_mutex_destroy(&mux->mutex);
+}
+
+static void
+sc_mux_fail(struct sc_mux *mux) {
+    sc_mutex_assert(&mux->mutex);
+    mux->failed = true;
+    sc_cond_broadcast(&mux->cond);
+}
+
+// Mark the start of a socket operation, to be executed with the mutex unlocked
+static sc_socket
+sc_mux_io_begin(struct sc_mux *mux, unsigned *generation) {
+    sc_mutex_assert(&mux->mutex);
+    assert(!mux->reconnecting);
+    ++mux->io_count;
+    *generation = mux->generation;
+    return mux->socket;
+}
+
+static void
+sc_mux_io_end(struct sc_mux *mux) {
+    sc_mutex_assert(&mux->mutex);
+    assert(mux->io_count);
+    if (!--mux->io_count) {
+        // the connection may be replaced
+        sc_cond_broadcast(&mux->cond);
+    }
+}
+
+// Handle a failure of the socket of the given generation
+// Return true if the connection has been replaced (by this thread or another).
+static bool
+sc_mux_handle_failure(struct sc_mux *mux, unsigned generation) {
+    sc_mutex_assert(&mux->mutex);
+
+    if (!mux->cbs || mux->failed) {
+        sc_mux_fail(mux);
+        return false;
+    }
+
+    if (generation != mux->generation) {
+        // already replaced
+        return true;
+    }
+
+    if (mux->reconnecting) {
+        // another thread is replacing the connection
+        while (mux->reconnecting) {
+            sc_cond_wait(&mux->cond, &mux->mutex);
+        }
+        return !mux->failed;
+    }
+
+    mux->reconnecting = true;
+    // Wake up the other threads blocked on the socket, and wait until they
+    // have stopped using it
+    net_interrupt(mux->socket);
+    while (mux->io_count && !mux->failed) {
+        sc_cond_wait(&mux->cond, &mux->mutex);
+    }
+
+    sc_socket socket = SC_SOCKET_NONE;
+    if (!mux->failed) {
+        sc_mutex_unlock(&mux->mutex);
+        LOGW("Connection lost, resuming...");
+        socket = mux->cbs->reconnect(mux, mux->cbs_userdata);
+        sc_mutex_lock(&mux->mutex);
+    }
+
+    mux->reconnecting = false;
+
+    if (socket == SC_SOCKET_NONE || mux->failed) {
+        // interrupted meanwhile, or could not reconnect
+        if (socket != SC_SOCKET_NONE) {
+            net_close(socket);
+        }
+        sc_mux_fail(mux);
+        return false;
+    }
+
+    LOGI("Connection resumed");
+
+    if (mux->owns_socket) {
+        net_close(mux->socket);
+    }
+    mux->socket = socket;
+    mux->owns_socket = true;
+    ++mux->generation;
+
+    // The new connection starts with a frame header
+    mux->recv_remaining = 0;
+    for (unsigned i = 0; i < SC_MUX_CHANNEL_COUNT; ++i) {
+        mux->resumed[i] = true;
+    }
+    sc_cond_broadcast(&mux->cond);
+
+    return true;
+}
+
+// Read the next frame header, with the mutex unlocked
+static void
+sc_mux_recv_header(struct sc_mux *mux) {
+    sc_mutex_assert(&mux->mutex);
+    assert(!mux->recv_remaining);
+    assert(!mux->recv_header);
+
+    mux->recv_header = true;
+    unsigned generation;
+    sc_socket socket = sc_mux_io_begin(mux, &generation);
+    sc_mutex_unlock(&mux->mutex);
+
+    uint8_t header[SC_MUX_HEADER_SIZE];
+    ssize_t r = net_recv_all(socket, header, SC_MUX_HEADER_SIZE);
+
+    sc_mutex_lock(&mux->mutex);
+    sc_mux_io_end(mux);
+    mux->recv_header = false;
+
+    if (r < SC_MUX_HEADER_SIZE) {
+        // the caller will find out whether the connection has been replaced
+        sc_mux_handle_failure(mux, generation);
+        return;
+    }
+
+    uint8_t channel = header[0];
+    if (channel >= SC_MUX_CHANNEL_COUNT) {
+        LOGE("Unexpected multiplexed channel: %d", (int) channel);
+        sc_mux_fail(mux);
+        return;
+    }
+
+    mux->recv_channel = channel;
+    mux->recv_remaining = buffer_read32be(&header[1]);
+    // wake up the receiver of the channel (or the next header reader, if the
+    // payload is empty)
+    sc_cond_broadcast(&mux->cond);
+}
+
+ssize_t
+sc_mux_recv(struct sc_mux *mux, enum sc_mux_channel channel, void *buf,
+            size_t len) {
+    assert(channel < SC_MUX_CHANNEL_COUNT);
+    assert(len);
+
+    sc_mutex_lock(&mux->mutex);
+    for (;;) {
+        if (mux->failed) {
+            sc_mutex_unlock(&mux->mutex);
+            return -1;
+        }
+
+        if (mux->resumed[channel]) {
+            mux->resumed[channel] = false;
+            sc_mutex_unlock(&mux->mutex);
+            return SC_MUX_RESUMED;
+        }
+
+        if (!mux->reconnecting) {
+            if (mux->recv_remaining) {
+                if (mux->recv_channel == channel) {
+                    // our turn
+                    break;
+                }
+            } else if (!mux->recv_header) {
+                sc_mux_recv_header(mux);
+                continue;
+            }
+        }
+
+        sc_cond_wait(&mux->cond, &mux->mutex);
+    }
+
+    if (len > mux->recv_remaining) {
+        len = mux->recv_remaining;
+    }
+    unsigned generation;
+    sc_socket socket = sc_mux_io_begin(mux, &generation);
+    sc_mutex_unlock(&mux->mutex);
+
+    // Only this receiver may read the socket until the end of the payload
+    ssize_t r = net_recv(socket, buf, len);
+
+    sc_mutex_lock(&mux->mutex);
+    sc_mux_io_end(mux);
+    if (r <= 0) {
+        bool resumed = sc_mux_handle_failure(mux, generation);
+        if (resumed) {
+            // this receiver is notified now
+            mux->resumed[channel] = false;
+        }
+        sc_mutex_unlock(&mux->mutex);
+        return resumed ? SC_MUX_RESUMED : -1;
+    }
+
+    assert((size_t) r <= mux->recv_remaining);
+    mux->recv_remaining -= r;
+    if (!mux->recv_remaining) {
+        // another receiver may read the next header
+        sc_cond_broadcast(&mux->cond);
+    }
+    sc_mutex_unlock(&mux->mutex);
+
+    return r;
+}
+
+ssize_t
+sc_mux_recv_all(struct sc_mux *mux, enum sc_mux_channel channel, void *buf,
+                size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t r = sc_mux_recv(mux, channel, (char *) buf + done, len - done);
+        if (r == SC_MUX_RESUMED) {
+            return SC_MUX_RESUMED;
+        }
+        if (r < 0) {
+            return done ? (ssize_t) done : -1;
+        }
+        done += r;
+    }
+    return done;
+}
+
+ssize_t
+sc_mux_send_all(struct sc_mux *mux, enum sc_mux_channel channel,
+                const void *buf, size_t len) {
+    assert(channel < SC_MUX_CHANNEL_COUNT);
+    assert(len <= UINT32_MAX);
+
+    uint8_t frame[SC_MUX_SMALL_FRAME_SIZE];
+    frame[0] = channel;
+    buffer_write32be(&frame[1], len);
+
+    bool small = SC_MUX_HEADER_SIZE + len <= sizeof(frame);
+    if (small) {
+        memcpy(&frame[SC_MUX_HEADER_SIZE], buf, len);
+    }
+
+    bool ok;
+    sc_mutex_lock(&mux->send_mutex);
+    sc_mutex_lock(&mux->mutex);
+    for (;;) {
+        while (mux->reconnecting && !mux->failed) {
+            sc_cond_wait(&mux->cond, &mux->mutex);
+        }
+        if (mux->failed) {
+            ok = false;
+            break;
+        }
+
+        unsigned generation;
+        sc_socket socket = sc_mux_io_begin(mux, &generation);
+        sc_mutex_unlock(&mux->mutex);
+
+        if (small) {
+            size_t frame_len = SC_MUX_HEADER_SIZE + len;
+            ok = net_send_all(socket, frame, frame_len) == (ssize_t) frame_len;
+        } else {
+            ok = net_send_all(socket, frame, SC_MUX_HEADER_SIZE)
+                    == SC_MUX_HEADER_SIZE
+              && net_send_all(socket, buf, len) == (ssize_t) len;
+        }
+
+        sc_mutex_lock(&mux->mutex);
+        sc_mux_io_end(mux);
+        if (ok || !sc_mux_handle_failure(mux, generation)) {
+            break;
+        }
+        // the connection has been replaced, send the frame again
+    }
+    sc_mutex_unlock(&mux->mutex);
+    sc_mutex_unlock(&mux->send_mutex);
+
+    return ok ? (ssize_t) len : -1;
+}
+
+void
+sc_mux_interrupt(struct sc_mux *mux) {
+    sc_mutex_lock(&mux->mutex);
+    sc_mux_fail(mux);
+    sc_mutex_unlock(&mux->mutex);
+}
@@ -0,0 +1,127 @@
+#ifndef SC_MUX_H
+#define SC_MUX_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util/net.h"
+#include "util/thread.h"
+
+// [u8 channel][u32 length], followed by <length> bytes of payload
+#define SC_MUX_HEADER_SIZE 5
+
+// Returned by sc_mux_recv() once per channel after the connection has been
+// replaced (see struct sc_mux_callbacks)
+#define SC_MUX_RESUMED -2
+
+enum sc_mux_channel {
+    SC_MUX_CHANNEL_VIDEO, // device -> computer
+    SC_MUX_CHANNEL_CONTROL, // both directions
+    SC_MUX_CHANNEL_COUNT,
+};
+
+/**
+ * Multiplex the video and control streams over a single socket
+ *
+ * The data is sent in frames, each one belonging to a channel. The stream of a
+ * channel is the concatenation of the payloads of its frames, so the frame
+ * boundaries have no meaning for the receiver.
+ *
+ * There is no demultiplexer thread: the receivers (one per channel) take turns
+ * to read the socket. The one which finds no payload for any channel reads the
+ * next frame header; if the payload is not for its own channel, it waits until
+ * the receiver of the other channel has read it. The payloads are received
+ * directly into the buffers of the receivers, without intermediate copy.
+ *
+ * If a reconnect callback is set, a connection failure does not end the
+ * streams: the socket is replaced by a new connection. The data in flight is
+ * lost, so each receiver is notified that its stream restarts from scratch.
+ */
+struct sc_mux {
+    sc_socket socket;
+    // Set once the initial socket has been replaced (the replacements are
+    // owned by the mux)
+    bool owns_socket;
+
+    sc_mutex mutex;
+    sc_cond cond;
+    // The channel of the payload being received, and its remaining length
+    enum sc_mux_channel recv_channel;
+    uint32_t recv_remaining;
+    // Set while a receiver reads a frame header
+    bool recv_header;
+    // Set on error, end of stream or interruption
+    bool failed;
+
+    // Number of receivers and senders using the socket (with the mutex
+    // unlocked), the socket is not replaced until they are done
+    unsigned io_count;
+    // Set while the connection is being replaced
+    bool reconnecting;
+    // Incremented on each replacement
+    unsigned generation;
+    // Set for each channel on replacement, until its receiver is notified
+    bool resumed[SC_MUX_CHANNEL_COUNT];
+
+    // The frames of several senders must not be interleaved
+    sc_mutex send_mutex;
+
+    const struct sc_mux_callbacks *cbs; // may be NULL
+    void *cbs_userdata;
+};
+
+struct sc_mux_callbacks {
+    /**
+     * Called when the connection is lost, to resume the streams over a new
+     * connection
+     *
+     * Return a new connected socket (owned by the mux from now on), or
+     * SC_SOCKET_NONE if the connection could not be resumed.
+     *
+     * It is called from the receiver or sender which detected the failure,
+     * while the others wait.
+     */
+    sc_socket (*reconnect)(struct sc_mux *mux, void *userdata);
+};
+
+bool
+sc_mux_init(struct sc_mux *mux, sc_socket socket);
+
+// Resume the streams over a new connection when the socket fails
+// Must be called before any receiver or sender is started.
+void
+sc_mux_set_callbacks(struct sc_mux *mux, const struct sc_mux_callbacks *cbs,
+                     void *cbs_userdata);
+
+void
+sc_mux_destroy(struct sc_mux *mux);
+
+// Receive at most len bytes of the given channel
+// Return -1 on error or end of stream, or SC_MUX_RESUMED if the connection has
+// been replaced since the last call (the next calls receive the new stream).
+ssize_t
+sc_mux_recv(struct sc_mux *mux, enum sc_mux_channel channel, void *buf,
+            size_t len);
+
+// Receive exactly len bytes of the given channel (unless an error occurs)
+// On SC_MUX_RESUMED, the bytes received so far are discarded.
+ssize_t
+sc_mux_recv_all(struct sc_mux *mux, enum sc_mux_channel channel, void *buf,
+                size_t len);
+
+// Send len bytes as a single frame of the given channel
+// If the connection is replaced meanwhile, the frame is sent again over the new
+// connection.
+ssize_t
+sc_mux_send_all(struct sc_mux *mux, enum sc_mux_channel channel,
+                const void *buf, size_t len);
+
+// Wake up the receivers waiting for their turn, they will fail
+// The socket itself is not shut down. The connection is not replaced anymore.
+void
+sc_mux_interrupt(struct sc_mux *mux);
+
+#endif
@@ -4,16 +4,31 @@ const struct scrcpy_options scrcpy_options_default = {
     .serial = NULL,
     .crop = NULL,
     .record_filename = NULL,
+    .timelapse_filename = NULL,
     .window_title = NULL,
     .push_target = NULL,
     .render_driver = NULL,
     .codec_options = NULL,
     .encoder_name = NULL,
+    .input_record_filename = NULL,
+    .input_replay_filename = NULL,
+    .keymap_filename = NULL,
+    .keymap_profile = NULL,
 #ifdef HAVE_V4L2
     .v4l2_device = NULL,
+#endif
+#ifdef HAVE_SHM_SINK
+    .shm_sink_name = NULL,
 #endif
     .log_level = SC_LOG_LEVEL_INFO,
     .record_format = SC_RECORD_FORMAT_AUTO,
+    .record_queue_policy = SC_RECORD_QUEUE_POLICY_BLOCK,
+    .record_queue_size = 64000000, // "64M", as documented and parsed
+    .record_queue_packets = 1024,
+    .timelapse_format = SC_RECORD_FORMAT_AUTO,
+    .timelapse_interval = 0,
+    .timelapse_threshold = 0,
+    .timelapse_crf = 23,
     .keyboard_input_mode = SC_KEYBOARD_INPUT_MODE_INJECT,
     .port_range = {
         .first = DEFAULT_LOCAL_PORT_RANGE_FIRST,
@@ -27,7 +42,10 @@ const struct scrcpy_options scrcpy_options_default = {
     },
     .max_size = 0,
     .bit_rate = DEFAULT_BIT_RATE,
+    .adaptive_bit_rate_min = 1000000,
+    .adaptive_bit_rate_max = 0,
     .max_fps = 0,
+    .camera_rate = 120,
     .lock_video_orientation = SC_LOCK_VIDEO_ORIENTATION_UNLOCKED,
     .rotation = 0,
     .window_x = SC_WINDOW_POSITION_UNDEFINED,
@@ -37,6 +55,11 @@ const struct scrcpy_options scrcpy_options_default = {
     .display_id = 0,
     .display_buffer = 0,
     .v4l2_buffer = 0,
+    .v4l2_pixel_format = SC_V4L2_PIXEL_FORMAT_YUV420,
+    .v4l2_width = 0,
+    .v4l2_height = 0,
+    .latency_probe_interval = 0,
+    .input_replay_speed = 1,
     .show_touches = false,
     .fullscreen = false,
     .always_on_top = false,
@@ -48,10 +71,16 @@ const struct scrcpy_options scrcpy_options_default = {
     .mipmaps = true,
     .stay_awake = false,
     .force_adb_forward = false,
+    .multiplex = false,
+    .resume = false,
+    .udp = false,
     .disable_screensaver = false,
     .forward_key_repeat = true,
     .forward_all_clicks = false,
     .legacy_paste = false,
+    .latency_probe = false,
+    .adaptive_bit_rate = false,
+    .low_latency = false,
     .power_off_on_close = false,
     .clipboard_autosync = true,
     .tcpip = false,
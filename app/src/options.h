@@ -23,6 +23,24 @@ enum sc_record_format {
     SC_RECORD_FORMAT_MKV,
 };
 
+enum sc_record_queue_policy {
+    // Block the stream until the recorder catches up.
+    // This is the default policy.
+    SC_RECORD_QUEUE_POLICY_BLOCK,
+
+    // Drop packets until the next keyframe.
+    SC_RECORD_QUEUE_POLICY_DROP,
+
+    // Stop the stream (and the recording).
+    SC_RECORD_QUEUE_POLICY_FAIL,
+};
+
+enum sc_v4l2_pixel_format {
+    SC_V4L2_PIXEL_FORMAT_YUV420,
+    SC_V4L2_PIXEL_FORMAT_YUYV,
+    SC_V4L2_PIXEL_FORMAT_NV12,
+};
+
 enum sc_lock_video_orientation {
     SC_LOCK_VIDEO_ORIENTATION_UNLOCKED = -1,
     // lock the current orientation when scrcpy starts
@@ -79,16 +97,31 @@ struct scrcpy_options {
     const char *serial;
     const char *crop;
     const char *record_filename;
+    const char *timelapse_filename;
     const char *window_title;
     const char *push_target;
     const char *render_driver;
     const char *codec_options;
     const char *encoder_name;
+    const char *input_record_filename;
+    const char *input_replay_filename;
+    const char *keymap_filename; // NULL for the built-in keymap
+    const char *keymap_profile; // NULL for the first profile
 #ifdef HAVE_V4L2
     const char *v4l2_device;
+#endif
+#ifdef HAVE_SHM_SINK
+    const char *shm_sink_name;
 #endif
     enum sc_log_level log_level;
     enum sc_record_format record_format;
+    enum sc_record_queue_policy record_queue_policy;
+    uint32_t record_queue_size; // in bytes
+    uint32_t record_queue_packets;
+    enum sc_record_format timelapse_format;
+    uint16_t timelapse_interval;
+    uint8_t timelapse_threshold;
+    uint8_t timelapse_crf;
     enum sc_keyboard_input_mode keyboard_input_mode;
     struct sc_port_range port_range;
     uint32_t tunnel_host;
@@ -96,7 +129,10 @@ struct scrcpy_options {
     struct sc_shortcut_mods shortcut_mods;
     uint16_t max_size;
     uint32_t bit_rate;
+    uint32_t adaptive_bit_rate_min;
+    uint32_t adaptive_bit_rate_max; // 0 for the bit-rate
     uint16_t max_fps;
+    uint16_t camera_rate; // 0 for no limit
     enum sc_lock_video_orientation lock_video_orientation;
     uint8_t rotation;
     int16_t window_x; // SC_WINDOW_POSITION_UNDEFINED for "auto"
@@ -106,6 +142,11 @@ struct scrcpy_options {
     uint32_t display_id;
     sc_tick display_buffer;
     sc_tick v4l2_buffer;
+    enum sc_v4l2_pixel_format v4l2_pixel_format;
+    uint16_t v4l2_width; // 0 for the video size
+    uint16_t v4l2_height;
+    sc_tick latency_probe_interval; // 0 for the default interval
+    float input_replay_speed; // 0 for as fast as possible
     bool show_touches;
     bool fullscreen;
     bool always_on_top;
@@ -117,10 +158,16 @@ struct scrcpy_options {
     bool mipmaps;
     bool stay_awake;
     bool force_adb_forward;
+    bool multiplex;
+    bool resume;
+    bool udp;
     bool disable_screensaver;
     bool forward_key_repeat;
     bool forward_all_clicks;
     bool legacy_paste;
+    bool latency_probe;
+    bool adaptive_bit_rate;
+    bool low_latency;
     bool power_off_on_close;
     bool clipboard_autosync;
     bool tcpip;
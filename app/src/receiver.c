@@ -1,6 +1,7 @@
 #include "receiver.h"
 
 #include <assert.h>
+#include <inttypes.h>
 #include <SDL2/SDL_clipboard.h>
 
 #include "device_msg.h"
@@ -15,7 +16,9 @@ receiver_init(struct receiver *receiver, sc_socket control_socket,
     }
 
     receiver->control_socket = control_socket;
+    receiver->mux = NULL;
     receiver->acksync = acksync;
+    sc_rtt_stats_init(&receiver->rtt_stats);
 
     return true;
 }
@@ -47,9 +50,31 @@ process_msg(struct receiver *receiver, struct device_msg *msg) {
                  msg->ack_clipboard.sequence);
             sc_acksync_ack(receiver->acksync, msg->ack_clipboard.sequence);
             break;
+        case DEVICE_MSG_TYPE_PONG: {
+            // the timestamp has been generated by sc_tick_now_precise() on
+            // ping, the device just echoes it
+            sc_tick now = sc_tick_now_precise();
+            sc_tick rtt = now - (sc_tick) msg->pong.timestamp;
+            LOGV("Pong rtt=%" PRItick "us", rtt);
+            sc_mutex_lock(&receiver->mutex);
+            sc_rtt_stats_push(&receiver->rtt_stats, rtt);
+            sc_mutex_unlock(&receiver->mutex);
+            break;
+        }
     }
 }
 
+bool
+receiver_take_rtt_percentiles(struct receiver *receiver,
+                              struct sc_rtt_percentiles *out) {
+    sc_mutex_lock(&receiver->mutex);
+    bool ok = sc_rtt_stats_compute(&receiver->rtt_stats, out);
+    sc_rtt_stats_init(&receiver->rtt_stats);
+    sc_mutex_unlock(&receiver->mutex);
+
+    return ok;
+}
+
 static ssize_t
 process_msgs(struct receiver *receiver, const unsigned char *buf, size_t len) {
     size_t head = 0;
@@ -74,6 +99,14 @@ process_msgs(struct receiver *receiver, const unsigned char *buf, size_t len) {
     }
 }
 
+static ssize_t
+receiver_recv(struct receiver *receiver, void *buf, size_t len) {
+    if (receiver->mux) {
+        return sc_mux_recv(receiver->mux, SC_MUX_CHANNEL_CONTROL, buf, len);
+    }
+    return net_recv(receiver->control_socket, buf, len);
+}
+
 static int
 run_receiver(void *data) {
     struct receiver *receiver = data;
@@ -83,8 +116,14 @@ run_receiver(void *data) {
 
     for (;;) {
         assert(head < DEVICE_MSG_MAX_SIZE);
-        ssize_t r = net_recv(receiver->control_socket, buf + head,
-                             DEVICE_MSG_MAX_SIZE - head);
+        ssize_t r = receiver_recv(receiver, buf + head,
+                                  DEVICE_MSG_MAX_SIZE - head);
+        if (r == SC_MUX_RESUMED) {
+            // a partial message is lost, the new connection starts with a
+            // new message
+            head = 0;
+            continue;
+        }
         if (r <= 0) {
             LOGD("Receiver stopped");
             break;
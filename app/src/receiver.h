@@ -5,18 +5,24 @@
 
 #include <stdbool.h>
 
+#include "mux.h"
 #include "util/acksync.h"
 #include "util/net.h"
+#include "util/rtt_stats.h"
 #include "util/thread.h"
 
 // receive events from the device
 // managed by the controller
 struct receiver {
     sc_socket control_socket;
+    struct sc_mux *mux; // if set, the socket is multiplexed
     sc_thread thread;
     sc_mutex mutex;
 
     struct sc_acksync *acksync;
+
+    // round-trip times of the pings, protected by the mutex
+    struct sc_rtt_stats rtt_stats;
 };
 
 bool
@@ -29,6 +35,13 @@ receiver_destroy(struct receiver *receiver);
 bool
 receiver_start(struct receiver *receiver);
 
+// Compute the round-trip time percentiles of the pongs received since the last
+// call, and reset the statistics
+// Return false if no pong has been received.
+bool
+receiver_take_rtt_percentiles(struct receiver *receiver,
+                              struct sc_rtt_percentiles *out);
+
 // no receiver_stop(), it will automatically stop on control_socket shutdown
 
 void
@@ -1,6 +1,7 @@
 #include "recorder.h"
 
 #include <assert.h>
+#include <inttypes.h>
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 #include <libavutil/time.h>
@@ -30,24 +31,33 @@ find_muxer(const char *name) {
     return oformat;
 }
 
+#define RECORDER_STATS_LOG_INTERVAL SC_TICK_FROM_SEC(10)
+
+// must be called with the mutex locked
 static struct record_packet *
-record_packet_new(const AVPacket *packet) {
-    struct record_packet *rec = malloc(sizeof(*rec));
-    if (!rec) {
-        LOG_OOM();
-        return NULL;
-    }
+recorder_packet_new(struct recorder *recorder, const AVPacket *packet) {
+    struct record_packet *rec;
+    if (!sc_queue_is_empty(&recorder->pool)) {
+        // reuse a packet written previously
+        sc_queue_take(&recorder->pool, next, &rec);
+    } else {
+        rec = malloc(sizeof(*rec));
+        if (!rec) {
+            LOG_OOM();
+            return NULL;
+        }
 
-    rec->packet = av_packet_alloc();
-    if (!rec->packet) {
-        LOG_OOM();
-        free(rec);
-        return NULL;
+        rec->packet = av_packet_alloc();
+        if (!rec->packet) {
+            LOG_OOM();
+            free(rec);
+            return NULL;
+        }
     }
 
     if (av_packet_ref(rec->packet, packet)) {
-        av_packet_free(&rec->packet);
-        free(rec);
+        // the packet is empty, it can be recycled
+        sc_queue_push(&recorder->pool, next, rec);
         return NULL;
     }
     return rec;
@@ -59,6 +69,13 @@ record_packet_delete(struct record_packet *rec) {
     free(rec);
 }
 
+// must be called with the mutex locked
+static void
+recorder_packet_recycle(struct recorder *recorder, struct record_packet *rec) {
+    av_packet_unref(rec->packet);
+    sc_queue_push(&recorder->pool, next, rec);
+}
+
 static void
 recorder_queue_clear(struct recorder_queue *queue) {
     while (!sc_queue_is_empty(queue)) {
@@ -68,6 +85,31 @@ recorder_queue_clear(struct recorder_queue *queue) {
     }
 }
 
+// must be called with the mutex locked
+static bool
+recorder_queue_is_full(struct recorder *recorder, const AVPacket *packet) {
+    const struct recorder_stats *stats = &recorder->stats;
+    if (!stats->packets) {
+        // always accept a packet in an empty queue, even if it is bigger than
+        // the byte limit, otherwise it could never be recorded
+        return false;
+    }
+
+    return stats->packets >= recorder->queue_max_packets
+        || stats->bytes + packet->size > recorder->queue_max_bytes;
+}
+
+// must be called with the mutex locked
+static void
+recorder_log_stats(struct recorder *recorder) {
+    const struct recorder_stats *stats = &recorder->stats;
+    LOGV("Recorder queue: %u packets, %" PRIu64_ " bytes "
+         "(high-water: %u packets, %" PRIu64_ " bytes), "
+         "%" PRIu64_ " dropped, %" PRIu64_ " blocked",
+         stats->packets, stats->bytes, stats->max_packets, stats->max_bytes,
+         stats->dropped, stats->blocked);
+}
+
 static const char *
 recorder_get_format_name(enum sc_record_format format) {
     switch (format) {
@@ -140,7 +182,13 @@ run_recorder(void *data) {
         sc_mutex_lock(&recorder->mutex);
 
         while (!recorder->stopped && sc_queue_is_empty(&recorder->queue)) {
-            sc_cond_wait(&recorder->queue_cond, &recorder->mutex);
+            bool signaled = sc_cond_timedwait(&recorder->queue_cond,
+                                              &recorder->mutex,
+                                              recorder->next_stats_log);
+            if (!signaled) {
+                recorder_log_stats(recorder);
+                recorder->next_stats_log += RECORDER_STATS_LOG_INTERVAL;
+            }
         }
 
         // if stopped is set, continue to process the remaining events (to
@@ -167,6 +215,18 @@ run_recorder(void *data) {
         struct record_packet *rec;
         sc_queue_take(&recorder->queue, next, &rec);
 
+        assert(recorder->stats.packets);
+        assert(recorder->stats.bytes >= (uint64_t) rec->packet->size);
+        --recorder->stats.packets;
+        recorder->stats.bytes -= rec->packet->size;
+        sc_cond_signal(&recorder->space_cond);
+
+        sc_tick now = sc_tick_now();
+        if (now >= recorder->next_stats_log) {
+            recorder_log_stats(recorder);
+            recorder->next_stats_log = now + RECORDER_STATS_LOG_INTERVAL;
+        }
+
         sc_mutex_unlock(&recorder->mutex);
 
         // recorder->previous is only written from this thread, no need to lock
@@ -187,17 +247,31 @@ run_recorder(void *data) {
         }
 
         bool ok = recorder_write(recorder, previous->packet);
-        record_packet_delete(previous);
+
+        sc_mutex_lock(&recorder->mutex);
+        recorder_packet_recycle(recorder, previous);
         if (!ok) {
             LOGE("Could not record packet");
 
-            sc_mutex_lock(&recorder->mutex);
             recorder->failed = true;
             // discard pending packets
             recorder_queue_clear(&recorder->queue);
+            recorder->stats.packets = 0;
+            recorder->stats.bytes = 0;
+            // wake up the stream thread if it is blocked on a full queue
+            sc_cond_signal(&recorder->space_cond);
             sc_mutex_unlock(&recorder->mutex);
             break;
         }
+        sc_mutex_unlock(&recorder->mutex);
+    }
+
+    const struct recorder_stats *stats = &recorder->stats;
+    LOGD("Recorder queue high-water: %u packets, %" PRIu64_ " bytes",
+         stats->max_packets, stats->max_bytes);
+    if (stats->dropped) {
+        LOGW("Recorder dropped %" PRIu64_ " packets (queue full)",
+             stats->dropped);
     }
 
     if (!recorder->failed) {
@@ -238,24 +312,33 @@ recorder_open(struct recorder *recorder, const AVCodec *input_codec) {
         goto error_mutex_destroy;
     }
 
+    ok = sc_cond_init(&recorder->space_cond);
+    if (!ok) {
+        goto error_queue_cond_destroy;
+    }
+
     sc_queue_init(&recorder->queue);
+    sc_queue_init(&recorder->pool);
     recorder->stopped = false;
     recorder->failed = false;
     recorder->header_written = false;
     recorder->previous = NULL;
+    recorder->dropping = false;
+    recorder->stats = (struct recorder_stats) {0};
+    recorder->next_stats_log = sc_tick_now() + RECORDER_STATS_LOG_INTERVAL;
 
     const char *format_name = recorder_get_format_name(recorder->format);
     assert(format_name);
     const AVOutputFormat *format = find_muxer(format_name);
     if (!format) {
         LOGE("Could not find muxer");
-        goto error_cond_destroy;
+        goto error_space_cond_destroy;
     }
 
     recorder->ctx = avformat_alloc_context();
     if (!recorder->ctx) {
         LOG_OOM();
-        goto error_cond_destroy;
+        goto error_space_cond_destroy;
     }
 
     // contrary to the deprecated API (av_oformat_next()), av_muxer_iterate()
@@ -302,7 +385,9 @@ error_avio_close:
     avio_close(recorder->ctx->pb);
 error_avformat_free_context:
     avformat_free_context(recorder->ctx);
-error_cond_destroy:
+error_space_cond_destroy:
+    sc_cond_destroy(&recorder->space_cond);
+error_queue_cond_destroy:
     sc_cond_destroy(&recorder->queue_cond);
 error_mutex_destroy:
     sc_mutex_destroy(&recorder->mutex);
@@ -321,6 +406,8 @@ recorder_close(struct recorder *recorder) {
 
     avio_close(recorder->ctx->pb);
     avformat_free_context(recorder->ctx);
+    recorder_queue_clear(&recorder->pool);
+    sc_cond_destroy(&recorder->space_cond);
     sc_cond_destroy(&recorder->queue_cond);
     sc_mutex_destroy(&recorder->mutex);
 }
@@ -336,7 +423,61 @@ recorder_push(struct recorder *recorder, const AVPacket *packet) {
         return false;
     }
 
-    struct record_packet *rec = record_packet_new(packet);
+    struct recorder_stats *stats = &recorder->stats;
+
+    // config packets are never dropped, they are required to write the
+    // header and to decode the following packets
+    bool is_config = packet->pts == AV_NOPTS_VALUE;
+    bool is_key = packet->flags & AV_PKT_FLAG_KEY;
+
+    if (recorder->dropping && !is_config) {
+        if (!is_key || recorder_queue_is_full(recorder, packet)) {
+            // keep dropping until the next keyframe
+            ++stats->dropped;
+            sc_mutex_unlock(&recorder->mutex);
+            return true;
+        }
+
+        LOGI("Recorder resumed on keyframe (%" PRIu64_ " packets dropped)",
+             stats->dropped);
+        recorder->dropping = false;
+    }
+
+    if (recorder_queue_is_full(recorder, packet)) {
+        switch (recorder->queue_policy) {
+            case SC_RECORD_QUEUE_POLICY_BLOCK:
+                ++stats->blocked;
+                while (!recorder->failed
+                        && recorder_queue_is_full(recorder, packet)) {
+                    sc_cond_wait(&recorder->space_cond, &recorder->mutex);
+                }
+                if (recorder->failed) {
+                    sc_mutex_unlock(&recorder->mutex);
+                    return false;
+                }
+                break;
+            case SC_RECORD_QUEUE_POLICY_DROP:
+                if (!is_config) {
+                    LOGW("Recorder queue full, dropping packets until the "
+                         "next keyframe");
+                    recorder->dropping = true;
+                    ++stats->dropped;
+                    sc_mutex_unlock(&recorder->mutex);
+                    return true;
+                }
+                break;
+            default:
+                assert(recorder->queue_policy == SC_RECORD_QUEUE_POLICY_FAIL);
+                LOGE("Recorder queue full (%u packets, %" PRIu64_ " bytes)",
+                     stats->packets, stats->bytes);
+                // reject the packet (this will stop the stream), the pending
+                // packets will still be written on close
+                sc_mutex_unlock(&recorder->mutex);
+                return false;
+        }
+    }
+
+    struct record_packet *rec = recorder_packet_new(recorder, packet);
     if (!rec) {
         LOG_OOM();
         sc_mutex_unlock(&recorder->mutex);
@@ -344,6 +485,16 @@ recorder_push(struct recorder *recorder, const AVPacket *packet) {
     }
 
     sc_queue_push(&recorder->queue, next, rec);
+
+    ++stats->packets;
+    stats->bytes += packet->size;
+    if (stats->packets > stats->max_packets) {
+        stats->max_packets = stats->packets;
+    }
+    if (stats->bytes > stats->max_bytes) {
+        stats->max_bytes = stats->bytes;
+    }
+
     sc_cond_signal(&recorder->queue_cond);
 
     sc_mutex_unlock(&recorder->mutex);
@@ -372,7 +523,13 @@ bool
 recorder_init(struct recorder *recorder,
               const char *filename,
               enum sc_record_format format,
-              struct sc_size declared_frame_size) {
+              struct sc_size declared_frame_size,
+              unsigned queue_max_packets,
+              uint64_t queue_max_bytes,
+              enum sc_record_queue_policy queue_policy) {
+    assert(queue_max_packets);
+    assert(queue_max_bytes);
+
     recorder->filename = strdup(filename);
     if (!recorder->filename) {
         LOG_OOM();
@@ -381,6 +538,9 @@ recorder_init(struct recorder *recorder,
 
     recorder->format = format;
     recorder->declared_frame_size = declared_frame_size;
+    recorder->queue_max_packets = queue_max_packets;
+    recorder->queue_max_bytes = queue_max_bytes;
+    recorder->queue_policy = queue_policy;
 
     static const struct sc_packet_sink_ops ops = {
         .open = recorder_packet_sink_open,
@@ -397,3 +557,10 @@ void
 recorder_destroy(struct recorder *recorder) {
     free(recorder->filename);
 }
+
+void
+recorder_get_stats(struct recorder *recorder, struct recorder_stats *stats) {
+    sc_mutex_lock(&recorder->mutex);
+    *stats = recorder->stats;
+    sc_mutex_unlock(&recorder->mutex);
+}
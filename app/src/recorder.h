@@ -4,6 +4,7 @@
 #include "common.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <libavformat/avformat.h>
 
 #include "coords.h"
@@ -11,6 +12,7 @@
 #include "trait/packet_sink.h"
 #include "util/queue.h"
 #include "util/thread.h"
+#include "util/tick.h"
 
 struct record_packet {
     AVPacket *packet;
@@ -19,6 +21,18 @@ struct record_packet {
 
 struct recorder_queue SC_QUEUE(struct record_packet);
 
+struct recorder_stats {
+    // current queue depth
+    unsigned packets;
+    uint64_t bytes;
+    // high-water marks
+    unsigned max_packets;
+    uint64_t max_bytes;
+    // number of packets dropped or delayed due to a full queue
+    uint64_t dropped;
+    uint64_t blocked;
+};
+
 struct recorder {
     struct sc_packet_sink packet_sink; // packet sink trait
 
@@ -31,10 +45,25 @@ struct recorder {
     sc_thread thread;
     sc_mutex mutex;
     sc_cond queue_cond;
+    sc_cond space_cond; // signaled when packets are removed from the queue
     bool stopped; // set on recorder_close()
     bool failed; // set on packet write failure
     struct recorder_queue queue;
 
+    // limits of the queue (packets pushed but not written yet)
+    unsigned queue_max_packets;
+    uint64_t queue_max_bytes;
+    enum sc_record_queue_policy queue_policy;
+    // set on queue overflow with SC_RECORD_QUEUE_POLICY_DROP, reset on the
+    // next keyframe
+    bool dropping;
+    struct recorder_stats stats;
+    sc_tick next_stats_log;
+
+    // record packets are recycled rather than freed, to avoid allocations
+    // for every packet (protected by the mutex)
+    struct recorder_queue pool;
+
     // we can write a packet only once we received the next one so that we can
     // set its duration (next_pts - current_pts)
     // "previous" is only accessed from the recorder thread, so it does not
@@ -44,9 +73,15 @@ struct recorder {
 
 bool
 recorder_init(struct recorder *recorder, const char *filename,
-              enum sc_record_format format, struct sc_size declared_frame_size);
+              enum sc_record_format format, struct sc_size declared_frame_size,
+              unsigned queue_max_packets, uint64_t queue_max_bytes,
+              enum sc_record_queue_policy queue_policy);
 
 void
 recorder_destroy(struct recorder *recorder);
 
+// may be called from any thread while the recorder is open
+void
+recorder_get_stats(struct recorder *recorder, struct recorder_stats *stats);
+
 #endif
@@ -0,0 +1,561 @@
+#include "rtp_receiver.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/buffer_util.h"
+#include "util/log.h"
+
+#define SC_RTP_VERSION 2
+
+#define NAL_TYPE_IDR 5
+#define NAL_TYPE_STAP_A 24
+#define NAL_TYPE_FU_A 28
+
+// Do not request key frames more often if the requested one is lost too
+#define SC_RTP_KEY_FRAME_REQUEST_INTERVAL SC_TICK_FROM_MS(300)
+
+static const uint8_t start_code[] = {0, 0, 0, 1};
+
+bool
+sc_rtp_receiver_init(struct sc_rtp_receiver *rr, sc_tick reorder_delay) {
+    rr->packets = calloc(SC_RTP_WINDOW, sizeof(*rr->packets));
+    if (!rr->packets) {
+        LOG_OOM();
+        return false;
+    }
+
+    rr->fecs = calloc(SC_RTP_FEC_SLOTS, sizeof(*rr->fecs));
+    if (!rr->fecs) {
+        LOG_OOM();
+        free(rr->packets);
+        return false;
+    }
+
+    rr->reorder_delay = reorder_delay;
+    rr->fec_head = 0;
+    rr->started = false;
+    rr->next_seq = 0;
+    rr->max_seq = 0;
+    rr->gap_since = 0;
+
+    rr->au = NULL;
+    rr->au_size = 0;
+    rr->au_capacity = 0;
+    rr->au_timestamp = 0;
+    rr->au_broken = false;
+    rr->au_has_vcl = false;
+    rr->au_has_idr = false;
+    rr->fu_started = false;
+    rr->prev_marker = true;
+
+    // The stream starts with a config packet and a key frame
+    rr->waiting_key_frame = true;
+    rr->key_frame_needed = false;
+    rr->last_key_frame_request = 0;
+
+    rr->has_timestamp = false;
+    rr->ext_timestamp = 0;
+
+    memset(&rr->stats, 0, sizeof(rr->stats));
+
+    return true;
+}
+
+void
+sc_rtp_receiver_destroy(struct sc_rtp_receiver *rr) {
+    free(rr->au);
+    free(rr->fecs);
+    free(rr->packets);
+}
+
+static inline bool
+seq_before(uint16_t a, uint16_t b) {
+    return (int16_t) (uint16_t) (a - b) < 0;
+}
+
+static struct sc_rtp_packet *
+sc_rtp_receiver_get(struct sc_rtp_receiver *rr, uint16_t seq) {
+    struct sc_rtp_packet *packet = &rr->packets[seq % SC_RTP_WINDOW];
+    return packet->present && packet->seq == seq ? packet : NULL;
+}
+
+static struct sc_rtp_packet *
+sc_rtp_receiver_store(struct sc_rtp_receiver *rr, uint16_t seq, bool marker,
+                      uint32_t timestamp, const uint8_t *payload,
+                      uint16_t len) {
+    assert(len <= SC_RTP_MAX_PAYLOAD_LENGTH);
+    struct sc_rtp_packet *packet = &rr->packets[seq % SC_RTP_WINDOW];
+    packet->present = true;
+    packet->seq = seq;
+    packet->marker = marker;
+    packet->timestamp = timestamp;
+    packet->len = len;
+    memcpy(packet->payload, payload, len);
+
+    if (seq_before(rr->max_seq, seq)) {
+        rr->max_seq = seq;
+    }
+
+    return packet;
+}
+
+static void
+sc_rtp_receiver_on_loss(struct sc_rtp_receiver *rr) {
+    // The current frame is incomplete, and the next packets are useless until
+    // the end of this frame (their frame is unknown)
+    rr->au_broken = true;
+    rr->prev_marker = false;
+    rr->gap_since = 0;
+
+    // The next frames reference a missing frame
+    rr->waiting_key_frame = true;
+    rr->key_frame_needed = true;
+}
+
+static void
+sc_rtp_receiver_try_recover(struct sc_rtp_receiver *rr,
+                            struct sc_rtp_fec *fec) {
+    assert(fec->present);
+
+    uint16_t missing_seq = 0;
+    unsigned missing_count = 0;
+    for (unsigned i = 0; i < fec->count; ++i) {
+        uint16_t seq = fec->base_seq + i;
+        if (!sc_rtp_receiver_get(rr, seq)) {
+            missing_seq = seq;
+            if (++missing_count > 1) {
+                // not (yet) recoverable
+                return;
+            }
+        }
+    }
+
+    // In any case, this FEC packet will not be useful anymore
+    fec->present = false;
+
+    if (!missing_count || seq_before(missing_seq, rr->next_seq)) {
+        // nothing to recover, or too late
+        return;
+    }
+
+    uint8_t block[SC_RTP_FEC_BLOCK_HEADER_LENGTH + SC_RTP_MAX_PAYLOAD_LENGTH];
+    memcpy(block, fec->block, fec->len);
+    for (unsigned i = 0; i < fec->count; ++i) {
+        uint16_t seq = fec->base_seq + i;
+        if (seq == missing_seq) {
+            continue;
+        }
+
+        struct sc_rtp_packet *packet = sc_rtp_receiver_get(rr, seq);
+        assert(packet);
+        if (SC_RTP_FEC_BLOCK_HEADER_LENGTH + packet->len > fec->len) {
+            LOGD("RTP: inconsistent FEC packet");
+            return;
+        }
+
+        block[0] ^= packet->marker;
+        block[1] ^= packet->len >> 8;
+        block[2] ^= packet->len;
+        for (unsigned j = 0; j < packet->len; ++j) {
+            block[SC_RTP_FEC_BLOCK_HEADER_LENGTH + j] ^= packet->payload[j];
+        }
+    }
+
+    uint16_t len = buffer_read16be(&block[1]);
+    if (block[0] > 1 || SC_RTP_FEC_BLOCK_HEADER_LENGTH + len > fec->len) {
+        LOGD("RTP: inconsistent FEC packet");
+        return;
+    }
+
+    sc_rtp_receiver_store(rr, missing_seq, block[0], fec->timestamp,
+                          &block[SC_RTP_FEC_BLOCK_HEADER_LENGTH], len);
+    ++rr->stats.recovered;
+}
+
+static void
+sc_rtp_receiver_push_media(struct sc_rtp_receiver *rr, uint16_t seq,
+                           bool marker, uint32_t timestamp,
+                           const uint8_t *payload, size_t len) {
+    if (len > SC_RTP_MAX_PAYLOAD_LENGTH) {
+        LOGD("RTP: payload too large (%u bytes)", (unsigned) len);
+        return;
+    }
+
+    if (!rr->started) {
+        rr->started = true;
+        rr->next_seq = seq;
+        rr->max_seq = seq - 1;
+    }
+
+    if (sc_rtp_receiver_get(rr, seq)) {
+        // duplicated, or already recovered by FEC (if it was only reordered)
+        return;
+    }
+
+    if (seq_before(seq, rr->next_seq)) {
+        ++rr->stats.late;
+        return;
+    }
+
+    if ((uint16_t) (seq - rr->next_seq) >= SC_RTP_WINDOW) {
+        // The packets before the window cannot be kept anymore
+        uint16_t new_next_seq = seq - SC_RTP_WINDOW + 1;
+        while (rr->next_seq != new_next_seq) {
+            if (!sc_rtp_receiver_get(rr, rr->next_seq)) {
+                ++rr->stats.lost;
+            }
+            ++rr->next_seq;
+        }
+        sc_rtp_receiver_on_loss(rr);
+    }
+
+    sc_rtp_receiver_store(rr, seq, marker, timestamp, payload, len);
+    ++rr->stats.received;
+
+    // This packet may complete a FEC group
+    for (unsigned i = 0; i < SC_RTP_FEC_SLOTS; ++i) {
+        struct sc_rtp_fec *fec = &rr->fecs[i];
+        if (fec->present && (uint16_t) (seq - fec->base_seq) < fec->count) {
+            sc_rtp_receiver_try_recover(rr, fec);
+        }
+    }
+}
+
+static void
+sc_rtp_receiver_push_fec(struct sc_rtp_receiver *rr, uint32_t timestamp,
+                         const uint8_t *payload, size_t len) {
+    if (len <= SC_RTP_FEC_HEADER_LENGTH + SC_RTP_FEC_BLOCK_HEADER_LENGTH
+            || len > SC_RTP_FEC_HEADER_LENGTH + SC_RTP_FEC_BLOCK_HEADER_LENGTH
+                   + SC_RTP_MAX_PAYLOAD_LENGTH) {
+        LOGD("RTP: invalid FEC packet length (%u bytes)", (unsigned) len);
+        return;
+    }
+
+    uint16_t base_seq = buffer_read16be(payload);
+    uint8_t count = payload[2];
+    if (!count) {
+        return;
+    }
+
+    if (!rr->started) {
+        // the first media packets may have been lost
+        rr->started = true;
+        rr->next_seq = base_seq;
+        rr->max_seq = base_seq - 1;
+    }
+
+    uint16_t last_seq = base_seq + count - 1;
+    if (seq_before(last_seq, rr->next_seq)) {
+        // the whole group has already been processed
+        return;
+    }
+
+    struct sc_rtp_fec *fec = &rr->fecs[rr->fec_head];
+    rr->fec_head = (rr->fec_head + 1) % SC_RTP_FEC_SLOTS;
+
+    fec->present = true;
+    fec->base_seq = base_seq;
+    fec->count = count;
+    fec->timestamp = timestamp;
+    fec->len = len - SC_RTP_FEC_HEADER_LENGTH;
+    memcpy(fec->block, &payload[SC_RTP_FEC_HEADER_LENGTH], fec->len);
+
+    sc_rtp_receiver_try_recover(rr, fec);
+}
+
+void
+sc_rtp_receiver_push(struct sc_rtp_receiver *rr, const uint8_t *data,
+                     size_t len) {
+    if (len < SC_RTP_HEADER_LENGTH || data[0] >> 6 != SC_RTP_VERSION) {
+        LOGD("RTP: invalid packet");
+        return;
+    }
+
+    bool padding = data[0] & 0x20;
+    bool extension = data[0] & 0x10;
+    unsigned csrc_count = data[0] & 0x0F;
+    bool marker = data[1] & 0x80;
+    uint8_t payload_type = data[1] & 0x7F;
+    uint16_t seq = buffer_read16be(&data[2]);
+    uint32_t timestamp = buffer_read32be(&data[4]);
+
+    size_t header_len = SC_RTP_HEADER_LENGTH + 4 * csrc_count;
+    if (extension) {
+        if (len < header_len + 4) {
+            LOGD("RTP: invalid packet");
+            return;
+        }
+        header_len += 4 + 4 * buffer_read16be(&data[header_len + 2]);
+    }
+
+    if (padding && len > header_len) {
+        len -= data[len - 1];
+    }
+
+    if (len < header_len) {
+        LOGD("RTP: invalid packet");
+        return;
+    }
+
+    const uint8_t *payload = &data[header_len];
+    size_t payload_len = len - header_len;
+
+    if (payload_type == SC_RTP_PAYLOAD_TYPE_H264) {
+        sc_rtp_receiver_push_media(rr, seq, marker, timestamp, payload,
+                                   payload_len);
+    } else if (payload_type == SC_RTP_PAYLOAD_TYPE_FEC) {
+        sc_rtp_receiver_push_fec(rr, timestamp, payload, payload_len);
+    } else {
+        LOGD("RTP: unexpected payload type %u", (unsigned) payload_type);
+    }
+}
+
+static bool
+sc_rtp_receiver_append(struct sc_rtp_receiver *rr, const uint8_t *data,
+                       size_t len) {
+    if (rr->au_size + len > rr->au_capacity) {
+        size_t capacity = rr->au_capacity ? rr->au_capacity : 0x10000;
+        while (rr->au_size + len > capacity) {
+            capacity *= 2;
+        }
+        uint8_t *au = realloc(rr->au, capacity);
+        if (!au) {
+            LOG_OOM();
+            return false;
+        }
+        rr->au = au;
+        rr->au_capacity = capacity;
+    }
+
+    memcpy(rr->au + rr->au_size, data, len);
+    rr->au_size += len;
+    return true;
+}
+
+static void
+sc_rtp_receiver_on_nal_type(struct sc_rtp_receiver *rr, uint8_t type) {
+    if (type >= 1 && type <= NAL_TYPE_IDR) {
+        rr->au_has_vcl = true;
+    }
+    if (type == NAL_TYPE_IDR) {
+        rr->au_has_idr = true;
+    }
+}
+
+static bool
+sc_rtp_receiver_append_nal(struct sc_rtp_receiver *rr, const uint8_t *nal,
+                           size_t len) {
+    assert(len);
+    sc_rtp_receiver_on_nal_type(rr, nal[0] & 0x1F);
+    return sc_rtp_receiver_append(rr, start_code, sizeof(start_code))
+        && sc_rtp_receiver_append(rr, nal, len);
+}
+
+// Append the NAL unit(s) of the packet to the current frame, in Annex B format
+static bool
+sc_rtp_receiver_depacketize(struct sc_rtp_receiver *rr,
+                            const struct sc_rtp_packet *packet) {
+    const uint8_t *payload = packet->payload;
+    size_t len = packet->len;
+    if (!len) {
+        return false;
+    }
+
+    uint8_t type = payload[0] & 0x1F;
+    if (type >= 1 && type < NAL_TYPE_STAP_A) {
+        // single NAL unit packet
+        return !rr->fu_started && sc_rtp_receiver_append_nal(rr, payload, len);
+    }
+
+    if (type == NAL_TYPE_STAP_A) {
+        if (rr->fu_started) {
+            return false;
+        }
+        size_t offset = 1;
+        while (offset < len) {
+            if (offset + 2 > len) {
+                return false;
+            }
+            size_t nal_len = buffer_read16be(&payload[offset]);
+            offset += 2;
+            if (!nal_len || offset + nal_len > len) {
+                return false;
+            }
+            if (!sc_rtp_receiver_append_nal(rr, &payload[offset], nal_len)) {
+                return false;
+            }
+            offset += nal_len;
+        }
+        return true;
+    }
+
+    if (type == NAL_TYPE_FU_A) {
+        if (len < 2) {
+            return false;
+        }
+        bool start = payload[1] & 0x80;
+        bool end = payload[1] & 0x40;
+        if (start == rr->fu_started) {
+            // a start while a NAL unit is in progress, or the opposite
+            return false;
+        }
+        if (start) {
+            // reconstruct the NAL unit header
+            uint8_t header = (payload[0] & 0xE0) | (payload[1] & 0x1F);
+            if (!sc_rtp_receiver_append_nal(rr, &header, 1)) {
+                return false;
+            }
+            rr->fu_started = true;
+        }
+        if (!sc_rtp_receiver_append(rr, &payload[2], len - 2)) {
+            return false;
+        }
+        if (end) {
+            rr->fu_started = false;
+        }
+        return true;
+    }
+
+    // STAP-B, MTAP and FU-B are not used in non-interleaved mode
+    return false;
+}
+
+static uint64_t
+sc_rtp_receiver_unwrap_timestamp(struct sc_rtp_receiver *rr,
+                                 uint32_t timestamp) {
+    if (!rr->has_timestamp) {
+        rr->has_timestamp = true;
+        rr->ext_timestamp = timestamp;
+    } else {
+        int32_t delta = (int32_t) (timestamp - (uint32_t) rr->ext_timestamp);
+        if (delta > 0 || (uint64_t) -(int64_t) delta <= rr->ext_timestamp) {
+            rr->ext_timestamp += delta;
+        }
+    }
+
+    // 90kHz to microseconds
+    return rr->ext_timestamp * 100 / 9;
+}
+
+// Return true if the completed frame must be delivered
+static bool
+sc_rtp_receiver_finish_frame(struct sc_rtp_receiver *rr,
+                             struct sc_rtp_frame *frame) {
+    if (rr->au_broken || rr->fu_started || !rr->au_size) {
+        ++rr->stats.dropped_frames;
+        return false;
+    }
+
+    bool config = !rr->au_has_vcl;
+    if (rr->waiting_key_frame && !config) {
+        if (!rr->au_has_idr) {
+            // it references a missing frame (the first packets of the stream
+            // may also have been lost before any gap could be detected)
+            ++rr->stats.dropped_frames;
+            rr->key_frame_needed = true;
+            return false;
+        }
+
+        rr->waiting_key_frame = false;
+        rr->key_frame_needed = false;
+    }
+
+    frame->data = rr->au;
+    frame->size = rr->au_size;
+    frame->config = config;
+    frame->pts = config
+               ? 0 : sc_rtp_receiver_unwrap_timestamp(rr, rr->au_timestamp);
+    ++rr->stats.frames;
+    return true;
+}
+
+// Return true if a frame is complete
+static bool
+sc_rtp_receiver_process(struct sc_rtp_receiver *rr,
+                        const struct sc_rtp_packet *packet,
+                        struct sc_rtp_frame *frame) {
+    if (rr->prev_marker) {
+        // start a new frame
+        rr->au_size = 0;
+        rr->au_timestamp = packet->timestamp;
+        rr->au_broken = false;
+        rr->au_has_vcl = false;
+        rr->au_has_idr = false;
+        rr->fu_started = false;
+    }
+    rr->prev_marker = packet->marker;
+
+    if (!rr->au_broken && !sc_rtp_receiver_depacketize(rr, packet)) {
+        LOGD("RTP: invalid H.264 payload");
+        rr->au_broken = true;
+    }
+
+    return packet->marker && sc_rtp_receiver_finish_frame(rr, frame);
+}
+
+bool
+sc_rtp_receiver_pop(struct sc_rtp_receiver *rr, sc_tick now,
+                    struct sc_rtp_frame *frame) {
+    if (!rr->started) {
+        return false;
+    }
+
+    for (;;) {
+        struct sc_rtp_packet *packet = sc_rtp_receiver_get(rr, rr->next_seq);
+        if (packet) {
+            ++rr->next_seq;
+            rr->gap_since = 0;
+            if (sc_rtp_receiver_process(rr, packet, frame)) {
+                return true;
+            }
+            continue;
+        }
+
+        if (seq_before(rr->max_seq, rr->next_seq)) {
+            // no packet after next_seq has been received yet
+            return false;
+        }
+
+        // A packet is missing, maybe only reordered
+        if (!rr->gap_since) {
+            rr->gap_since = now;
+        }
+        if (now - rr->gap_since < rr->reorder_delay) {
+            return false;
+        }
+
+        // Give up, skip to the next received packet (max_seq is received)
+        uint64_t lost = 0;
+        while (!sc_rtp_receiver_get(rr, rr->next_seq)) {
+            ++rr->next_seq;
+            ++lost;
+        }
+        rr->stats.lost += lost;
+        LOGD("RTP: %" PRIu64_ " packet(s) lost", lost);
+        sc_rtp_receiver_on_loss(rr);
+    }
+}
+
+sc_tick
+sc_rtp_receiver_get_deadline(const struct sc_rtp_receiver *rr) {
+    return rr->gap_since ? rr->gap_since + rr->reorder_delay : 0;
+}
+
+bool
+sc_rtp_receiver_consume_key_frame_request(struct sc_rtp_receiver *rr,
+                                          sc_tick now) {
+    if (!rr->key_frame_needed) {
+        return false;
+    }
+
+    if (rr->last_key_frame_request
+            && now - rr->last_key_frame_request
+                < SC_RTP_KEY_FRAME_REQUEST_INTERVAL) {
+        return false;
+    }
+
+    rr->last_key_frame_request = now;
+    return true;
+}
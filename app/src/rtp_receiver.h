@@ -0,0 +1,154 @@
+#ifndef SC_RTP_RECEIVER_H
+#define SC_RTP_RECEIVER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util/tick.h"
+
+// Receive the H.264 video stream over RTP (RFC 3550), for the UDP transport.
+//
+// The NAL units are packetized as defined by RFC 6184 (single NAL unit and
+// FU-A packets; STAP-A packets are also accepted). All the packets of an
+// encoder output buffer (a frame or the codec config) have the same RTP
+// timestamp (the PTS at 90kHz), and the marker bit is set on the last one.
+//
+// The media packets are protected by XOR FEC packets, sent with a distinct
+// payload type (and their own sequence numbers). A FEC packet protects
+// consecutive media packets of the same frame, and has the same timestamp.
+// Its payload is:
+//
+//     [. .|.|.]. . . . . . . . . . . . . . . ...
+//      <-> | | <-------------------------------
+//       |  | |  XOR of the protected blocks (zero-padded)
+//       |  | reserved
+//       |  number of protected packets
+//      sequence number of the first protected packet
+//
+// The protected block of a media packet is its marker bit (1 byte), its
+// payload length (2 bytes) and its payload. A single loss in the group can be
+// repaired.
+//
+// The packets are reordered, and a missing packet is considered lost after
+// the reorder delay. Once a packet is lost, the following frames are dropped
+// until the next key frame, which the caller is expected to request.
+
+#define SC_RTP_PAYLOAD_TYPE_H264 96
+#define SC_RTP_PAYLOAD_TYPE_FEC 97
+
+#define SC_RTP_HEADER_LENGTH 12
+#define SC_RTP_FEC_HEADER_LENGTH 4
+#define SC_RTP_FEC_BLOCK_HEADER_LENGTH 3
+#define SC_RTP_MAX_PAYLOAD_LENGTH 1400
+#define SC_RTP_MAX_DATAGRAM_LENGTH (SC_RTP_HEADER_LENGTH \
+                                  + SC_RTP_FEC_HEADER_LENGTH \
+                                  + SC_RTP_FEC_BLOCK_HEADER_LENGTH \
+                                  + SC_RTP_MAX_PAYLOAD_LENGTH)
+
+// Number of media packets kept for reordering and recovery (power of 2)
+#define SC_RTP_WINDOW 1024
+// Number of FEC packets kept until their group is complete
+#define SC_RTP_FEC_SLOTS 64
+
+struct sc_rtp_packet {
+    bool present;
+    uint16_t seq;
+    bool marker;
+    uint32_t timestamp;
+    uint16_t len;
+    uint8_t payload[SC_RTP_MAX_PAYLOAD_LENGTH];
+};
+
+struct sc_rtp_fec {
+    bool present;
+    uint16_t base_seq;
+    uint8_t count;
+    uint32_t timestamp;
+    uint16_t len;
+    uint8_t block[SC_RTP_FEC_BLOCK_HEADER_LENGTH + SC_RTP_MAX_PAYLOAD_LENGTH];
+};
+
+struct sc_rtp_frame {
+    // Annex B, valid until the next call to sc_rtp_receiver_pop()
+    const uint8_t *data;
+    size_t size;
+    bool config; // the codec config (SPS and PPS), without frame
+    uint64_t pts; // in microseconds (unset for a config packet)
+};
+
+struct sc_rtp_stats {
+    uint64_t received; // media packets
+    uint64_t recovered; // media packets repaired by FEC
+    uint64_t lost; // media packets neither received nor repaired in time
+    uint64_t late; // media packets received after being considered lost
+    uint64_t frames; // delivered (including config packets)
+    uint64_t dropped_frames; // incomplete, or waiting for a key frame
+};
+
+struct sc_rtp_receiver {
+    sc_tick reorder_delay;
+
+    struct sc_rtp_packet *packets; // SC_RTP_WINDOW slots, indexed by seq
+    struct sc_rtp_fec *fecs; // SC_RTP_FEC_SLOTS slots, in a ring
+    unsigned fec_head; // next slot to overwrite
+
+    bool started;
+    uint16_t next_seq; // next packet to process
+    uint16_t max_seq; // most recent packet received
+    sc_tick gap_since; // since when next_seq is missing (0 if no gap)
+
+    // the frame being assembled
+    uint8_t *au;
+    size_t au_size;
+    size_t au_capacity;
+    uint32_t au_timestamp;
+    bool au_broken; // a packet is missing or invalid
+    bool au_has_vcl; // contains a slice
+    bool au_has_idr;
+    bool fu_started; // a fragmented NAL unit is in progress
+    bool prev_marker; // the previous packet ended a frame
+
+    bool waiting_key_frame;
+    bool key_frame_needed; // a packet has been lost since the last key frame
+    sc_tick last_key_frame_request;
+
+    bool has_timestamp;
+    uint64_t ext_timestamp; // the last timestamp, unwrapped
+
+    struct sc_rtp_stats stats;
+};
+
+bool
+sc_rtp_receiver_init(struct sc_rtp_receiver *rr, sc_tick reorder_delay);
+
+void
+sc_rtp_receiver_destroy(struct sc_rtp_receiver *rr);
+
+// Handle a received datagram (invalid datagrams are ignored)
+void
+sc_rtp_receiver_push(struct sc_rtp_receiver *rr, const uint8_t *data,
+                     size_t len);
+
+// Get the next frame (or config packet) in order, if any
+//
+// A packet still missing after the reorder delay is considered lost.
+bool
+sc_rtp_receiver_pop(struct sc_rtp_receiver *rr, sc_tick now,
+                    struct sc_rtp_frame *frame);
+
+// Return when sc_rtp_receiver_pop() must be called if no datagram is received
+// meanwhile (to give up on a missing packet), or 0
+sc_tick
+sc_rtp_receiver_get_deadline(const struct sc_rtp_receiver *rr);
+
+// Return true if a key frame must be requested to the device, after a loss
+//
+// It returns true again if the key frame is still missing after some delay.
+bool
+sc_rtp_receiver_consume_key_frame_request(struct sc_rtp_receiver *rr,
+                                          sc_tick now);
+
+#endif
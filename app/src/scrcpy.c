@@ -18,21 +18,30 @@
 #include "events.h"
 #include "file_handler.h"
 #include "input_manager.h"
+#include "input_record.h"
+#include "input_replay.h"
+#include "keymap.h"
 #ifdef HAVE_AOA_HID
 # include "hid_keyboard.h"
 #endif
 #include "keyboard_inject.h"
+#include "latency_probe.h"
 #include "mouse_inject.h"
 #include "recorder.h"
 #include "screen.h"
 #include "server.h"
 #include "stream.h"
+#include "stream_stats.h"
+#include "timelapse.h"
 #include "util/acksync.h"
 #include "util/log.h"
 #include "util/net.h"
 #ifdef HAVE_V4L2
 # include "v4l2_sink.h"
 #endif
+#ifdef HAVE_SHM_SINK
+# include "shm_sink.h"
+#endif
 
 struct scrcpy {
     struct sc_server server;
@@ -42,8 +51,17 @@ struct scrcpy {
     struct recorder recorder;
 #ifdef HAVE_V4L2
     struct sc_v4l2_sink v4l2_sink;
+#endif
+    struct sc_timelapse timelapse;
+#ifdef HAVE_SHM_SINK
+    struct sc_shm_sink shm_sink;
 #endif
     struct controller controller;
+    struct sc_latency_probe latency_probe;
+    struct sc_stream_stats stream_stats;
+    struct sc_input_recorder input_recorder;
+    struct sc_input_replay input_replay;
+    struct sc_keymap keymap;
     struct file_handler file_handler;
 #ifdef HAVE_AOA_HID
     struct sc_aoa aoa;
@@ -288,6 +306,23 @@ stream_on_eos(struct stream *stream, void *userdata) {
     PUSH_EVENT(EVENT_STREAM_STOPPED);
 }
 
+static void
+stream_on_key_frame_needed(struct stream *stream, void *userdata) {
+    (void) stream;
+    struct controller *controller = userdata;
+
+    if (!controller) {
+        // Without control, the stream recovers on the next periodic key frame
+        return;
+    }
+
+    struct control_msg msg;
+    msg.type = CONTROL_MSG_TYPE_REQUEST_KEY_FRAME;
+    if (!controller_push_msg(controller, &msg)) {
+        LOGW("Could not request a key frame");
+    }
+}
+
 static void
 sc_server_on_connection_failed(struct sc_server *server, void *userdata) {
     (void) server;
@@ -334,6 +369,10 @@ scrcpy(struct scrcpy_options *options) {
     bool recorder_initialized = false;
 #ifdef HAVE_V4L2
     bool v4l2_sink_initialized = false;
+#endif
+    bool timelapse_initialized = false;
+#ifdef HAVE_SHM_SINK
+    bool shm_sink_initialized = false;
 #endif
     bool stream_started = false;
 #ifdef HAVE_AOA_HID
@@ -341,9 +380,16 @@ scrcpy(struct scrcpy_options *options) {
 #endif
     bool controller_initialized = false;
     bool controller_started = false;
+    bool latency_probe_initialized = false;
+    bool input_recorder_opened = false;
+    bool input_replay_initialized = false;
+    bool input_replay_started = false;
+    bool keymap_initialized = false;
     bool screen_initialized = false;
 
     struct sc_acksync *acksync = NULL;
+    struct sc_latency_probe *latency_probe = NULL;
+    const struct sc_keymap *keymap = NULL;
 
     struct sc_server_params params = {
         .serial = options->serial,
@@ -354,6 +400,9 @@ scrcpy(struct scrcpy_options *options) {
         .tunnel_port = options->tunnel_port,
         .max_size = options->max_size,
         .bit_rate = options->bit_rate,
+        .min_bit_rate = options->adaptive_bit_rate
+                      ? options->adaptive_bit_rate_min : 0,
+        .max_bit_rate = options->adaptive_bit_rate_max,
         .max_fps = options->max_fps,
         .lock_video_orientation = options->lock_video_orientation,
         .control = options->control,
@@ -363,6 +412,10 @@ scrcpy(struct scrcpy_options *options) {
         .codec_options = options->codec_options,
         .encoder_name = options->encoder_name,
         .force_adb_forward = options->force_adb_forward,
+        .multiplex = options->multiplex,
+        .resume = options->resume,
+        .udp = options->udp,
+        .low_latency = options->low_latency,
         .power_off_on_close = options->power_off_on_close,
         .clipboard_autosync = options->clipboard_autosync,
         .tcpip = options->tcpip,
@@ -416,9 +469,12 @@ scrcpy(struct scrcpy_options *options) {
     }
 
     struct decoder *dec = NULL;
-    bool needs_decoder = options->display;
+    bool needs_decoder = options->display || options->timelapse_filename;
 #ifdef HAVE_V4L2
     needs_decoder |= !!options->v4l2_device;
+#endif
+#ifdef HAVE_SHM_SINK
+    needs_decoder |= !!options->shm_sink_name;
 #endif
     if (needs_decoder) {
         decoder_init(&s->decoder);
@@ -430,7 +486,10 @@ scrcpy(struct scrcpy_options *options) {
         if (!recorder_init(&s->recorder,
                            options->record_filename,
                            options->record_format,
-                           info->frame_size)) {
+                           info->frame_size,
+                           options->record_queue_packets,
+                           options->record_queue_size,
+                           options->record_queue_policy)) {
             goto end;
         }
         rec = &s->recorder;
@@ -441,8 +500,18 @@ scrcpy(struct scrcpy_options *options) {
 
     static const struct stream_callbacks stream_cbs = {
         .on_eos = stream_on_eos,
+        .on_key_frame_needed = stream_on_key_frame_needed,
     };
-    stream_init(&s->stream, s->server.video_socket, &stream_cbs, NULL);
+    // The controller is started before the stream
+    struct controller *controller = options->control ? &s->controller : NULL;
+    stream_init(&s->stream, s->server.video_socket, &stream_cbs, controller);
+    if (options->multiplex) {
+        stream_set_mux(&s->stream, &s->server.mux);
+    }
+    if (options->udp) {
+        stream_set_udp(&s->stream, s->server.udp_socket,
+                       s->server.udp_token);
+    }
 
     if (dec) {
         stream_add_sink(&s->stream, &dec->packet_sink);
@@ -463,17 +532,81 @@ scrcpy(struct scrcpy_options *options) {
             acksync = &s->acksync;
         }
 #endif
+        bool ok = options->keymap_filename
+                ? sc_keymap_load(&s->keymap, options->keymap_filename)
+                : sc_keymap_init_default(&s->keymap);
+        if (!ok) {
+            goto end;
+        }
+        keymap_initialized = true;
+
+        if (!sc_keymap_find(&s->keymap, options->keymap_profile)) {
+            LOGE("Keymap profile not found: %s", options->keymap_profile);
+            goto end;
+        }
+        keymap = &s->keymap;
+
         if (!controller_init(&s->controller, s->server.control_socket,
                              acksync)) {
             goto end;
         }
         controller_initialized = true;
 
+        if (options->multiplex) {
+            controller_set_mux(&s->controller, &s->server.mux);
+        }
+
+        if (options->input_record_filename) {
+            if (!sc_input_recorder_open(&s->input_recorder,
+                                        options->input_record_filename)) {
+                goto end;
+            }
+            input_recorder_opened = true;
+            controller_set_input_recorder(&s->controller, &s->input_recorder);
+        }
+
         if (!controller_start(&s->controller)) {
             goto end;
         }
         controller_started = true;
 
+        if (!sc_latency_probe_init(&s->latency_probe, &s->controller,
+                                   options->latency_probe_interval)) {
+            goto end;
+        }
+        latency_probe_initialized = true;
+        latency_probe = &s->latency_probe;
+
+        if (options->latency_probe) {
+            if (!sc_latency_probe_start(&s->latency_probe)) {
+                goto end;
+            }
+        }
+
+        if (options->adaptive_bit_rate) {
+            // The screen (and its fps counter) is initialized before the
+            // stream is started
+            struct fps_counter *fps_counter =
+                options->display ? &s->screen.fps_counter : NULL;
+            sc_stream_stats_init(&s->stream_stats, &s->controller,
+                                 fps_counter, 0);
+            stream_add_sink(&s->stream, &s->stream_stats.packet_sink);
+        }
+
+        if (options->input_replay_filename) {
+            if (!sc_input_replay_init(&s->input_replay, &s->controller,
+                                      options->input_replay_filename,
+                                      options->input_replay_speed)) {
+                goto end;
+            }
+            input_replay_initialized = true;
+
+            if (!sc_input_replay_start(&s->input_replay)) {
+                goto end;
+            }
+            input_replay_started = true;
+        }
+
         if (options->turn_screen_off) {
             struct control_msg msg;
             msg.type = CONTROL_MSG_TYPE_SET_SCREEN_POWER_MODE;
@@ -514,8 +647,14 @@ scrcpy(struct scrcpy_options *options) {
 
 #ifdef HAVE_V4L2
     if (options->v4l2_device) {
+        struct sc_size v4l2_size = {
+            .width = options->v4l2_width,
+            .height = options->v4l2_height,
+        };
         if (!sc_v4l2_sink_init(&s->v4l2_sink, options->v4l2_device,
-                               info->frame_size, options->v4l2_buffer)) {
+                               info->frame_size, v4l2_size,
+                               options->v4l2_pixel_format,
+                               options->v4l2_buffer)) {
             goto end;
         }
 
@@ -525,6 +664,33 @@ scrcpy(struct scrcpy_options *options) {
     }
 #endif
 
+    if (options->timelapse_filename) {
+        if (!sc_timelapse_init(&s->timelapse, options->timelapse_filename,
+                               options->timelapse_format,
+                               options->timelapse_interval,
+                               options->timelapse_threshold,
+                               options->timelapse_crf)) {
+            goto end;
+        }
+
+        decoder_add_sink(&s->decoder, &s->timelapse.frame_sink);
+
+        timelapse_initialized = true;
+    }
+
+#ifdef HAVE_SHM_SINK
+    if (options->shm_sink_name) {
+        if (!sc_shm_sink_init(&s->shm_sink, options->shm_sink_name,
+                              info->frame_size)) {
+            goto end;
+        }
+
+        decoder_add_sink(&s->decoder, &s->shm_sink.frame_sink);
+
+        shm_sink_initialized = true;
+    }
+#endif
+
     // now we consumed the header values, the socket receives the video stream
     // start the stream
     if (!stream_start(&s->stream)) {
@@ -588,7 +754,7 @@ aoa_hid_end:
     }
 
     input_manager_init(&s->input_manager, &s->controller, &s->screen, kp, mp,
-                       options);
+                       latency_probe, keymap, options);
 
     ret = event_loop(s, options);
     LOGD("quit...");
@@ -609,6 +775,12 @@ end:
         sc_acksync_destroy(acksync);
     }
 #endif
+    if (latency_probe_initialized) {
+        sc_latency_probe_interrupt(&s->latency_probe);
+    }
+    if (input_replay_started) {
+        sc_input_replay_stop(&s->input_replay);
+    }
     if (controller_started) {
         controller_stop(&s->controller);
     }
@@ -636,6 +808,16 @@ end:
     }
 #endif
 
+    if (timelapse_initialized) {
+        sc_timelapse_destroy(&s->timelapse);
+    }
+
+#ifdef HAVE_SHM_SINK
+    if (shm_sink_initialized) {
+        sc_shm_sink_destroy(&s->shm_sink);
+    }
+#endif
+
 #ifdef HAVE_AOA_HID
     if (aoa_hid_initialized) {
         sc_aoa_join(&s->aoa);
@@ -650,9 +832,25 @@ end:
         screen_destroy(&s->screen);
     }
 
+    if (latency_probe_initialized) {
+        sc_latency_probe_join(&s->latency_probe);
+        sc_latency_probe_destroy(&s->latency_probe);
+    }
+
+    if (input_replay_started) {
+        sc_input_replay_join(&s->input_replay);
+    }
+    if (input_replay_initialized) {
+        sc_input_replay_destroy(&s->input_replay);
+    }
+
     if (controller_started) {
         controller_join(&s->controller);
     }
+    if (input_recorder_opened) {
+        controller_set_input_recorder(&s->controller, NULL);
+        sc_input_recorder_close(&s->input_recorder);
+    }
     if (controller_initialized) {
         controller_destroy(&s->controller);
     }
@@ -666,6 +864,10 @@ end:
         file_handler_destroy(&s->file_handler);
     }
 
+    if (keymap_initialized) {
+        sc_keymap_destroy(&s->keymap);
+    }
+
     sc_server_destroy(&s->server);
 
     return ret;
@@ -12,6 +12,7 @@
 #include "util/log.h"
 #include "util/net_intr.h"
 #include "util/process_intr.h"
+#include "util/rand.h"
 #include "util/str.h"
 
 #define SC_SERVER_FILENAME "scrcpy-server"
@@ -19,6 +20,14 @@
 #define SC_SERVER_PATH_DEFAULT PREFIX "/share/scrcpy/" SC_SERVER_FILENAME
 #define SC_DEVICE_SERVER_PATH "/data/local/tmp/scrcpy-server.jar"
 
+// In resume mode, how long the client tries to reconnect (and the server waits
+// for it) after a connection failure
+#define SC_SERVER_RESUME_TIMEOUT SC_TICK_FROM_SEC(10)
+#define SC_SERVER_RESUME_MAX_DELAY SC_TICK_FROM_SEC(1)
+
+// In UDP mode, the port the device listens on for the client "hello" datagram
+#define SC_SERVER_UDP_PORT 27183
+
 static char *
 get_server_path(void) {
 #ifdef __WINDOWS__
@@ -192,6 +201,10 @@ execute_server(struct sc_server *server,
 
     ADD_PARAM("log_level=%s", log_level_to_server_string(params->log_level));
     ADD_PARAM("bit_rate=%" PRIu32, params->bit_rate);
+    if (params->min_bit_rate) {
+        ADD_PARAM("min_bit_rate=%" PRIu32, params->min_bit_rate);
+        ADD_PARAM("max_bit_rate=%" PRIu32, params->max_bit_rate);
+    }
 
     if (params->max_size) {
         ADD_PARAM("max_size=%" PRIu16, params->max_size);
@@ -206,6 +219,17 @@ execute_server(struct sc_server *server,
     if (server->tunnel.forward) {
         ADD_PARAM("tunnel_forward=%s", STRBOOL(server->tunnel.forward));
     }
+    if (params->multiplex) {
+        ADD_PARAM("multiplex=%s", STRBOOL(params->multiplex));
+    }
+    if (params->resume) {
+        ADD_PARAM("resume_timeout=%u",
+                  (unsigned) SC_TICK_TO_MS(SC_SERVER_RESUME_TIMEOUT));
+    }
+    if (params->udp) {
+        ADD_PARAM("udp_port=%u", SC_SERVER_UDP_PORT);
+        ADD_PARAM("udp_token=%s", server->udp_token);
+    }
     if (params->crop) {
         ADD_PARAM("crop=%s", params->crop);
     }
@@ -228,6 +252,9 @@ execute_server(struct sc_server *server,
     if (params->encoder_name) {
         ADD_PARAM("encoder_name=%s", params->encoder_name);
     }
+    if (params->low_latency) {
+        ADD_PARAM("low_latency=%s", STRBOOL(params->low_latency));
+    }
     if (params->power_off_on_close) {
         ADD_PARAM("power_off_on_close=%s", STRBOOL(params->power_off_on_close));
     }
@@ -322,6 +349,9 @@ sc_server_init(struct sc_server *server, const struct sc_server_params *params,
         return false;
     }
 
+    // The resumed connection is a single socket, connected by the client
+    assert(!params->resume || (params->multiplex && params->force_adb_forward));
+
     ok = sc_mutex_init(&server->mutex);
     if (!ok) {
         sc_server_params_destroy(&server->params);
@@ -344,9 +374,13 @@ sc_server_init(struct sc_server *server, const struct sc_server_params *params,
     }
 
     server->stopped = false;
+    server->connected = false;
 
     server->video_socket = SC_SOCKET_NONE;
     server->control_socket = SC_SOCKET_NONE;
+    server->udp_socket = SC_SOCKET_NONE;
+    server->udp_token[0] = '\0';
+    server->mux_initialized = false;
 
     sc_adb_tunnel_init(&server->tunnel);
 
@@ -381,13 +415,17 @@ device_read_info(struct sc_intr *intr, sc_socket device_socket,
     return true;
 }
 
+// If the mux is already initialized, replace the current sockets by a new
+// connection (to resume the mux)
 static bool
-sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
+sc_server_connect_to(struct sc_server *server, unsigned attempts,
+                     struct sc_server_info *info) {
     struct sc_adb_tunnel *tunnel = &server->tunnel;
 
     assert(tunnel->enabled);
 
     const char *serial = server->params.serial;
+    bool multiplex = server->params.multiplex;
 
     sc_socket video_socket = SC_SOCKET_NONE;
     sc_socket control_socket = SC_SOCKET_NONE;
@@ -397,9 +435,12 @@ sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
             goto fail;
         }
 
-        control_socket = net_accept_intr(&server->intr, tunnel->server_socket);
-        if (control_socket == SC_SOCKET_NONE) {
-            goto fail;
+        if (!multiplex) {
+            control_socket = net_accept_intr(&server->intr,
+                                             tunnel->server_socket);
+            if (control_socket == SC_SOCKET_NONE) {
+                goto fail;
+            }
         }
     } else {
         uint32_t tunnel_host = server->params.tunnel_host;
@@ -412,7 +453,6 @@ sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
             tunnel_port = tunnel->local_port;
         }
 
-        unsigned attempts = 100;
         sc_tick delay = SC_TICK_FROM_MS(100);
         video_socket = connect_to_server(server, attempts, delay, tunnel_host,
                                          tunnel_port);
@@ -420,15 +460,18 @@ sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
             goto fail;
         }
 
-        // we know that the device is listening, we don't need several attempts
-        control_socket = net_socket();
-        if (control_socket == SC_SOCKET_NONE) {
-            goto fail;
-        }
-        bool ok = net_connect_intr(&server->intr, control_socket, tunnel_host,
-                                   tunnel_port);
-        if (!ok) {
-            goto fail;
+        if (!multiplex) {
+            // we know that the device is listening, we don't need several
+            // attempts
+            control_socket = net_socket();
+            if (control_socket == SC_SOCKET_NONE) {
+                goto fail;
+            }
+            bool ok = net_connect_intr(&server->intr, control_socket,
+                                       tunnel_host, tunnel_port);
+            if (!ok) {
+                goto fail;
+            }
         }
     }
 
@@ -441,9 +484,29 @@ sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
         goto fail;
     }
 
+    if (multiplex && !server->mux_initialized) {
+        // The device info is sent before the multiplexed frames
+        ok = sc_mux_init(&server->mux, video_socket);
+        if (!ok) {
+            goto fail;
+        }
+        server->mux_initialized = true;
+    }
+
+    if (multiplex) {
+        control_socket = video_socket;
+    }
+
     assert(video_socket != SC_SOCKET_NONE);
     assert(control_socket != SC_SOCKET_NONE);
 
+    // Do not delay small control messages (input events)
+    // In multiplex mode, this also applies to the video stream, but each video
+    // packet is written by the device at once anyway.
+    if (!net_set_tcp_nodelay(control_socket, true)) {
+        LOGW("Could not disable Nagle's algorithm on the control socket");
+    }
+
     server->video_socket = video_socket;
     server->control_socket = control_socket;
 
@@ -468,15 +531,80 @@ fail:
     return false;
 }
 
+static bool
+sc_server_try_resume(struct sc_server *server) {
+    struct sc_intr *intr = &server->intr;
+    const struct sc_server_params *params = &server->params;
+
+    if (strchr(params->serial, ':')) {
+        // Over TCP/IP, the adb connection may have been lost as well (if it is
+        // still connected, the command fails harmlessly)
+        adb_connect(intr, params->serial, SC_ADB_SILENT);
+    }
+
+    bool ok = sc_adb_tunnel_open(&server->tunnel, intr, params->serial,
+                                 params->port_range, true);
+    if (!ok) {
+        return false;
+    }
+
+    // The tunnel is always closed by sc_server_connect_to()
+    // The server is waiting for the connection, a single attempt is sufficient
+    struct sc_server_info info;
+    return sc_server_connect_to(server, 1, &info);
+}
+
+static sc_socket
+sc_server_reconnect(struct sc_mux *mux, void *userdata) {
+    (void) mux;
+    struct sc_server *server = userdata;
+
+    sc_tick deadline = sc_tick_now() + SC_SERVER_RESUME_TIMEOUT;
+    sc_tick delay = SC_TICK_FROM_MS(50);
+    for (;;) {
+        if (sc_server_try_resume(server)) {
+            return server->video_socket;
+        }
+
+        sc_tick now = sc_tick_now();
+        if (now + delay >= deadline) {
+            LOGE("Could not resume the connection");
+            return SC_SOCKET_NONE;
+        }
+
+        if (!sc_server_sleep(server, now + delay)) {
+            // stopped
+            return SC_SOCKET_NONE;
+        }
+
+        // exponential backoff
+        delay = MIN(delay * 2, SC_SERVER_RESUME_MAX_DELAY);
+    }
+}
+
 static void
 sc_server_on_terminated(void *userdata) {
     struct sc_server *server = userdata;
 
-    // If the server process dies before connecting to the server socket,
-    // then the client will be stuck forever on accept(). To avoid the problem,
-    // wake up the accept() call (or any other) when the server dies, like on
-    // stop() (it is safe to call interrupt() twice).
-    sc_intr_interrupt(&server->intr);
+    sc_mutex_lock(&server->mutex);
+    bool connected = server->connected;
+    sc_mutex_unlock(&server->mutex);
+
+    // In resume mode, the "adb shell" process may terminate on a transient
+    // disconnection (typically over TCP/IP) while the server keeps running on
+    // the device, so the connection may still be resumed
+    if (!server->params.resume || !connected) {
+        // If the server process dies before connecting to the server socket,
+        // then the client will be stuck forever on accept(). To avoid the
+        // problem, wake up the accept() call (or any other) when the server
+        // dies, like on stop() (it is safe to call interrupt() twice).
+        sc_intr_interrupt(&server->intr);
+    }
+
+    if (server->udp_socket != SC_SOCKET_NONE) {
+        // Nothing else would wake up the stream: datagrams just stop arriving
+        net_interrupt(server->udp_socket);
+    }
 
     server->cbs->on_disconnected(server, server->cbs_userdata);
 
@@ -682,6 +810,61 @@ sc_server_configure_tcpip(struct sc_server *server) {
     return ok;
 }
 
+// Create the UDP socket to receive the video from the device, connected to the
+// IP address of the device (which must be connected over TCP/IP)
+static bool
+sc_server_open_udp(struct sc_server *server) {
+    const char *serial = server->params.serial;
+    assert(serial);
+
+    const char *colon = strchr(serial, ':');
+    if (!colon) {
+        LOGE("UDP mode requires a device connected over TCP/IP "
+             "(use --tcpip)");
+        return false;
+    }
+
+    // "255.255.255.255"
+    char ip[16];
+    size_t len = colon - serial;
+    uint32_t ipv4;
+    bool ok = len < sizeof(ip);
+    if (ok) {
+        memcpy(ip, serial, len);
+        ip[len] = '\0';
+        ok = net_parse_ipv4(ip, &ipv4);
+    }
+    if (!ok) {
+        LOGE("UDP mode requires an IPv4 device address: %s", serial);
+        return false;
+    }
+
+    sc_socket socket = net_udp_socket();
+    if (socket == SC_SOCKET_NONE) {
+        return false;
+    }
+
+    // Only accept datagrams from the device
+    if (!net_connect(socket, ipv4, SC_SERVER_UDP_PORT)) {
+        net_close(socket);
+        return false;
+    }
+
+    // Any host on the network could send a "hello" datagram to the device, so
+    // the device only streams to the client which proves it knows the token
+    uint8_t token[SC_SERVER_UDP_TOKEN_LENGTH];
+    if (!sc_rand_bytes(token, sizeof(token))) {
+        net_close(socket);
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(token); ++i) {
+        sprintf(&server->udp_token[2 * i], "%02x", token[i]);
+    }
+
+    server->udp_socket = socket;
+    return true;
+}
+
 static int
 run_server(void *data) {
     struct sc_server *server = data;
@@ -706,6 +889,10 @@ run_server(void *data) {
         goto error_connection_failed;
     }
 
+    if (params->udp && !sc_server_open_udp(server)) {
+        goto error_connection_failed;
+    }
+
     bool ok = push_server(&server->intr, params->serial);
     if (!ok) {
         goto error_connection_failed;
@@ -736,7 +923,7 @@ run_server(void *data) {
         goto error_connection_failed;
     }
 
-    ok = sc_server_connect_to(server, &server->info);
+    ok = sc_server_connect_to(server, 100, &server->info);
     // The tunnel is always closed by server_connect_to()
     if (!ok) {
         sc_process_terminate(pid);
@@ -746,6 +933,17 @@ run_server(void *data) {
         goto error_connection_failed;
     }
 
+    if (params->resume) {
+        static const struct sc_mux_callbacks mux_cbs = {
+            .reconnect = sc_server_reconnect,
+        };
+        sc_mux_set_callbacks(&server->mux, &mux_cbs, server);
+    }
+
+    sc_mutex_lock(&server->mutex);
+    server->connected = true;
+    sc_mutex_unlock(&server->mutex);
+
     // Now connected
     server->cbs->on_connected(server, server->cbs_userdata);
 
@@ -756,6 +954,12 @@ run_server(void *data) {
     }
     sc_mutex_unlock(&server->mutex);
 
+    if (server->mux_initialized) {
+        // A receiver waiting for its turn would never be woken up if the
+        // receiver of the other channel has stopped reading
+        sc_mux_interrupt(&server->mux);
+    }
+
     // Give some delay for the server to terminate properly
 #define WATCHDOG_DELAY SC_TICK_FROM_SEC(1)
     sc_tick deadline = sc_tick_now() + WATCHDOG_DELAY;
@@ -804,10 +1008,21 @@ sc_server_stop(struct sc_server *server) {
     sc_mutex_unlock(&server->mutex);
 
     sc_thread_join(&server->thread, NULL);
+
+    if (server->udp_socket != SC_SOCKET_NONE) {
+        // wake up the stream
+        net_interrupt(server->udp_socket);
+    }
 }
 
 void
 sc_server_destroy(struct sc_server *server) {
+    if (server->udp_socket != SC_SOCKET_NONE) {
+        net_close(server->udp_socket);
+    }
+    if (server->mux_initialized) {
+        sc_mux_destroy(&server->mux);
+    }
     sc_server_params_destroy(&server->params);
     sc_intr_destroy(&server->intr);
     sc_cond_destroy(&server->cond_stopped);
@@ -10,6 +10,7 @@
 #include "adb.h"
 #include "adb_tunnel.h"
 #include "coords.h"
+#include "mux.h"
 #include "options.h"
 #include "util/intr.h"
 #include "util/log.h"
@@ -17,6 +18,8 @@
 #include "util/thread.h"
 
 #define SC_DEVICE_NAME_FIELD_LENGTH 64
+// In UDP mode, the number of random bytes of the token
+#define SC_SERVER_UDP_TOKEN_LENGTH 16
 struct sc_server_info {
     char device_name[SC_DEVICE_NAME_FIELD_LENGTH];
     struct sc_size frame_size;
@@ -33,6 +36,8 @@ struct sc_server_params {
     uint16_t tunnel_port;
     uint16_t max_size;
     uint32_t bit_rate;
+    uint32_t min_bit_rate; // 0 if the bit-rate is not adaptive
+    uint32_t max_bit_rate;
     uint16_t max_fps;
     int8_t lock_video_orientation;
     bool control;
@@ -40,6 +45,10 @@ struct sc_server_params {
     bool show_touches;
     bool stay_awake;
     bool force_adb_forward;
+    bool multiplex;
+    bool resume; // requires multiplex and force_adb_forward
+    bool udp; // receive the video over UDP (requires a device over TCP/IP)
+    bool low_latency;
     bool power_off_on_close;
     bool clipboard_autosync;
     bool tcpip;
@@ -56,12 +65,26 @@ struct sc_server {
     sc_mutex mutex;
     sc_cond cond_stopped;
     bool stopped;
+    bool connected; // protected by the mutex
 
     struct sc_intr intr;
     struct sc_adb_tunnel tunnel;
 
     sc_socket video_socket;
     sc_socket control_socket;
+    // In UDP mode, the video is received from this socket (the video socket
+    // is unused)
+    sc_socket udp_socket;
+    // The secret passed to the device, so that it only streams to the client
+    // which sends it in its "hello" datagram (hexadecimal)
+    char udp_token[SC_SERVER_UDP_TOKEN_LENGTH * 2 + 1];
+
+    // In multiplex mode, the video and control streams share a single socket
+    // (video_socket and control_socket are the same)
+    // In resume mode, the mux replaces the socket by a new connection to the
+    // same server process when it fails.
+    struct sc_mux mux;
+    bool mux_initialized;
 
     const struct sc_server_callbacks *cbs;
     void *cbs_userdata;
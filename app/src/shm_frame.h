@@ -0,0 +1,77 @@
+#ifndef SC_SHM_FRAME_H
+#define SC_SHM_FRAME_H
+
+/**
+ * Layout of the shared memory frame ring exported by --shm-sink.
+ *
+ * This header is self-contained (C11 only), so that external readers can
+ * include it directly (see app/examples/shm_reader.c).
+ *
+ * The shared memory object starts with a struct sc_shm_frame_header,
+ * followed by slot_count frame buffers of slot_size bytes each.
+ *
+ * The writer never waits for readers: the frames are written to the slots
+ * in turn, and each slot is protected by a seqlock. To read a frame
+ * (without copy):
+ *  1. read last_frame (0 if there is no frame yet), the frame is in slot
+ *     (last_frame - 1) % slot_count;
+ *  2. read the slot seq (acquire); if it is odd, the slot is being written;
+ *  3. read the metadata and process the pixels in place;
+ *  4. read the slot seq again (after an acquire fence): if it changed, the
+ *     slot has been overwritten during processing, the result must be
+ *     discarded.
+ *
+ * A slot is overwritten only slot_count - 1 frames after it was published.
+ *
+ * To wait for a new frame, increment waiters, FUTEX_WAIT on futex while it
+ * still has the value previously read, then decrement waiters. The writer
+ * increments futex on each frame, and wakes up the waiters (if any).
+ */
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#define SC_SHM_FRAME_MAGIC 0x4d485353 // "SSHM"
+#define SC_SHM_FRAME_VERSION 1
+
+#define SC_SHM_FRAME_SLOTS 4
+#define SC_SHM_FRAME_MAX_PLANES 3
+
+// fourcc of planar YUV 4:2:0 (same value as V4L2_PIX_FMT_YUV420)
+#define SC_SHM_FRAME_FORMAT_I420 0x32315559 // "YU12"
+
+struct sc_shm_frame_slot {
+    _Atomic uint64_t seq; // odd while the slot is being written
+
+    uint64_t frame; // frame number, starting from 1
+    int64_t pts; // in microseconds, -1 if unknown
+    uint64_t publish_time_ns; // CLOCK_MONOTONIC, when the frame was published
+
+    uint32_t format; // SC_SHM_FRAME_FORMAT_*
+    uint32_t width;
+    uint32_t height;
+    uint32_t plane_count;
+    // relative to the start of the slot data
+    uint32_t plane_offsets[SC_SHM_FRAME_MAX_PLANES];
+    uint32_t plane_linesizes[SC_SHM_FRAME_MAX_PLANES];
+
+    uint64_t data_offset; // relative to the start of the shared memory
+};
+
+struct sc_shm_frame_header {
+    // magic is written last (release), once the header is initialized
+    _Atomic uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t reserved;
+    uint64_t slot_size;
+
+    _Atomic uint64_t last_frame; // 0 if no frame has been published yet
+    _Atomic uint32_t futex; // incremented on each frame (and on close)
+    _Atomic uint32_t waiters; // number of readers waiting on futex
+    _Atomic uint32_t closed; // set when the writer has stopped
+
+    struct sc_shm_frame_slot slots[SC_SHM_FRAME_SLOTS];
+};
+
+#endif
@@ -0,0 +1,269 @@
+#include "shm_sink.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <libavutil/avutil.h>
+#include <libavutil/frame.h>
+
+#include "util/log.h"
+
+/** Downcast frame_sink to sc_shm_sink */
+#define DOWNCAST(SINK) container_of(SINK, struct sc_shm_sink, frame_sink)
+
+#define SC_SHM_SINK_ALIGN(X, A) (((X) + (A) - 1) / (A) * (A))
+
+// Line sizes are aligned so that decoded frames (which are usually padded)
+// may be copied with a single memcpy() per plane
+#define SC_SHM_SINK_LINESIZE_ALIGN 128
+#define SC_SHM_SINK_PAGE_SIZE 4096
+
+static size_t
+yuv420_size(size_t linesize, unsigned height) {
+    size_t chroma_linesize = (linesize + 1) / 2;
+    size_t chroma_height = (height + 1) / 2;
+    return linesize * height + 2 * chroma_linesize * chroma_height;
+}
+
+static size_t
+compute_slot_size(struct sc_size size) {
+    // The frame size may be swapped on device rotation
+    size_t w = SC_SHM_SINK_ALIGN(size.width, SC_SHM_SINK_LINESIZE_ALIGN);
+    size_t h = SC_SHM_SINK_ALIGN(size.height, SC_SHM_SINK_LINESIZE_ALIGN);
+    size_t portrait = yuv420_size(w, size.height);
+    size_t landscape = yuv420_size(h, size.width);
+    size_t slot_size = portrait > landscape ? portrait : landscape;
+    return SC_SHM_SINK_ALIGN(slot_size, SC_SHM_SINK_PAGE_SIZE);
+}
+
+static size_t
+get_header_size(void) {
+    return SC_SHM_SINK_ALIGN(sizeof(struct sc_shm_frame_header),
+                             SC_SHM_SINK_PAGE_SIZE);
+}
+
+static uint64_t
+get_monotonic_time_ns(void) {
+    struct timespec ts;
+    int r = clock_gettime(CLOCK_MONOTONIC, &ts);
+    assert(!r);
+    (void) r;
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+wake_readers(struct sc_shm_frame_header *header) {
+    atomic_fetch_add(&header->futex, 1);
+    if (atomic_load(&header->waiters)) {
+        // Not FUTEX_PRIVATE_FLAG: the readers are in other processes
+        syscall(SYS_futex, &header->futex, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+static bool
+sc_shm_sink_open(struct sc_shm_sink *ss) {
+    ss->fd = shm_open(ss->name, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (ss->fd == -1) {
+        LOGE("Could not open shared memory %s: %s", ss->name, strerror(errno));
+        return false;
+    }
+
+    ss->slot_size = compute_slot_size(ss->frame_size);
+    size_t header_size = get_header_size();
+    ss->map_size = header_size + SC_SHM_FRAME_SLOTS * ss->slot_size;
+
+    if (ftruncate(ss->fd, ss->map_size) == -1) {
+        LOGE("Could not resize shared memory %s: %s", ss->name,
+             strerror(errno));
+        goto error_unlink;
+    }
+
+    void *map = mmap(NULL, ss->map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     ss->fd, 0);
+    if (map == MAP_FAILED) {
+        LOGE("Could not map shared memory %s: %s", ss->name, strerror(errno));
+        goto error_unlink;
+    }
+
+    // The memory is zero-initialized by ftruncate()
+    struct sc_shm_frame_header *header = map;
+    header->version = SC_SHM_FRAME_VERSION;
+    header->slot_count = SC_SHM_FRAME_SLOTS;
+    header->slot_size = ss->slot_size;
+    for (unsigned i = 0; i < SC_SHM_FRAME_SLOTS; ++i) {
+        header->slots[i].data_offset = header_size + i * ss->slot_size;
+    }
+    atomic_store_explicit(&header->magic, SC_SHM_FRAME_MAGIC,
+                          memory_order_release);
+
+    ss->header = header;
+    ss->frame_count = 0;
+    ss->unsupported_format_logged = false;
+    ss->frame_too_big_logged = false;
+
+    LOGI("Shared memory sink started: %s (%u slots of %u bytes)", ss->name,
+         SC_SHM_FRAME_SLOTS, (unsigned) ss->slot_size);
+
+    return true;
+
+error_unlink:
+    shm_unlink(ss->name);
+    close(ss->fd);
+
+    return false;
+}
+
+static void
+sc_shm_sink_close(struct sc_shm_sink *ss) {
+    atomic_store(&ss->header->closed, 1);
+    wake_readers(ss->header);
+
+    munmap(ss->header, ss->map_size);
+    // Readers which have already mapped the memory keep their mapping
+    shm_unlink(ss->name);
+    close(ss->fd);
+}
+
+static bool
+sc_shm_sink_push(struct sc_shm_sink *ss, const AVFrame *frame) {
+    if (frame->format != AV_PIX_FMT_YUV420P
+            && frame->format != AV_PIX_FMT_YUVJ420P) {
+        if (!ss->unsupported_format_logged) {
+            LOGW("Unsupported frame format for shared memory sink: %d",
+                 frame->format);
+            ss->unsupported_format_logged = true;
+        }
+        // Not an error, just ignore the frame
+        return true;
+    }
+
+    unsigned w = frame->width;
+    unsigned h = frame->height;
+    unsigned row_sizes[3] = {w, (w + 1) / 2, (w + 1) / 2};
+    unsigned heights[3] = {h, (h + 1) / 2, (h + 1) / 2};
+
+    // Keep the decoder line sizes if they fit, to copy each plane at once
+    bool keep_linesizes = true;
+    size_t total = 0;
+    for (unsigned i = 0; i < 3; ++i) {
+        if (frame->linesize[i] < 0
+                || (unsigned) frame->linesize[i] < row_sizes[i]) {
+            keep_linesizes = false;
+            break;
+        }
+        total += (size_t) frame->linesize[i] * heights[i];
+    }
+    if (keep_linesizes && total > ss->slot_size) {
+        keep_linesizes = false;
+    }
+
+    if (!keep_linesizes && yuv420_size(w, h) > ss->slot_size) {
+        if (!ss->frame_too_big_logged) {
+            LOGW("Frame too big for shared memory sink: %ux%u", w, h);
+            ss->frame_too_big_logged = true;
+        }
+        return true;
+    }
+
+    struct sc_shm_frame_header *header = ss->header;
+    uint64_t frame_number = ++ss->frame_count;
+    unsigned index = (frame_number - 1) % SC_SHM_FRAME_SLOTS;
+    struct sc_shm_frame_slot *slot = &header->slots[index];
+    uint8_t *data = (uint8_t *) header + slot->data_offset;
+
+    // Seqlock write: readers detect that the slot is being (or has been)
+    // overwritten
+    uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    uint32_t offset = 0;
+    for (unsigned i = 0; i < 3; ++i) {
+        uint8_t *dst = data + offset;
+        const uint8_t *src = frame->data[i];
+        if (keep_linesizes) {
+            unsigned linesize = frame->linesize[i];
+            // The last row is not necessarily padded
+            memcpy(dst, src, (size_t) linesize * (heights[i] - 1)
+                                 + row_sizes[i]);
+            slot->plane_linesizes[i] = linesize;
+        } else {
+            for (unsigned y = 0; y < heights[i]; ++y) {
+                memcpy(dst + (size_t) y * row_sizes[i],
+                       src + (size_t) y * frame->linesize[i], row_sizes[i]);
+            }
+            slot->plane_linesizes[i] = row_sizes[i];
+        }
+        slot->plane_offsets[i] = offset;
+        offset += slot->plane_linesizes[i] * heights[i];
+    }
+
+    slot->frame = frame_number;
+    slot->pts = frame->pts != AV_NOPTS_VALUE ? frame->pts : -1;
+    slot->format = SC_SHM_FRAME_FORMAT_I420;
+    slot->width = w;
+    slot->height = h;
+    slot->plane_count = 3;
+    slot->publish_time_ns = get_monotonic_time_ns();
+
+    atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+    atomic_store_explicit(&header->last_frame, frame_number,
+                          memory_order_release);
+
+    wake_readers(header);
+
+    return true;
+}
+
+static bool
+sc_shm_frame_sink_open(struct sc_frame_sink *sink) {
+    struct sc_shm_sink *ss = DOWNCAST(sink);
+    return sc_shm_sink_open(ss);
+}
+
+static void
+sc_shm_frame_sink_close(struct sc_frame_sink *sink) {
+    struct sc_shm_sink *ss = DOWNCAST(sink);
+    sc_shm_sink_close(ss);
+}
+
+static bool
+sc_shm_frame_sink_push(struct sc_frame_sink *sink, const AVFrame *frame) {
+    struct sc_shm_sink *ss = DOWNCAST(sink);
+    return sc_shm_sink_push(ss, frame);
+}
+
+bool
+sc_shm_sink_init(struct sc_shm_sink *ss, const char *name,
+                 struct sc_size frame_size) {
+    ss->name = strdup(name);
+    if (!ss->name) {
+        LOGE("Could not strdup shared memory name");
+        return false;
+    }
+
+    ss->frame_size = frame_size;
+
+    static const struct sc_frame_sink_ops ops = {
+        .open = sc_shm_frame_sink_open,
+        .close = sc_shm_frame_sink_close,
+        .push = sc_shm_frame_sink_push,
+    };
+
+    ss->frame_sink.ops = &ops;
+
+    return true;
+}
+
+void
+sc_shm_sink_destroy(struct sc_shm_sink *ss) {
+    free(ss->name);
+}
@@ -0,0 +1,44 @@
+#ifndef SC_SHM_SINK_H
+#define SC_SHM_SINK_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "coords.h"
+#include "shm_frame.h"
+#include "trait/frame_sink.h"
+
+/**
+ * Frame sink publishing the decoded frames into a POSIX shared memory ring,
+ * for local consumers (see shm_frame.h for the layout).
+ *
+ * The frames are copied directly from the decoder thread: the sink never
+ * waits for the readers.
+ */
+struct sc_shm_sink {
+    struct sc_frame_sink frame_sink; // frame sink trait
+
+    char *name;
+    struct sc_size frame_size;
+
+    int fd;
+    struct sc_shm_frame_header *header;
+    size_t map_size;
+    size_t slot_size;
+
+    uint64_t frame_count;
+    bool unsupported_format_logged;
+    bool frame_too_big_logged;
+};
+
+bool
+sc_shm_sink_init(struct sc_shm_sink *ss, const char *name,
+                 struct sc_size frame_size);
+
+void
+sc_shm_sink_destroy(struct sc_shm_sink *ss);
+
+#endif
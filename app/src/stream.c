@@ -1,6 +1,8 @@
 #include "stream.h"
 
 #include <assert.h>
+#include <stdio.h>
+#include <string.h>
 #include <libavformat/avformat.h>
 #include <libavutil/time.h>
 #include <unistd.h>
@@ -16,8 +18,101 @@
 #define HEADER_SIZE 12
 #define NO_PTS UINT64_C(-1)
 
+// Over UDP, a missing packet is considered lost after this delay
+#define STREAM_UDP_REORDER_DELAY SC_TICK_FROM_MS(50)
+// The device sends the video to the source address of the "hello" datagram,
+// which is sent again until the first datagram is received (it may be lost)
+#define STREAM_UDP_HELLO "scrcpy"
+#define STREAM_UDP_HELLO_INTERVAL SC_TICK_FROM_MS(100)
+
+static ssize_t
+stream_recv_all(struct stream *stream, void *buf, size_t len) {
+    if (stream->mux) {
+        return sc_mux_recv_all(stream->mux, SC_MUX_CHANNEL_VIDEO, buf, len);
+    }
+    return net_recv_all(stream->socket, buf, len);
+}
+
+enum stream_recv_result {
+    STREAM_RECV_OK,
+    STREAM_RECV_EOS,
+    // the connection has been replaced, the packet in flight is lost
+    STREAM_RECV_RESUMED,
+};
+
 static bool
+stream_set_udp_timeout(struct stream *stream, sc_tick timeout) {
+    if (timeout == stream->udp_timeout) {
+        return true;
+    }
+    stream->udp_timeout = timeout;
+    return net_set_recv_timeout(stream->udp_socket, timeout);
+}
+
+static enum stream_recv_result
+stream_recv_rtp_packet(struct stream *stream, AVPacket *packet) {
+    struct sc_rtp_receiver *rr = &stream->rtp;
+    uint8_t datagram[SC_RTP_MAX_DATAGRAM_LENGTH];
+
+    for (;;) {
+        sc_tick now = sc_tick_now();
+
+        struct sc_rtp_frame frame;
+        if (sc_rtp_receiver_pop(rr, now, &frame)) {
+            if (av_new_packet(packet, frame.size)) {
+                LOG_OOM();
+                return STREAM_RECV_EOS;
+            }
+            memcpy(packet->data, frame.data, frame.size);
+            packet->pts = frame.config ? AV_NOPTS_VALUE : (int64_t) frame.pts;
+            return STREAM_RECV_OK;
+        }
+
+        if (sc_rtp_receiver_consume_key_frame_request(rr, now)
+                && stream->cbs->on_key_frame_needed) {
+            stream->cbs->on_key_frame_needed(stream, stream->cbs_userdata);
+        }
+
+        sc_tick timeout;
+        if (!stream->udp_received) {
+            net_send(stream->udp_socket, stream->udp_hello,
+                     strlen(stream->udp_hello));
+            timeout = STREAM_UDP_HELLO_INTERVAL;
+        } else {
+            sc_tick deadline = sc_rtp_receiver_get_deadline(rr);
+            if (deadline) {
+                // at least 1ms, 0 would mean "no timeout"
+                timeout = deadline > now + SC_TICK_FROM_MS(1)
+                        ? deadline - now : SC_TICK_FROM_MS(1);
+            } else {
+                timeout = 0;
+            }
+        }
+
+        if (!stream_set_udp_timeout(stream, timeout)) {
+            return STREAM_RECV_EOS;
+        }
+
+        ssize_t r = net_recv(stream->udp_socket, datagram, sizeof(datagram));
+        if (r < 0 && net_timed_out()) {
+            continue;
+        }
+        if (r <= 0) {
+            // interrupted (or failed)
+            return STREAM_RECV_EOS;
+        }
+
+        stream->udp_received = true;
+        sc_rtp_receiver_push(rr, datagram, r);
+    }
+}
+
+static enum stream_recv_result
 stream_recv_packet(struct stream *stream, AVPacket *packet) {
+    if (stream->udp_socket != SC_SOCKET_NONE) {
+        return stream_recv_rtp_packet(stream, packet);
+    }
+
     // The video stream contains raw packets, without time information. When we
     // record, we retrieve the timestamps separately, from a "meta" header
     // added by the server before each raw packet.
@@ -31,9 +126,12 @@ stream_recv_packet(struct stream *stream, AVPacket *packet) {
     // It is followed by <packet_size> bytes containing the packet/frame.
 
     uint8_t header[HEADER_SIZE];
-    ssize_t r = net_recv_all(stream->socket, header, HEADER_SIZE);
+    ssize_t r = stream_recv_all(stream, header, HEADER_SIZE);
+    if (r == SC_MUX_RESUMED) {
+        return STREAM_RECV_RESUMED;
+    }
     if (r < HEADER_SIZE) {
-        return false;
+        return STREAM_RECV_EOS;
     }
 
     uint64_t pts = buffer_read64be(header);
@@ -43,18 +141,18 @@ stream_recv_packet(struct stream *stream, AVPacket *packet) {
 
     if (av_new_packet(packet, len)) {
         LOG_OOM();
-        return false;
+        return STREAM_RECV_EOS;
     }
 
-    r = net_recv_all(stream->socket, packet->data, len);
+    r = stream_recv_all(stream, packet->data, len);
     if (r < 0 || ((uint32_t) r) < len) {
         av_packet_unref(packet);
-        return false;
+        return r == SC_MUX_RESUMED ? STREAM_RECV_RESUMED : STREAM_RECV_EOS;
     }
 
     packet->pts = pts != NO_PTS ? (int64_t) pts : AV_NOPTS_VALUE;
 
-    return true;
+    return STREAM_RECV_OK;
 }
 
 static bool
@@ -219,20 +317,34 @@ run_stream(void *data) {
     // It's more complicated, but this allows to reduce the latency by 1 frame!
     stream->parser->flags |= PARSER_FLAG_COMPLETE_FRAMES;
 
+    bool udp = stream->udp_socket != SC_SOCKET_NONE;
+    if (udp && !sc_rtp_receiver_init(&stream->rtp, STREAM_UDP_REORDER_DELAY)) {
+        goto finally_close_parser;
+    }
+
     AVPacket *packet = av_packet_alloc();
     if (!packet) {
         LOG_OOM();
-        goto finally_close_parser;
+        goto finally_destroy_rtp;
     }
 
     for (;;) {
-        bool ok = stream_recv_packet(stream, packet);
-        if (!ok) {
-            // end of stream
+        enum stream_recv_result result = stream_recv_packet(stream, packet);
+        if (result == STREAM_RECV_EOS) {
             break;
         }
 
-        ok = stream_push_packet(stream, packet);
+        if (result == STREAM_RECV_RESUMED) {
+            // The device restarts the stream with a config packet and a key
+            // frame, so the sinks are kept open across the gap
+            LOGI("Video stream resumed");
+            if (stream->pending) {
+                av_packet_free(&stream->pending);
+            }
+            continue;
+        }
+
+        bool ok = stream_push_packet(stream, packet);
         av_packet_unref(packet);
         if (!ok) {
             // cannot process packet (error already logged)
@@ -247,6 +359,16 @@ run_stream(void *data) {
     }
 
     av_packet_free(&packet);
+finally_destroy_rtp:
+    if (udp) {
+        struct sc_rtp_stats *stats = &stream->rtp.stats;
+        LOGI("UDP stream: %" PRIu64_ " packets received, %" PRIu64_
+             " recovered, %" PRIu64_ " lost, %" PRIu64_ " late; %" PRIu64_
+             " frames, %" PRIu64_ " dropped", stats->received,
+             stats->recovered, stats->lost, stats->late, stats->frames,
+             stats->dropped_frames);
+        sc_rtp_receiver_destroy(&stream->rtp);
+    }
 finally_close_parser:
     av_parser_close(stream->parser);
 finally_close_sinks:
@@ -263,6 +385,10 @@ void
 stream_init(struct stream *stream, sc_socket socket,
             const struct stream_callbacks *cbs, void *cbs_userdata) {
     stream->socket = socket;
+    stream->mux = NULL;
+    stream->udp_socket = SC_SOCKET_NONE;
+    stream->udp_received = false;
+    stream->udp_timeout = 0;
     stream->pending = NULL;
     stream->sink_count = 0;
 
@@ -280,6 +406,21 @@ stream_add_sink(struct stream *stream, struct sc_packet_sink *sink) {
     stream->sinks[stream->sink_count++] = sink;
 }
 
+void
+stream_set_mux(struct stream *stream, struct sc_mux *mux) {
+    stream->mux = mux;
+}
+
+void
+stream_set_udp(struct stream *stream, sc_socket udp_socket,
+               const char *token) {
+    int r = snprintf(stream->udp_hello, sizeof(stream->udp_hello), "%s%s",
+                     STREAM_UDP_HELLO, token);
+    assert(r >= 0 && (size_t) r < sizeof(stream->udp_hello));
+    (void) r;
+    stream->udp_socket = udp_socket;
+}
+
 bool
 stream_start(struct stream *stream) {
     LOGD("Starting stream thread");
@@ -7,14 +7,25 @@
 #include <stdint.h>
 #include <libavformat/avformat.h>
 
+#include "mux.h"
+#include "rtp_receiver.h"
 #include "trait/packet_sink.h"
 #include "util/net.h"
 #include "util/thread.h"
 
-#define STREAM_MAX_SINKS 2
+#define STREAM_MAX_SINKS 3
+#define STREAM_UDP_HELLO_MAX_LENGTH 64
 
 struct stream {
     sc_socket socket;
+    struct sc_mux *mux; // if set, the socket is multiplexed
+    // if set, the video is received over UDP (the socket is unused)
+    sc_socket udp_socket;
+    struct sc_rtp_receiver rtp;
+    // sent until a datagram is received: "scrcpy" followed by the token
+    char udp_hello[STREAM_UDP_HELLO_MAX_LENGTH + 1];
+    bool udp_received; // a datagram has been received
+    sc_tick udp_timeout; // the current receive timeout
     sc_thread thread;
 
     struct sc_packet_sink *sinks[STREAM_MAX_SINKS];
@@ -32,6 +43,9 @@ struct stream {
 
 struct stream_callbacks {
     void (*on_eos)(struct stream *stream, void *userdata);
+    // Called from the stream thread when packets have been lost (over UDP),
+    // so that a key frame is requested to the device (optional)
+    void (*on_key_frame_needed)(struct stream *stream, void *userdata);
 };
 
 void
@@ -41,6 +55,17 @@ stream_init(struct stream *stream, sc_socket socket,
 void
 stream_add_sink(struct stream *stream, struct sc_packet_sink *sink);
 
+// Receive the video from the video channel of a multiplexed socket
+void
+stream_set_mux(struct stream *stream, struct sc_mux *mux);
+
+// Receive the video over RTP from a connected UDP socket (see rtp_receiver.h)
+//
+// The token authenticates the client to the device.
+void
+stream_set_udp(struct stream *stream, sc_socket udp_socket,
+               const char *token);
+
 bool
 stream_start(struct stream *stream);
 
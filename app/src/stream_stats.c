@@ -0,0 +1,154 @@
+#include "stream_stats.h"
+
+#include <libavcodec/avcodec.h>
+
+#include "controller.h"
+#include "fps_counter.h"
+#include "util/log.h"
+
+/** Downcast packet_sink to sc_stream_stats */
+#define DOWNCAST(SINK) container_of(SINK, struct sc_stream_stats, packet_sink)
+
+// The minimal one-way delay is computed over 2 successive windows, so that it
+// follows a change of route (or a drift of the device clock)
+#define SC_STREAM_STATS_MIN_DELAY_WINDOW SC_TICK_FROM_SEC(10)
+
+// Smoothing factor of the jitter (like RFC 3550)
+#define SC_STREAM_STATS_JITTER_GAIN 16
+
+static uint32_t
+clamp_u32(uint64_t value) {
+    return value > UINT32_MAX ? UINT32_MAX : (uint32_t) value;
+}
+
+static void
+update_min_delay(struct sc_stream_stats *stats, sc_tick delay, sc_tick now) {
+    sc_tick window_elapsed = now - stats->min_delay_window_start;
+    if (window_elapsed >= SC_STREAM_STATS_MIN_DELAY_WINDOW) {
+        stats->previous_min_delay = stats->min_delay;
+        stats->min_delay = delay;
+        stats->min_delay_window_start = now;
+    } else if (delay < stats->min_delay) {
+        stats->min_delay = delay;
+    }
+}
+
+static void
+account_delay(struct sc_stream_stats *stats, int64_t pts, sc_tick now) {
+    sc_tick delay = now - pts;
+    update_min_delay(stats, delay, now);
+
+    if (stats->clock.count > 1) {
+        // Deviation from the arrival time expected from the previous packets
+        sc_tick deviation = now - sc_clock_to_system_time(&stats->clock, pts);
+        if (deviation < 0) {
+            deviation = -deviation;
+        }
+        stats->jitter += (deviation - stats->jitter)
+                       / SC_STREAM_STATS_JITTER_GAIN;
+    }
+    sc_clock_update(&stats->clock, now, pts);
+
+    sc_tick base = stats->min_delay < stats->previous_min_delay
+                 ? stats->min_delay : stats->previous_min_delay;
+    stats->delay_sum += delay - base;
+    ++stats->delay_count;
+}
+
+bool
+sc_stream_stats_account(struct sc_stream_stats *stats, size_t size,
+                        int64_t pts, sc_tick now, struct control_msg *msg) {
+    if (stats->last_report == -1) {
+        // first packet
+        stats->last_report = now;
+        stats->min_delay_window_start = now;
+    }
+
+    stats->bytes += size;
+    if (pts >= 0) {
+        account_delay(stats, pts, now);
+    }
+
+    sc_tick elapsed = now - stats->last_report;
+    if (elapsed < stats->interval) {
+        return false;
+    }
+
+    unsigned skipped = stats->fps_counter
+                     ? fps_counter_take_skipped_frames(stats->fps_counter)
+                     : 0;
+
+    msg->type = CONTROL_MSG_TYPE_STREAM_STATS;
+    msg->stream_stats.throughput =
+        clamp_u32(stats->bytes * SC_TICK_FREQ / elapsed);
+    msg->stream_stats.queue_delay = stats->delay_count
+        ? clamp_u32(SC_TICK_TO_US(stats->delay_sum / stats->delay_count)) : 0;
+    msg->stream_stats.jitter = clamp_u32(SC_TICK_TO_US(stats->jitter));
+    msg->stream_stats.skipped_frames =
+        skipped > UINT16_MAX ? UINT16_MAX : skipped;
+
+    stats->last_report = now;
+    stats->bytes = 0;
+    stats->delay_sum = 0;
+    stats->delay_count = 0;
+    return true;
+}
+
+static bool
+sc_stream_stats_packet_sink_open(struct sc_packet_sink *sink,
+                                 const AVCodec *codec) {
+    (void) sink;
+    (void) codec;
+    return true;
+}
+
+static void
+sc_stream_stats_packet_sink_close(struct sc_packet_sink *sink) {
+    (void) sink;
+}
+
+static bool
+sc_stream_stats_packet_sink_push(struct sc_packet_sink *sink,
+                                 const AVPacket *packet) {
+    struct sc_stream_stats *stats = DOWNCAST(sink);
+
+    int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : -1;
+    struct control_msg msg;
+    if (sc_stream_stats_account(stats, packet->size, pts,
+                                sc_tick_now_precise(), &msg)) {
+        if (!controller_push_msg(stats->controller, &msg)) {
+            // not fatal, the next report will be sent
+            LOGW("Could not request 'stream stats'");
+        }
+    }
+
+    return true;
+}
+
+void
+sc_stream_stats_init(struct sc_stream_stats *stats,
+                     struct controller *controller,
+                     struct fps_counter *fps_counter, sc_tick interval) {
+    stats->controller = controller;
+    stats->fps_counter = fps_counter;
+    stats->interval = interval ? interval : SC_STREAM_STATS_DEFAULT_INTERVAL;
+
+    sc_clock_init(&stats->clock);
+    stats->min_delay = INT64_MAX;
+    stats->previous_min_delay = INT64_MAX;
+    stats->min_delay_window_start = 0;
+    stats->jitter = 0;
+
+    stats->last_report = -1;
+    stats->bytes = 0;
+    stats->delay_sum = 0;
+    stats->delay_count = 0;
+
+    static const struct sc_packet_sink_ops ops = {
+        .open = sc_stream_stats_packet_sink_open,
+        .close = sc_stream_stats_packet_sink_close,
+        .push = sc_stream_stats_packet_sink_push,
+    };
+
+    stats->packet_sink.ops = &ops;
+}
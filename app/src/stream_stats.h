@@ -0,0 +1,74 @@
+#ifndef SC_STREAM_STATS_H
+#define SC_STREAM_STATS_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "clock.h"
+#include "control_msg.h"
+#include "trait/packet_sink.h"
+#include "util/tick.h"
+
+#define SC_STREAM_STATS_DEFAULT_INTERVAL SC_TICK_FROM_MS(500)
+
+struct controller;
+struct fps_counter;
+
+/**
+ * Measure the reception of the video stream, and report it periodically to
+ * the device (so that it may adapt the bit-rate)
+ *
+ * It is a packet sink of the stream, so it sees every packet as soon as it is
+ * received. For each report, it measures:
+ *  - the throughput (bytes received per second);
+ *  - the queue delay: the one-way delay of the packets (arrival time minus
+ *    PTS, up to an unknown constant offset) relative to its recent minimum,
+ *    which increases when the packets wait in a network queue;
+ *  - the jitter: the smoothed deviation of the arrival times from the clock
+ *    estimated from the previous packets (see sc_clock);
+ *  - the number of frames skipped by the screen.
+ */
+struct sc_stream_stats {
+    struct sc_packet_sink packet_sink; // packet sink trait
+
+    struct controller *controller; // may be NULL (for tests)
+    struct fps_counter *fps_counter; // may be NULL
+    sc_tick interval;
+
+    struct sc_clock clock;
+
+    // Minimal one-way delay over the current and the previous windows
+    sc_tick min_delay;
+    sc_tick previous_min_delay;
+    sc_tick min_delay_window_start;
+
+    sc_tick jitter;
+
+    // Accumulated since the last report
+    sc_tick last_report;
+    uint64_t bytes;
+    sc_tick delay_sum;
+    unsigned delay_count;
+};
+
+// If interval is 0, SC_STREAM_STATS_DEFAULT_INTERVAL is used
+void
+sc_stream_stats_init(struct sc_stream_stats *stats,
+                     struct controller *controller,
+                     struct fps_counter *fps_counter, sc_tick interval);
+
+/**
+ * Account a packet of `size` bytes received at `now`
+ *
+ * The PTS is in microseconds, or -1 for a config packet.
+ *
+ * Return true if a report is due, and fill `msg` with the stream stats.
+ */
+bool
+sc_stream_stats_account(struct sc_stream_stats *stats, size_t size,
+                        int64_t pts, sc_tick now, struct control_msg *msg);
+
+#endif
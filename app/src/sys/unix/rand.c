@@ -0,0 +1,23 @@
+#include "util/rand.h"
+
+#include <stdio.h>
+
+#include "util/log.h"
+
+bool
+sc_rand_bytes(void *buf, size_t len) {
+    FILE *f = fopen("/dev/urandom", "rb");
+    if (!f) {
+        LOGE("Could not open /dev/urandom");
+        return false;
+    }
+
+    size_t r = fread(buf, 1, len, f);
+    fclose(f);
+    if (r != len) {
+        LOGE("Could not read /dev/urandom");
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,27 @@
+// rand_s() is only declared if this is defined before <stdlib.h>
+#define _CRT_RAND_S
+
+#include "util/rand.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/log.h"
+
+bool
+sc_rand_bytes(void *buf, size_t len) {
+    unsigned char *p = buf;
+    while (len) {
+        unsigned int value;
+        if (rand_s(&value)) {
+            LOGE("Could not generate random bytes");
+            return false;
+        }
+        size_t n = len < sizeof(value) ? len : sizeof(value);
+        memcpy(p, &value, n);
+        p += n;
+        len -= n;
+    }
+
+    return true;
+}
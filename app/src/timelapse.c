@@ -0,0 +1,479 @@
+#include "timelapse.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <string.h>
+#include <libavutil/opt.h>
+
+#include "util/log.h"
+#include "util/sad.h"
+#include "util/str.h"
+
+/** Downcast frame_sink to sc_timelapse */
+#define DOWNCAST(SINK) container_of(SINK, struct sc_timelapse, frame_sink)
+
+// frame rate of the resulting file (independent of the capture rate)
+#define SC_TIMELAPSE_FPS 30
+
+static const AVOutputFormat *
+find_muxer(const char *name) {
+#ifdef SCRCPY_LAVF_HAS_NEW_MUXER_ITERATOR_API
+    void *opaque = NULL;
+#endif
+    const AVOutputFormat *oformat = NULL;
+    do {
+#ifdef SCRCPY_LAVF_HAS_NEW_MUXER_ITERATOR_API
+        oformat = av_muxer_iterate(&opaque);
+#else
+        oformat = av_oformat_next(oformat);
+#endif
+        // until null or containing the requested name
+    } while (oformat && !sc_str_list_contains(oformat->name, ',', name));
+    return oformat;
+}
+
+static const char *
+get_format_name(enum sc_record_format format) {
+    switch (format) {
+        case SC_RECORD_FORMAT_MP4: return "mp4";
+        case SC_RECORD_FORMAT_MKV: return "matroska";
+        default: return NULL;
+    }
+}
+
+static bool
+sc_timelapse_open_output(struct sc_timelapse *tl, const AVFrame *frame) {
+    // Many FFmpeg builds only provide libopenh264
+    const AVCodec *encoder = avcodec_find_encoder_by_name("libx264");
+    bool x264 = encoder;
+    if (!encoder) {
+        encoder = avcodec_find_encoder_by_name("libopenh264");
+        if (!encoder) {
+            LOGE("Time-lapse: H.264 encoder not found (libx264 or "
+                 "libopenh264)");
+            return false;
+        }
+        LOGD("Time-lapse: libx264 not found, using libopenh264");
+    }
+
+    const char *format_name = get_format_name(tl->format);
+    assert(format_name);
+    const AVOutputFormat *format = find_muxer(format_name);
+    if (!format) {
+        LOGE("Time-lapse: could not find muxer");
+        return false;
+    }
+
+    tl->format_ctx = avformat_alloc_context();
+    if (!tl->format_ctx) {
+        LOG_OOM();
+        return false;
+    }
+
+    // See recorder.c
+    tl->format_ctx->oformat = (AVOutputFormat *) format;
+
+    av_dict_set(&tl->format_ctx->metadata, "comment",
+                "Recorded by scrcpy " SCRCPY_VERSION, 0);
+
+    tl->encoder_ctx = avcodec_alloc_context3(encoder);
+    if (!tl->encoder_ctx) {
+        LOG_OOM();
+        goto error_avformat_free_context;
+    }
+
+    AVCodecContext *ctx = tl->encoder_ctx;
+    ctx->width = frame->width;
+    ctx->height = frame->height;
+    ctx->pix_fmt = frame->format;
+    ctx->time_base = (AVRational) {1, SC_TIMELAPSE_FPS};
+    ctx->framerate = (AVRational) {SC_TIMELAPSE_FPS, 1};
+    // Let the encoder use its own pool of threads
+    ctx->thread_count = 0;
+    if (format->flags & AVFMT_GLOBALHEADER) {
+        ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    if (x264) {
+        if (av_opt_set_int(ctx->priv_data, "crf", tl->crf, 0) < 0) {
+            LOGW("Time-lapse: could not set CRF %u", tl->crf);
+        }
+    } else {
+        // openh264 has no CRF: use the CRF as a constant QP (both range from
+        // 0 to 51, a QP is close to the same CRF on average), in quality mode
+        // so that the QP is not overridden to reach the default bit-rate
+        if (av_opt_set(ctx->priv_data, "rc_mode", "quality", 0) < 0) {
+            LOGW("Time-lapse: could not set the openh264 quality mode");
+        }
+        ctx->qmin = tl->crf;
+        ctx->qmax = tl->crf;
+    }
+
+    if (avcodec_open2(ctx, encoder, NULL) < 0) {
+        LOGE("Time-lapse: could not open encoder");
+        goto error_avcodec_free_context;
+    }
+
+    AVStream *ostream = avformat_new_stream(tl->format_ctx, encoder);
+    if (!ostream) {
+        LOG_OOM();
+        goto error_avcodec_free_context;
+    }
+
+    if (avcodec_parameters_from_context(ostream->codecpar, ctx) < 0) {
+        LOGE("Time-lapse: could not initialize stream parameters");
+        goto error_avcodec_free_context;
+    }
+    ostream->time_base = ctx->time_base;
+
+    int ret = avio_open(&tl->format_ctx->pb, tl->filename, AVIO_FLAG_WRITE);
+    if (ret < 0) {
+        LOGE("Time-lapse: failed to open output file: %s", tl->filename);
+        goto error_avcodec_free_context;
+    }
+
+    ret = avformat_write_header(tl->format_ctx, NULL);
+    if (ret < 0) {
+        LOGE("Time-lapse: failed to write header to %s", tl->filename);
+        goto error_avio_close;
+    }
+
+    LOGI("Time-lapse recording started to %s file: %s", format_name,
+                                                        tl->filename);
+
+    return true;
+
+error_avio_close:
+    avio_close(tl->format_ctx->pb);
+error_avcodec_free_context:
+    avcodec_free_context(&tl->encoder_ctx);
+error_avformat_free_context:
+    avformat_free_context(tl->format_ctx);
+
+    return false;
+}
+
+static void
+sc_timelapse_close_output(struct sc_timelapse *tl) {
+    avcodec_free_context(&tl->encoder_ctx);
+    avio_close(tl->format_ctx->pb);
+    avformat_free_context(tl->format_ctx);
+}
+
+// frame may be NULL to flush the encoder
+static bool
+sc_timelapse_encode(struct sc_timelapse *tl, const AVFrame *frame) {
+    int ret = avcodec_send_frame(tl->encoder_ctx, frame);
+    if (ret < 0) {
+        LOGE("Time-lapse: could not send frame: %d", ret);
+        return false;
+    }
+
+    AVStream *ostream = tl->format_ctx->streams[0];
+    AVPacket *packet = tl->packet;
+    for (;;) {
+        ret = avcodec_receive_packet(tl->encoder_ctx, packet);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            return true;
+        }
+        if (ret < 0) {
+            LOGE("Time-lapse: could not receive packet: %d", ret);
+            return false;
+        }
+
+        av_packet_rescale_ts(packet, tl->encoder_ctx->time_base,
+                             ostream->time_base);
+        packet->stream_index = ostream->index;
+
+        ret = av_write_frame(tl->format_ctx, packet);
+        av_packet_unref(packet);
+        if (ret < 0) {
+            LOGE("Time-lapse: could not write packet");
+            return false;
+        }
+    }
+}
+
+static bool
+sc_timelapse_has_changed(struct sc_timelapse *tl, const AVFrame *frame) {
+    const AVFrame *last = tl->last;
+    if (!last->data[0] || last->width != frame->width
+                       || last->height != frame->height) {
+        return true;
+    }
+
+    uint64_t sad = sc_sad_plane(frame->data[0], frame->linesize[0],
+                                last->data[0], last->linesize[0],
+                                frame->width, frame->height);
+    uint64_t samples = (uint64_t) frame->width * frame->height;
+
+    // compare the mean absolute difference per luma sample to the threshold
+    return sad > tl->threshold * samples;
+}
+
+static bool
+sc_timelapse_process_frame(struct sc_timelapse *tl, AVFrame *frame) {
+    if (tl->threshold && !sc_timelapse_has_changed(tl, frame)) {
+        // not enough changes since the last written frame
+        return true;
+    }
+
+    if (!tl->encoder_opened) {
+        if (!sc_timelapse_open_output(tl, frame)) {
+            return false;
+        }
+        tl->encoder_opened = true;
+    } else if (frame->width != tl->encoder_ctx->width
+            || frame->height != tl->encoder_ctx->height) {
+        // The encoder can not change its resolution
+        LOGD("Time-lapse: frame size changed, frame ignored");
+        return true;
+    }
+
+    frame->pts = tl->next_pts++;
+    // do not force the picture type of the decoded frame on the encoder
+    frame->pict_type = AV_PICTURE_TYPE_NONE;
+
+    if (!sc_timelapse_encode(tl, frame)) {
+        return false;
+    }
+
+    if (tl->threshold) {
+        // keep a reference to compare the next frames (the decoded frame is
+        // refcounted, no copy is involved)
+        av_frame_unref(tl->last);
+        av_frame_move_ref(tl->last, frame);
+    }
+
+    return true;
+}
+
+static int
+run_timelapse(void *data) {
+    struct sc_timelapse *tl = data;
+
+    for (;;) {
+        sc_mutex_lock(&tl->mutex);
+
+        while (!tl->stopped && !tl->has_frame) {
+            sc_cond_wait(&tl->cond, &tl->mutex);
+        }
+
+        if (tl->stopped) {
+            sc_mutex_unlock(&tl->mutex);
+            break;
+        }
+
+        tl->has_frame = false;
+        sc_mutex_unlock(&tl->mutex);
+
+        sc_video_buffer_consume(&tl->vb, tl->frame);
+
+        bool ok = sc_timelapse_process_frame(tl, tl->frame);
+        av_frame_unref(tl->frame);
+        if (!ok) {
+            LOGE("Time-lapse recording failed to %s", tl->filename);
+            tl->failed = true;
+            break;
+        }
+    }
+
+    if (tl->encoder_opened) {
+        if (!tl->failed) {
+            // flush the frames delayed by the encoder
+            bool ok = sc_timelapse_encode(tl, NULL)
+                   && av_write_trailer(tl->format_ctx) >= 0;
+            if (ok) {
+                LOGI("Time-lapse recording complete (%" PRIu64_ " frames): %s",
+                     (uint64_t) tl->next_pts, tl->filename);
+            } else {
+                LOGE("Time-lapse recording failed to %s", tl->filename);
+            }
+        }
+        sc_timelapse_close_output(tl);
+    }
+
+    av_frame_unref(tl->last);
+
+    LOGD("Time-lapse thread ended");
+
+    return 0;
+}
+
+static void
+sc_video_buffer_on_new_frame(struct sc_video_buffer *vb, bool previous_skipped,
+                             void *userdata) {
+    (void) vb;
+    struct sc_timelapse *tl = userdata;
+
+    if (!previous_skipped) {
+        sc_mutex_lock(&tl->mutex);
+        tl->has_frame = true;
+        sc_cond_signal(&tl->cond);
+        sc_mutex_unlock(&tl->mutex);
+    }
+}
+
+static bool
+sc_timelapse_open(struct sc_timelapse *tl) {
+    static const struct sc_video_buffer_callbacks cbs = {
+        .on_new_frame = sc_video_buffer_on_new_frame,
+    };
+
+    // no buffering: if the encoder is busy, intermediate frames are skipped
+    bool ok = sc_video_buffer_init(&tl->vb, 0, &cbs, tl);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_video_buffer_start(&tl->vb);
+    if (!ok) {
+        goto error_video_buffer_destroy;
+    }
+
+    ok = sc_mutex_init(&tl->mutex);
+    if (!ok) {
+        goto error_video_buffer_stop_and_join;
+    }
+
+    ok = sc_cond_init(&tl->cond);
+    if (!ok) {
+        goto error_mutex_destroy;
+    }
+
+    tl->frame = av_frame_alloc();
+    if (!tl->frame) {
+        LOG_OOM();
+        goto error_cond_destroy;
+    }
+
+    tl->last = av_frame_alloc();
+    if (!tl->last) {
+        LOG_OOM();
+        goto error_av_frame_free;
+    }
+
+    tl->packet = av_packet_alloc();
+    if (!tl->packet) {
+        LOG_OOM();
+        goto error_av_frame_free_last;
+    }
+
+    tl->frame_count = 0;
+    tl->has_frame = false;
+    tl->stopped = false;
+    tl->encoder_opened = false;
+    tl->failed = false;
+    tl->next_pts = 0;
+
+    LOGD("Starting time-lapse thread");
+    ok = sc_thread_create(&tl->thread, run_timelapse, "timelapse", tl);
+    if (!ok) {
+        LOGC("Could not start time-lapse thread");
+        goto error_av_packet_free;
+    }
+
+    return true;
+
+error_av_packet_free:
+    av_packet_free(&tl->packet);
+error_av_frame_free_last:
+    av_frame_free(&tl->last);
+error_av_frame_free:
+    av_frame_free(&tl->frame);
+error_cond_destroy:
+    sc_cond_destroy(&tl->cond);
+error_mutex_destroy:
+    sc_mutex_destroy(&tl->mutex);
+error_video_buffer_stop_and_join:
+    sc_video_buffer_stop(&tl->vb);
+    sc_video_buffer_join(&tl->vb);
+error_video_buffer_destroy:
+    sc_video_buffer_destroy(&tl->vb);
+
+    return false;
+}
+
+static void
+sc_timelapse_close(struct sc_timelapse *tl) {
+    sc_mutex_lock(&tl->mutex);
+    tl->stopped = true;
+    sc_cond_signal(&tl->cond);
+    sc_mutex_unlock(&tl->mutex);
+
+    sc_video_buffer_stop(&tl->vb);
+
+    sc_thread_join(&tl->thread, NULL);
+    sc_video_buffer_join(&tl->vb);
+
+    av_packet_free(&tl->packet);
+    av_frame_free(&tl->last);
+    av_frame_free(&tl->frame);
+    sc_cond_destroy(&tl->cond);
+    sc_mutex_destroy(&tl->mutex);
+    sc_video_buffer_destroy(&tl->vb);
+}
+
+static bool
+sc_timelapse_push(struct sc_timelapse *tl, const AVFrame *frame) {
+    if (tl->interval > 1) {
+        // select one frame every interval frames, other frames are ignored
+        // without even waking up the time-lapse thread
+        bool selected = !(tl->frame_count % tl->interval);
+        ++tl->frame_count;
+        if (!selected) {
+            return true;
+        }
+    }
+
+    return sc_video_buffer_push(&tl->vb, frame);
+}
+
+static bool
+sc_timelapse_frame_sink_open(struct sc_frame_sink *sink) {
+    struct sc_timelapse *tl = DOWNCAST(sink);
+    return sc_timelapse_open(tl);
+}
+
+static void
+sc_timelapse_frame_sink_close(struct sc_frame_sink *sink) {
+    struct sc_timelapse *tl = DOWNCAST(sink);
+    sc_timelapse_close(tl);
+}
+
+static bool
+sc_timelapse_frame_sink_push(struct sc_frame_sink *sink, const AVFrame *frame) {
+    struct sc_timelapse *tl = DOWNCAST(sink);
+    return sc_timelapse_push(tl, frame);
+}
+
+bool
+sc_timelapse_init(struct sc_timelapse *tl, const char *filename,
+                  enum sc_record_format format, unsigned interval,
+                  unsigned threshold, unsigned crf) {
+    tl->filename = strdup(filename);
+    if (!tl->filename) {
+        LOG_OOM();
+        return false;
+    }
+
+    tl->format = format;
+    tl->interval = interval;
+    tl->threshold = threshold;
+    tl->crf = crf;
+
+    static const struct sc_frame_sink_ops ops = {
+        .open = sc_timelapse_frame_sink_open,
+        .close = sc_timelapse_frame_sink_close,
+        .push = sc_timelapse_frame_sink_push,
+    };
+
+    tl->frame_sink.ops = &ops;
+
+    return true;
+}
+
+void
+sc_timelapse_destroy(struct sc_timelapse *tl) {
+    free(tl->filename);
+}
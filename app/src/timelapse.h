@@ -0,0 +1,66 @@
+#ifndef SC_TIMELAPSE_H
+#define SC_TIMELAPSE_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+
+#include "options.h"
+#include "trait/frame_sink.h"
+#include "video_buffer.h"
+#include "util/thread.h"
+
+/**
+ * Frame sink re-encoding a subset of the decoded frames to a file.
+ *
+ * A frame is selected every `interval` frames, and/or when its luma differs
+ * from the last written frame by more than `threshold` (mean absolute
+ * difference per sample).
+ *
+ * The selection and the encoding are performed on a separate thread, so that
+ * the decoder is never blocked: if the encoder is too slow, intermediate
+ * frames are skipped.
+ */
+struct sc_timelapse {
+    struct sc_frame_sink frame_sink; // frame sink trait
+
+    struct sc_video_buffer vb;
+
+    char *filename;
+    enum sc_record_format format;
+    unsigned interval;
+    unsigned threshold;
+    unsigned crf;
+
+    // only accessed from the decoder thread
+    unsigned frame_count;
+
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond cond;
+    bool has_frame;
+    bool stopped;
+
+    // the following fields are only accessed from the timelapse thread
+    AVFormatContext *format_ctx;
+    AVCodecContext *encoder_ctx;
+    bool encoder_opened;
+    bool failed;
+    AVFrame *frame;
+    AVFrame *last; // last written frame, to compute the difference
+    AVPacket *packet;
+    int64_t next_pts;
+};
+
+bool
+sc_timelapse_init(struct sc_timelapse *tl, const char *filename,
+                  enum sc_record_format format, unsigned interval,
+                  unsigned threshold, unsigned crf);
+
+void
+sc_timelapse_destroy(struct sc_timelapse *tl);
+
+#endif
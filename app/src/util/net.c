@@ -15,7 +15,9 @@
 #else
 # include <sys/types.h>
 # include <sys/socket.h>
+# include <sys/time.h>
 # include <netinet/in.h>
+# include <netinet/tcp.h>
 # include <arpa/inet.h>
 # include <unistd.h>
 # include <fcntl.h>
@@ -128,12 +130,12 @@ net_perror(const char *s) {
 #endif
 }
 
-sc_socket
-net_socket(void) {
+static sc_socket
+create_socket(int type) {
 #ifdef HAVE_SOCK_CLOEXEC
-    sc_raw_socket raw_sock = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sc_raw_socket raw_sock = socket(AF_INET, type | SOCK_CLOEXEC, 0);
 #else
-    sc_raw_socket raw_sock = socket(AF_INET, SOCK_STREAM, 0);
+    sc_raw_socket raw_sock = socket(AF_INET, type, 0);
     if (raw_sock != SC_RAW_SOCKET_NONE && !set_cloexec_flag(raw_sock)) {
         sc_raw_socket_close(raw_sock);
         return SC_SOCKET_NONE;
@@ -147,6 +149,16 @@ net_socket(void) {
     return sock;
 }
 
+sc_socket
+net_socket(void) {
+    return create_socket(SOCK_STREAM);
+}
+
+sc_socket
+net_udp_socket(void) {
+    return create_socket(SOCK_DGRAM);
+}
+
 bool
 net_connect(sc_socket socket, uint32_t addr, uint16_t port) {
     sc_raw_socket raw_sock = unwrap(socket);
@@ -214,6 +226,54 @@ net_accept(sc_socket server_socket) {
     return wrap(raw_sock);
 }
 
+bool
+net_set_tcp_nodelay(sc_socket socket, bool tcp_nodelay) {
+    sc_raw_socket raw_sock = unwrap(socket);
+
+    int value = tcp_nodelay ? 1 : 0;
+    if (setsockopt(raw_sock, IPPROTO_TCP, TCP_NODELAY, (const void *) &value,
+                   sizeof(value)) == SOCKET_ERROR) {
+        net_perror("setsockopt(TCP_NODELAY)");
+        return false;
+    }
+
+    return true;
+}
+
+bool
+net_set_recv_timeout(sc_socket socket, sc_tick timeout) {
+    sc_raw_socket raw_sock = unwrap(socket);
+
+#ifdef __WINDOWS__
+    DWORD value = SC_TICK_TO_MS(timeout);
+    if (timeout && !value) {
+        // 0 would mean "no timeout"
+        value = 1;
+    }
+#else
+    struct timeval value = {
+        .tv_sec = timeout / SC_TICK_FREQ,
+        .tv_usec = SC_TICK_TO_US(timeout % SC_TICK_FREQ),
+    };
+#endif
+    if (setsockopt(raw_sock, SOL_SOCKET, SO_RCVTIMEO, (const void *) &value,
+                   sizeof(value)) == SOCKET_ERROR) {
+        net_perror("setsockopt(SO_RCVTIMEO)");
+        return false;
+    }
+
+    return true;
+}
+
+bool
+net_timed_out(void) {
+#ifdef __WINDOWS__
+    return WSAGetLastError() == WSAETIMEDOUT;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
 ssize_t
 net_recv(sc_socket socket, void *buf, size_t len) {
     sc_raw_socket raw_sock = unwrap(socket);
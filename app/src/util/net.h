@@ -7,6 +7,8 @@
 #include <stdint.h>
 #include <SDL2/SDL_platform.h>
 
+#include "tick.h"
+
 #ifdef __WINDOWS__
 
 # include <winsock2.h>
@@ -36,6 +38,10 @@ net_cleanup(void);
 sc_socket
 net_socket(void);
 
+// Create a datagram (UDP) socket
+sc_socket
+net_udp_socket(void);
+
 bool
 net_connect(sc_socket socket, uint32_t addr, uint16_t port);
 
@@ -58,6 +64,20 @@ net_send(sc_socket socket, const void *buf, size_t len);
 ssize_t
 net_send_all(sc_socket socket, const void *buf, size_t len);
 
+// Make recv() fail after waiting for the given timeout (0 to wait
+// indefinitely)
+bool
+net_set_recv_timeout(sc_socket socket, sc_tick timeout);
+
+// Return true if the last failing recv() timed out (see
+// net_set_recv_timeout())
+bool
+net_timed_out(void);
+
+// Enable or disable Nagle's algorithm
+bool
+net_set_tcp_nodelay(sc_socket socket, bool tcp_nodelay);
+
 // Shutdown the socket (or close on Windows) so that any blocking send() or
 // recv() are interrupted.
 bool
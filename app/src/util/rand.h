@@ -0,0 +1,17 @@
+#ifndef SC_RAND_H
+#define SC_RAND_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Fill `buf` with `len` random bytes from the system source
+ *
+ * The bytes are unpredictable, so they may be used as a secret.
+ */
+bool
+sc_rand_bytes(void *buf, size_t len);
+
+#endif
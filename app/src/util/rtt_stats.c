@@ -0,0 +1,59 @@
+#include "rtt_stats.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+void
+sc_rtt_stats_init(struct sc_rtt_stats *stats) {
+    stats->head = 0;
+    stats->count = 0;
+}
+
+void
+sc_rtt_stats_push(struct sc_rtt_stats *stats, sc_tick rtt) {
+    stats->samples[stats->head] = rtt;
+    stats->head = (stats->head + 1) % SC_RTT_STATS_CAPACITY;
+    if (stats->count < SC_RTT_STATS_CAPACITY) {
+        ++stats->count;
+    }
+}
+
+static int
+compare_ticks(const void *a, const void *b) {
+    sc_tick ta = *(const sc_tick *) a;
+    sc_tick tb = *(const sc_tick *) b;
+    return (ta > tb) - (ta < tb);
+}
+
+// nearest-rank method
+static sc_tick
+percentile(const sc_tick *sorted, unsigned count, unsigned p) {
+    assert(count);
+    assert(p <= 100);
+    unsigned rank = (p * count + 99) / 100; // ceil(p * count / 100)
+    return sorted[rank ? rank - 1 : 0];
+}
+
+bool
+sc_rtt_stats_compute(const struct sc_rtt_stats *stats,
+                     struct sc_rtt_percentiles *out) {
+    unsigned count = stats->count;
+    if (!count) {
+        return false;
+    }
+
+    // the samples are not ordered in the ring buffer, but the order does not
+    // matter once they are sorted
+    sc_tick sorted[SC_RTT_STATS_CAPACITY];
+    memcpy(sorted, stats->samples, count * sizeof(*sorted));
+    qsort(sorted, count, sizeof(*sorted), compare_ticks);
+
+    out->count = count;
+    out->min = sorted[0];
+    out->p50 = percentile(sorted, count, 50);
+    out->p95 = percentile(sorted, count, 95);
+    out->p99 = percentile(sorted, count, 99);
+    out->max = sorted[count - 1];
+    return true;
+}
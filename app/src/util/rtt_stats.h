@@ -0,0 +1,45 @@
+#ifndef SC_RTT_STATS_H
+#define SC_RTT_STATS_H
+
+#include "common.h"
+
+#include <stdbool.h>
+
+#include "tick.h"
+
+// Number of recent samples used to compute the percentiles
+#define SC_RTT_STATS_CAPACITY 1024
+
+/**
+ * Round-trip time samples
+ *
+ * Only the last SC_RTT_STATS_CAPACITY samples are kept. This is not
+ * thread-safe, the caller must synchronize the accesses.
+ */
+struct sc_rtt_stats {
+    sc_tick samples[SC_RTT_STATS_CAPACITY];
+    unsigned head; // index of the next sample to write
+    unsigned count; // number of samples, at most SC_RTT_STATS_CAPACITY
+};
+
+struct sc_rtt_percentiles {
+    unsigned count; // number of samples used
+    sc_tick min;
+    sc_tick p50;
+    sc_tick p95;
+    sc_tick p99;
+    sc_tick max;
+};
+
+void
+sc_rtt_stats_init(struct sc_rtt_stats *stats);
+
+void
+sc_rtt_stats_push(struct sc_rtt_stats *stats, sc_tick rtt);
+
+// Return false if there are no samples
+bool
+sc_rtt_stats_compute(const struct sc_rtt_stats *stats,
+                     struct sc_rtt_percentiles *out);
+
+#endif
@@ -0,0 +1,68 @@
+#include "sad.h"
+
+#include <assert.h>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#elif defined(__ARM_NEON)
+# include <arm_neon.h>
+#endif
+
+static inline uint64_t
+sc_sad_scalar(const uint8_t *a, const uint8_t *b, size_t len) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < len; ++i) {
+        sum += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+    }
+    return sum;
+}
+
+uint64_t
+sc_sad(const uint8_t *a, const uint8_t *b, size_t len) {
+    uint64_t sum = 0;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    // _mm_sad_epu8() computes two 16-bit sums, stored in 64-bit lanes
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 16 <= len; i += 16) {
+        __m128i va = _mm_loadu_si128((const __m128i *) (a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i *) (b + i));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i *) lanes, acc);
+    sum = lanes[0] + lanes[1];
+#elif defined(__ARM_NEON)
+    uint64x2_t acc = vdupq_n_u64(0);
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t va = vld1q_u8(a + i);
+        uint8x16_t vb = vld1q_u8(b + i);
+        uint8x16_t diff = vabdq_u8(va, vb);
+        // widen pairwise up to 64 bits, so that it never overflows
+        acc = vpadalq_u32(acc, vpaddlq_u16(vpaddlq_u8(diff)));
+    }
+    sum = vgetq_lane_u64(acc, 0) + vgetq_lane_u64(acc, 1);
+#endif
+
+    return sum + sc_sad_scalar(a + i, b + i, len - i);
+}
+
+uint64_t
+sc_sad_plane(const uint8_t *a, int a_linesize, const uint8_t *b,
+             int b_linesize, int width, int height) {
+    assert(width >= 0 && height >= 0);
+
+    if (a_linesize == width && b_linesize == width) {
+        // contiguous planes
+        return sc_sad(a, b, (size_t) width * height);
+    }
+
+    uint64_t sum = 0;
+    for (int y = 0; y < height; ++y) {
+        sum += sc_sad(a, b, width);
+        a += a_linesize;
+        b += b_linesize;
+    }
+    return sum;
+}
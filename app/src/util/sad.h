@@ -0,0 +1,26 @@
+#ifndef SC_SAD_H
+#define SC_SAD_H
+
+#include "common.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Compute the sum of absolute differences between two byte buffers of the
+ * same length.
+ *
+ * It uses SIMD instructions when available (SSE2 on x86, NEON on ARM).
+ */
+uint64_t
+sc_sad(const uint8_t *a, const uint8_t *b, size_t len);
+
+/**
+ * Compute the sum of absolute differences between two planes of
+ * width x height bytes (typically the luma planes of two frames).
+ */
+uint64_t
+sc_sad_plane(const uint8_t *a, int a_linesize, const uint8_t *b,
+             int b_linesize, int width, int height);
+
+#endif
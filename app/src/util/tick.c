@@ -14,3 +14,12 @@ sc_tick_now(void) {
     //  - in practice, we don't need more precision for now.
     return (sc_tick) SDL_GetTicks() * 1000;
 }
+
+sc_tick
+sc_tick_now_precise(void) {
+    uint64_t counter = SDL_GetPerformanceCounter();
+    uint64_t freq = SDL_GetPerformanceFrequency();
+    // split the conversion to avoid overflow
+    return (sc_tick) (counter / freq * SC_TICK_FREQ
+                    + counter % freq * SC_TICK_FREQ / freq);
+}
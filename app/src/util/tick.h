@@ -20,4 +20,13 @@ typedef int64_t sc_tick;
 sc_tick
 sc_tick_now(void);
 
+// A clock with a microsecond resolution (slower), to measure durations
+//
+// It is a different clock than sc_tick_now() (its origin is unspecified): its
+// values must not be mixed with sc_tick_now() values, nor used as
+// sc_cond_timedwait() deadlines. Only differences between its own values are
+// meaningful.
+sc_tick
+sc_tick_now_precise(void);
+
 #endif
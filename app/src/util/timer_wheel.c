@@ -0,0 +1,141 @@
+#include "timer_wheel.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#define SLOT_MASK (SC_TIMER_WHEEL_SLOTS - 1)
+
+static_assert(!(SC_TIMER_WHEEL_SLOTS & SLOT_MASK),
+              "SC_TIMER_WHEEL_SLOTS must be a power of 2");
+
+void
+sc_timer_wheel_init(struct sc_timer_wheel *wheel, sc_tick resolution,
+                    sc_tick now) {
+    assert(resolution > 0);
+    wheel->resolution = resolution;
+    wheel->current = now / resolution;
+    for (unsigned i = 0; i < SC_TIMER_WHEEL_SLOTS; ++i) {
+        wheel->slots[i].head = NULL;
+        wheel->slots[i].tail = NULL;
+    }
+    wheel->count = 0;
+}
+
+void
+sc_timer_wheel_add(struct sc_timer_wheel *wheel,
+                   struct sc_timer_wheel_entry *entry, sc_tick deadline) {
+    sc_tick slot_index = deadline / wheel->resolution;
+    if (slot_index < wheel->current) {
+        // already expired, it will be removed on the next call to expire()
+        slot_index = wheel->current;
+    }
+
+    entry->deadline = deadline;
+    entry->next = NULL;
+
+    // Append, to keep the insertion order
+    struct sc_timer_wheel_slot *slot = &wheel->slots[slot_index & SLOT_MASK];
+    if (slot->tail) {
+        slot->tail->next = entry;
+    } else {
+        slot->head = entry;
+    }
+    slot->tail = entry;
+    ++wheel->count;
+}
+
+// Insert the entry in the list sorted by deadline, after the entries having
+// the same deadline
+static void
+insert_sorted(struct sc_timer_wheel_entry **head,
+              struct sc_timer_wheel_entry **tail,
+              struct sc_timer_wheel_entry *entry) {
+    entry->next = NULL;
+    if (!*head) {
+        *head = entry;
+        *tail = entry;
+        return;
+    }
+
+    if ((*tail)->deadline <= entry->deadline) {
+        // most common case
+        (*tail)->next = entry;
+        *tail = entry;
+        return;
+    }
+
+    struct sc_timer_wheel_entry **link = head;
+    while ((*link)->deadline <= entry->deadline) {
+        link = &(*link)->next;
+    }
+    entry->next = *link;
+    *link = entry;
+}
+
+struct sc_timer_wheel_entry *
+sc_timer_wheel_expire(struct sc_timer_wheel *wheel, sc_tick now) {
+    sc_tick now_index = now / wheel->resolution;
+    if (now_index < wheel->current) {
+        return NULL;
+    }
+
+    struct sc_timer_wheel_entry *head = NULL;
+    struct sc_timer_wheel_entry *tail = NULL;
+
+    if (wheel->count) {
+        // Visit each slot at most once
+        sc_tick end = now_index;
+        if (end - wheel->current >= SC_TIMER_WHEEL_SLOTS) {
+            end = wheel->current + SC_TIMER_WHEEL_SLOTS - 1;
+        }
+
+        for (sc_tick i = wheel->current; i <= end; ++i) {
+            struct sc_timer_wheel_slot *slot = &wheel->slots[i & SLOT_MASK];
+            struct sc_timer_wheel_entry **link = &slot->head;
+            struct sc_timer_wheel_entry *prev = NULL;
+            while (*link) {
+                struct sc_timer_wheel_entry *entry = *link;
+                if (entry->deadline <= now) {
+                    *link = entry->next;
+                    if (slot->tail == entry) {
+                        slot->tail = prev;
+                    }
+                    insert_sorted(&head, &tail, entry);
+                    --wheel->count;
+                } else {
+                    // for a later turn of the wheel
+                    prev = entry;
+                    link = &entry->next;
+                }
+            }
+        }
+    }
+
+    // The entries of the current slot expiring later than now are kept
+    wheel->current = now_index;
+    return head;
+}
+
+bool
+sc_timer_wheel_next_deadline(const struct sc_timer_wheel *wheel,
+                             sc_tick *deadline) {
+    if (!wheel->count) {
+        return false;
+    }
+
+    bool found = false;
+    sc_tick min = 0;
+    for (unsigned i = 0; i < SC_TIMER_WHEEL_SLOTS; ++i) {
+        const struct sc_timer_wheel_entry *entry = wheel->slots[i].head;
+        for (; entry; entry = entry->next) {
+            if (!found || entry->deadline < min) {
+                min = entry->deadline;
+                found = true;
+            }
+        }
+    }
+
+    assert(found);
+    *deadline = min;
+    return true;
+}
@@ -0,0 +1,79 @@
+#ifndef SC_TIMER_WHEEL_H
+#define SC_TIMER_WHEEL_H
+
+#include "common.h"
+
+#include <stdbool.h>
+
+#include "tick.h"
+
+// Must be a power of 2
+#define SC_TIMER_WHEEL_SLOTS 256
+
+/**
+ * Hashed timer wheel
+ *
+ * Each slot covers `resolution` ticks. Adding an entry is O(1), and expiring
+ * entries only visits the slots elapsed since the last call. Entries further
+ * than one turn of the wheel stay in their slot until their deadline.
+ *
+ * The entries are intrusive: they are embedded in the caller structures (use
+ * container_of() to retrieve them). This is not thread-safe, the caller must
+ * synchronize the accesses.
+ */
+struct sc_timer_wheel_entry {
+    sc_tick deadline;
+    struct sc_timer_wheel_entry *next;
+};
+
+struct sc_timer_wheel_slot {
+    struct sc_timer_wheel_entry *head;
+    struct sc_timer_wheel_entry *tail;
+};
+
+struct sc_timer_wheel {
+    sc_tick resolution;
+    // The first slot (in resolution units since the origin of sc_tick) which
+    // may contain pending entries
+    sc_tick current;
+    struct sc_timer_wheel_slot slots[SC_TIMER_WHEEL_SLOTS];
+    unsigned count;
+};
+
+void
+sc_timer_wheel_init(struct sc_timer_wheel *wheel, sc_tick resolution,
+                    sc_tick now);
+
+/**
+ * Add an entry to expire at `deadline`
+ *
+ * A deadline in the past expires on the next call to sc_timer_wheel_expire().
+ */
+void
+sc_timer_wheel_add(struct sc_timer_wheel *wheel,
+                   struct sc_timer_wheel_entry *entry, sc_tick deadline);
+
+/**
+ * Remove the entries whose deadline is not after `now`
+ *
+ * Return them as a list linked by `next` (or NULL if there are none), sorted
+ * by deadline. Entries having the same deadline are kept in insertion order.
+ */
+struct sc_timer_wheel_entry *
+sc_timer_wheel_expire(struct sc_timer_wheel *wheel, sc_tick now);
+
+/**
+ * Get the earliest deadline
+ *
+ * Return false if the wheel is empty.
+ */
+bool
+sc_timer_wheel_next_deadline(const struct sc_timer_wheel *wheel,
+                             sc_tick *deadline);
+
+static inline bool
+sc_timer_wheel_is_empty(const struct sc_timer_wheel *wheel) {
+    return !wheel->count;
+}
+
+#endif
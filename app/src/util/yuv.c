@@ -0,0 +1,113 @@
+#include "yuv.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#elif defined(__ARM_NEON)
+# include <arm_neon.h>
+#endif
+
+static void
+yuyv_row(uint8_t *dst, const uint8_t *y, const uint8_t *u, const uint8_t *v,
+         unsigned width) {
+    unsigned i = 0;
+
+#if defined(__SSE2__)
+    for (; i + 16 <= width; i += 16) {
+        __m128i vy = _mm_loadu_si128((const __m128i *) (y + i));
+        __m128i vu = _mm_loadl_epi64((const __m128i *) (u + i / 2));
+        __m128i vv = _mm_loadl_epi64((const __m128i *) (v + i / 2));
+        __m128i uv = _mm_unpacklo_epi8(vu, vv); // U0 V0 U1 V1...
+        _mm_storeu_si128((__m128i *) (dst + 2 * i),
+                         _mm_unpacklo_epi8(vy, uv)); // Y0 U0 Y1 V0...
+        _mm_storeu_si128((__m128i *) (dst + 2 * i + 16),
+                         _mm_unpackhi_epi8(vy, uv));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 16 <= width; i += 16) {
+        uint8x8x2_t uv = vzip_u8(vld1_u8(u + i / 2), vld1_u8(v + i / 2));
+        uint8x16x2_t yuyv;
+        yuyv.val[0] = vld1q_u8(y + i);
+        yuyv.val[1] = vcombine_u8(uv.val[0], uv.val[1]);
+        vst2q_u8(dst + 2 * i, yuyv); // interleave Y and UV bytes
+    }
+#endif
+
+    for (; i < width; i += 2) {
+        dst[2 * i] = y[i];
+        dst[2 * i + 1] = u[i / 2];
+        // If the width is odd, duplicate the last luma sample
+        dst[2 * i + 2] = i + 1 < width ? y[i + 1] : y[i];
+        dst[2 * i + 3] = v[i / 2];
+    }
+}
+
+static void
+interleave_row(uint8_t *dst, const uint8_t *u, const uint8_t *v,
+               unsigned width) {
+    unsigned i = 0;
+
+#if defined(__SSE2__)
+    for (; i + 16 <= width; i += 16) {
+        __m128i vu = _mm_loadu_si128((const __m128i *) (u + i));
+        __m128i vv = _mm_loadu_si128((const __m128i *) (v + i));
+        _mm_storeu_si128((__m128i *) (dst + 2 * i), _mm_unpacklo_epi8(vu, vv));
+        _mm_storeu_si128((__m128i *) (dst + 2 * i + 16),
+                         _mm_unpackhi_epi8(vu, vv));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 16 <= width; i += 16) {
+        uint8x16x2_t uv;
+        uv.val[0] = vld1q_u8(u + i);
+        uv.val[1] = vld1q_u8(v + i);
+        vst2q_u8(dst + 2 * i, uv);
+    }
+#endif
+
+    for (; i < width; ++i) {
+        dst[2 * i] = u[i];
+        dst[2 * i + 1] = v[i];
+    }
+}
+
+void
+sc_yuv420_to_yuyv(const uint8_t *const src[3], const int src_linesize[3],
+                  uint8_t *dst, int dst_linesize, unsigned width,
+                  unsigned height) {
+    for (unsigned row = 0; row < height; ++row) {
+        const uint8_t *y = src[0] + (ptrdiff_t) row * src_linesize[0];
+        const uint8_t *u = src[1] + (ptrdiff_t) (row / 2) * src_linesize[1];
+        const uint8_t *v = src[2] + (ptrdiff_t) (row / 2) * src_linesize[2];
+        yuyv_row(dst + (ptrdiff_t) row * dst_linesize, y, u, v, width);
+    }
+}
+
+void
+sc_yuv420_to_nv12(const uint8_t *const src[3], const int src_linesize[3],
+                  uint8_t *dst_y, int dst_y_linesize, uint8_t *dst_uv,
+                  int dst_uv_linesize, unsigned width, unsigned height) {
+    if (!width || !height) {
+        return;
+    }
+
+    if (src_linesize[0] == dst_y_linesize) {
+        // same stride: copy the whole luma plane at once
+        memcpy(dst_y, src[0], (size_t) dst_y_linesize * (height - 1) + width);
+    } else {
+        for (unsigned row = 0; row < height; ++row) {
+            memcpy(dst_y + (ptrdiff_t) row * dst_y_linesize,
+                   src[0] + (ptrdiff_t) row * src_linesize[0], width);
+        }
+    }
+
+    unsigned chroma_width = (width + 1) / 2;
+    unsigned chroma_height = (height + 1) / 2;
+    for (unsigned row = 0; row < chroma_height; ++row) {
+        const uint8_t *u = src[1] + (ptrdiff_t) row * src_linesize[1];
+        const uint8_t *v = src[2] + (ptrdiff_t) row * src_linesize[2];
+        interleave_row(dst_uv + (ptrdiff_t) row * dst_uv_linesize, u, v,
+                       chroma_width);
+    }
+}
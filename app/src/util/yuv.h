@@ -0,0 +1,33 @@
+#ifndef SC_YUV_H
+#define SC_YUV_H
+
+#include "common.h"
+
+#include <stdint.h>
+
+/**
+ * Pixel format conversions from planar YUV 4:2:0 (the decoder output).
+ *
+ * They use SIMD instructions when available (SSE2 on x86, NEON on ARM).
+ */
+
+/**
+ * Convert a YUV 4:2:0 frame to packed YUYV 4:2:2
+ *
+ * The chroma of each source line is used for two destination lines.
+ */
+void
+sc_yuv420_to_yuyv(const uint8_t *const src[3], const int src_linesize[3],
+                  uint8_t *dst, int dst_linesize, unsigned width,
+                  unsigned height);
+
+/**
+ * Convert a YUV 4:2:0 frame to NV12 (a luma plane followed by an interleaved
+ * chroma plane)
+ */
+void
+sc_yuv420_to_nv12(const uint8_t *const src[3], const int src_linesize[3],
+                  uint8_t *dst_y, int dst_y_linesize, uint8_t *dst_uv,
+                  int dst_uv_linesize, unsigned width, unsigned height);
+
+#endif
@@ -0,0 +1,470 @@
+#include "v4l2_output.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include "util/log.h"
+
+static int
+xioctl(int fd, unsigned long request, void *arg) {
+    int r;
+    do {
+        r = ioctl(fd, request, arg);
+    } while (r == -1 && errno == EINTR);
+    return r;
+}
+
+static bool
+write_all(int fd, const uint8_t *buf, size_t len) {
+    while (len) {
+        ssize_t w = write(fd, buf, len);
+        if (w == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        buf += w;
+        len -= w;
+    }
+    return true;
+}
+
+// Compute the layout of the planes in a frame buffer, given the line size of
+// the first plane (0 for packed lines)
+static bool
+sc_v4l2_output_init_layout(struct sc_v4l2_output *out, unsigned bytesperline) {
+    unsigned w = out->width;
+    unsigned h = out->height;
+    unsigned chroma_w = (w + 1) / 2;
+    unsigned chroma_h = (h + 1) / 2;
+
+    switch (out->pixelformat) {
+        case V4L2_PIX_FMT_YUV420: {
+            if (!bytesperline) {
+                bytesperline = w;
+            }
+            unsigned chroma_bpl = (bytesperline + 1) / 2;
+            out->plane_count = 3;
+            out->plane_linesizes[0] = bytesperline;
+            out->plane_linesizes[1] = chroma_bpl;
+            out->plane_linesizes[2] = chroma_bpl;
+            out->plane_row_sizes[0] = w;
+            out->plane_row_sizes[1] = chroma_w;
+            out->plane_row_sizes[2] = chroma_w;
+            out->plane_heights[0] = h;
+            out->plane_heights[1] = chroma_h;
+            out->plane_heights[2] = chroma_h;
+            break;
+        }
+        case V4L2_PIX_FMT_NV12:
+            if (!bytesperline) {
+                bytesperline = w;
+            }
+            out->plane_count = 2;
+            out->plane_linesizes[0] = bytesperline;
+            // interleaved U and V samples, same line size as luma
+            out->plane_linesizes[1] = bytesperline;
+            out->plane_row_sizes[0] = w;
+            out->plane_row_sizes[1] = chroma_w * 2;
+            out->plane_heights[0] = h;
+            out->plane_heights[1] = chroma_h;
+            break;
+        case V4L2_PIX_FMT_YUYV:
+            if (!bytesperline) {
+                bytesperline = chroma_w * 4;
+            }
+            out->plane_count = 1;
+            out->plane_linesizes[0] = bytesperline;
+            out->plane_row_sizes[0] = chroma_w * 4;
+            out->plane_heights[0] = h;
+            break;
+        default:
+            LOGE("Unsupported V4L2 pixel format: %.4s",
+                 (const char *) &out->pixelformat);
+            return false;
+    }
+
+    size_t offset = 0;
+    for (unsigned i = 0; i < out->plane_count; ++i) {
+        out->plane_offsets[i] = offset;
+        offset += (size_t) out->plane_linesizes[i] * out->plane_heights[i];
+    }
+
+    if (out->sizeimage < offset) {
+        // If the driver did not provide a size (or a smaller one), use the
+        // computed size
+        out->sizeimage = offset;
+    }
+
+    return true;
+}
+
+static bool
+sc_v4l2_output_set_format(struct sc_v4l2_output *out,
+                          unsigned *bytesperline) {
+    struct v4l2_format fmt;
+    memset(&fmt, 0, sizeof(fmt));
+    fmt.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    fmt.fmt.pix.width = out->width;
+    fmt.fmt.pix.height = out->height;
+    fmt.fmt.pix.pixelformat = out->pixelformat;
+    fmt.fmt.pix.field = V4L2_FIELD_NONE;
+    fmt.fmt.pix.colorspace = V4L2_COLORSPACE_SRGB;
+
+    if (xioctl(out->fd, VIDIOC_S_FMT, &fmt) == -1) {
+        LOGE("Could not set V4L2 output format: %s", strerror(errno));
+        return false;
+    }
+
+    if (fmt.fmt.pix.pixelformat != out->pixelformat
+            || fmt.fmt.pix.width != out->width
+            || fmt.fmt.pix.height != out->height) {
+        LOGE("V4L2 output format rejected: requested %.4s %ux%u, got "
+             "%.4s %ux%u", (const char *) &out->pixelformat, out->width,
+             out->height, (const char *) &fmt.fmt.pix.pixelformat,
+             fmt.fmt.pix.width, fmt.fmt.pix.height);
+        return false;
+    }
+
+    *bytesperline = fmt.fmt.pix.bytesperline;
+    out->sizeimage = fmt.fmt.pix.sizeimage;
+    return true;
+}
+
+static void
+sc_v4l2_output_unmap_buffers(struct sc_v4l2_output *out) {
+    for (unsigned i = 0; i < out->buffer_count; ++i) {
+        munmap(out->buffers[i].start, out->buffers[i].length);
+    }
+    out->buffer_count = 0;
+
+    struct v4l2_requestbuffers req;
+    memset(&req, 0, sizeof(req));
+    req.count = 0;
+    req.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    req.memory = V4L2_MEMORY_MMAP;
+    // release the buffers (ignore failure)
+    xioctl(out->fd, VIDIOC_REQBUFS, &req);
+}
+
+static bool
+sc_v4l2_output_map_buffers(struct sc_v4l2_output *out) {
+    struct v4l2_requestbuffers req;
+    memset(&req, 0, sizeof(req));
+    req.count = SC_V4L2_OUTPUT_BUFFERS;
+    req.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    req.memory = V4L2_MEMORY_MMAP;
+
+    if (xioctl(out->fd, VIDIOC_REQBUFS, &req) == -1) {
+        LOGD("V4L2 mmap buffers not supported: %s", strerror(errno));
+        return false;
+    }
+
+    if (!req.count) {
+        LOGD("V4L2 device provided no mmap buffers");
+        return false;
+    }
+
+    // The driver may grant more buffers than requested: only map (and queue)
+    // the first ones, the others are never used
+    unsigned count = MIN(req.count, SC_V4L2_OUTPUT_BUFFERS);
+    if (req.count > SC_V4L2_OUTPUT_BUFFERS) {
+        LOGD("V4L2 device provided %u buffers, using %u", req.count, count);
+    }
+
+    out->buffer_count = 0;
+    for (unsigned i = 0; i < count; ++i) {
+        struct v4l2_buffer buf;
+        memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+
+        if (xioctl(out->fd, VIDIOC_QUERYBUF, &buf) == -1) {
+            LOGE("Could not query V4L2 buffer: %s", strerror(errno));
+            goto error;
+        }
+
+        if (buf.length < out->sizeimage) {
+            LOGE("V4L2 buffer too small: %u < %zu", buf.length,
+                 out->sizeimage);
+            goto error;
+        }
+
+        void *start = mmap(NULL, buf.length, PROT_READ | PROT_WRITE,
+                           MAP_SHARED, out->fd, buf.m.offset);
+        if (start == MAP_FAILED) {
+            LOGE("Could not map V4L2 buffer: %s", strerror(errno));
+            goto error;
+        }
+
+        out->buffers[i].start = start;
+        out->buffers[i].length = buf.length;
+        ++out->buffer_count;
+    }
+
+    out->unqueued_count = out->buffer_count;
+    return true;
+
+error:
+    sc_v4l2_output_unmap_buffers(out);
+    return false;
+}
+
+bool
+sc_v4l2_output_open(struct sc_v4l2_output *out, const char *device,
+                    unsigned width, unsigned height, uint32_t pixelformat) {
+    out->width = width;
+    out->height = height;
+    out->pixelformat = pixelformat;
+    out->sizeimage = 0;
+    out->streaming = false;
+    out->stream_on = false;
+    out->buffer_count = 0;
+    out->unqueued_count = 0;
+    out->current = -1;
+    out->write_buffer = NULL;
+    out->dropped = 0;
+
+    // Non-blocking, so that dequeuing a buffer never blocks
+    out->fd = open(device, O_RDWR | O_TRUNC | O_NONBLOCK | O_CLOEXEC);
+    if (out->fd == -1) {
+        // Maybe a pipe or a file, not open for reading
+        out->fd = open(device, O_WRONLY | O_TRUNC | O_CLOEXEC);
+        if (out->fd == -1) {
+            LOGE("Could not open V4L2 output %s: %s", device, strerror(errno));
+            return false;
+        }
+    }
+
+    unsigned bytesperline = 0;
+
+    struct v4l2_capability cap;
+    memset(&cap, 0, sizeof(cap));
+    if (xioctl(out->fd, VIDIOC_QUERYCAP, &cap) == -1) {
+        // Not a V4L2 device, write raw frames (for example to a file or a
+        // pipe)
+        LOGI("%s is not a V4L2 device, writing raw frames", device);
+
+        // Writing to a pipe must block
+        int flags = fcntl(out->fd, F_GETFL);
+        if (flags != -1) {
+            fcntl(out->fd, F_SETFL, flags & ~O_NONBLOCK);
+        }
+    } else {
+        uint32_t caps = cap.capabilities & V4L2_CAP_DEVICE_CAPS
+                      ? cap.device_caps : cap.capabilities;
+        if (!(caps & V4L2_CAP_VIDEO_OUTPUT)) {
+            LOGE("%s is not a V4L2 output device", device);
+            goto error_close;
+        }
+
+        if (!sc_v4l2_output_set_format(out, &bytesperline)) {
+            goto error_close;
+        }
+    }
+
+    if (!sc_v4l2_output_init_layout(out, bytesperline)) {
+        goto error_close;
+    }
+
+    bool is_v4l2 = !!cap.capabilities;
+    if (is_v4l2 && (cap.capabilities & V4L2_CAP_STREAMING)) {
+        out->streaming = sc_v4l2_output_map_buffers(out);
+    }
+
+    if (!out->streaming) {
+        if (is_v4l2 && !(cap.capabilities & V4L2_CAP_READWRITE)) {
+            LOGE("V4L2 device %s supports neither mmap nor write()", device);
+            goto error_close;
+        }
+
+        out->write_buffer = malloc(out->sizeimage);
+        if (!out->write_buffer) {
+            LOG_OOM();
+            goto error_close;
+        }
+    }
+
+    LOGD("V4L2 output %s: %.4s %ux%u, %zu bytes per frame (%s)", device,
+         (const char *) &pixelformat, width, height, out->sizeimage,
+         out->streaming ? "mmap" : "write");
+
+    return true;
+
+error_close:
+    close(out->fd);
+    return false;
+}
+
+void
+sc_v4l2_output_close(struct sc_v4l2_output *out) {
+    if (out->streaming) {
+        if (out->stream_on) {
+            int type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+            xioctl(out->fd, VIDIOC_STREAMOFF, &type);
+        }
+        sc_v4l2_output_unmap_buffers(out);
+    } else {
+        free(out->write_buffer);
+    }
+
+    if (out->dropped) {
+        LOGD("V4L2 output: %" PRIu64_ " frames dropped (no buffer "
+             "available)", out->dropped);
+    }
+
+    close(out->fd);
+}
+
+uint8_t *
+sc_v4l2_output_acquire(struct sc_v4l2_output *out) {
+    assert(out->current == -1);
+
+    if (!out->streaming) {
+        out->current = 0;
+        return out->write_buffer;
+    }
+
+    if (out->unqueued_count) {
+        // Use the buffers never queued first
+        unsigned index = out->buffer_count - out->unqueued_count--;
+        out->current = index;
+        return out->buffers[index].start;
+    }
+
+    struct v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    buf.memory = V4L2_MEMORY_MMAP;
+
+    if (xioctl(out->fd, VIDIOC_DQBUF, &buf) == -1) {
+        if (errno != EAGAIN) {
+            LOGW("Could not dequeue V4L2 buffer: %s", strerror(errno));
+        }
+        ++out->dropped;
+        return NULL;
+    }
+
+    if (buf.index >= out->buffer_count) {
+        // Never queued by us, so it should not happen
+        LOGW("Unexpected V4L2 buffer index: %u", buf.index);
+        ++out->dropped;
+        return NULL;
+    }
+
+    out->current = buf.index;
+    return out->buffers[buf.index].start;
+}
+
+void
+sc_v4l2_output_get_planes(const struct sc_v4l2_output *out, uint8_t *buffer,
+                          uint8_t *data[], int linesize[]) {
+    for (unsigned i = 0; i < out->plane_count; ++i) {
+        data[i] = buffer + out->plane_offsets[i];
+        linesize[i] = out->plane_linesizes[i];
+    }
+}
+
+bool
+sc_v4l2_output_submit(struct sc_v4l2_output *out) {
+    assert(out->current != -1);
+    unsigned index = out->current;
+    out->current = -1;
+
+    if (!out->streaming) {
+        if (!write_all(out->fd, out->write_buffer, out->sizeimage)) {
+            LOGE("Could not write frame to V4L2 output: %s", strerror(errno));
+            return false;
+        }
+        return true;
+    }
+
+    struct v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = index;
+    buf.bytesused = out->sizeimage;
+    buf.field = V4L2_FIELD_NONE;
+
+    if (xioctl(out->fd, VIDIOC_QBUF, &buf) == -1) {
+        LOGE("Could not queue V4L2 buffer: %s", strerror(errno));
+        return false;
+    }
+
+    if (!out->stream_on) {
+        int type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+        if (xioctl(out->fd, VIDIOC_STREAMON, &type) == -1) {
+            LOGE("Could not start V4L2 streaming: %s", strerror(errno));
+            return false;
+        }
+        out->stream_on = true;
+    }
+
+    return true;
+}
+
+static bool
+sc_v4l2_output_is_packed(struct sc_v4l2_output *out,
+                         const uint8_t *const data[], const int linesize[]) {
+    for (unsigned i = 0; i < out->plane_count; ++i) {
+        if (linesize[i] < 0
+                || (unsigned) linesize[i] != out->plane_linesizes[i]) {
+            return false;
+        }
+        if (data[i] != data[0] + out->plane_offsets[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+sc_v4l2_output_write(struct sc_v4l2_output *out, const uint8_t *const data[],
+                     const int linesize[]) {
+    uint8_t *dst = sc_v4l2_output_acquire(out);
+    if (!dst) {
+        // No buffer available, drop the frame
+        return true;
+    }
+
+    if (sc_v4l2_output_is_packed(out, data, linesize)) {
+        // The source has exactly the same layout: a single copy
+        unsigned last = out->plane_count - 1;
+        size_t size = out->plane_offsets[last]
+                    + (size_t) out->plane_linesizes[last]
+                    * out->plane_heights[last];
+        memcpy(dst, data[0], size);
+        return sc_v4l2_output_submit(out);
+    }
+
+    for (unsigned i = 0; i < out->plane_count; ++i) {
+        uint8_t *dst_plane = dst + out->plane_offsets[i];
+        const uint8_t *src = data[i];
+        unsigned dst_linesize = out->plane_linesizes[i];
+        unsigned height = out->plane_heights[i];
+
+        if (linesize[i] >= 0 && (unsigned) linesize[i] == dst_linesize) {
+            // same stride: copy the whole plane at once
+            memcpy(dst_plane, src, (size_t) dst_linesize * height);
+        } else {
+            unsigned row_size = out->plane_row_sizes[i];
+            for (unsigned y = 0; y < height; ++y) {
+                memcpy(dst_plane, src, row_size);
+                dst_plane += dst_linesize;
+                src += linesize[i];
+            }
+        }
+    }
+
+    return sc_v4l2_output_submit(out);
+}
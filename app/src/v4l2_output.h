@@ -0,0 +1,100 @@
+#ifndef SC_V4L2_OUTPUT_H
+#define SC_V4L2_OUTPUT_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SC_V4L2_OUTPUT_MAX_PLANES 3
+#define SC_V4L2_OUTPUT_BUFFERS 4
+
+struct sc_v4l2_output_buffer {
+    uint8_t *start;
+    size_t length;
+};
+
+/**
+ * Native V4L2 video output.
+ *
+ * Frames are written directly into buffers mapped from the device
+ * (VIDIOC_REQBUFS + mmap) when the device supports streaming I/O. Otherwise
+ * (if the device only supports write(), or if the target is not a V4L2
+ * device, like a regular file or a pipe), frames are written with write().
+ *
+ * A frame buffer is a single memory block containing all the planes, as
+ * described by plane_offsets and plane_linesizes.
+ */
+struct sc_v4l2_output {
+    int fd;
+    bool streaming; // mmap streaming I/O, otherwise write()
+    bool stream_on;
+
+    uint32_t pixelformat;
+    unsigned width;
+    unsigned height;
+    size_t sizeimage;
+
+    unsigned plane_count;
+    size_t plane_offsets[SC_V4L2_OUTPUT_MAX_PLANES];
+    unsigned plane_linesizes[SC_V4L2_OUTPUT_MAX_PLANES];
+    unsigned plane_row_sizes[SC_V4L2_OUTPUT_MAX_PLANES]; // in bytes
+    unsigned plane_heights[SC_V4L2_OUTPUT_MAX_PLANES];
+
+    // only if streaming
+    struct sc_v4l2_output_buffer buffers[SC_V4L2_OUTPUT_BUFFERS];
+    unsigned buffer_count;
+    unsigned unqueued_count; // buffers never queued yet (available)
+    int current; // index of the buffer acquired, or -1
+
+    // only if !streaming
+    uint8_t *write_buffer;
+
+    uint64_t dropped; // frames dropped because no buffer was available
+};
+
+/**
+ * Open the output and negotiate the format (a V4L2 fourcc among
+ * V4L2_PIX_FMT_YUV420, V4L2_PIX_FMT_NV12 and V4L2_PIX_FMT_YUYV)
+ */
+bool
+sc_v4l2_output_open(struct sc_v4l2_output *out, const char *device,
+                    unsigned width, unsigned height, uint32_t pixelformat);
+
+void
+sc_v4l2_output_close(struct sc_v4l2_output *out);
+
+/**
+ * Acquire a frame buffer to fill
+ *
+ * Return NULL if no buffer is available (all the buffers are owned by the
+ * device). In that case, the frame should be dropped: this function never
+ * blocks.
+ */
+uint8_t *
+sc_v4l2_output_acquire(struct sc_v4l2_output *out);
+
+/**
+ * Get the planes (plane_count items) of an acquired frame buffer
+ */
+void
+sc_v4l2_output_get_planes(const struct sc_v4l2_output *out, uint8_t *buffer,
+                          uint8_t *data[], int linesize[]);
+
+/**
+ * Submit the frame buffer previously acquired
+ */
+bool
+sc_v4l2_output_submit(struct sc_v4l2_output *out);
+
+/**
+ * Copy the planes of a frame (in the negotiated format) and submit it
+ *
+ * If no buffer is available, the frame is dropped (and true is returned).
+ */
+bool
+sc_v4l2_output_write(struct sc_v4l2_output *out, const uint8_t *const data[],
+                     const int linesize[]);
+
+#endif
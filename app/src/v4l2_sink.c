@@ -1,110 +1,153 @@
 #include "v4l2_sink.h"
 
+#include <assert.h>
+#include <inttypes.h>
 #include <string.h>
+#include <time.h>
+#include <linux/videodev2.h>
+#include <libavutil/opt.h>
 
 #include "util/log.h"
-#include "util/str.h"
+#include "util/yuv.h"
 
 /** Downcast frame_sink to sc_v4l2_sink */
 #define DOWNCAST(SINK) container_of(SINK, struct sc_v4l2_sink, frame_sink)
 
-static const AVRational SCRCPY_TIME_BASE = {1, 1000000}; // timestamps in us
-
-static const AVOutputFormat *
-find_muxer(const char *name) {
-#ifdef SCRCPY_LAVF_HAS_NEW_MUXER_ITERATOR_API
-    void *opaque = NULL;
-#endif
-    const AVOutputFormat *oformat = NULL;
-    do {
-#ifdef SCRCPY_LAVF_HAS_NEW_MUXER_ITERATOR_API
-        oformat = av_muxer_iterate(&opaque);
-#else
-        oformat = av_oformat_next(oformat);
-#endif
-        // until null or containing the requested name
-    } while (oformat && !sc_str_list_contains(oformat->name, ',', name));
-    return oformat;
+static uint32_t
+get_v4l2_pixelformat(enum sc_v4l2_pixel_format format) {
+    switch (format) {
+        case SC_V4L2_PIXEL_FORMAT_YUYV:
+            return V4L2_PIX_FMT_YUYV;
+        case SC_V4L2_PIXEL_FORMAT_NV12:
+            return V4L2_PIX_FMT_NV12;
+        default:
+            assert(format == SC_V4L2_PIXEL_FORMAT_YUV420);
+            return V4L2_PIX_FMT_YUV420;
+    }
+}
+
+static enum AVPixelFormat
+get_av_pixel_format(enum sc_v4l2_pixel_format format) {
+    switch (format) {
+        case SC_V4L2_PIXEL_FORMAT_YUYV:
+            return AV_PIX_FMT_YUYV422;
+        case SC_V4L2_PIXEL_FORMAT_NV12:
+            return AV_PIX_FMT_NV12;
+        default:
+            assert(format == SC_V4L2_PIXEL_FORMAT_YUV420);
+            return AV_PIX_FMT_YUV420P;
+    }
+}
+
+static uint64_t
+get_monotonic_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
 }
 
 static bool
-write_header(struct sc_v4l2_sink *vs, const AVPacket *packet) {
-    AVStream *ostream = vs->format_ctx->streams[0];
+prepare_scaler(struct sc_v4l2_sink *vs, const AVFrame *frame) {
+    if (vs->sws_ctx && vs->sws_input_size.width == frame->width
+                    && vs->sws_input_size.height == frame->height) {
+        // reuse the current context
+        return true;
+    }
+
+    sws_freeContext(vs->sws_ctx);
 
-    uint8_t *extradata = av_malloc(packet->size * sizeof(uint8_t));
-    if (!extradata) {
+    vs->sws_ctx = sws_alloc_context();
+    if (!vs->sws_ctx) {
         LOG_OOM();
         return false;
     }
 
-    // copy the first packet to the extra data
-    memcpy(extradata, packet->data, packet->size);
-
-    ostream->codecpar->extradata = extradata;
-    ostream->codecpar->extradata_size = packet->size;
+    struct SwsContext *ctx = vs->sws_ctx;
+    av_opt_set_int(ctx, "srcw", frame->width, 0);
+    av_opt_set_int(ctx, "srch", frame->height, 0);
+    av_opt_set_int(ctx, "src_format", frame->format, 0);
+    av_opt_set_int(ctx, "dstw", vs->output_size.width, 0);
+    av_opt_set_int(ctx, "dsth", vs->output_size.height, 0);
+    av_opt_set_int(ctx, "dst_format", get_av_pixel_format(vs->pixel_format),
+                   0);
+    av_opt_set_int(ctx, "sws_flags", SWS_BILINEAR, 0);
+    // Slice threading is only available since FFmpeg 5.0 (0 means auto),
+    // older versions just ignore it
+    if (av_opt_set_int(ctx, "threads", 0, 0) < 0) {
+        LOGD("Multithreaded scaling not available");
+    }
 
-    int ret = avformat_write_header(vs->format_ctx, NULL);
-    if (ret < 0) {
-        LOGE("Failed to write header to %s", vs->device_name);
+    if (sws_init_context(ctx, NULL, NULL) < 0) {
+        LOGE("Could not initialize v4l2 scaler (%ux%u to %ux%u)",
+             frame->width, frame->height, vs->output_size.width,
+             vs->output_size.height);
+        sws_freeContext(ctx);
+        vs->sws_ctx = NULL;
         return false;
     }
 
+    vs->sws_input_size.width = frame->width;
+    vs->sws_input_size.height = frame->height;
+    LOGD("V4l2 scaler: %ux%u to %ux%u", frame->width, frame->height,
+         vs->output_size.width, vs->output_size.height);
     return true;
 }
 
-static void
-rescale_packet(struct sc_v4l2_sink *vs, AVPacket *packet) {
-    AVStream *ostream = vs->format_ctx->streams[0];
-    av_packet_rescale_ts(packet, SCRCPY_TIME_BASE, ostream->time_base);
-}
-
 static bool
-write_packet(struct sc_v4l2_sink *vs, AVPacket *packet) {
-    if (!vs->header_written) {
-        bool ok = write_header(vs, packet);
-        if (!ok) {
-            return false;
-        }
-        vs->header_written = true;
-        return true;
+write_frame(struct sc_v4l2_sink *vs, const AVFrame *frame) {
+    if (frame->format != AV_PIX_FMT_YUV420P
+            && frame->format != AV_PIX_FMT_YUVJ420P) {
+        LOGE("Unsupported frame format for v4l2 sink: %d", frame->format);
+        return false;
     }
 
-    rescale_packet(vs, packet);
-
-    bool ok = av_write_frame(vs->format_ctx, packet) >= 0;
-
-    // Failing to write the last frame is not very serious, no future frame may
-    // depend on it, so the resulting file will still be valid
-    (void) ok;
+    bool scale = (unsigned) frame->width != vs->output.width
+              || (unsigned) frame->height != vs->output.height;
+    if (scale && !vs->output_size.width) {
+        // The v4l2 format is negotiated once, the frame size must not change
+        LOGD("Frame size changed, frame ignored by v4l2 sink");
+        return true;
+    }
 
-    return true;
-}
+    const uint8_t *const *src = (const uint8_t *const *) frame->data;
+    if (!scale && vs->pixel_format == SC_V4L2_PIXEL_FORMAT_YUV420) {
+        // No conversion, copy the planes
+        return sc_v4l2_output_write(&vs->output, src, frame->linesize);
+    }
 
-static bool
-encode_and_write_frame(struct sc_v4l2_sink *vs, const AVFrame *frame) {
-    int ret = avcodec_send_frame(vs->encoder_ctx, frame);
-    if (ret < 0 && ret != AVERROR(EAGAIN)) {
-        LOGE("Could not send v4l2 video frame: %d", ret);
+    if (scale && !prepare_scaler(vs, frame)) {
         return false;
     }
 
-    AVPacket *packet = vs->packet;
-    ret = avcodec_receive_packet(vs->encoder_ctx, packet);
-    if (ret == 0) {
-        // A packet was received
+    uint8_t *buffer = sc_v4l2_output_acquire(&vs->output);
+    if (!buffer) {
+        // No buffer available, drop the frame
+        return true;
+    }
 
-        bool ok = write_packet(vs, packet);
-        av_packet_unref(packet);
-        if (!ok) {
-            LOGW("Could not send packet to v4l2 sink");
-            return false;
-        }
-    } else if (ret != AVERROR(EAGAIN)) {
-        LOGE("Could not receive v4l2 video packet: %d", ret);
-        return false;
+    uint8_t *data[SC_V4L2_OUTPUT_MAX_PLANES];
+    int linesize[SC_V4L2_OUTPUT_MAX_PLANES];
+    sc_v4l2_output_get_planes(&vs->output, buffer, data, linesize);
+
+    uint64_t start = get_monotonic_time_ns();
+
+    if (scale) {
+        // Scale and convert in the same pass, directly into the buffer
+        sws_scale(vs->sws_ctx, src, frame->linesize, 0, frame->height, data,
+                  linesize);
+    } else if (vs->pixel_format == SC_V4L2_PIXEL_FORMAT_YUYV) {
+        sc_yuv420_to_yuyv(src, frame->linesize, data[0], linesize[0],
+                          frame->width, frame->height);
+    } else {
+        assert(vs->pixel_format == SC_V4L2_PIXEL_FORMAT_NV12);
+        sc_yuv420_to_nv12(src, frame->linesize, data[0], linesize[0], data[1],
+                          linesize[1], frame->width, frame->height);
     }
 
-    return true;
+    vs->convert_time_ns += get_monotonic_time_ns() - start;
+    ++vs->convert_count;
+
+    return sc_v4l2_output_submit(&vs->output);
 }
 
 static int
@@ -128,7 +171,7 @@ run_v4l2_sink(void *data) {
 
         sc_video_buffer_consume(&vs->vb, vs->frame);
 
-        bool ok = encode_and_write_frame(vs, vs->frame);
+        bool ok = write_frame(vs, vs->frame);
         av_frame_unref(vs->frame);
         if (!ok) {
             LOGE("Could not send frame to v4l2 sink");
@@ -181,119 +224,44 @@ sc_v4l2_sink_open(struct sc_v4l2_sink *vs) {
         goto error_mutex_destroy;
     }
 
-    const AVOutputFormat *format = find_muxer("v4l2");
-    if (!format) {
-        // Alternative name
-        format = find_muxer("video4linux2");
-    }
-    if (!format) {
-        LOGE("Could not find v4l2 muxer");
-        goto error_cond_destroy;
-    }
-
-    const AVCodec *encoder = avcodec_find_encoder(AV_CODEC_ID_RAWVIDEO);
-    if (!encoder) {
-        LOGE("Raw video encoder not found");
-        return false;
-    }
-
-    vs->format_ctx = avformat_alloc_context();
-    if (!vs->format_ctx) {
-        LOG_OOM();
-        return false;
-    }
-
-    // contrary to the deprecated API (av_oformat_next()), av_muxer_iterate()
-    // returns (on purpose) a pointer-to-const, but AVFormatContext.oformat
-    // still expects a pointer-to-non-const (it has not be updated accordingly)
-    // <https://github.com/FFmpeg/FFmpeg/commit/0694d8702421e7aff1340038559c438b61bb30dd>
-    vs->format_ctx->oformat = (AVOutputFormat *) format;
-#ifdef SCRCPY_LAVF_HAS_AVFORMATCONTEXT_URL
-    vs->format_ctx->url = strdup(vs->device_name);
-    if (!vs->format_ctx->url) {
-        LOG_OOM();
-        goto error_avformat_free_context;
-    }
-#else
-    strncpy(vs->format_ctx->filename, vs->device_name,
-            sizeof(vs->format_ctx->filename));
-#endif
-
-    AVStream *ostream = avformat_new_stream(vs->format_ctx, encoder);
-    if (!ostream) {
-        LOG_OOM();
-        goto error_avformat_free_context;
-    }
-
-    ostream->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
-    ostream->codecpar->codec_id = encoder->id;
-    ostream->codecpar->format = AV_PIX_FMT_YUV420P;
-    ostream->codecpar->width = vs->frame_size.width;
-    ostream->codecpar->height = vs->frame_size.height;
-
-    int ret = avio_open(&vs->format_ctx->pb, vs->device_name, AVIO_FLAG_WRITE);
-    if (ret < 0) {
+    struct sc_size size = vs->output_size.width ? vs->output_size
+                                                : vs->frame_size;
+    ok = sc_v4l2_output_open(&vs->output, vs->device_name, size.width,
+                             size.height,
+                             get_v4l2_pixelformat(vs->pixel_format));
+    if (!ok) {
         LOGE("Failed to open output device: %s", vs->device_name);
-        // ostream will be cleaned up during context cleaning
-        goto error_avformat_free_context;
-    }
-
-    vs->encoder_ctx = avcodec_alloc_context3(encoder);
-    if (!vs->encoder_ctx) {
-        LOG_OOM();
-        goto error_avio_close;
-    }
-
-    vs->encoder_ctx->width = vs->frame_size.width;
-    vs->encoder_ctx->height = vs->frame_size.height;
-    vs->encoder_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
-    vs->encoder_ctx->time_base.num = 1;
-    vs->encoder_ctx->time_base.den = 1;
-
-    if (avcodec_open2(vs->encoder_ctx, encoder, NULL) < 0) {
-        LOGE("Could not open codec for v4l2");
-        goto error_avcodec_free_context;
+        goto error_cond_destroy;
     }
 
     vs->frame = av_frame_alloc();
     if (!vs->frame) {
         LOG_OOM();
-        goto error_avcodec_close;
+        goto error_v4l2_output_close;
     }
 
-    vs->packet = av_packet_alloc();
-    if (!vs->packet) {
-        LOG_OOM();
-        goto error_av_frame_free;
-    }
+    vs->sws_ctx = NULL;
+    vs->convert_count = 0;
+    vs->convert_time_ns = 0;
 
     vs->has_frame = false;
-    vs->header_written = false;
     vs->stopped = false;
 
     LOGD("Starting v4l2 thread");
     ok = sc_thread_create(&vs->thread, run_v4l2_sink, "v4l2", vs);
     if (!ok) {
         LOGC("Could not start v4l2 thread");
-        goto error_av_packet_free;
+        goto error_av_frame_free;
     }
 
     LOGI("v4l2 sink started to device: %s", vs->device_name);
 
     return true;
 
-error_av_packet_free:
-    av_packet_free(&vs->packet);
 error_av_frame_free:
     av_frame_free(&vs->frame);
-error_avcodec_close:
-    avcodec_close(vs->encoder_ctx);
-error_avcodec_free_context:
-    avcodec_free_context(&vs->encoder_ctx);
-error_avio_close:
-    avio_close(vs->format_ctx->pb);
-error_avformat_free_context:
-    avformat_free_context(vs->format_ctx);
+error_v4l2_output_close:
+    sc_v4l2_output_close(&vs->output);
 error_cond_destroy:
     sc_cond_destroy(&vs->cond);
 error_mutex_destroy:
@@ -319,12 +287,15 @@ sc_v4l2_sink_close(struct sc_v4l2_sink *vs) {
     sc_thread_join(&vs->thread, NULL);
     sc_video_buffer_join(&vs->vb);
 
-    av_packet_free(&vs->packet);
+    if (vs->convert_count) {
+        LOGD("V4l2 conversion: %" PRIu64_ " frames, %" PRIu64_ " us per frame "
+             "on average", vs->convert_count,
+             vs->convert_time_ns / 1000 / vs->convert_count);
+    }
+
+    sws_freeContext(vs->sws_ctx);
     av_frame_free(&vs->frame);
-    avcodec_close(vs->encoder_ctx);
-    avcodec_free_context(&vs->encoder_ctx);
-    avio_close(vs->format_ctx->pb);
-    avformat_free_context(vs->format_ctx);
+    sc_v4l2_output_close(&vs->output);
     sc_cond_destroy(&vs->cond);
     sc_mutex_destroy(&vs->mutex);
     sc_video_buffer_destroy(&vs->vb);
@@ -355,7 +326,9 @@ sc_v4l2_frame_sink_push(struct sc_frame_sink *sink, const AVFrame *frame) {
 
 bool
 sc_v4l2_sink_init(struct sc_v4l2_sink *vs, const char *device_name,
-                  struct sc_size frame_size, sc_tick buffering_time) {
+                  struct sc_size frame_size, struct sc_size output_size,
+                  enum sc_v4l2_pixel_format pixel_format,
+                  sc_tick buffering_time) {
     vs->device_name = strdup(device_name);
     if (!vs->device_name) {
         LOGE("Could not strdup v4l2 device name");
@@ -363,6 +336,8 @@ sc_v4l2_sink_init(struct sc_v4l2_sink *vs, const char *device_name,
     }
 
     vs->frame_size = frame_size;
+    vs->output_size = output_size;
+    vs->pixel_format = pixel_format;
     vs->buffering_time = buffering_time;
 
     static const struct sc_frame_sink_ops ops = {
@@ -4,37 +4,48 @@
 #include "common.h"
 
 #include "coords.h"
+#include "options.h"
 #include "trait/frame_sink.h"
+#include "v4l2_output.h"
 #include "video_buffer.h"
 #include "util/tick.h"
 
 #include <libavformat/avformat.h>
+#include <libswscale/swscale.h>
 
 struct sc_v4l2_sink {
     struct sc_frame_sink frame_sink; // frame sink trait
 
     struct sc_video_buffer vb;
-    AVFormatContext *format_ctx;
-    AVCodecContext *encoder_ctx;
+    struct sc_v4l2_output output;
 
     char *device_name;
     struct sc_size frame_size;
+    struct sc_size output_size; // {0, 0} for the frame size (no scaling)
+    enum sc_v4l2_pixel_format pixel_format;
     sc_tick buffering_time;
 
+    // only if scaling
+    struct SwsContext *sws_ctx;
+    struct sc_size sws_input_size;
+
+    uint64_t convert_count;
+    uint64_t convert_time_ns;
+
     sc_thread thread;
     sc_mutex mutex;
     sc_cond cond;
     bool has_frame;
     bool stopped;
-    bool header_written;
 
     AVFrame *frame;
-    AVPacket *packet;
 };
 
 bool
 sc_v4l2_sink_init(struct sc_v4l2_sink *vs, const char *device_name,
-                  struct sc_size frame_size, sc_tick buffering_time);
+                  struct sc_size frame_size, struct sc_size output_size,
+                  enum sc_v4l2_pixel_format pixel_format,
+                  sc_tick buffering_time);
 
 void
 sc_v4l2_sink_destroy(struct sc_v4l2_sink *vs);
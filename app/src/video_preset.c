@@ -0,0 +1,55 @@
+#include "video_preset.h"
+
+#include <assert.h>
+
+const struct sc_video_preset sc_video_presets[SC_VIDEO_PRESET_COUNT] = {
+    {  720, 30 },
+    { 1024, 60 },
+    { 1280, 60 },
+    { 1920, 60 },
+    {    0,  0 },
+};
+
+unsigned
+sc_video_preset_find(uint16_t max_size) {
+    if (!max_size) {
+        // the device size, the last preset
+        return SC_VIDEO_PRESET_COUNT - 1;
+    }
+
+    for (unsigned i = 0; i < SC_VIDEO_PRESET_COUNT; ++i) {
+        uint16_t preset_max_size = sc_video_presets[i].max_size;
+        if (!preset_max_size || preset_max_size >= max_size) {
+            return i;
+        }
+    }
+
+    assert(!"the last preset has no max size");
+    return SC_VIDEO_PRESET_COUNT - 1;
+}
+
+unsigned
+sc_video_preset_step(unsigned index, bool better) {
+    assert(index < SC_VIDEO_PRESET_COUNT);
+    if (better) {
+        return index + 1 < SC_VIDEO_PRESET_COUNT ? index + 1 : index;
+    }
+    return index ? index - 1 : index;
+}
+
+bool
+sc_video_preset_is_allowed(const struct sc_video_preset *preset,
+                           uint16_t initial_max_size,
+                           enum sc_video_preset_constraint constraint) {
+    switch (constraint) {
+        case SC_VIDEO_PRESET_NOT_LARGER:
+            // The initial frames have the device size if there is no max size
+            return !initial_max_size
+                || (preset->max_size && preset->max_size <= initial_max_size);
+        case SC_VIDEO_PRESET_SAME_SIZE:
+            return preset->max_size == initial_max_size;
+        default:
+            assert(constraint == SC_VIDEO_PRESET_ANY_SIZE);
+            return true;
+    }
+}
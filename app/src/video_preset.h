@@ -0,0 +1,59 @@
+#ifndef SC_VIDEO_PRESET_H
+#define SC_VIDEO_PRESET_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Video settings which may be changed during the session, to trade sharpness
+ * for latency
+ */
+struct sc_video_preset {
+    uint16_t max_size; // 0 for the device size
+    uint16_t max_fps; // 0 for unlimited
+};
+
+#define SC_VIDEO_PRESET_COUNT 5
+
+// The frame size changes the video sinks can handle
+enum sc_video_preset_constraint {
+    SC_VIDEO_PRESET_ANY_SIZE,
+    // The frames must not be larger than the initial frames (the shared memory
+    // sink sizes its slots once)
+    SC_VIDEO_PRESET_NOT_LARGER,
+    // The frames must keep their initial size (the v4l2 format is negotiated
+    // once, and frames of another size are only scaled if --v4l2-size is set)
+    SC_VIDEO_PRESET_SAME_SIZE,
+};
+
+// Ordered from the lowest latency to the best quality
+extern const struct sc_video_preset sc_video_presets[SC_VIDEO_PRESET_COUNT];
+
+/**
+ * Return the index of the preset matching the initial max size
+ *
+ * It is the lowest preset which does not decrease the resolution.
+ */
+unsigned
+sc_video_preset_find(uint16_t max_size);
+
+/**
+ * Return the index of the next (better) or previous (lower latency) preset
+ *
+ * Return `index` if there is no such preset.
+ */
+unsigned
+sc_video_preset_step(unsigned index, bool better);
+
+/**
+ * Indicate if a preset may be applied, given the initial max size (0 for the
+ * device size)
+ */
+bool
+sc_video_preset_is_allowed(const struct sc_video_preset *preset,
+                           uint16_t initial_max_size,
+                           enum sc_video_preset_constraint constraint);
+
+#endif
@@ -0,0 +1,105 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "camera_motion.h"
+
+static const struct sc_size frame_size = {2400, 1080};
+static const struct sc_point center = {1450, 542};
+
+static void test_subpixel_accumulation(void) {
+    struct sc_camera_motion cm;
+    sc_camera_motion_init(&cm, 0);
+    sc_camera_motion_reset(&cm, center);
+
+    // A high-DPI mouse generates small motions, scaled by a sensitivity < 1
+    for (int i = 0; i < 300; ++i) {
+        bool recenter = sc_camera_motion_move(&cm, 0.25f, -0.125f, frame_size,
+                                              center);
+        assert(!recenter);
+        (void) recenter;
+    }
+
+    // Truncating each motion to an integer would not move at all
+    struct sc_point point = sc_camera_motion_get_point(&cm);
+    assert(point.x == center.x + 75);
+    assert(point.y == center.y - 37); // 504.5 is rounded to 505
+}
+
+static void test_recenter(void) {
+    struct sc_camera_motion cm;
+    sc_camera_motion_init(&cm, 0);
+    sc_camera_motion_reset(&cm, center);
+
+    // Move right until the margin
+    int moves = 0;
+    bool recenter;
+    do {
+        recenter = sc_camera_motion_move(&cm, 10, 0, frame_size, center);
+        ++moves;
+    } while (!recenter);
+
+    // 2400 * 0.9 = 2160, so the position 2170 triggered the recentering
+    assert(moves == (2170 - 1450) / 10);
+
+    // The motion is applied from the center
+    struct sc_point point = sc_camera_motion_get_point(&cm);
+    assert(point.x == center.x + 10);
+    assert(point.y == center.y);
+
+    // Vertically too (1080 * 0.1 = 108)
+    recenter = sc_camera_motion_move(&cm, 0, -400, frame_size, center);
+    assert(!recenter);
+    recenter = sc_camera_motion_move(&cm, 0, -400, frame_size, center);
+    assert(recenter);
+    point = sc_camera_motion_get_point(&cm);
+    assert(point.x == center.x);
+    assert(point.y == center.y - 400);
+}
+
+static void test_fixed_rate(void) {
+    struct sc_camera_motion cm;
+    sc_camera_motion_init(&cm, SC_TICK_FROM_MS(8)); // 125 Hz
+    sc_camera_motion_reset(&cm, center);
+
+    // The first MOVE is sent immediately
+    sc_tick deadline = sc_camera_motion_next_deadline(&cm, 1000000);
+    assert(deadline == 1000000);
+
+    // The next ones (1 per millisecond) are delayed, and replace each other
+    for (sc_tick t = 1; t < 8; ++t) {
+        deadline = sc_camera_motion_next_deadline(&cm,
+                                                  1000000 + SC_TICK_FROM_MS(t));
+        assert(deadline == 1000000 + SC_TICK_FROM_MS(8));
+    }
+
+    deadline = sc_camera_motion_next_deadline(&cm,
+                                              1000000 + SC_TICK_FROM_MS(8));
+    assert(deadline == 1000000 + SC_TICK_FROM_MS(16));
+
+    // After a pause, the MOVE event is sent immediately again
+    deadline = sc_camera_motion_next_deadline(&cm, 2000000);
+    assert(deadline == 2000000);
+}
+
+static void test_no_rate_limit(void) {
+    struct sc_camera_motion cm;
+    sc_camera_motion_init(&cm, 0);
+
+    for (sc_tick t = 1000; t < 2000; t += 100) {
+        sc_tick deadline = sc_camera_motion_next_deadline(&cm, t);
+        assert(deadline == t);
+        (void) deadline;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_subpixel_accumulation();
+    test_recenter();
+    test_fixed_rate();
+    test_no_rate_limit();
+    return 0;
+}
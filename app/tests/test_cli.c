@@ -52,14 +52,21 @@ static void test_options(void) {
         "--max-fps", "30",
         "--max-size", "1024",
         "--lock-video-orientation=2", // optional arguments require '='
+        "--low-latency",
+        "--multiplex",
         // "--no-control" is not compatible with "--turn-screen-off"
         // "--no-display" is not compatible with "--fulscreen"
         "--port", "1234:1236",
         "--push-target", "/sdcard/Movies",
         "--record", "file",
         "--record-format", "mkv",
+        "--record-queue-policy", "drop",
+        "--record-queue-size", "16M",
+        "--record-queue-packets", "300",
         "--serial", "0123456789abcdef",
         "--show-touches",
+        "--timelapse", "lapse.mp4",
+        "--timelapse-threshold", "4",
         "--turn-screen-off",
         "--prefer-text",
         "--window-title", "my device",
@@ -81,13 +88,22 @@ static void test_options(void) {
     assert(opts->max_fps == 30);
     assert(opts->max_size == 1024);
     assert(opts->lock_video_orientation == 2);
+    assert(opts->low_latency);
+    assert(opts->multiplex);
     assert(opts->port_range.first == 1234);
     assert(opts->port_range.last == 1236);
     assert(!strcmp(opts->push_target, "/sdcard/Movies"));
     assert(!strcmp(opts->record_filename, "file"));
     assert(opts->record_format == SC_RECORD_FORMAT_MKV);
+    assert(opts->record_queue_policy == SC_RECORD_QUEUE_POLICY_DROP);
+    assert(opts->record_queue_size == 16000000);
+    assert(opts->record_queue_packets == 300);
     assert(!strcmp(opts->serial, "0123456789abcdef"));
     assert(opts->show_touches);
+    assert(!strcmp(opts->timelapse_filename, "lapse.mp4"));
+    assert(opts->timelapse_format == SC_RECORD_FORMAT_MP4);
+    assert(opts->timelapse_interval == 0);
+    assert(opts->timelapse_threshold == 4);
     assert(opts->turn_screen_off);
     assert(opts->key_inject_mode == SC_KEY_INJECT_MODE_TEXT);
     assert(!strcmp(opts->window_title, "my device"));
@@ -122,6 +138,215 @@ static void test_options2(void) {
     assert(opts->record_format == SC_RECORD_FORMAT_MP4);
 }
 
+static void test_options_input_replay(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--input-replay=file.scin",
+                    "--input-replay-speed=2.5"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+    assert(!strcmp(args.opts.input_replay_filename, "file.scin"));
+    assert(args.opts.input_replay_speed == 2.5f);
+
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--input-replay=file.scin",
+                     "--input-replay-speed=max"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(ok);
+    assert(args.opts.input_replay_speed == 0); // as fast as possible
+
+    args.opts = scrcpy_options_default;
+    char *argv3[] = {"scrcpy", "--input-replay=file.scin",
+                     "--input-record=other.scin"};
+
+    // record and replay are mutually exclusive
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv3), argv3);
+    assert(!ok);
+}
+
+static void test_options_keymap(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--keymap=games.keymap",
+                    "--keymap-profile=shooter", "--camera-rate=60"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+    assert(!strcmp(args.opts.keymap_filename, "games.keymap"));
+    assert(!strcmp(args.opts.keymap_profile, "shooter"));
+    assert(args.opts.camera_rate == 60);
+
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--keymap=games.keymap", "--no-control"};
+
+    // the keymap generates control messages
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(!ok);
+}
+
+static void test_options_latency_probe(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--latency-probe"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+    assert(args.opts.latency_probe);
+    assert(!args.opts.latency_probe_interval); // default interval
+
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--latency-probe=20"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(ok);
+    assert(args.opts.latency_probe);
+    assert(args.opts.latency_probe_interval == SC_TICK_FROM_MS(20));
+
+    args.opts = scrcpy_options_default;
+    char *argv3[] = {"scrcpy", "--latency-probe", "--no-control"};
+
+    // a ping requires the control channel
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv3), argv3);
+    assert(!ok);
+}
+
+static void test_options_adaptive_bit_rate(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--adaptive-bit-rate", "--bit-rate=4M"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+    assert(args.opts.adaptive_bit_rate);
+    assert(args.opts.adaptive_bit_rate_min == 1000000);
+    assert(args.opts.adaptive_bit_rate_max == 4000000); // the bit-rate
+
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--adaptive-bit-rate=2M:16M"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(ok);
+    assert(args.opts.adaptive_bit_rate);
+    assert(args.opts.adaptive_bit_rate_min == 2000000);
+    assert(args.opts.adaptive_bit_rate_max == 16000000);
+
+    args.opts = scrcpy_options_default;
+    char *argv3[] = {"scrcpy", "--adaptive-bit-rate=16M:2M"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv3), argv3);
+    assert(!ok);
+
+    args.opts = scrcpy_options_default;
+    char *argv4[] = {"scrcpy", "--adaptive-bit-rate", "--no-control"};
+
+    // the stream stats are sent through the control channel
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv4), argv4);
+    assert(!ok);
+}
+
+static void test_options_resume(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--resume"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+    assert(args.opts.resume);
+    assert(args.opts.multiplex);
+    assert(args.opts.force_adb_forward);
+}
+
+static void test_options_record_queue_size_default(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    // the documented default
+    char *argv[] = {"scrcpy", "--record-queue-size=64M"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+    assert(args.opts.record_queue_size
+            == scrcpy_options_default.record_queue_size);
+}
+
+static void test_options_udp(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--udp"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+    assert(args.opts.udp);
+
+    // the video stream over UDP cannot be resumed
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--udp", "--resume"};
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(!ok);
+}
+
+#ifdef HAVE_SHM_SINK
+static void test_options_shm_sink(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {
+        "scrcpy",
+        "--no-display",
+        "--shm-sink", "/scrcpy", // a frame sink is enough for --no-display
+    };
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+
+    const struct scrcpy_options *opts = &args.opts;
+    assert(!opts->display);
+    assert(!strcmp(opts->shm_sink_name, "/scrcpy"));
+
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {
+        "scrcpy",
+        "--shm-sink", "/dev/shm/scrcpy", // must not contain other slashes
+    };
+
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(!ok);
+}
+#endif
+
 static void test_parse_shortcut_mods(void) {
     struct sc_shortcut_mods mods;
     bool ok;
@@ -167,6 +392,16 @@ int main(int argc, char *argv[]) {
     test_flag_help();
     test_options();
     test_options2();
+    test_options_input_replay();
+    test_options_keymap();
+    test_options_latency_probe();
+    test_options_adaptive_bit_rate();
+    test_options_resume();
+    test_options_record_queue_size_default();
+    test_options_udp();
+#ifdef HAVE_SHM_SINK
+    test_options_shm_sink();
+#endif
     test_parse_shortcut_mods();
     return 0;
 };
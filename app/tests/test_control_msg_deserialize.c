@@ -0,0 +1,184 @@
+#include "common.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "control_msg.h"
+
+// Serialize, deserialize and serialize again: the result must be identical
+static void check_roundtrip(const struct control_msg *msg) {
+    static unsigned char buf[CONTROL_MSG_MAX_SIZE];
+    static unsigned char buf2[CONTROL_MSG_MAX_SIZE];
+
+    size_t size = control_msg_serialize(msg, buf);
+
+    // a truncated message is not available yet
+    struct control_msg out;
+    ssize_t r = control_msg_deserialize(buf, size - 1, &out);
+    assert(r == 0);
+
+    r = control_msg_deserialize(buf, size, &out);
+    assert(r == (ssize_t) size);
+    assert(out.type == msg->type);
+
+    size_t size2 = control_msg_serialize(&out, buf2);
+    assert(size2 == size);
+    assert(!memcmp(buf, buf2, size));
+
+    control_msg_destroy(&out);
+}
+
+static void test_deserialize_inject_keycode(void) {
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_INJECT_KEYCODE,
+        .inject_keycode = {
+            .action = AKEY_EVENT_ACTION_UP,
+            .keycode = AKEYCODE_ENTER,
+            .repeat = 5,
+            .metastate = AMETA_SHIFT_ON | AMETA_SHIFT_LEFT_ON,
+        },
+    };
+    check_roundtrip(&msg);
+}
+
+static void test_deserialize_inject_text(void) {
+    struct control_msg msg;
+    msg.type = CONTROL_MSG_TYPE_INJECT_TEXT;
+    bool ok = control_msg_text_init(&msg.inject_text.text, "hello, world!");
+    assert(ok);
+    (void) ok;
+    check_roundtrip(&msg);
+    control_msg_destroy(&msg);
+}
+
+static void test_deserialize_inject_touch_event(void) {
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT,
+        .inject_touch_event = {
+            .action = AMOTION_EVENT_ACTION_DOWN,
+            .pointer_id = UINT64_C(0x1234567887654321),
+            .position = {
+                .point = {
+                    .x = -100,
+                    .y = 200,
+                },
+                .screen_size = {
+                    .width = 1080,
+                    .height = 1920,
+                },
+            },
+            .pressure = 0.5f,
+            .buttons = AMOTION_EVENT_BUTTON_PRIMARY,
+        },
+    };
+    check_roundtrip(&msg);
+
+    // the max pressure is not altered
+    msg.inject_touch_event.pressure = 1.0f;
+    check_roundtrip(&msg);
+}
+
+static void test_deserialize_inject_scroll_event(void) {
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_INJECT_SCROLL_EVENT,
+        .inject_scroll_event = {
+            .position = {
+                .point = {
+                    .x = 260,
+                    .y = 1026,
+                },
+                .screen_size = {
+                    .width = 1080,
+                    .height = 1920,
+                },
+            },
+            .hscroll = 1,
+            .vscroll = -1,
+        },
+    };
+    check_roundtrip(&msg);
+}
+
+static void test_deserialize_set_clipboard(void) {
+    struct control_msg msg;
+    msg.type = CONTROL_MSG_TYPE_SET_CLIPBOARD;
+    msg.set_clipboard.sequence = UINT64_C(0x0102030405060708);
+    msg.set_clipboard.paste = true;
+
+    // stored on the heap
+    char text[CONTROL_MSG_TEXT_INLINE_MAX_LENGTH + 100];
+    memset(text, 'a', sizeof(text));
+    text[sizeof(text) - 1] = '\0';
+    bool ok = control_msg_text_init(&msg.set_clipboard.text, text);
+    assert(ok);
+    (void) ok;
+
+    check_roundtrip(&msg);
+    control_msg_destroy(&msg);
+}
+
+static void test_deserialize_simple_msgs(void) {
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_BACK_OR_SCREEN_ON,
+        .back_or_screen_on = {
+            .action = AKEY_EVENT_ACTION_UP,
+        },
+    };
+    check_roundtrip(&msg);
+
+    msg.type = CONTROL_MSG_TYPE_GET_CLIPBOARD;
+    msg.get_clipboard.copy_key = GET_CLIPBOARD_COPY_KEY_CUT;
+    check_roundtrip(&msg);
+
+    msg.type = CONTROL_MSG_TYPE_SET_SCREEN_POWER_MODE;
+    msg.set_screen_power_mode.mode = SCREEN_POWER_MODE_NORMAL;
+    check_roundtrip(&msg);
+
+    msg.type = CONTROL_MSG_TYPE_PING;
+    msg.ping.timestamp = 42;
+    check_roundtrip(&msg);
+
+    msg.type = CONTROL_MSG_TYPE_STREAM_STATS;
+    msg.stream_stats.throughput = 1000000;
+    msg.stream_stats.queue_delay = 12000;
+    msg.stream_stats.jitter = 3000;
+    msg.stream_stats.skipped_frames = 2;
+    check_roundtrip(&msg);
+
+    msg.type = CONTROL_MSG_TYPE_SET_VIDEO_SETTINGS;
+    msg.set_video_settings.max_size = 1024;
+    msg.set_video_settings.max_fps = 30;
+    check_roundtrip(&msg);
+
+    msg.type = CONTROL_MSG_TYPE_EXPAND_NOTIFICATION_PANEL;
+    check_roundtrip(&msg);
+
+    msg.type = CONTROL_MSG_TYPE_ROTATE_DEVICE;
+    check_roundtrip(&msg);
+
+    msg.type = CONTROL_MSG_TYPE_REQUEST_KEY_FRAME;
+    check_roundtrip(&msg);
+}
+
+static void test_deserialize_invalid(void) {
+    const unsigned char input[] = {0xff, 0x00, 0x00};
+
+    struct control_msg msg;
+    ssize_t r = control_msg_deserialize(input, sizeof(input), &msg);
+    assert(r == -1);
+    (void) r;
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_deserialize_inject_keycode();
+    test_deserialize_inject_text();
+    test_deserialize_inject_touch_event();
+    test_deserialize_inject_scroll_event();
+    test_deserialize_set_clipboard();
+    test_deserialize_simple_msgs();
+    test_deserialize_invalid();
+    return 0;
+}
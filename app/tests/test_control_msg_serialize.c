@@ -1,6 +1,7 @@
 #include "common.h"
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "control_msg.h"
@@ -31,12 +32,13 @@ static void test_serialize_inject_keycode(void) {
 }
 
 static void test_serialize_inject_text(void) {
-    struct control_msg msg = {
-        .type = CONTROL_MSG_TYPE_INJECT_TEXT,
-        .inject_text = {
-            .text = "hello, world!",
-        },
-    };
+    struct control_msg msg;
+    msg.type = CONTROL_MSG_TYPE_INJECT_TEXT;
+    bool ok = control_msg_text_init(&msg.inject_text.text, "hello, world!");
+    assert(ok);
+    (void) ok;
+    // short texts are stored inline
+    assert(!msg.inject_text.text.heap);
 
     unsigned char buf[CONTROL_MSG_MAX_SIZE];
     size_t size = control_msg_serialize(&msg, buf);
@@ -48,6 +50,8 @@ static void test_serialize_inject_text(void) {
         'h', 'e', 'l', 'l', 'o', ',', ' ', 'w', 'o', 'r', 'l', 'd', '!', // text
     };
     assert(!memcmp(buf, expected, sizeof(expected)));
+
+    control_msg_destroy(&msg);
 }
 
 static void test_serialize_inject_text_long(void) {
@@ -56,7 +60,11 @@ static void test_serialize_inject_text_long(void) {
     char text[CONTROL_MSG_INJECT_TEXT_MAX_LENGTH + 1];
     memset(text, 'a', sizeof(text));
     text[CONTROL_MSG_INJECT_TEXT_MAX_LENGTH] = '\0';
-    msg.inject_text.text = text;
+    bool ok = control_msg_text_init(&msg.inject_text.text, text);
+    assert(ok);
+    (void) ok;
+    // the max length still fits inline
+    assert(!msg.inject_text.text.heap);
 
     unsigned char buf[CONTROL_MSG_MAX_SIZE];
     size_t size = control_msg_serialize(&msg, buf);
@@ -71,6 +79,39 @@ static void test_serialize_inject_text_long(void) {
     memset(&expected[5], 'a', CONTROL_MSG_INJECT_TEXT_MAX_LENGTH);
 
     assert(!memcmp(buf, expected, sizeof(expected)));
+
+    control_msg_destroy(&msg);
+}
+
+static void test_serialize_inject_text_out_of_line(void) {
+    struct control_msg msg;
+    msg.type = CONTROL_MSG_TYPE_INJECT_TEXT;
+    char text[CONTROL_MSG_INJECT_TEXT_MAX_LENGTH + 11];
+    memset(text, 'b', sizeof(text));
+    text[CONTROL_MSG_INJECT_TEXT_MAX_LENGTH + 10] = '\0';
+    bool ok = control_msg_text_init(&msg.inject_text.text, text);
+    assert(ok);
+    (void) ok;
+    // too long to be stored inline
+    assert(msg.inject_text.text.heap);
+    assert(!strcmp(msg.inject_text.text.heap, text));
+
+    unsigned char buf[CONTROL_MSG_MAX_SIZE];
+    size_t size = control_msg_serialize(&msg, buf);
+    // truncated on serialization
+    assert(size == 5 + CONTROL_MSG_INJECT_TEXT_MAX_LENGTH);
+
+    unsigned char expected[5 + CONTROL_MSG_INJECT_TEXT_MAX_LENGTH];
+    expected[0] = CONTROL_MSG_TYPE_INJECT_TEXT;
+    expected[1] = 0x00;
+    expected[2] = 0x00;
+    expected[3] = 0x01;
+    expected[4] = 0x2c; // text length (32 bits)
+    memset(&expected[5], 'b', CONTROL_MSG_INJECT_TEXT_MAX_LENGTH);
+
+    assert(!memcmp(buf, expected, sizeof(expected)));
+
+    control_msg_destroy(&msg);
 }
 
 static void test_serialize_inject_touch_event(void) {
@@ -227,14 +268,14 @@ static void test_serialize_get_clipboard(void) {
 }
 
 static void test_serialize_set_clipboard(void) {
-    struct control_msg msg = {
-        .type = CONTROL_MSG_TYPE_SET_CLIPBOARD,
-        .set_clipboard = {
-            .sequence = UINT64_C(0x0102030405060708),
-            .paste = true,
-            .text = "hello, world!",
-        },
-    };
+    struct control_msg msg;
+    msg.type = CONTROL_MSG_TYPE_SET_CLIPBOARD;
+    msg.set_clipboard.sequence = UINT64_C(0x0102030405060708);
+    msg.set_clipboard.paste = true;
+    bool ok = control_msg_text_init(&msg.set_clipboard.text, "hello, world!");
+    assert(ok);
+    (void) ok;
+    assert(!msg.set_clipboard.text.heap);
 
     unsigned char buf[CONTROL_MSG_MAX_SIZE];
     size_t size = control_msg_serialize(&msg, buf);
@@ -248,6 +289,43 @@ static void test_serialize_set_clipboard(void) {
         'h', 'e', 'l', 'l', 'o', ',', ' ', 'w', 'o', 'r', 'l', 'd', '!', // text
     };
     assert(!memcmp(buf, expected, sizeof(expected)));
+
+    control_msg_destroy(&msg);
+}
+
+static void test_serialize_set_clipboard_long(void) {
+    struct control_msg msg;
+    msg.type = CONTROL_MSG_TYPE_SET_CLIPBOARD;
+    msg.set_clipboard.sequence = 42;
+    msg.set_clipboard.paste = false;
+
+    size_t len = 10000;
+    char *text = malloc(len + 1);
+    assert(text);
+    memset(text, 'c', len);
+    text[len] = '\0';
+    bool ok = control_msg_text_init(&msg.set_clipboard.text, text);
+    assert(ok);
+    (void) ok;
+    // stored on the heap
+    assert(msg.set_clipboard.text.heap);
+
+    static unsigned char buf[CONTROL_MSG_MAX_SIZE];
+    size_t size = control_msg_serialize(&msg, buf);
+    assert(size == 14 + len);
+
+    const unsigned char expected_header[] = {
+        CONTROL_MSG_TYPE_SET_CLIPBOARD,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x2a, // sequence
+        0, // paste
+        0x00, 0x00, 0x27, 0x10, // text length
+    };
+    assert(!memcmp(buf, expected_header, sizeof(expected_header)));
+    // the whole text is serialized, not truncated to the inline length
+    assert(!memcmp(&buf[14], text, len));
+
+    free(text);
+    control_msg_destroy(&msg);
 }
 
 static void test_serialize_set_screen_power_mode(void) {
@@ -284,6 +362,86 @@ static void test_serialize_rotate_device(void) {
     assert(!memcmp(buf, expected, sizeof(expected)));
 }
 
+static void test_serialize_ping(void) {
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_PING,
+        .ping = {
+            .timestamp = UINT64_C(0x0102030405060708),
+        },
+    };
+
+    unsigned char buf[CONTROL_MSG_MAX_SIZE];
+    size_t size = control_msg_serialize(&msg, buf);
+    assert(size == 9);
+
+    const unsigned char expected[] = {
+        CONTROL_MSG_TYPE_PING,
+        0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, // timestamp
+    };
+    assert(!memcmp(buf, expected, sizeof(expected)));
+}
+
+static void test_serialize_stream_stats(void) {
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_STREAM_STATS,
+        .stream_stats = {
+            .throughput = 0x01020304,
+            .queue_delay = 0x05060708,
+            .jitter = 0x090A0B0C,
+            .skipped_frames = 0x0D0E,
+        },
+    };
+
+    unsigned char buf[CONTROL_MSG_MAX_SIZE];
+    size_t size = control_msg_serialize(&msg, buf);
+    assert(size == 15);
+
+    const unsigned char expected[] = {
+        CONTROL_MSG_TYPE_STREAM_STATS,
+        0x01, 0x02, 0x03, 0x04, // throughput
+        0x05, 0x06, 0x07, 0x08, // queue delay
+        0x09, 0x0A, 0x0B, 0x0C, // jitter
+        0x0D, 0x0E, // skipped frames
+    };
+    assert(!memcmp(buf, expected, sizeof(expected)));
+}
+
+static void test_serialize_set_video_settings(void) {
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_SET_VIDEO_SETTINGS,
+        .set_video_settings = {
+            .max_size = 1280,
+            .max_fps = 60,
+        },
+    };
+
+    unsigned char buf[CONTROL_MSG_MAX_SIZE];
+    size_t size = control_msg_serialize(&msg, buf);
+    assert(size == 5);
+
+    const unsigned char expected[] = {
+        CONTROL_MSG_TYPE_SET_VIDEO_SETTINGS,
+        0x05, 0x00, // 1280
+        0x00, 0x3c, // 60
+    };
+    assert(!memcmp(buf, expected, sizeof(expected)));
+}
+
+static void test_serialize_request_key_frame(void) {
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_REQUEST_KEY_FRAME,
+    };
+
+    unsigned char buf[CONTROL_MSG_MAX_SIZE];
+    size_t size = control_msg_serialize(&msg, buf);
+    assert(size == 1);
+
+    const unsigned char expected[] = {
+        CONTROL_MSG_TYPE_REQUEST_KEY_FRAME,
+    };
+    assert(!memcmp(buf, expected, sizeof(expected)));
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
@@ -291,6 +449,7 @@ int main(int argc, char *argv[]) {
     test_serialize_inject_keycode();
     test_serialize_inject_text();
     test_serialize_inject_text_long();
+    test_serialize_inject_text_out_of_line();
     test_serialize_inject_touch_event();
     test_serialize_inject_scroll_event();
     test_serialize_back_or_screen_on();
@@ -299,7 +458,12 @@ int main(int argc, char *argv[]) {
     test_serialize_collapse_panels();
     test_serialize_get_clipboard();
     test_serialize_set_clipboard();
+    test_serialize_set_clipboard_long();
     test_serialize_set_screen_power_mode();
     test_serialize_rotate_device();
+    test_serialize_ping();
+    test_serialize_stream_stats();
+    test_serialize_set_video_settings();
+    test_serialize_request_key_frame();
     return 0;
 }
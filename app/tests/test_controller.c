@@ -0,0 +1,518 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "controller.h"
+
+#define EVENTS_PER_SECOND 8000 // 8 kHz input device
+#define TAKE_PERIOD 8 // the controller consumes 1 message every 8 events
+#define CLICK_PERIOD 50
+#define KEY_PERIOD 400
+
+#define MAX_BARRIERS (EVENTS_PER_SECOND / CLICK_PERIOD \
+                    + EVENTS_PER_SECOND / KEY_PERIOD)
+
+#define POINTER_COUNT 2
+static const uint64_t pointer_ids[POINTER_COUNT] = {
+    POINTER_ID_MOUSE,
+    POINTER_ID_VIRTUAL_FINGER,
+};
+
+// A DOWN, UP or non-motion message, and the last positions pushed before it
+struct barrier {
+    enum control_msg_type type;
+    int action;
+    int32_t last_x[POINTER_COUNT];
+};
+
+struct state {
+    struct barrier expected[MAX_BARRIERS];
+    size_t expected_count;
+    size_t taken_count;
+    int32_t pushed_x[POINTER_COUNT];
+    int32_t taken_x[POINTER_COUNT];
+    unsigned moves_taken;
+};
+
+static unsigned pointer_index(uint64_t pointer_id) {
+    for (unsigned i = 0; i < POINTER_COUNT; ++i) {
+        if (pointer_ids[i] == pointer_id) {
+            return i;
+        }
+    }
+    assert(!"unexpected pointer id");
+    return 0;
+}
+
+static void push_touch(struct controller *controller, struct state *state,
+                       enum android_motionevent_action action,
+                       unsigned pointer, int32_t x) {
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT,
+        .inject_touch_event = {
+            .action = action,
+            .pointer_id = pointer_ids[pointer],
+            .position = {
+                .screen_size = {1920, 1080},
+                .point = {x, 0},
+            },
+            .pressure = 1.f,
+        },
+    };
+
+    bool ok = controller_push_msg(controller, &msg);
+    assert(ok);
+    (void) ok;
+
+    if (action == AMOTION_EVENT_ACTION_MOVE) {
+        state->pushed_x[pointer] = x;
+    } else {
+        assert(state->expected_count < MAX_BARRIERS);
+        struct barrier *barrier = &state->expected[state->expected_count++];
+        barrier->type = msg.type;
+        barrier->action = action;
+        memcpy(barrier->last_x, state->pushed_x, sizeof(barrier->last_x));
+    }
+}
+
+static void push_key(struct controller *controller, struct state *state) {
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_INJECT_KEYCODE,
+        .inject_keycode = {
+            .action = AKEY_EVENT_ACTION_DOWN,
+            .keycode = AKEYCODE_ENTER,
+        },
+    };
+
+    bool ok = controller_push_msg(controller, &msg);
+    assert(ok);
+    (void) ok;
+
+    assert(state->expected_count < MAX_BARRIERS);
+    struct barrier *barrier = &state->expected[state->expected_count++];
+    barrier->type = msg.type;
+    barrier->action = AKEY_EVENT_ACTION_DOWN;
+    memcpy(barrier->last_x, state->pushed_x, sizeof(barrier->last_x));
+}
+
+// Take one message, as the controller thread would do
+static bool take(struct controller *controller, struct state *state) {
+    struct controller_msg cmsg;
+    if (!cbuf_take(&controller->queue, &cmsg)) {
+        return false;
+    }
+    struct control_msg msg = cmsg.msg;
+
+    if (msg.type == CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT
+            && msg.inject_touch_event.action == AMOTION_EVENT_ACTION_MOVE) {
+        unsigned pointer = pointer_index(msg.inject_touch_event.pointer_id);
+        int32_t x = msg.inject_touch_event.position.point.x;
+        // the positions of a pointer never go backwards
+        assert(x > state->taken_x[pointer]);
+        state->taken_x[pointer] = x;
+        ++state->moves_taken;
+        return true;
+    }
+
+    // the barriers are received in order, none is lost
+    assert(state->taken_count < state->expected_count);
+    struct barrier *barrier = &state->expected[state->taken_count++];
+    assert(msg.type == barrier->type);
+    if (msg.type == CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT) {
+        assert((int) msg.inject_touch_event.action == barrier->action);
+    } else {
+        assert((int) msg.inject_keycode.action == barrier->action);
+    }
+
+    // the latest positions before the barrier have been received before it,
+    // and no position pushed after it
+    for (unsigned i = 0; i < POINTER_COUNT; ++i) {
+        assert(state->taken_x[i] == barrier->last_x[i]);
+    }
+
+    return true;
+}
+
+static void test_flood_moves(void) {
+    struct controller controller;
+    bool ok = controller_init(&controller, SC_SOCKET_NONE, NULL);
+    assert(ok);
+
+    static struct state state;
+    memset(&state, 0, sizeof(state));
+
+    bool pressed = false;
+    for (int32_t t = 1; t <= EVENTS_PER_SECOND; ++t) {
+        push_touch(&controller, &state, AMOTION_EVENT_ACTION_MOVE, 0, t);
+        if (t % 2) {
+            push_touch(&controller, &state, AMOTION_EVENT_ACTION_MOVE, 1, t);
+        }
+
+        if (t % CLICK_PERIOD == 0) {
+            enum android_motionevent_action action =
+                pressed ? AMOTION_EVENT_ACTION_UP : AMOTION_EVENT_ACTION_DOWN;
+            push_touch(&controller, &state, action, 0, t);
+            pressed = !pressed;
+        }
+
+        if (t % KEY_PERIOD == 0) {
+            push_key(&controller, &state);
+        }
+
+        if (t % TAKE_PERIOD == 0) {
+            take(&controller, &state);
+        }
+    }
+
+    while (take(&controller, &state)) {
+        // drain
+    }
+
+    assert(state.taken_count == state.expected_count);
+    assert(state.expected_count == MAX_BARRIERS);
+    // the last positions are not lost
+    assert(state.taken_x[0] == EVENTS_PER_SECOND);
+    assert(state.taken_x[1] == EVENTS_PER_SECOND - 1);
+    // the moves have been coalesced
+    assert(state.moves_taken < EVENTS_PER_SECOND);
+
+    controller_destroy(&controller);
+}
+
+static void test_no_coalescing_across_other_msgs(void) {
+    struct controller controller;
+    bool ok = controller_init(&controller, SC_SOCKET_NONE, NULL);
+    assert(ok);
+
+    static struct state state;
+    memset(&state, 0, sizeof(state));
+
+    push_touch(&controller, &state, AMOTION_EVENT_ACTION_MOVE, 0, 1);
+    push_touch(&controller, &state, AMOTION_EVENT_ACTION_MOVE, 1, 1);
+    push_touch(&controller, &state, AMOTION_EVENT_ACTION_MOVE, 0, 2);
+    push_touch(&controller, &state, AMOTION_EVENT_ACTION_DOWN, 0, 2);
+    push_touch(&controller, &state, AMOTION_EVENT_ACTION_MOVE, 0, 3);
+    push_key(&controller, &state);
+    push_touch(&controller, &state, AMOTION_EVENT_ACTION_MOVE, 0, 4);
+    push_touch(&controller, &state, AMOTION_EVENT_ACTION_MOVE, 0, 5);
+
+    // MOVE(0, 2), MOVE(1, 1), DOWN, MOVE(0, 3), KEY, MOVE(0, 5)
+    unsigned count = 0;
+    while (take(&controller, &state)) {
+        ++count;
+    }
+    assert(count == 6);
+    assert(state.moves_taken == 4);
+    assert(state.taken_x[0] == 5);
+
+    controller_destroy(&controller);
+}
+
+#ifndef __WINDOWS__
+static void test_batched_send(void) {
+    int sockets[2];
+    int r = socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+    assert(!r);
+    (void) r;
+
+    struct controller controller;
+    bool ok = controller_init(&controller, sockets[0], NULL);
+    assert(ok);
+
+    // Fill the queue before starting the controller
+    static unsigned char expected[CONTROLLER_QUEUE_SIZE * 32];
+    size_t expected_len = 0;
+    static unsigned char serialized[CONTROL_MSG_MAX_SIZE];
+    for (int i = 0; i < CONTROLLER_QUEUE_SIZE; ++i) {
+        struct control_msg msg = {
+            .type = CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT,
+            .inject_touch_event = {
+                // DOWN events are never coalesced
+                .action = AMOTION_EVENT_ACTION_DOWN,
+                .pointer_id = i,
+                .position = {
+                    .screen_size = {1920, 1080},
+                    .point = {i, i},
+                },
+                .pressure = 1.f,
+            },
+        };
+        ok = controller_push_msg(&controller, &msg);
+        assert(ok);
+
+        size_t len = control_msg_serialize(&msg, serialized);
+        assert(expected_len + len <= sizeof(expected));
+        memcpy(&expected[expected_len], serialized, len);
+        expected_len += len;
+    }
+
+    ok = controller_start(&controller);
+    assert(ok);
+
+    unsigned char *received = malloc(expected_len);
+    assert(received);
+    ssize_t w = net_recv_all(sockets[1], received, expected_len);
+    assert((size_t) w == expected_len);
+    assert(!memcmp(received, expected, expected_len));
+    free(received);
+
+    controller_stop(&controller);
+    net_interrupt(sockets[0]);
+    controller_join(&controller);
+
+    // All the pending messages have been sent with a single write
+    assert(controller.msg_count == CONTROLLER_QUEUE_SIZE);
+    assert(controller.send_count == 1);
+
+    controller_destroy(&controller);
+    net_close(sockets[0]);
+    net_close(sockets[1]);
+}
+
+#define SEQUENCE_COUNT 4
+#define SEQUENCE_DELAY SC_TICK_FROM_MS(35)
+
+struct received_msg {
+    struct control_msg msg;
+    sc_tick time;
+};
+
+static void push_touch_event(struct controller *controller,
+                             enum android_motionevent_action action,
+                             uint64_t pointer_id) {
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT,
+        .inject_touch_event = {
+            .action = action,
+            .pointer_id = pointer_id,
+            .position = {
+                .screen_size = {1920, 1080},
+                .point = {100, 100},
+            },
+            .pressure = 1.f,
+        },
+    };
+    bool ok = controller_push_msg(controller, &msg);
+    assert(ok);
+    (void) ok;
+}
+
+static void test_scheduled_sequences(void) {
+    int sockets[2];
+    int r = socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+    assert(!r);
+    (void) r;
+
+    struct controller controller;
+    bool ok = controller_init(&controller, sockets[0], NULL);
+    assert(ok);
+
+    ok = controller_start(&controller);
+    assert(ok);
+
+    // Push the sequences like the event loop would do: DOWN, then MOVE and UP
+    // at least SEQUENCE_DELAY later
+    sc_tick max_latency = 0;
+    for (uint64_t pointer_id = 1; pointer_id <= SEQUENCE_COUNT; ++pointer_id) {
+        sc_tick start = sc_tick_now_precise();
+        push_touch_event(&controller, AMOTION_EVENT_ACTION_DOWN, pointer_id);
+        controller_hold_pointer(&controller, pointer_id,
+                                sc_tick_now() + SEQUENCE_DELAY);
+        push_touch_event(&controller, AMOTION_EVENT_ACTION_MOVE, pointer_id);
+        push_touch_event(&controller, AMOTION_EVENT_ACTION_UP, pointer_id);
+        sc_tick latency = sc_tick_now_precise() - start;
+        if (latency > max_latency) {
+            max_latency = latency;
+        }
+    }
+
+    // Other messages are not delayed by the sequences
+    struct control_msg key = {
+        .type = CONTROL_MSG_TYPE_INJECT_KEYCODE,
+        .inject_keycode = {
+            .action = AKEY_EVENT_ACTION_DOWN,
+            .keycode = AKEYCODE_ENTER,
+        },
+    };
+    ok = controller_push_msg(&controller, &key);
+    assert(ok);
+
+    // The event loop is never blocked while the sequences run
+    assert(max_latency < SC_TICK_FROM_MS(1));
+
+    static struct received_msg received[3 * SEQUENCE_COUNT + 1];
+    size_t count = 0;
+    unsigned char buf[CONTROL_MSG_MAX_SIZE];
+    size_t len = 0;
+    while (count < ARRAY_LEN(received)) {
+        ssize_t n = net_recv(sockets[1], &buf[len], sizeof(buf) - len);
+        assert(n > 0);
+        sc_tick now = sc_tick_now_precise();
+        len += n;
+
+        ssize_t consumed;
+        while (count < ARRAY_LEN(received)
+                && (consumed = control_msg_deserialize(buf, len,
+                                                       &received[count].msg))) {
+            assert(consumed > 0);
+            received[count++].time = now;
+            memmove(buf, &buf[consumed], len - consumed);
+            len -= consumed;
+        }
+    }
+    // no unexpected message
+    assert(!len);
+
+    // All the DOWN events and the key are received first
+    for (size_t i = 0; i < SEQUENCE_COUNT; ++i) {
+        assert(received[i].msg.type == CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT);
+        assert(received[i].msg.inject_touch_event.action
+                == AMOTION_EVENT_ACTION_DOWN);
+    }
+    assert(received[SEQUENCE_COUNT].msg.type
+            == CONTROL_MSG_TYPE_INJECT_KEYCODE);
+
+    // Then the MOVE and UP events of each pointer, in order
+    for (size_t i = 0; i < SEQUENCE_COUNT; ++i) {
+        const struct received_msg *down = &received[i];
+        const struct received_msg *move = &received[SEQUENCE_COUNT + 1 + 2 * i];
+        const struct received_msg *up = &received[SEQUENCE_COUNT + 2 + 2 * i];
+        uint64_t pointer_id = down->msg.inject_touch_event.pointer_id;
+        assert(move->msg.inject_touch_event.action
+                == AMOTION_EVENT_ACTION_MOVE);
+        assert(move->msg.inject_touch_event.pointer_id == pointer_id);
+        assert(up->msg.inject_touch_event.action == AMOTION_EVENT_ACTION_UP);
+        assert(up->msg.inject_touch_event.pointer_id == pointer_id);
+        // sc_tick_now() has a millisecond resolution
+        assert(move->time - down->time
+                >= SEQUENCE_DELAY - SC_TICK_FROM_MS(1));
+    }
+
+    controller_stop(&controller);
+    net_interrupt(sockets[0]);
+    controller_join(&controller);
+    controller_destroy(&controller);
+    net_close(sockets[0]);
+    net_close(sockets[1]);
+}
+
+#define STALL_TEXT_LENGTH (1 << 16)
+
+static void sleep_ms(unsigned ms) {
+    struct timespec ts = {
+        .tv_sec = ms / 1000,
+        .tv_nsec = (ms % 1000) * 1000000L,
+    };
+    nanosleep(&ts, NULL);
+}
+
+static void recv_msgs(sc_socket socket, struct control_msg *msgs,
+                      size_t count) {
+    static unsigned char buf[CONTROL_MSG_MAX_SIZE];
+    size_t len = 0;
+    size_t received = 0;
+    while (received < count) {
+        ssize_t n = net_recv(socket, &buf[len], sizeof(buf) - len);
+        assert(n > 0);
+        len += n;
+
+        ssize_t consumed;
+        while (received < count
+                && (consumed = control_msg_deserialize(buf, len,
+                                                       &msgs[received]))) {
+            assert(consumed > 0);
+            ++received;
+            memmove(buf, &buf[consumed], len - consumed);
+            len -= consumed;
+        }
+    }
+    // no unexpected message
+    assert(!len);
+}
+
+static void test_scheduled_after_stall(void) {
+    int sockets[2];
+    int r = socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+    assert(!r);
+
+    int sndbuf = 4096;
+    r = setsockopt(sockets[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    assert(!r);
+    (void) r;
+
+    struct controller controller;
+    bool ok = controller_init(&controller, sockets[0], NULL);
+    assert(ok);
+
+    ok = controller_start(&controller);
+    assert(ok);
+
+    // A message larger than the socket buffer: the controller thread is
+    // blocked on send until the peer reads it
+    char *text = malloc(STALL_TEXT_LENGTH + 1);
+    assert(text);
+    memset(text, 'a', STALL_TEXT_LENGTH);
+    text[STALL_TEXT_LENGTH] = '\0';
+    struct control_msg clipboard = {
+        .type = CONTROL_MSG_TYPE_SET_CLIPBOARD,
+        .set_clipboard = {
+            .sequence = 1,
+            .paste = false,
+        },
+    };
+    ok = control_msg_text_init(&clipboard.set_clipboard.text, text);
+    assert(ok);
+    free(text);
+    ok = controller_push_msg(&controller, &clipboard);
+    assert(ok);
+    sleep_ms(10);
+
+    // While the controller thread is blocked, the DOWN is pending and the UP
+    // is scheduled
+    push_touch_event(&controller, AMOTION_EVENT_ACTION_DOWN, 1);
+    controller_hold_pointer(&controller, 1,
+                            sc_tick_now() + SC_TICK_FROM_MS(5));
+    push_touch_event(&controller, AMOTION_EVENT_ACTION_UP, 1);
+
+    // Unblock the controller thread past the deadline of the UP
+    sleep_ms(30);
+
+    struct control_msg msgs[3];
+    recv_msgs(sockets[1], msgs, ARRAY_LEN(msgs));
+    assert(msgs[0].type == CONTROL_MSG_TYPE_SET_CLIPBOARD);
+    assert(strlen(control_msg_text_get(&msgs[0].set_clipboard.text))
+            == STALL_TEXT_LENGTH);
+    // The UP is never sent before its DOWN
+    assert(msgs[1].type == CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT);
+    assert(msgs[1].inject_touch_event.action == AMOTION_EVENT_ACTION_DOWN);
+    assert(msgs[2].type == CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT);
+    assert(msgs[2].inject_touch_event.action == AMOTION_EVENT_ACTION_UP);
+    for (size_t i = 0; i < ARRAY_LEN(msgs); ++i) {
+        control_msg_destroy(&msgs[i]);
+    }
+
+    controller_stop(&controller);
+    net_interrupt(sockets[0]);
+    controller_join(&controller);
+    controller_destroy(&controller);
+    net_close(sockets[0]);
+    net_close(sockets[1]);
+}
+#endif
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_flood_moves();
+    test_no_coalescing_across_other_msgs();
+#ifndef __WINDOWS__
+    test_batched_send();
+    test_scheduled_sequences();
+    test_scheduled_after_stall();
+#endif
+    return 0;
+}
@@ -61,6 +61,24 @@ static void test_deserialize_ack_set_clipboard(void) {
     assert(msg.ack_clipboard.sequence == UINT64_C(0x0102030405060708));
 }
 
+static void test_deserialize_pong(void) {
+    const unsigned char input[] = {
+        DEVICE_MSG_TYPE_PONG,
+        0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, // timestamp
+    };
+
+    struct device_msg msg;
+    // incomplete message
+    ssize_t r = device_msg_deserialize(input, 5, &msg);
+    assert(r == 0);
+
+    r = device_msg_deserialize(input, sizeof(input), &msg);
+    assert(r == 9);
+
+    assert(msg.type == DEVICE_MSG_TYPE_PONG);
+    assert(msg.pong.timestamp == UINT64_C(0x0102030405060708));
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
@@ -68,5 +86,6 @@ int main(int argc, char *argv[]) {
     test_deserialize_clipboard();
     test_deserialize_clipboard_big();
     test_deserialize_ack_set_clipboard();
+    test_deserialize_pong();
     return 0;
 }
@@ -0,0 +1,188 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <SDL2/SDL_timer.h>
+
+#include "controller.h"
+#include "input_record.h"
+#include "input_replay.h"
+
+#define RECORD_FILENAME "test_input_record.tmp"
+#define MOVE_COUNT 10
+#define MOVE_DELAY_MS 10
+#define MSG_COUNT (MOVE_COUNT + 2) // the moves, a DOWN and a text
+
+static void push_touch(struct controller *controller,
+                       enum android_motionevent_action action, int32_t x) {
+    struct control_msg msg = {
+        .type = CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT,
+        .inject_touch_event = {
+            .action = action,
+            .pointer_id = POINTER_ID_MOUSE,
+            .position = {
+                .screen_size = {1920, 1080},
+                .point = {x, 0},
+            },
+            .pressure = 1.f,
+        },
+    };
+
+    bool ok = controller_push_msg(controller, &msg);
+    assert(ok);
+    (void) ok;
+}
+
+static void drain(struct controller *controller) {
+    struct controller_msg cmsg;
+    while (cbuf_take(&controller->queue, &cmsg)) {
+        control_msg_destroy(&cmsg.msg);
+    }
+}
+
+static void record(void) {
+    struct controller controller;
+    bool ok = controller_init(&controller, SC_SOCKET_NONE, NULL);
+    assert(ok);
+
+    struct sc_input_recorder recorder;
+    ok = sc_input_recorder_open(&recorder, RECORD_FILENAME);
+    assert(ok);
+    controller_set_input_recorder(&controller, &recorder);
+
+    push_touch(&controller, AMOTION_EVENT_ACTION_DOWN, 0);
+    for (int i = 1; i <= MOVE_COUNT; ++i) {
+        SDL_Delay(MOVE_DELAY_MS);
+        push_touch(&controller, AMOTION_EVENT_ACTION_MOVE, i);
+        // the consumer is slower, the moves are coalesced in the queue (but
+        // all of them must be recorded)
+    }
+
+    struct control_msg msg;
+    msg.type = CONTROL_MSG_TYPE_INJECT_TEXT;
+    ok = control_msg_text_init(&msg.inject_text.text, "hello");
+    assert(ok);
+    ok = controller_push_msg(&controller, &msg);
+    assert(ok);
+
+    // pings are not recorded
+    msg.type = CONTROL_MSG_TYPE_PING;
+    msg.ping.timestamp = 42;
+    ok = controller_push_msg(&controller, &msg);
+    assert(ok);
+    (void) ok;
+
+    // a message which cannot be serialized is not recorded
+    size_t size = recorder.pending.size;
+    msg.type = (enum control_msg_type) 0xff;
+    sc_input_recorder_push(&recorder, &msg);
+    assert(recorder.pending.size == size);
+    (void) size;
+
+    controller_set_input_recorder(&controller, NULL);
+    assert(recorder.count == MSG_COUNT);
+    assert(!recorder.failed);
+    sc_input_recorder_close(&recorder);
+
+    drain(&controller);
+    controller_destroy(&controller);
+}
+
+static void test_read(void) {
+    struct sc_input_record_reader reader;
+    bool ok = sc_input_record_reader_open(&reader, RECORD_FILENAME);
+    assert(ok);
+    (void) ok;
+
+    struct control_msg msg;
+    sc_tick delay;
+    int r = sc_input_record_reader_next(&reader, &delay, &msg);
+    assert(r == 1);
+    assert(delay == 0); // the first message is not delayed
+    assert(msg.type == CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT);
+    assert(msg.inject_touch_event.action == AMOTION_EVENT_ACTION_DOWN);
+
+    for (int i = 1; i <= MOVE_COUNT; ++i) {
+        r = sc_input_record_reader_next(&reader, &delay, &msg);
+        assert(r == 1);
+        assert(delay >= SC_TICK_FROM_MS(MOVE_DELAY_MS));
+        assert(msg.type == CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT);
+        assert(msg.inject_touch_event.action == AMOTION_EVENT_ACTION_MOVE);
+        assert(msg.inject_touch_event.position.point.x == i);
+    }
+
+    r = sc_input_record_reader_next(&reader, &delay, &msg);
+    assert(r == 1);
+    assert(msg.type == CONTROL_MSG_TYPE_INJECT_TEXT);
+    assert(!strcmp(control_msg_text_get(&msg.inject_text.text), "hello"));
+    control_msg_destroy(&msg);
+
+    // end of file
+    r = sc_input_record_reader_next(&reader, &delay, &msg);
+    assert(r == 0);
+
+    sc_input_record_reader_close(&reader);
+}
+
+static void test_replay(float speed) {
+    struct controller controller;
+    bool ok = controller_init(&controller, SC_SOCKET_NONE, NULL);
+    assert(ok);
+
+    struct sc_input_replay replay;
+    ok = sc_input_replay_init(&replay, &controller, RECORD_FILENAME, speed);
+    assert(ok);
+
+    sc_tick start = sc_tick_now_precise();
+    ok = sc_input_replay_start(&replay);
+    assert(ok);
+    (void) ok;
+    sc_input_replay_join(&replay);
+    sc_tick duration = sc_tick_now_precise() - start;
+
+    assert(replay.count == MSG_COUNT);
+    if (speed) {
+        // the original timing is respected
+        sc_tick original = SC_TICK_FROM_MS(MOVE_COUNT * MOVE_DELAY_MS);
+        assert(duration >= (sc_tick) (original / speed));
+        // the deadlines are absolute, the error does not accumulate
+        assert(replay.max_error < SC_TICK_FROM_MS(MOVE_DELAY_MS));
+    }
+
+    // the controller thread is not started, so all the messages are still in
+    // the queue (except the coalesced moves)
+    struct controller_msg cmsg;
+    ok = cbuf_take(&controller.queue, &cmsg);
+    assert(ok);
+    assert(cmsg.msg.type == CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT);
+    assert(cmsg.msg.inject_touch_event.action == AMOTION_EVENT_ACTION_DOWN);
+
+    int32_t last_x = 0;
+    while (cbuf_take(&controller.queue, &cmsg)
+            && cmsg.msg.type == CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT) {
+        assert(cmsg.msg.inject_touch_event.position.point.x > last_x);
+        last_x = cmsg.msg.inject_touch_event.position.point.x;
+    }
+    assert(last_x == MOVE_COUNT);
+    assert(cmsg.msg.type == CONTROL_MSG_TYPE_INJECT_TEXT);
+    control_msg_destroy(&cmsg.msg);
+    assert(cbuf_is_empty(&controller.queue));
+
+    sc_input_replay_destroy(&replay);
+    controller_destroy(&controller);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    record();
+    test_read();
+    test_replay(1.f);
+    test_replay(2.f);
+    test_replay(0.f); // as fast as possible
+
+    remove(RECORD_FILENAME);
+    return 0;
+}
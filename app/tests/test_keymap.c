@@ -0,0 +1,128 @@
+#include "common.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "keymap.h"
+
+static void test_parse(void) {
+    const char *data =
+        "# comment\n"
+        "[first]\n"
+        "joystick = 0.25 0.75 0.2\n"
+        "camera = 0.5 0.5 1.5 0.75  # fire sensitivity\n"
+        "fire = 0.8 0.7\n"
+        "W = up\n"
+        "Escape = recenter\n"
+        "Left Shift = 0.5 0.25\n"
+        "\n"
+        "[ second ]\n"
+        "Space = 0.1 0.2\n";
+
+    struct sc_keymap keymap;
+    bool ok = sc_keymap_parse(&keymap, data);
+    assert(ok);
+    assert(keymap.count == 2);
+
+    const struct sc_keymap_profile *first = sc_keymap_find(&keymap, NULL);
+    assert(first == sc_keymap_find(&keymap, "first"));
+    assert(!strcmp(first->name, "first"));
+    assert(first->joystick.x == 0.25f);
+    assert(first->joystick.y == 0.75f);
+    assert(first->joystick_radius == 0.2f);
+    assert(first->camera_sensitivity == 1.5f);
+    assert(first->camera_fire_sensitivity == 0.75f);
+    assert(first->fire.x == 0.8f);
+
+    const struct sc_keymap_entry *entry =
+        sc_keymap_profile_get(first, SDL_SCANCODE_W);
+    assert(entry);
+    assert(entry->action == SC_KEYMAP_ACTION_JOYSTICK_UP);
+    assert(entry->pointer_id == SC_KEYMAP_POINTER_ID_JOYSTICK);
+
+    entry = sc_keymap_profile_get(first, SDL_SCANCODE_ESCAPE);
+    assert(entry);
+    assert(entry->action == SC_KEYMAP_ACTION_JOYSTICK_RECENTER);
+
+    entry = sc_keymap_profile_get(first, SDL_SCANCODE_LSHIFT);
+    assert(entry);
+    assert(entry->action == SC_KEYMAP_ACTION_TOUCH);
+    assert(entry->point.x == 0.5f);
+    assert(entry->point.y == 0.25f);
+    assert(entry->pointer_id >= SC_KEYMAP_POINTER_ID_FIRST_KEY);
+
+    // not mapped in this profile
+    assert(!sc_keymap_profile_get(first, SDL_SCANCODE_SPACE));
+    assert(!sc_keymap_profile_get(first, SDL_SCANCODE_UNKNOWN));
+
+    const struct sc_keymap_profile *second = sc_keymap_find(&keymap, "second");
+    assert(second);
+    assert(sc_keymap_profile_get(second, SDL_SCANCODE_SPACE));
+    assert(!sc_keymap_profile_get(second, SDL_SCANCODE_W));
+
+    assert(!sc_keymap_find(&keymap, "third"));
+
+    sc_keymap_destroy(&keymap);
+}
+
+static void test_parse_errors(void) {
+    const char *const invalid[] = {
+        "W = up\n", // outside of a profile
+        "[p]\nW = sideways\n",
+        "[p]\nW = 0.5\n",
+        "[p]\nW = 0.5 1.5\n", // not normalized
+        "[p]\nW = 0.5 0.5 0.5\n",
+        "[p]\nNotAKey = up\n",
+        "[p]\nW = up\nW = down\n",
+        "[p]\njoystick = 0.5 0.5\n", // missing radius
+        "[p]\n[p]\n",
+        "[p\n",
+        "# no profile\n",
+    };
+
+    for (size_t i = 0; i < ARRAY_LEN(invalid); ++i) {
+        struct sc_keymap keymap;
+        bool ok = sc_keymap_parse(&keymap, invalid[i]);
+        assert(!ok);
+        (void) ok;
+    }
+}
+
+static void test_default(void) {
+    struct sc_keymap keymap;
+    bool ok = sc_keymap_init_default(&keymap);
+    assert(ok);
+    assert(keymap.count == 1);
+
+    const struct sc_keymap_profile *profile = sc_keymap_find(&keymap, NULL);
+    assert(profile);
+
+    // the joystick center used to be hardcoded to (340, 865) on 2400x1080
+    struct sc_size size = {2400, 1080};
+    struct sc_point center = sc_keymap_point_to_frame(profile->joystick, size);
+    assert(center.x >= 339 && center.x <= 341);
+    assert(center.y >= 864 && center.y <= 866);
+
+    // the coordinates scale to any frame size
+    struct sc_size small = {1200, 540};
+    struct sc_point point = sc_keymap_point_to_frame(profile->joystick, small);
+    assert(point.x >= 169 && point.x <= 171);
+    assert(point.y >= 431 && point.y <= 433);
+
+    const struct sc_keymap_entry *entry =
+        sc_keymap_profile_get(profile, SDL_SCANCODE_SPACE);
+    assert(entry);
+    assert(entry->action == SC_KEYMAP_ACTION_TOUCH);
+
+    sc_keymap_destroy(&keymap);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_parse();
+    test_parse_errors();
+    test_default();
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include "common.h"
+
+#include <assert.h>
+#include <SDL2/SDL_timer.h>
+
+#include "device_msg.h"
+#include "latency_probe.h"
+
+#ifndef __WINDOWS__
+// Fake server, answering each ping with a pong after a delay
+struct fake_server {
+    sc_socket socket;
+    sc_thread thread;
+    unsigned delay_ms;
+    unsigned ping_count;
+};
+
+static int
+run_fake_server(void *data) {
+    struct fake_server *server = data;
+
+    for (;;) {
+        unsigned char buf[9];
+        ssize_t r = net_recv_all(server->socket, buf, sizeof(buf));
+        if (r != sizeof(buf)) {
+            // the client closed the connection
+            break;
+        }
+
+        // only pings are expected
+        assert(buf[0] == CONTROL_MSG_TYPE_PING);
+        ++server->ping_count;
+
+        if (server->delay_ms) {
+            SDL_Delay(server->delay_ms);
+        }
+
+        // echo the timestamp
+        buf[0] = DEVICE_MSG_TYPE_PONG;
+        ssize_t w = net_send_all(server->socket, buf, sizeof(buf));
+        if (w != sizeof(buf)) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+struct fixture {
+    sc_socket sockets[2];
+    struct controller controller;
+    struct fake_server server;
+};
+
+static void
+fixture_start(struct fixture *f, unsigned delay_ms) {
+    int sockets[2];
+    int r = socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+    assert(!r);
+    (void) r;
+    f->sockets[0] = sockets[0];
+    f->sockets[1] = sockets[1];
+
+    bool ok = controller_init(&f->controller, f->sockets[0], NULL);
+    assert(ok);
+    ok = controller_start(&f->controller);
+    assert(ok);
+
+    f->server.socket = f->sockets[1];
+    f->server.delay_ms = delay_ms;
+    f->server.ping_count = 0;
+    ok = sc_thread_create(&f->server.thread, run_fake_server, "fake server",
+                          &f->server);
+    assert(ok);
+    (void) ok;
+}
+
+static void
+fixture_stop(struct fixture *f) {
+    controller_stop(&f->controller);
+    net_interrupt(f->sockets[0]);
+    net_interrupt(f->sockets[1]);
+    controller_join(&f->controller);
+    sc_thread_join(&f->server.thread, NULL);
+    controller_destroy(&f->controller);
+    net_close(f->sockets[0]);
+    net_close(f->sockets[1]);
+}
+
+static unsigned
+rtt_sample_count(struct receiver *receiver) {
+    sc_mutex_lock(&receiver->mutex);
+    unsigned count = receiver->rtt_stats.count;
+    sc_mutex_unlock(&receiver->mutex);
+    return count;
+}
+
+static void test_ping_pong(void) {
+    static struct fixture f;
+    fixture_start(&f, 2);
+
+    for (int i = 0; i < 20; ++i) {
+        bool ok = sc_latency_probe_ping(&f.controller);
+        assert(ok);
+        (void) ok;
+    }
+
+    // wait for all the pongs (at least 40ms)
+    while (rtt_sample_count(&f.controller.receiver) < 20) {
+        SDL_Delay(1);
+    }
+
+    struct sc_rtt_percentiles p;
+    bool ok = receiver_take_rtt_percentiles(&f.controller.receiver, &p);
+    assert(ok);
+    (void) ok;
+    assert(p.count == 20);
+    // the fake server answers after 2ms
+    assert(p.min >= SC_TICK_FROM_MS(2));
+    assert(p.min <= p.p50);
+    assert(p.p50 <= p.p95);
+    assert(p.p95 <= p.p99);
+    assert(p.p99 <= p.max);
+
+    // the statistics have been reset
+    assert(!receiver_take_rtt_percentiles(&f.controller.receiver, &p));
+
+    fixture_stop(&f);
+    assert(f.server.ping_count == 20);
+}
+
+static void test_periodic_probe(void) {
+    static struct fixture f;
+    fixture_start(&f, 0);
+
+    struct sc_latency_probe probe;
+    bool ok = sc_latency_probe_init(&probe, &f.controller, SC_TICK_FROM_MS(5));
+    assert(ok);
+
+    ok = sc_latency_probe_start(&probe);
+    assert(ok);
+    assert(sc_latency_probe_is_started(&probe));
+
+    // 10 pings at least (the first one is sent immediately)
+    while (rtt_sample_count(&f.controller.receiver) < 10) {
+        SDL_Delay(1);
+    }
+
+    sc_latency_probe_stop(&probe);
+    assert(!sc_latency_probe_is_started(&probe));
+
+    sc_latency_probe_interrupt(&probe);
+    sc_latency_probe_join(&probe);
+    sc_latency_probe_destroy(&probe);
+
+    fixture_stop(&f);
+    assert(f.server.ping_count >= 10);
+}
+#endif
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+#ifndef __WINDOWS__
+    test_ping_pong();
+    test_periodic_probe();
+#endif
+    return 0;
+}
@@ -0,0 +1,463 @@
+#include "common.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "mux.h"
+#include "util/buffer_util.h"
+
+#ifndef __WINDOWS__
+
+#define VIDEO_LEN 100000
+#define CONTROL_LEN 3000
+
+static uint8_t
+video_byte(size_t i) {
+    return i * 7;
+}
+
+static uint8_t
+control_byte(size_t i) {
+    return 255 - i * 13;
+}
+
+static void
+send_frame(sc_socket socket, uint8_t channel, const uint8_t *data,
+           uint32_t len) {
+    uint8_t header[SC_MUX_HEADER_SIZE];
+    header[0] = channel;
+    buffer_write32be(&header[1], len);
+    ssize_t w = net_send_all(socket, header, sizeof(header));
+    assert(w == sizeof(header));
+    if (len) {
+        w = net_send_all(socket, data, len);
+        assert(w == (ssize_t) len);
+    }
+    (void) w;
+}
+
+// Behave like the device: send the video and the control streams, split into
+// frames of various sizes, interleaved
+static int
+run_fake_server(void *data) {
+    sc_socket socket = *(sc_socket *) data;
+
+    static uint8_t video[VIDEO_LEN];
+    static uint8_t control[CONTROL_LEN];
+    for (size_t i = 0; i < VIDEO_LEN; ++i) {
+        video[i] = video_byte(i);
+    }
+    for (size_t i = 0; i < CONTROL_LEN; ++i) {
+        control[i] = control_byte(i);
+    }
+
+    size_t video_sent = 0;
+    size_t control_sent = 0;
+    unsigned n = 0;
+    while (video_sent < VIDEO_LEN || control_sent < CONTROL_LEN) {
+        ++n;
+        if (video_sent < VIDEO_LEN) {
+            uint32_t len = (n * 997) % 5000 + 1;
+            if (len > VIDEO_LEN - video_sent) {
+                len = VIDEO_LEN - video_sent;
+            }
+            send_frame(socket, SC_MUX_CHANNEL_VIDEO, &video[video_sent], len);
+            video_sent += len;
+        }
+        if (control_sent < CONTROL_LEN && n % 3 == 0) {
+            uint32_t len = (n * 31) % 150 + 1;
+            if (len > CONTROL_LEN - control_sent) {
+                len = CONTROL_LEN - control_sent;
+            }
+            send_frame(socket, SC_MUX_CHANNEL_CONTROL, &control[control_sent],
+                       len);
+            control_sent += len;
+        }
+        if (n % 10 == 0) {
+            // empty frames are valid
+            send_frame(socket, SC_MUX_CHANNEL_CONTROL, NULL, 0);
+        }
+    }
+
+    // end of stream
+    net_interrupt(socket);
+    return 0;
+}
+
+static int
+run_video_receiver(void *data) {
+    struct sc_mux *mux = data;
+
+    static uint8_t buf[777];
+    size_t received = 0;
+    while (received < VIDEO_LEN) {
+        size_t len = sizeof(buf);
+        if (len > VIDEO_LEN - received) {
+            len = VIDEO_LEN - received;
+        }
+        ssize_t r = sc_mux_recv_all(mux, SC_MUX_CHANNEL_VIDEO, buf, len);
+        assert(r == (ssize_t) len);
+        for (size_t i = 0; i < len; ++i) {
+            assert(buf[i] == video_byte(received + i));
+        }
+        received += len;
+    }
+
+    ssize_t r = sc_mux_recv(mux, SC_MUX_CHANNEL_VIDEO, buf, sizeof(buf));
+    assert(r == -1);
+    (void) r;
+
+    return 0;
+}
+
+static void test_demux(void) {
+    int sockets[2];
+    int r = socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+    assert(!r);
+    (void) r;
+
+    struct sc_mux mux;
+    bool ok = sc_mux_init(&mux, sockets[0]);
+    assert(ok);
+
+    sc_thread server_thread;
+    ok = sc_thread_create(&server_thread, run_fake_server, "test-server",
+                          &sockets[1]);
+    assert(ok);
+
+    sc_thread video_thread;
+    ok = sc_thread_create(&video_thread, run_video_receiver, "test-video",
+                          &mux);
+    assert(ok);
+    (void) ok;
+
+    // receive the control stream from this thread, with partial reads
+    uint8_t buf[100];
+    size_t received = 0;
+    while (received < CONTROL_LEN) {
+        ssize_t len = sc_mux_recv(&mux, SC_MUX_CHANNEL_CONTROL, buf,
+                                  sizeof(buf));
+        assert(len > 0);
+        for (ssize_t i = 0; i < len; ++i) {
+            assert(buf[i] == control_byte(received + i));
+        }
+        received += len;
+    }
+    assert(received == CONTROL_LEN);
+
+    ssize_t len = sc_mux_recv(&mux, SC_MUX_CHANNEL_CONTROL, buf, sizeof(buf));
+    assert(len == -1);
+    (void) len;
+
+    sc_thread_join(&video_thread, NULL);
+    sc_thread_join(&server_thread, NULL);
+
+    sc_mux_destroy(&mux);
+    net_close(sockets[0]);
+    net_close(sockets[1]);
+}
+
+static void test_send(void) {
+    int sockets[2];
+    int r = socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+    assert(!r);
+    (void) r;
+
+    struct sc_mux mux;
+    bool ok = sc_mux_init(&mux, sockets[0]);
+    assert(ok);
+    (void) ok;
+
+    // small frame (sent at once) and large frame
+    static uint8_t large[1000];
+    for (size_t i = 0; i < sizeof(large); ++i) {
+        large[i] = i;
+    }
+    ssize_t w = sc_mux_send_all(&mux, SC_MUX_CHANNEL_CONTROL, "hello", 5);
+    assert(w == 5);
+    w = sc_mux_send_all(&mux, SC_MUX_CHANNEL_CONTROL, large, sizeof(large));
+    assert(w == sizeof(large));
+    (void) w;
+
+    uint8_t buf[SC_MUX_HEADER_SIZE + sizeof(large)];
+    ssize_t len = net_recv_all(sockets[1], buf, SC_MUX_HEADER_SIZE + 5);
+    assert(len == SC_MUX_HEADER_SIZE + 5);
+    assert(buf[0] == SC_MUX_CHANNEL_CONTROL);
+    assert(buffer_read32be(&buf[1]) == 5);
+    assert(!memcmp(&buf[SC_MUX_HEADER_SIZE], "hello", 5));
+
+    len = net_recv_all(sockets[1], buf, sizeof(buf));
+    assert(len == sizeof(buf));
+    assert(buf[0] == SC_MUX_CHANNEL_CONTROL);
+    assert(buffer_read32be(&buf[1]) == sizeof(large));
+    assert(!memcmp(&buf[SC_MUX_HEADER_SIZE], large, sizeof(large)));
+    (void) len;
+
+    sc_mux_destroy(&mux);
+    net_close(sockets[0]);
+    net_close(sockets[1]);
+}
+
+static int
+run_control_receiver(void *data) {
+    struct sc_mux *mux = data;
+
+    uint8_t buf[16];
+    ssize_t r = sc_mux_recv(mux, SC_MUX_CHANNEL_CONTROL, buf, sizeof(buf));
+    // interrupted while waiting for the video payload to be consumed
+    assert(r == -1);
+    (void) r;
+
+    return 0;
+}
+
+static void test_interrupt(void) {
+    int sockets[2];
+    int r = socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+    assert(!r);
+    (void) r;
+
+    struct sc_mux mux;
+    bool ok = sc_mux_init(&mux, sockets[0]);
+    assert(ok);
+
+    // a video payload that nobody reads
+    static const uint8_t video[10];
+    send_frame(sockets[1], SC_MUX_CHANNEL_VIDEO, video, sizeof(video));
+
+    sc_thread thread;
+    ok = sc_thread_create(&thread, run_control_receiver, "test-control",
+                          &mux);
+    assert(ok);
+    (void) ok;
+
+    sc_mux_interrupt(&mux);
+    sc_thread_join(&thread, NULL);
+
+    sc_mux_destroy(&mux);
+    net_close(sockets[0]);
+    net_close(sockets[1]);
+}
+
+static void test_invalid_channel(void) {
+    int sockets[2];
+    int r = socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+    assert(!r);
+    (void) r;
+
+    struct sc_mux mux;
+    bool ok = sc_mux_init(&mux, sockets[0]);
+    assert(ok);
+    (void) ok;
+
+    static const uint8_t data[4];
+    send_frame(sockets[1], 42, data, sizeof(data));
+
+    uint8_t buf[4];
+    ssize_t len = sc_mux_recv(&mux, SC_MUX_CHANNEL_VIDEO, buf, sizeof(buf));
+    assert(len == -1);
+    // the error is permanent
+    len = sc_mux_recv(&mux, SC_MUX_CHANNEL_CONTROL, buf, sizeof(buf));
+    assert(len == -1);
+    (void) len;
+
+    sc_mux_destroy(&mux);
+    net_close(sockets[0]);
+    net_close(sockets[1]);
+}
+
+struct resume_test {
+    sc_mutex mutex;
+    sc_cond cond;
+    // the device side of the sockets
+    sc_socket first_socket;
+    sc_socket new_socket;
+    bool fail_reconnect;
+};
+
+static sc_socket
+test_reconnect(struct sc_mux *mux, void *userdata) {
+    (void) mux;
+    struct resume_test *test = userdata;
+
+    if (test->fail_reconnect) {
+        return SC_SOCKET_NONE;
+    }
+
+    int sockets[2];
+    int r = socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+    assert(!r);
+    (void) r;
+
+    sc_mutex_lock(&test->mutex);
+    test->new_socket = sockets[1];
+    sc_cond_signal(&test->cond);
+    sc_mutex_unlock(&test->mutex);
+
+    return sockets[0];
+}
+
+static const struct sc_mux_callbacks test_mux_cbs = {
+    .reconnect = test_reconnect,
+};
+
+// Behave like a device losing the connection in the middle of a frame, then
+// streaming again over the new connection
+static int
+run_fake_server_resume(void *data) {
+    struct resume_test *test = data;
+
+    uint8_t header[SC_MUX_HEADER_SIZE];
+    header[0] = SC_MUX_CHANNEL_VIDEO;
+    buffer_write32be(&header[1], 100);
+    ssize_t w = net_send_all(test->first_socket, header, sizeof(header));
+    assert(w == sizeof(header));
+
+    uint8_t video[100];
+    for (size_t i = 0; i < sizeof(video); ++i) {
+        video[i] = video_byte(i);
+    }
+    // only a part of the payload
+    w = net_send_all(test->first_socket, video, 40);
+    assert(w == 40);
+    (void) w;
+
+    // connection lost
+    net_interrupt(test->first_socket);
+
+    sc_mutex_lock(&test->mutex);
+    while (test->new_socket == SC_SOCKET_NONE) {
+        sc_cond_wait(&test->cond, &test->mutex);
+    }
+    sc_socket socket = test->new_socket;
+    sc_mutex_unlock(&test->mutex);
+
+    // the new stream starts from scratch
+    for (size_t i = 0; i < sizeof(video); ++i) {
+        video[i] = video_byte(1000 + i);
+    }
+    send_frame(socket, SC_MUX_CHANNEL_VIDEO, video, 50);
+    send_frame(socket, SC_MUX_CHANNEL_CONTROL, (const uint8_t *) "ok", 2);
+
+    // the client is still able to send
+    uint8_t buf[SC_MUX_HEADER_SIZE + 5];
+    ssize_t r = net_recv_all(socket, buf, sizeof(buf));
+    assert(r == sizeof(buf));
+    assert(buf[0] == SC_MUX_CHANNEL_CONTROL);
+    assert(buffer_read32be(&buf[1]) == 5);
+    assert(!memcmp(&buf[SC_MUX_HEADER_SIZE], "hello", 5));
+    (void) r;
+
+    return 0;
+}
+
+static void test_resume(void) {
+    int sockets[2];
+    int r = socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+    assert(!r);
+    (void) r;
+
+    struct resume_test test = {
+        .first_socket = sockets[1],
+        .new_socket = SC_SOCKET_NONE,
+        .fail_reconnect = false,
+    };
+    bool ok = sc_mutex_init(&test.mutex);
+    assert(ok);
+    ok = sc_cond_init(&test.cond);
+    assert(ok);
+
+    struct sc_mux mux;
+    ok = sc_mux_init(&mux, sockets[0]);
+    assert(ok);
+    sc_mux_set_callbacks(&mux, &test_mux_cbs, &test);
+
+    sc_thread server_thread;
+    ok = sc_thread_create(&server_thread, run_fake_server_resume, "test-server",
+                          &test);
+    assert(ok);
+    (void) ok;
+
+    // the truncated packet is discarded
+    uint8_t buf[100];
+    ssize_t len = sc_mux_recv_all(&mux, SC_MUX_CHANNEL_VIDEO, buf, 100);
+    assert(len == SC_MUX_RESUMED);
+
+    len = sc_mux_recv_all(&mux, SC_MUX_CHANNEL_VIDEO, buf, 50);
+    assert(len == 50);
+    for (size_t i = 0; i < 50; ++i) {
+        assert(buf[i] == video_byte(1000 + i));
+    }
+
+    // the receiver of the other channel is notified as well
+    len = sc_mux_recv(&mux, SC_MUX_CHANNEL_CONTROL, buf, sizeof(buf));
+    assert(len == SC_MUX_RESUMED);
+    len = sc_mux_recv_all(&mux, SC_MUX_CHANNEL_CONTROL, buf, 2);
+    assert(len == 2);
+    assert(!memcmp(buf, "ok", 2));
+
+    ssize_t w = sc_mux_send_all(&mux, SC_MUX_CHANNEL_CONTROL, "hello", 5);
+    assert(w == 5);
+    (void) w;
+    (void) len;
+
+    sc_thread_join(&server_thread, NULL);
+
+    // closes the client side of the new connection
+    sc_mux_destroy(&mux);
+    net_close(test.new_socket);
+    net_close(sockets[0]);
+    net_close(sockets[1]);
+    sc_cond_destroy(&test.cond);
+    sc_mutex_destroy(&test.mutex);
+}
+
+static void test_resume_failed(void) {
+    int sockets[2];
+    int r = socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+    assert(!r);
+    (void) r;
+
+    struct resume_test test = {
+        .fail_reconnect = true,
+    };
+
+    struct sc_mux mux;
+    bool ok = sc_mux_init(&mux, sockets[0]);
+    assert(ok);
+    (void) ok;
+    sc_mux_set_callbacks(&mux, &test_mux_cbs, &test);
+
+    net_interrupt(sockets[1]);
+
+    uint8_t buf[4];
+    ssize_t len = sc_mux_recv(&mux, SC_MUX_CHANNEL_VIDEO, buf, sizeof(buf));
+    assert(len == -1);
+    // the error is permanent
+    len = sc_mux_recv(&mux, SC_MUX_CHANNEL_CONTROL, buf, sizeof(buf));
+    assert(len == -1);
+    ssize_t w = sc_mux_send_all(&mux, SC_MUX_CHANNEL_CONTROL, "hello", 5);
+    assert(w == -1);
+    (void) len;
+    (void) w;
+
+    sc_mux_destroy(&mux);
+    net_close(sockets[0]);
+    net_close(sockets[1]);
+}
+#endif
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+#ifndef __WINDOWS__
+    test_demux();
+    test_send();
+    test_interrupt();
+    test_invalid_channel();
+    test_resume();
+    test_resume_failed();
+#endif
+    return 0;
+}
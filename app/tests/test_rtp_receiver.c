@@ -0,0 +1,484 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "rtp_receiver.h"
+#include "util/buffer_util.h"
+#include "util/net.h"
+
+#ifndef __WINDOWS__
+
+# include <sys/socket.h>
+
+// 100 fps, so that the PTS are integral in microseconds
+#define FRAME_INTERVAL SC_TICK_FROM_MS(10)
+#define FRAME_TIMESTAMP_STEP 900 // 90kHz
+#define GOP 60 // periodic key frames
+#define REORDER_DELAY SC_TICK_FROM_MS(30)
+
+#define MAX_FRAME_SIZE 0x8000
+#define QUEUE_CAPACITY 512
+
+struct datagram {
+    uint8_t data[SC_RTP_MAX_DATAGRAM_LENGTH];
+    size_t len;
+    sc_tick delivery;
+};
+
+// Loss and reorder simulator, delivering the datagrams over a loopback socket
+struct sim {
+    uint32_t rand;
+    unsigned loss; // per thousand
+    unsigned drop_every; // drop every Nth datagram (0 to disable)
+    unsigned reorder; // per thousand
+    sc_tick latency;
+    sc_tick reorder_extra_delay;
+
+    // in flight, sorted by delivery time
+    struct datagram queue[QUEUE_CAPACITY];
+    unsigned count;
+
+    int sockets[2];
+
+    uint64_t sent;
+    uint64_t dropped;
+    uint64_t reordered;
+};
+
+// Mirror of the device packetizer (RtpPacketizer.java)
+struct packetizer {
+    struct sim *sim;
+    unsigned fec_group_size; // 0 to disable FEC
+    uint16_t seq;
+    uint16_t fec_seq;
+    uint32_t timestamp;
+
+    uint16_t fec_base_seq;
+    unsigned fec_count;
+    size_t fec_block_len;
+    uint8_t fec[SC_RTP_MAX_DATAGRAM_LENGTH];
+    uint8_t packet[SC_RTP_MAX_DATAGRAM_LENGTH];
+};
+
+static void
+sim_init(struct sim *sim) {
+    memset(sim, 0, sizeof(*sim));
+    sim->rand = 42;
+    sim->latency = SC_TICK_FROM_MS(2);
+    sim->reorder_extra_delay = SC_TICK_FROM_MS(5);
+    int r = socketpair(AF_UNIX, SOCK_DGRAM, 0, sim->sockets);
+    assert(!r);
+    (void) r;
+}
+
+static void
+sim_destroy(struct sim *sim) {
+    net_close(sim->sockets[0]);
+    net_close(sim->sockets[1]);
+}
+
+static unsigned
+sim_rand(struct sim *sim) {
+    // deterministic LCG
+    sim->rand = sim->rand * 1103515245 + 12345;
+    return (sim->rand >> 16) & 0x7FFF;
+}
+
+static void
+sim_send(struct sim *sim, const uint8_t *data, size_t len, sc_tick now) {
+    ++sim->sent;
+    if ((sim->drop_every && sim->sent % sim->drop_every == 0)
+            || sim_rand(sim) % 1000 < sim->loss) {
+        ++sim->dropped;
+        return;
+    }
+
+    sc_tick delivery = now + sim->latency;
+    if (sim_rand(sim) % 1000 < sim->reorder) {
+        delivery += sim->reorder_extra_delay;
+        ++sim->reordered;
+    }
+
+    assert(sim->count < QUEUE_CAPACITY);
+    unsigned i = sim->count;
+    while (i && sim->queue[i - 1].delivery > delivery) {
+        sim->queue[i] = sim->queue[i - 1];
+        --i;
+    }
+    memcpy(sim->queue[i].data, data, len);
+    sim->queue[i].len = len;
+    sim->queue[i].delivery = delivery;
+    ++sim->count;
+}
+
+static void
+sim_deliver(struct sim *sim, sc_tick now, struct sc_rtp_receiver *rr) {
+    unsigned n = 0;
+    while (n < sim->count && sim->queue[n].delivery <= now) {
+        struct datagram *d = &sim->queue[n];
+        ssize_t w = net_send(sim->sockets[0], d->data, d->len);
+        assert(w == (ssize_t) d->len);
+        (void) w;
+
+        uint8_t buf[SC_RTP_MAX_DATAGRAM_LENGTH];
+        ssize_t r = net_recv(sim->sockets[1], buf, sizeof(buf));
+        assert(r == (ssize_t) d->len);
+
+        sc_rtp_receiver_push(rr, buf, r);
+        ++n;
+    }
+
+    sim->count -= n;
+    memmove(sim->queue, &sim->queue[n], sim->count * sizeof(*sim->queue));
+}
+
+static void
+write_header(struct packetizer *p, uint8_t *buf, uint8_t payload_type,
+             bool marker, uint16_t seq) {
+    buf[0] = 0x80;
+    buf[1] = marker ? 0x80 | payload_type : payload_type;
+    buffer_write16be(&buf[2], seq);
+    buffer_write32be(&buf[4], p->timestamp);
+    buffer_write32be(&buf[8], 0x12345678);
+}
+
+static void
+packetizer_flush_fec(struct packetizer *p, sc_tick now) {
+    if (!p->fec_count) {
+        return;
+    }
+
+    write_header(p, p->fec, SC_RTP_PAYLOAD_TYPE_FEC, false, p->fec_seq++);
+    buffer_write16be(&p->fec[SC_RTP_HEADER_LENGTH], p->fec_base_seq);
+    p->fec[SC_RTP_HEADER_LENGTH + 2] = p->fec_count;
+    p->fec[SC_RTP_HEADER_LENGTH + 3] = 0;
+    size_t len = SC_RTP_HEADER_LENGTH + SC_RTP_FEC_HEADER_LENGTH
+               + p->fec_block_len;
+    p->fec_count = 0;
+
+    sim_send(p->sim, p->fec, len, now);
+}
+
+static void
+packetizer_send_media(struct packetizer *p, size_t payload_len, bool marker,
+                      sc_tick now) {
+    write_header(p, p->packet, SC_RTP_PAYLOAD_TYPE_H264, marker, p->seq);
+
+    if (p->fec_group_size) {
+        if (!p->fec_count) {
+            p->fec_base_seq = p->seq;
+            p->fec_block_len = 0;
+            memset(p->fec, 0, sizeof(p->fec));
+        }
+        uint8_t *block = &p->fec[SC_RTP_HEADER_LENGTH
+                                 + SC_RTP_FEC_HEADER_LENGTH];
+        block[0] ^= marker;
+        block[1] ^= payload_len >> 8;
+        block[2] ^= payload_len;
+        for (size_t i = 0; i < payload_len; ++i) {
+            block[SC_RTP_FEC_BLOCK_HEADER_LENGTH + i] ^=
+                p->packet[SC_RTP_HEADER_LENGTH + i];
+        }
+        size_t block_len = SC_RTP_FEC_BLOCK_HEADER_LENGTH + payload_len;
+        if (block_len > p->fec_block_len) {
+            p->fec_block_len = block_len;
+        }
+        ++p->fec_count;
+    }
+
+    ++p->seq;
+    sim_send(p->sim, p->packet, SC_RTP_HEADER_LENGTH + payload_len, now);
+
+    if (p->fec_count && p->fec_count == p->fec_group_size) {
+        packetizer_flush_fec(p, now);
+    }
+}
+
+// Packetize a buffer containing a single NAL unit (without start code)
+static void
+packetizer_send(struct packetizer *p, const uint8_t *nal, size_t len,
+                sc_tick now) {
+    uint8_t *payload = &p->packet[SC_RTP_HEADER_LENGTH];
+    if (len <= SC_RTP_MAX_PAYLOAD_LENGTH) {
+        memcpy(payload, nal, len);
+        packetizer_send_media(p, len, true, now);
+    } else {
+        // FU-A
+        size_t offset = 1;
+        while (offset < len) {
+            size_t chunk = len - offset;
+            if (chunk > SC_RTP_MAX_PAYLOAD_LENGTH - 2) {
+                chunk = SC_RTP_MAX_PAYLOAD_LENGTH - 2;
+            }
+            bool last = offset + chunk == len;
+            payload[0] = (nal[0] & 0xE0) | 28;
+            payload[1] = (nal[0] & 0x1F) | (offset == 1 ? 0x80 : 0)
+                                         | (last ? 0x40 : 0);
+            memcpy(&payload[2], &nal[offset], chunk);
+            packetizer_send_media(p, 2 + chunk, last, now);
+            offset += chunk;
+        }
+    }
+
+    packetizer_flush_fec(p, now);
+}
+
+static size_t
+build_config(uint8_t *nal) {
+    // a fake SPS
+    nal[0] = 0x67;
+    for (size_t i = 1; i < 20; ++i) {
+        nal[i] = i;
+    }
+    return 20;
+}
+
+static size_t
+build_frame(unsigned k, bool idr, uint8_t *nal) {
+    size_t len = idr ? 6000 : 1000 + (k * 379) % 3000;
+    nal[0] = idr ? 0x65 : 0x41;
+    for (size_t i = 1; i < len; ++i) {
+        // never 0, so that it contains no start code
+        nal[i] = 1 + (k * 31 + i) % 255;
+    }
+    return len;
+}
+
+struct result {
+    unsigned frames_sent;
+    unsigned frames_received; // excluding config packets
+    unsigned key_frame_requests;
+    struct sc_rtp_stats stats;
+};
+
+static void
+check_frame(const struct sc_rtp_frame *frame, const bool *sent_as_idr,
+            unsigned frame_count, int *last_k) {
+    static uint8_t expected[MAX_FRAME_SIZE];
+    memcpy(expected, "\0\0\0\1", 4);
+
+    size_t len;
+    if (frame->config) {
+        len = build_config(&expected[4]);
+    } else {
+        assert(frame->pts % 10000 == 0);
+        unsigned k = frame->pts / 10000;
+        assert(k < frame_count);
+        assert((int) k > *last_k);
+        *last_k = k;
+        len = build_frame(k, sent_as_idr[k], &expected[4]);
+    }
+
+    assert(frame->size == 4 + len);
+    assert(!memcmp(frame->data, expected, frame->size));
+}
+
+static void
+simulate(struct sim *sim, unsigned fec_group_size, unsigned frame_count,
+         struct result *result) {
+    struct sc_rtp_receiver rr;
+    bool ok = sc_rtp_receiver_init(&rr, REORDER_DELAY);
+    assert(ok);
+    (void) ok;
+
+    static struct packetizer p;
+    memset(&p, 0, sizeof(p));
+    p.sim = sim;
+    p.fec_group_size = fec_group_size;
+
+    static bool sent_as_idr[10000];
+    assert(frame_count <= 10000);
+
+    static uint8_t nal[MAX_FRAME_SIZE];
+
+    memset(result, 0, sizeof(*result));
+    int last_k = -1;
+    bool key_frame_requested = false;
+
+    // sc_tick 0 has a special meaning for the receiver
+    sc_tick start = SC_TICK_FROM_SEC(1);
+    // a few more intervals to drain the packets in flight
+    for (unsigned k = 0; k < frame_count + 10; ++k) {
+        sc_tick frame_time = start + k * FRAME_INTERVAL;
+
+        if (k < frame_count) {
+            // the device
+            p.timestamp = k * FRAME_TIMESTAMP_STEP;
+            bool idr = k % GOP == 0 || key_frame_requested;
+            key_frame_requested = false;
+            if (idr) {
+                // the config is sent again before each key frame
+                size_t len = build_config(nal);
+                packetizer_send(&p, nal, len, frame_time);
+            }
+            size_t len = build_frame(k, idr, nal);
+            packetizer_send(&p, nal, len, frame_time);
+            sent_as_idr[k] = idr;
+            ++result->frames_sent;
+        }
+
+        // the client, with a 1ms resolution
+        for (sc_tick t = frame_time; t < frame_time + FRAME_INTERVAL;
+                t += SC_TICK_FROM_MS(1)) {
+            sim_deliver(sim, t, &rr);
+
+            struct sc_rtp_frame frame;
+            while (sc_rtp_receiver_pop(&rr, t, &frame)) {
+                check_frame(&frame, sent_as_idr, frame_count, &last_k);
+                if (!frame.config) {
+                    ++result->frames_received;
+                }
+            }
+
+            if (sc_rtp_receiver_consume_key_frame_request(&rr, t)) {
+                // received by the device before its next frame
+                key_frame_requested = true;
+                ++result->key_frame_requests;
+            }
+        }
+    }
+
+    result->stats = rr.stats;
+    sc_rtp_receiver_destroy(&rr);
+}
+
+static void test_depacketize(void) {
+    struct sim sim;
+    sim_init(&sim);
+
+    struct result result;
+    simulate(&sim, 0, 200, &result);
+
+    // the key frames are fragmented (FU-A)
+    assert(result.frames_received == 200);
+    assert(result.stats.lost == 0);
+    assert(result.stats.dropped_frames == 0);
+    assert(result.key_frame_requests == 0);
+
+    sim_destroy(&sim);
+}
+
+static void test_reorder(void) {
+    struct sim sim;
+    sim_init(&sim);
+    sim.reorder = 100;
+
+    struct result result;
+    simulate(&sim, 10, 200, &result);
+
+    assert(sim.reordered > 0);
+    assert(result.frames_received == 200);
+    assert(result.stats.lost == 0);
+    assert(result.stats.late == 0);
+
+    sim_destroy(&sim);
+}
+
+static void test_fec_recovery(void) {
+    struct sim sim;
+    sim_init(&sim);
+    // never 2 losses among 11 consecutive datagrams (a FEC group with its
+    // FEC packet)
+    sim.drop_every = 13;
+
+    struct result result;
+    simulate(&sim, 10, 200, &result);
+
+    assert(sim.dropped > 0);
+    assert(result.stats.recovered > 0);
+    assert(result.frames_received == 200);
+    assert(result.stats.lost == 0);
+    assert(result.key_frame_requests == 0);
+
+    sim_destroy(&sim);
+}
+
+static void test_unrecoverable_loss(void) {
+    struct sim sim;
+    sim_init(&sim);
+    sim.drop_every = 13;
+
+    struct result result;
+    // without FEC
+    simulate(&sim, 0, 200, &result);
+
+    assert(result.stats.lost > 0);
+    assert(result.stats.dropped_frames > 0);
+    // the stream recovers from the requested key frames
+    assert(result.key_frame_requests > 0);
+    assert(result.frames_received > 0);
+    assert(result.frames_received < 200);
+
+    sim_destroy(&sim);
+}
+
+static void test_late_packets(void) {
+    struct sim sim;
+    sim_init(&sim);
+    sim.reorder = 50;
+    // longer than the reorder delay
+    sim.reorder_extra_delay = REORDER_DELAY * 2;
+
+    struct result result;
+    simulate(&sim, 0, 200, &result);
+
+    assert(result.stats.late > 0);
+    assert(result.stats.lost > 0);
+    assert(result.key_frame_requests > 0);
+
+    sim_destroy(&sim);
+}
+
+static void
+print_result(const char *name, const struct sim *sim,
+             const struct result *result) {
+    printf("%-9s %" PRIu64_ "/%" PRIu64_ " datagrams dropped, %" PRIu64_
+           " recovered, %" PRIu64_ " lost; %u/%u frames, %u key frame "
+           "requests\n", name, sim->dropped, sim->sent,
+           result->stats.recovered, result->stats.lost,
+           result->frames_received, result->frames_sent,
+           result->key_frame_requests);
+}
+
+// Compare the delivered frames with and without FEC on the same lossy link
+static void test_benchmark(void) {
+    struct result without_fec;
+    struct result with_fec;
+
+    struct sim sim;
+    sim_init(&sim);
+    sim.loss = 20;
+    sim.reorder = 50;
+    simulate(&sim, 0, 2000, &without_fec);
+    print_result("no FEC:", &sim, &without_fec);
+    sim_destroy(&sim);
+
+    sim_init(&sim);
+    sim.loss = 20;
+    sim.reorder = 50;
+    simulate(&sim, 10, 2000, &with_fec);
+    print_result("FEC 10:", &sim, &with_fec);
+    sim_destroy(&sim);
+
+    assert(with_fec.stats.recovered > 0);
+    assert(with_fec.frames_received > without_fec.frames_received);
+}
+
+#endif
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+#ifndef __WINDOWS__
+    test_depacketize();
+    test_reorder();
+    test_fec_recovery();
+    test_unrecoverable_loss();
+    test_late_packets();
+    test_benchmark();
+#endif
+    return 0;
+}
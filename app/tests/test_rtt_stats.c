@@ -0,0 +1,84 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "util/rtt_stats.h"
+
+static void test_rtt_stats_empty(void) {
+    struct sc_rtt_stats stats;
+    sc_rtt_stats_init(&stats);
+
+    struct sc_rtt_percentiles p;
+    bool ok = sc_rtt_stats_compute(&stats, &p);
+    assert(!ok);
+    (void) ok;
+}
+
+static void test_rtt_stats_percentiles(void) {
+    static struct sc_rtt_stats stats;
+    sc_rtt_stats_init(&stats);
+
+    // push in a non-sorted order
+    for (sc_tick i = 100; i > 0; --i) {
+        sc_rtt_stats_push(&stats, i);
+    }
+
+    struct sc_rtt_percentiles p;
+    bool ok = sc_rtt_stats_compute(&stats, &p);
+    assert(ok);
+    (void) ok;
+
+    assert(p.count == 100);
+    assert(p.min == 1);
+    assert(p.p50 == 50);
+    assert(p.p95 == 95);
+    assert(p.p99 == 99);
+    assert(p.max == 100);
+}
+
+static void test_rtt_stats_single(void) {
+    struct sc_rtt_stats stats;
+    sc_rtt_stats_init(&stats);
+    sc_rtt_stats_push(&stats, 42);
+
+    struct sc_rtt_percentiles p;
+    bool ok = sc_rtt_stats_compute(&stats, &p);
+    assert(ok);
+    (void) ok;
+
+    assert(p.count == 1);
+    assert(p.min == 42);
+    assert(p.p50 == 42);
+    assert(p.p99 == 42);
+    assert(p.max == 42);
+}
+
+static void test_rtt_stats_overflow(void) {
+    static struct sc_rtt_stats stats;
+    sc_rtt_stats_init(&stats);
+
+    // only the last SC_RTT_STATS_CAPACITY samples are kept
+    for (sc_tick i = 0; i < 3 * SC_RTT_STATS_CAPACITY; ++i) {
+        sc_rtt_stats_push(&stats, i);
+    }
+
+    struct sc_rtt_percentiles p;
+    bool ok = sc_rtt_stats_compute(&stats, &p);
+    assert(ok);
+    (void) ok;
+
+    assert(p.count == SC_RTT_STATS_CAPACITY);
+    assert(p.min == 2 * SC_RTT_STATS_CAPACITY);
+    assert(p.max == 3 * SC_RTT_STATS_CAPACITY - 1);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_rtt_stats_empty();
+    test_rtt_stats_percentiles();
+    test_rtt_stats_single();
+    test_rtt_stats_overflow();
+    return 0;
+}
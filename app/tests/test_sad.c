@@ -0,0 +1,84 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "util/sad.h"
+
+static uint64_t sad_ref(const uint8_t *a, const uint8_t *b, size_t len) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < len; ++i) {
+        sum += abs(a[i] - b[i]);
+    }
+    return sum;
+}
+
+static void test_sad_empty(void) {
+    uint8_t a[1] = {0};
+    uint8_t b[1] = {42};
+    assert(sc_sad(a, b, 0) == 0);
+}
+
+static void test_sad_extremes(void) {
+    uint8_t a[100];
+    uint8_t b[100];
+    for (int i = 0; i < 100; ++i) {
+        // alternate the sign of the difference
+        a[i] = i % 2 ? 0 : 255;
+        b[i] = i % 2 ? 255 : 0;
+    }
+
+    assert(sc_sad(a, b, 100) == 100 * 255);
+    assert(sc_sad(a, a, 100) == 0);
+}
+
+static void test_sad_random(void) {
+    uint8_t a[1027];
+    uint8_t b[1027];
+    srand(42);
+    for (size_t i = 0; i < sizeof(a); ++i) {
+        a[i] = rand();
+        b[i] = rand();
+    }
+
+    // all lengths and alignments, to cover the SIMD and scalar paths
+    for (size_t offset = 0; offset < 17; ++offset) {
+        for (size_t len = 0; len < 64; ++len) {
+            assert(sc_sad(a + offset, b + offset, len)
+                    == sad_ref(a + offset, b + offset, len));
+        }
+    }
+
+    assert(sc_sad(a, b, sizeof(a)) == sad_ref(a, b, sizeof(a)));
+}
+
+static void test_sad_plane(void) {
+    // 5x3 planes, with padding which must be ignored
+    uint8_t a[] = {
+        1, 2, 3, 4, 5, 99, 99, 99,
+        6, 7, 8, 9, 10, 99, 99, 99,
+        11, 12, 13, 14, 15, 99, 99, 99,
+    };
+    uint8_t b[] = {
+        2, 2, 3, 4, 5, 0,
+        6, 7, 0, 9, 10, 0,
+        11, 12, 13, 14, 20, 0,
+    };
+
+    uint64_t sad = sc_sad_plane(a, 8, b, 6, 5, 3);
+    assert(sad == 1 + 8 + 5);
+
+    // contiguous planes
+    assert(sc_sad_plane(b, 6, b, 6, 6, 3) == 0);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_sad_empty();
+    test_sad_extremes();
+    test_sad_random();
+    test_sad_plane();
+    return 0;
+}
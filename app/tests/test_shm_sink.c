@@ -0,0 +1,159 @@
+#include "common.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <libavutil/avutil.h>
+#include <libavutil/frame.h>
+
+#include "shm_sink.h"
+
+#define WIDTH 6
+#define HEIGHT 4
+#define PADDING 10
+
+static void init_frame(AVFrame *frame, uint8_t *y, uint8_t *u, uint8_t *v,
+                       uint8_t seed) {
+    memset(frame, 0, sizeof(*frame));
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = WIDTH;
+    frame->height = HEIGHT;
+    frame->pts = 1000 * seed;
+    frame->data[0] = y;
+    frame->data[1] = u;
+    frame->data[2] = v;
+    frame->linesize[0] = WIDTH + PADDING;
+    frame->linesize[1] = WIDTH / 2 + PADDING;
+    frame->linesize[2] = WIDTH / 2 + PADDING;
+
+    for (int row = 0; row < HEIGHT; ++row) {
+        for (int col = 0; col < WIDTH; ++col) {
+            y[row * frame->linesize[0] + col] = seed + row * WIDTH + col;
+        }
+    }
+    for (int row = 0; row < HEIGHT / 2; ++row) {
+        for (int col = 0; col < WIDTH / 2; ++col) {
+            u[row * frame->linesize[1] + col] = seed + 100 + col;
+            v[row * frame->linesize[2] + col] = seed + 200 + col;
+        }
+    }
+}
+
+static struct sc_shm_frame_header *map_shm(const char *name, size_t *size) {
+    int fd = shm_open(name, O_RDWR, 0);
+    assert(fd != -1);
+
+    struct stat st;
+    int r = fstat(fd, &st);
+    assert(!r);
+    (void) r;
+    *size = st.st_size;
+
+    void *map = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    assert(map != MAP_FAILED);
+    close(fd);
+    return map;
+}
+
+static void assert_slot(struct sc_shm_frame_header *header, uint64_t frame,
+                        uint8_t seed) {
+    struct sc_shm_frame_slot *slot =
+        &header->slots[(frame - 1) % header->slot_count];
+    assert(!(atomic_load(&slot->seq) & 1));
+    assert(slot->frame == frame);
+    assert(slot->pts == 1000 * seed);
+    assert(slot->format == SC_SHM_FRAME_FORMAT_I420);
+    assert(slot->width == WIDTH);
+    assert(slot->height == HEIGHT);
+    assert(slot->plane_count == 3);
+    assert(slot->publish_time_ns);
+
+    const uint8_t *data = (const uint8_t *) header + slot->data_offset;
+    const uint8_t *y = data + slot->plane_offsets[0];
+    const uint8_t *u = data + slot->plane_offsets[1];
+    const uint8_t *v = data + slot->plane_offsets[2];
+    for (int row = 0; row < HEIGHT; ++row) {
+        for (int col = 0; col < WIDTH; ++col) {
+            assert(y[row * slot->plane_linesizes[0] + col]
+                    == (uint8_t) (seed + row * WIDTH + col));
+        }
+    }
+    for (int row = 0; row < HEIGHT / 2; ++row) {
+        for (int col = 0; col < WIDTH / 2; ++col) {
+            assert(u[row * slot->plane_linesizes[1] + col] == seed + 100 + col);
+            assert(v[row * slot->plane_linesizes[2] + col] == seed + 200 + col);
+        }
+    }
+}
+
+static void test_publish_frames(void) {
+    char name[64];
+    snprintf(name, sizeof(name), "/scrcpy_test_shm_%d", (int) getpid());
+
+    struct sc_shm_sink ss;
+    struct sc_size size = {WIDTH, HEIGHT};
+    bool ok = sc_shm_sink_init(&ss, name, size);
+    assert(ok);
+
+    struct sc_frame_sink *sink = &ss.frame_sink;
+    ok = sink->ops->open(sink);
+    assert(ok);
+
+    size_t map_size;
+    struct sc_shm_frame_header *header = map_shm(name, &map_size);
+    assert(atomic_load(&header->magic) == SC_SHM_FRAME_MAGIC);
+    assert(header->version == SC_SHM_FRAME_VERSION);
+    assert(header->slot_count == SC_SHM_FRAME_SLOTS);
+    assert(atomic_load(&header->last_frame) == 0);
+
+    uint8_t y[(WIDTH + PADDING) * HEIGHT];
+    uint8_t u[(WIDTH / 2 + PADDING) * HEIGHT / 2];
+    uint8_t v[(WIDTH / 2 + PADDING) * HEIGHT / 2];
+    AVFrame frame;
+
+    // wrap around the ring
+    for (unsigned i = 1; i <= SC_SHM_FRAME_SLOTS + 2; ++i) {
+        uint32_t futex = atomic_load(&header->futex);
+        init_frame(&frame, y, u, v, i);
+        ok = sink->ops->push(sink, &frame);
+        assert(ok);
+        assert(atomic_load(&header->last_frame) == i);
+        assert(atomic_load(&header->futex) == futex + 1);
+        assert_slot(header, i, i);
+    }
+
+    // the previous frames are still readable
+    for (unsigned i = 3; i <= SC_SHM_FRAME_SLOTS + 2; ++i) {
+        assert_slot(header, i, i);
+    }
+
+    // unsupported formats are ignored
+    init_frame(&frame, y, u, v, 42);
+    frame.format = AV_PIX_FMT_RGB24;
+    ok = sink->ops->push(sink, &frame);
+    assert(ok);
+    assert(atomic_load(&header->last_frame) == SC_SHM_FRAME_SLOTS + 2);
+
+    sink->ops->close(sink);
+    sc_shm_sink_destroy(&ss);
+
+    // the mapping is still valid, but the writer is closed
+    assert(atomic_load(&header->closed));
+    munmap(header, map_size);
+
+    // the shared memory object has been removed
+    int fd = shm_open(name, O_RDONLY, 0);
+    assert(fd == -1);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_publish_frames();
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "stream_stats.h"
+
+#define FRAME_INTERVAL SC_TICK_FROM_MS(10)
+#define FRAME_SIZE 1000
+
+static void test_stream_stats_steady(void) {
+    struct sc_stream_stats stats;
+    sc_stream_stats_init(&stats, NULL, NULL, SC_TICK_FROM_MS(500));
+
+    struct control_msg msg;
+
+    // the config packet is counted in the throughput
+    bool report = sc_stream_stats_account(&stats, 30, -1, 1000000, &msg);
+    assert(!report);
+
+    unsigned reports = 0;
+    for (int i = 0; i < 200; ++i) {
+        int64_t pts = i * FRAME_INTERVAL;
+        // constant network delay
+        sc_tick now = 1000000 + pts + SC_TICK_FROM_MS(5);
+        report = sc_stream_stats_account(&stats, FRAME_SIZE, pts, now, &msg);
+        if (report) {
+            ++reports;
+            assert(msg.type == CONTROL_MSG_TYPE_STREAM_STATS);
+            // 1000 bytes every 10ms (the first report contains the config
+            // packet and one more frame)
+            assert(msg.stream_stats.throughput >= 100000);
+            assert(msg.stream_stats.throughput <= 103000);
+            assert(msg.stream_stats.queue_delay == 0);
+            assert(msg.stream_stats.jitter == 0);
+            assert(msg.stream_stats.skipped_frames == 0);
+        }
+    }
+
+    // 2 seconds
+    assert(reports == 3);
+}
+
+static void test_stream_stats_congestion(void) {
+    struct sc_stream_stats stats;
+    sc_stream_stats_init(&stats, NULL, NULL, SC_TICK_FROM_MS(500));
+
+    struct control_msg msg;
+    uint32_t last_queue_delay = 0;
+    uint32_t last_throughput = 0;
+    for (int i = 0; i < 300; ++i) {
+        int64_t pts = i * FRAME_INTERVAL;
+        sc_tick now = pts + SC_TICK_FROM_MS(5);
+        if (i >= 100) {
+            // the link is too slow: each frame waits 2ms more than the
+            // previous one in a queue
+            now += (i - 100) * SC_TICK_FROM_MS(2);
+        }
+        if (sc_stream_stats_account(&stats, FRAME_SIZE, pts, now, &msg)) {
+            last_queue_delay = msg.stream_stats.queue_delay;
+            last_throughput = msg.stream_stats.throughput;
+        }
+    }
+
+    // the frames received during the last report waited about 300ms
+    assert(last_queue_delay > SC_TICK_TO_US(SC_TICK_FROM_MS(250)));
+    // 1000 bytes every 12ms
+    assert(last_throughput > 80000 && last_throughput < 86000);
+}
+
+static void test_stream_stats_jitter(void) {
+    struct sc_stream_stats stats;
+    sc_stream_stats_init(&stats, NULL, NULL, SC_TICK_FROM_MS(500));
+
+    struct control_msg msg;
+    uint32_t last_jitter = 0;
+    for (int i = 0; i < 300; ++i) {
+        int64_t pts = i * FRAME_INTERVAL;
+        // one frame out of two is late by 4ms
+        sc_tick now = pts + SC_TICK_FROM_MS(5) + (i % 2) * SC_TICK_FROM_MS(4);
+        if (sc_stream_stats_account(&stats, FRAME_SIZE, pts, now, &msg)) {
+            last_jitter = msg.stream_stats.jitter;
+        }
+    }
+
+    // every arrival is about 2ms away from the estimated clock
+    assert(last_jitter > SC_TICK_TO_US(SC_TICK_FROM_MS(1)));
+    assert(last_jitter < SC_TICK_TO_US(SC_TICK_FROM_MS(3)));
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_stream_stats_steady();
+    test_stream_stats_congestion();
+    test_stream_stats_jitter();
+    return 0;
+}
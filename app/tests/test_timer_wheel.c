@@ -0,0 +1,111 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "util/timer_wheel.h"
+
+struct item {
+    struct sc_timer_wheel_entry entry;
+    int id;
+};
+
+// Expire the wheel at `now` and store the ids of the expired items
+static unsigned
+expire(struct sc_timer_wheel *wheel, sc_tick now, int *ids, unsigned max) {
+    unsigned count = 0;
+    struct sc_timer_wheel_entry *entry = sc_timer_wheel_expire(wheel, now);
+    while (entry) {
+        assert(count < max);
+        ids[count++] = container_of(entry, struct item, entry)->id;
+        entry = entry->next;
+    }
+    return count;
+}
+
+static void test_timer_wheel_order(void) {
+    struct sc_timer_wheel wheel;
+    sc_timer_wheel_init(&wheel, 1000, 10000);
+
+    struct item items[5] = {
+        {.id = 0}, {.id = 1}, {.id = 2}, {.id = 3}, {.id = 4},
+    };
+    sc_timer_wheel_add(&wheel, &items[0].entry, 15000);
+    sc_timer_wheel_add(&wheel, &items[1].entry, 12000);
+    sc_timer_wheel_add(&wheel, &items[2].entry, 15000);
+    sc_timer_wheel_add(&wheel, &items[3].entry, 5000); // in the past
+    sc_timer_wheel_add(&wheel, &items[4].entry, 12500);
+
+    sc_tick deadline;
+    bool ok = sc_timer_wheel_next_deadline(&wheel, &deadline);
+    assert(ok);
+    (void) ok;
+    assert(deadline == 5000);
+
+    int ids[5];
+    unsigned count = expire(&wheel, 10000, ids, 5);
+    assert(count == 1);
+    assert(ids[0] == 3);
+
+    // nothing expires between the deadlines
+    count = expire(&wheel, 11999, ids, 5);
+    assert(!count);
+
+    // 12500 is in the same slot as 12000, but expires later
+    count = expire(&wheel, 12000, ids, 5);
+    assert(count == 1);
+    assert(ids[0] == 1);
+
+    ok = sc_timer_wheel_next_deadline(&wheel, &deadline);
+    assert(ok);
+    assert(deadline == 12500);
+
+    // same deadlines are kept in insertion order
+    count = expire(&wheel, 20000, ids, 5);
+    assert(count == 3);
+    assert(ids[0] == 4);
+    assert(ids[1] == 0);
+    assert(ids[2] == 2);
+
+    assert(sc_timer_wheel_is_empty(&wheel));
+    ok = sc_timer_wheel_next_deadline(&wheel, &deadline);
+    assert(!ok);
+}
+
+static void test_timer_wheel_multiple_turns(void) {
+    struct sc_timer_wheel wheel;
+    sc_timer_wheel_init(&wheel, 1, 0);
+
+    // far after one turn of the wheel, in the same slot as the near one
+    struct item far = {.id = 1};
+    struct item near = {.id = 0};
+    sc_timer_wheel_add(&wheel, &far.entry, 3 * SC_TIMER_WHEEL_SLOTS + 10);
+    sc_timer_wheel_add(&wheel, &near.entry, 10);
+
+    int ids[2];
+    unsigned count = expire(&wheel, 10, ids, 2);
+    assert(count == 1);
+    assert(ids[0] == 0);
+
+    count = expire(&wheel, SC_TIMER_WHEEL_SLOTS + 10, ids, 2);
+    assert(!count);
+
+    // late by several turns: still expired in deadline order
+    struct item other = {.id = 2};
+    sc_timer_wheel_add(&wheel, &other.entry, 2 * SC_TIMER_WHEEL_SLOTS + 100);
+    count = expire(&wheel, 10 * SC_TIMER_WHEEL_SLOTS, ids, 2);
+    assert(count == 2);
+    assert(ids[0] == 2);
+    assert(ids[1] == 1);
+
+    assert(sc_timer_wheel_is_empty(&wheel));
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_timer_wheel_order();
+    test_timer_wheel_multiple_turns();
+    return 0;
+}
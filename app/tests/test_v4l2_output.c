@@ -0,0 +1,183 @@
+#include "common.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+
+#include "v4l2_output.h"
+
+#define WIDTH 6
+#define HEIGHT 4
+#define FRAME_SIZE (WIDTH * HEIGHT * 3 / 2)
+
+// Fill a YUV420 frame with padded lines (linesize > width)
+static void fill_padded_frame(uint8_t *y, uint8_t *u, uint8_t *v,
+                              int linesize[3]) {
+    linesize[0] = WIDTH + 10;
+    linesize[1] = WIDTH / 2 + 5;
+    linesize[2] = WIDTH / 2 + 5;
+
+    memset(y, 0xFF, linesize[0] * HEIGHT);
+    memset(u, 0xFF, linesize[1] * HEIGHT / 2);
+    memset(v, 0xFF, linesize[2] * HEIGHT / 2);
+
+    for (int row = 0; row < HEIGHT; ++row) {
+        for (int col = 0; col < WIDTH; ++col) {
+            y[row * linesize[0] + col] = row * WIDTH + col;
+        }
+    }
+    for (int row = 0; row < HEIGHT / 2; ++row) {
+        for (int col = 0; col < WIDTH / 2; ++col) {
+            u[row * linesize[1] + col] = 100 + row * WIDTH / 2 + col;
+            v[row * linesize[2] + col] = 200 + row * WIDTH / 2 + col;
+        }
+    }
+}
+
+static void assert_packed_frame(const uint8_t *frame) {
+    for (int i = 0; i < WIDTH * HEIGHT; ++i) {
+        assert(frame[i] == i);
+    }
+    const uint8_t *u = frame + WIDTH * HEIGHT;
+    const uint8_t *v = u + WIDTH * HEIGHT / 4;
+    for (int i = 0; i < WIDTH * HEIGHT / 4; ++i) {
+        assert(u[i] == 100 + i);
+        assert(v[i] == 200 + i);
+    }
+}
+
+static void test_write_padded_to_file(void) {
+    char path[] = "/tmp/scrcpy_test_v4l2_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd != -1);
+
+    struct sc_v4l2_output out;
+    bool ok = sc_v4l2_output_open(&out, path, WIDTH, HEIGHT,
+                                  V4L2_PIX_FMT_YUV420);
+    assert(ok);
+    assert(!out.streaming);
+    assert(out.sizeimage == FRAME_SIZE);
+
+    uint8_t y[(WIDTH + 10) * HEIGHT];
+    uint8_t u[(WIDTH / 2 + 5) * HEIGHT / 2];
+    uint8_t v[(WIDTH / 2 + 5) * HEIGHT / 2];
+    int linesize[3];
+    fill_padded_frame(y, u, v, linesize);
+
+    const uint8_t *data[3] = {y, u, v};
+    ok = sc_v4l2_output_write(&out, data, linesize);
+    assert(ok);
+    ok = sc_v4l2_output_write(&out, data, linesize);
+    assert(ok);
+
+    sc_v4l2_output_close(&out);
+
+    uint8_t frames[2 * FRAME_SIZE + 1];
+    ssize_t r = read(fd, frames, sizeof(frames));
+    assert(r == 2 * FRAME_SIZE);
+    assert_packed_frame(frames);
+    assert_packed_frame(frames + FRAME_SIZE);
+
+    close(fd);
+    unlink(path);
+}
+
+static void test_write_packed_to_pipe(void) {
+    int fds[2];
+    int r = pipe(fds);
+    assert(!r);
+
+    char path[64];
+    sprintf(path, "/proc/self/fd/%d", fds[1]);
+
+    struct sc_v4l2_output out;
+    bool ok = sc_v4l2_output_open(&out, path, WIDTH, HEIGHT,
+                                  V4L2_PIX_FMT_YUV420);
+    assert(ok);
+    assert(!out.streaming);
+
+    // planes contiguous in memory, with the exact output layout (single copy)
+    uint8_t frame[FRAME_SIZE];
+    for (int i = 0; i < FRAME_SIZE; ++i) {
+        frame[i] = i < WIDTH * HEIGHT ? i
+                 : i < WIDTH * HEIGHT * 5 / 4 ? 100 + i - WIDTH * HEIGHT
+                 : 200 + i - WIDTH * HEIGHT * 5 / 4;
+    }
+
+    const uint8_t *data[3] = {
+        frame,
+        frame + WIDTH * HEIGHT,
+        frame + WIDTH * HEIGHT * 5 / 4,
+    };
+    int linesize[3] = {WIDTH, WIDTH / 2, WIDTH / 2};
+    ok = sc_v4l2_output_write(&out, data, linesize);
+    assert(ok);
+
+    sc_v4l2_output_close(&out);
+    close(fds[1]);
+
+    uint8_t result[FRAME_SIZE + 1];
+    ssize_t len = read(fds[0], result, sizeof(result));
+    assert(len == FRAME_SIZE);
+    assert_packed_frame(result);
+
+    close(fds[0]);
+}
+
+static void test_packed_formats_layout(void) {
+    char path[] = "/tmp/scrcpy_test_v4l2_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd != -1);
+
+    struct sc_v4l2_output out;
+    bool ok = sc_v4l2_output_open(&out, path, WIDTH, HEIGHT,
+                                  V4L2_PIX_FMT_YUYV);
+    assert(ok);
+    assert(out.plane_count == 1);
+    assert(out.plane_linesizes[0] == WIDTH * 2);
+    assert(out.sizeimage == WIDTH * HEIGHT * 2);
+
+    uint8_t *buffer = sc_v4l2_output_acquire(&out);
+    assert(buffer);
+    uint8_t *data[3];
+    int linesize[3];
+    sc_v4l2_output_get_planes(&out, buffer, data, linesize);
+    assert(data[0] == buffer);
+    assert(linesize[0] == WIDTH * 2);
+    memset(buffer, 42, out.sizeimage);
+    ok = sc_v4l2_output_submit(&out);
+    assert(ok);
+    sc_v4l2_output_close(&out);
+
+    uint8_t frame[WIDTH * HEIGHT * 2 + 1];
+    ssize_t r = read(fd, frame, sizeof(frame));
+    assert(r == WIDTH * HEIGHT * 2);
+    assert(frame[0] == 42 && frame[r - 1] == 42);
+
+    ok = sc_v4l2_output_open(&out, path, WIDTH, HEIGHT, V4L2_PIX_FMT_NV12);
+    assert(ok);
+    assert(out.plane_count == 2);
+    assert(out.plane_offsets[1] == WIDTH * HEIGHT);
+    assert(out.plane_linesizes[1] == WIDTH);
+    assert(out.plane_row_sizes[1] == WIDTH);
+    assert(out.plane_heights[1] == HEIGHT / 2);
+    assert(out.sizeimage == FRAME_SIZE);
+    sc_v4l2_output_close(&out);
+
+    close(fd);
+    unlink(path);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_write_padded_to_file();
+    test_write_packed_to_pipe();
+    test_packed_formats_layout();
+    return 0;
+}
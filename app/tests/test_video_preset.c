@@ -0,0 +1,63 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "video_preset.h"
+
+static void test_video_preset_find(void) {
+    assert(sc_video_presets[sc_video_preset_find(720)].max_size == 720);
+    assert(sc_video_presets[sc_video_preset_find(1280)].max_size == 1280);
+    // the resolution is not decreased
+    assert(sc_video_presets[sc_video_preset_find(800)].max_size == 1024);
+    assert(sc_video_presets[sc_video_preset_find(2400)].max_size == 0);
+    assert(sc_video_presets[sc_video_preset_find(0)].max_size == 0);
+    assert(sc_video_presets[sc_video_preset_find(300)].max_size == 720);
+}
+
+static void test_video_preset_step(void) {
+    unsigned index = sc_video_preset_find(1024);
+    unsigned better = sc_video_preset_step(index, true);
+    assert(sc_video_presets[better].max_size == 1280);
+    unsigned lower = sc_video_preset_step(index, false);
+    assert(sc_video_presets[lower].max_size == 720);
+
+    // bounded
+    assert(sc_video_preset_step(0, false) == 0);
+    unsigned last = SC_VIDEO_PRESET_COUNT - 1;
+    assert(sc_video_preset_step(last, true) == last);
+}
+
+static void test_video_preset_is_allowed(void) {
+    const struct sc_video_preset small = {720, 30};
+    const struct sc_video_preset large = {1920, 60};
+    const struct sc_video_preset device = {0, 0};
+
+    assert(sc_video_preset_is_allowed(&large, 720, SC_VIDEO_PRESET_ANY_SIZE));
+
+    // frames larger than the initial frames are refused
+    assert(sc_video_preset_is_allowed(&small, 1024,
+                                      SC_VIDEO_PRESET_NOT_LARGER));
+    assert(!sc_video_preset_is_allowed(&large, 1024,
+                                       SC_VIDEO_PRESET_NOT_LARGER));
+    assert(!sc_video_preset_is_allowed(&device, 1024,
+                                       SC_VIDEO_PRESET_NOT_LARGER));
+    // the device size is the largest
+    assert(sc_video_preset_is_allowed(&large, 0, SC_VIDEO_PRESET_NOT_LARGER));
+    assert(sc_video_preset_is_allowed(&device, 0, SC_VIDEO_PRESET_NOT_LARGER));
+
+    // any size change is refused
+    assert(!sc_video_preset_is_allowed(&small, 1024,
+                                       SC_VIDEO_PRESET_SAME_SIZE));
+    assert(sc_video_preset_is_allowed(&small, 720, SC_VIDEO_PRESET_SAME_SIZE));
+    assert(!sc_video_preset_is_allowed(&large, 0, SC_VIDEO_PRESET_SAME_SIZE));
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_video_preset_find();
+    test_video_preset_step();
+    test_video_preset_is_allowed();
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/yuv.h"
+
+#define MAX_WIDTH 67
+#define MAX_HEIGHT 9
+#define PADDING 7
+
+struct frame {
+    uint8_t y[(MAX_WIDTH + PADDING) * MAX_HEIGHT];
+    uint8_t u[(MAX_WIDTH / 2 + 1 + PADDING) * (MAX_HEIGHT / 2 + 1)];
+    uint8_t v[(MAX_WIDTH / 2 + 1 + PADDING) * (MAX_HEIGHT / 2 + 1)];
+    const uint8_t *data[3];
+    int linesize[3];
+};
+
+static void init_frame(struct frame *frame, unsigned width) {
+    for (size_t i = 0; i < sizeof(frame->y); ++i) {
+        frame->y[i] = rand();
+    }
+    for (size_t i = 0; i < sizeof(frame->u); ++i) {
+        frame->u[i] = rand();
+        frame->v[i] = rand();
+    }
+    frame->data[0] = frame->y;
+    frame->data[1] = frame->u;
+    frame->data[2] = frame->v;
+    frame->linesize[0] = width + PADDING;
+    frame->linesize[1] = (width + 1) / 2 + PADDING;
+    frame->linesize[2] = (width + 1) / 2 + PADDING;
+}
+
+static void test_yuyv(unsigned width, unsigned height) {
+    struct frame frame;
+    init_frame(&frame, width);
+
+    unsigned dst_linesize = (width + 1) / 2 * 4 + 3;
+    uint8_t dst[((MAX_WIDTH + 1) * 2 + 3) * MAX_HEIGHT];
+    memset(dst, 0, sizeof(dst));
+    sc_yuv420_to_yuyv(frame.data, frame.linesize, dst, dst_linesize, width,
+                      height);
+
+    for (unsigned row = 0; row < height; ++row) {
+        const uint8_t *y = frame.y + row * frame.linesize[0];
+        const uint8_t *u = frame.u + row / 2 * frame.linesize[1];
+        const uint8_t *v = frame.v + row / 2 * frame.linesize[2];
+        const uint8_t *line = dst + row * dst_linesize;
+        for (unsigned x = 0; x < width; x += 2) {
+            assert(line[2 * x] == y[x]);
+            assert(line[2 * x + 1] == u[x / 2]);
+            assert(line[2 * x + 2] == (x + 1 < width ? y[x + 1] : y[x]));
+            assert(line[2 * x + 3] == v[x / 2]);
+        }
+        // the padding is not written
+        for (unsigned x = (width + 1) / 2 * 4; x < dst_linesize; ++x) {
+            assert(!line[x]);
+        }
+    }
+}
+
+static void test_nv12(unsigned width, unsigned height, bool same_stride) {
+    struct frame frame;
+    init_frame(&frame, width);
+
+    unsigned chroma_width = (width + 1) / 2;
+    unsigned chroma_height = (height + 1) / 2;
+    int y_linesize = same_stride ? frame.linesize[0] : (int) width + 1;
+    int uv_linesize = chroma_width * 2 + 1;
+    uint8_t dst_y[(MAX_WIDTH + PADDING) * MAX_HEIGHT];
+    uint8_t dst_uv[(MAX_WIDTH + 2) * (MAX_HEIGHT / 2 + 1)];
+    sc_yuv420_to_nv12(frame.data, frame.linesize, dst_y, y_linesize, dst_uv,
+                      uv_linesize, width, height);
+
+    for (unsigned row = 0; row < height; ++row) {
+        assert(!memcmp(dst_y + row * y_linesize,
+                       frame.y + row * frame.linesize[0], width));
+    }
+
+    for (unsigned row = 0; row < chroma_height; ++row) {
+        const uint8_t *u = frame.u + row * frame.linesize[1];
+        const uint8_t *v = frame.v + row * frame.linesize[2];
+        const uint8_t *line = dst_uv + row * uv_linesize;
+        for (unsigned x = 0; x < chroma_width; ++x) {
+            assert(line[2 * x] == u[x]);
+            assert(line[2 * x + 1] == v[x]);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    srand(42);
+
+    // cover the SIMD loops and the scalar tails, with odd sizes
+    unsigned widths[] = {1, 2, 15, 16, 17, 32, 33, 64, 67};
+    unsigned heights[] = {1, 2, 8, 9};
+    for (size_t i = 0; i < ARRAY_LEN(widths); ++i) {
+        for (size_t j = 0; j < ARRAY_LEN(heights); ++j) {
+            test_yuyv(widths[i], heights[j]);
+            test_nv12(widths[i], heights[j], true);
+            test_nv12(widths[i], heights[j], false);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,100 @@
+package com.genymobile.scrcpy;
+
+import java.util.concurrent.atomic.AtomicInteger;
+
+/**
+ * Adapt the encoding bit-rate to the network conditions, from the stream stats periodically reported by the client.
+ * <p>
+ * The bit-rate is decreased multiplicatively as soon as the stream is congested (the packets wait in a network queue, or the client skips
+ * frames), and increased additively while the client receives what is encoded.
+ * <p>
+ * The stats are received on the controller thread, the changes are consumed by the encoder.
+ */
+public class BitRateController {
+
+    // A queue delay below this value is considered as noise
+    private static final int MIN_CONGESTION_QUEUE_DELAY = 30_000; // µs
+    // More skipped frames per report means that the client could not follow
+    private static final int MAX_SKIPPED_FRAMES = 5;
+
+    private static final float DECREASE_FACTOR = 0.85f;
+    private static final int MIN_INCREASE_STEP = 50_000;
+    // Do not increase the bit-rate during the reports following a decrease (the queue takes time to drain)
+    private static final int HOLD_REPORTS = 2;
+
+    private final int minBitRate;
+    private final int maxBitRate;
+
+    private int bitRate;
+    private int holdReports;
+
+    // 0 if there is no change
+    private final AtomicInteger pendingBitRate = new AtomicInteger();
+
+    public BitRateController(int bitRate, int minBitRate, int maxBitRate) {
+        if (minBitRate <= 0 || minBitRate > maxBitRate) {
+            throw new IllegalArgumentException("Invalid bit-rate range: " + minBitRate + ":" + maxBitRate);
+        }
+        this.minBitRate = minBitRate;
+        this.maxBitRate = maxBitRate;
+        this.bitRate = clamp(bitRate);
+    }
+
+    private int clamp(long value) {
+        return (int) Math.max(minBitRate, Math.min(maxBitRate, value));
+    }
+
+    /**
+     * Return the initial bit-rate (within the bounds).
+     */
+    public int getInitialBitRate() {
+        return bitRate;
+    }
+
+    /**
+     * @param throughput    bytes received by the client per second
+     * @param queueDelay    average one-way delay of the packets above its recent minimum, in microseconds
+     * @param jitter        smoothed deviation of the packet arrival times, in microseconds
+     * @param skippedFrames number of frames skipped by the client since the previous report
+     */
+    public synchronized void onStreamStats(long throughput, int queueDelay, int jitter, int skippedFrames) {
+        long receivedBitRate = throughput * 8;
+        // A delay caused by the jitter is not a sign of congestion
+        int congestionDelay = Math.max(MIN_CONGESTION_QUEUE_DELAY, 2 * jitter);
+
+        int newBitRate;
+        if (queueDelay > congestionDelay || skippedFrames > MAX_SKIPPED_FRAMES) {
+            // The link capacity is at most what the client received
+            long capacity = receivedBitRate > 0 ? Math.min(bitRate, receivedBitRate) : bitRate;
+            newBitRate = clamp((long) (capacity * DECREASE_FACTOR));
+            holdReports = HOLD_REPORTS;
+        } else if (holdReports > 0) {
+            --holdReports;
+            return;
+        } else if (receivedBitRate * 3 / 2 >= bitRate) {
+            // Only increase if the current bit-rate is actually used (a static screen produces much less)
+            newBitRate = clamp((long) bitRate + Math.max(MIN_INCREASE_STEP, maxBitRate / 40));
+        } else {
+            return;
+        }
+
+        if (newBitRate != bitRate) {
+            bitRate = newBitRate;
+            pendingBitRate.set(newBitRate);
+        }
+    }
+
+    /**
+     * Return the new bit-rate to apply, or 0 if it did not change since the last call.
+     */
+    public int consumeBitRateChange() {
+        return pendingBitRate.getAndSet(0);
+    }
+
+    /**
+     * Return the current target bit-rate.
+     */
+    public synchronized int getBitRate() {
+        return bitRate;
+    }
+}
@@ -17,6 +17,10 @@ public final class ControlMessage {
     public static final int TYPE_SET_CLIPBOARD = 9;
     public static final int TYPE_SET_SCREEN_POWER_MODE = 10;
     public static final int TYPE_ROTATE_DEVICE = 11;
+    public static final int TYPE_PING = 12;
+    public static final int TYPE_STREAM_STATS = 13;
+    public static final int TYPE_SET_VIDEO_SETTINGS = 14;
+    public static final int TYPE_REQUEST_KEY_FRAME = 15;
 
     public static final long SEQUENCE_INVALID = 0;
 
@@ -32,91 +36,199 @@ public final class ControlMessage {
     private int buttons; // MotionEvent.BUTTON_*
     private long pointerId;
     private float pressure;
-    private Position position;
+    private int x;
+    private int y;
+    private int screenWidth;
+    private int screenHeight;
+    private Position position; // created on demand from the fields above
     private int hScroll;
     private int vScroll;
     private int copyKey;
     private boolean paste;
     private int repeat;
     private long sequence;
+    private long timestamp;
+    private long throughput; // bytes per second
+    private int queueDelay; // in microseconds
+    private int jitter; // in microseconds
+    private int skippedFrames;
+    private int maxSize;
+    private int maxFps;
 
-    private ControlMessage() {
+    /**
+     * Create an empty message, to be reused by the {@code set*()} methods.
+     */
+    ControlMessage() {
     }
 
     public static ControlMessage createInjectKeycode(int action, int keycode, int repeat, int metaState) {
-        ControlMessage msg = new ControlMessage();
-        msg.type = TYPE_INJECT_KEYCODE;
-        msg.action = action;
-        msg.keycode = keycode;
-        msg.repeat = repeat;
-        msg.metaState = metaState;
-        return msg;
+        return new ControlMessage().setInjectKeycode(action, keycode, repeat, metaState);
     }
 
     public static ControlMessage createInjectText(String text) {
-        ControlMessage msg = new ControlMessage();
-        msg.type = TYPE_INJECT_TEXT;
-        msg.text = text;
-        return msg;
+        return new ControlMessage().setInjectText(text);
     }
 
     public static ControlMessage createInjectTouchEvent(int action, long pointerId, Position position, float pressure, int buttons) {
         ControlMessage msg = new ControlMessage();
-        msg.type = TYPE_INJECT_TOUCH_EVENT;
-        msg.action = action;
-        msg.pointerId = pointerId;
-        msg.pressure = pressure;
+        Point point = position.getPoint();
+        Size screenSize = position.getScreenSize();
+        msg.setInjectTouchEvent(action, pointerId, point.getX(), point.getY(), screenSize.getWidth(), screenSize.getHeight(), pressure, buttons);
         msg.position = position;
-        msg.buttons = buttons;
         return msg;
     }
 
     public static ControlMessage createInjectScrollEvent(Position position, int hScroll, int vScroll) {
         ControlMessage msg = new ControlMessage();
-        msg.type = TYPE_INJECT_SCROLL_EVENT;
+        Point point = position.getPoint();
+        Size screenSize = position.getScreenSize();
+        msg.setInjectScrollEvent(point.getX(), point.getY(), screenSize.getWidth(), screenSize.getHeight(), hScroll, vScroll);
         msg.position = position;
-        msg.hScroll = hScroll;
-        msg.vScroll = vScroll;
         return msg;
     }
 
     public static ControlMessage createBackOrScreenOn(int action) {
-        ControlMessage msg = new ControlMessage();
-        msg.type = TYPE_BACK_OR_SCREEN_ON;
-        msg.action = action;
-        return msg;
+        return new ControlMessage().setBackOrScreenOn(action);
     }
 
     public static ControlMessage createGetClipboard(int copyKey) {
-        ControlMessage msg = new ControlMessage();
-        msg.type = TYPE_GET_CLIPBOARD;
-        msg.copyKey = copyKey;
-        return msg;
+        return new ControlMessage().setGetClipboard(copyKey);
     }
 
     public static ControlMessage createSetClipboard(long sequence, String text, boolean paste) {
-        ControlMessage msg = new ControlMessage();
-        msg.type = TYPE_SET_CLIPBOARD;
-        msg.sequence = sequence;
-        msg.text = text;
-        msg.paste = paste;
-        return msg;
+        return new ControlMessage().setSetClipboard(sequence, text, paste);
     }
 
     /**
      * @param mode one of the {@code Device.SCREEN_POWER_MODE_*} constants
      */
     public static ControlMessage createSetScreenPowerMode(int mode) {
-        ControlMessage msg = new ControlMessage();
-        msg.type = TYPE_SET_SCREEN_POWER_MODE;
-        msg.action = mode;
-        return msg;
+        return new ControlMessage().setSetScreenPowerMode(mode);
+    }
+
+    /**
+     * @param timestamp client timestamp, opaque for the device (it is echoed in the pong)
+     */
+    public static ControlMessage createPing(long timestamp) {
+        return new ControlMessage().setPing(timestamp);
+    }
+
+    /**
+     * @param throughput    bytes received by the client per second
+     * @param queueDelay    average one-way delay of the packets above its recent minimum, in microseconds
+     * @param jitter        smoothed deviation of the packet arrival times, in microseconds
+     * @param skippedFrames number of frames skipped by the client since the previous report
+     */
+    public static ControlMessage createStreamStats(long throughput, int queueDelay, int jitter, int skippedFrames) {
+        return new ControlMessage().setStreamStats(throughput, queueDelay, jitter, skippedFrames);
+    }
+
+    /**
+     * @param maxSize 0 for the device size
+     * @param maxFps  0 for unlimited
+     */
+    public static ControlMessage createSetVideoSettings(int maxSize, int maxFps) {
+        return new ControlMessage().setSetVideoSettings(maxSize, maxFps);
     }
 
     public static ControlMessage createEmpty(int type) {
-        ControlMessage msg = new ControlMessage();
-        msg.type = type;
-        return msg;
+        return new ControlMessage().setEmpty(type);
+    }
+
+    ControlMessage setInjectKeycode(int action, int keycode, int repeat, int metaState) {
+        setEmpty(TYPE_INJECT_KEYCODE);
+        this.action = action;
+        this.keycode = keycode;
+        this.repeat = repeat;
+        this.metaState = metaState;
+        return this;
+    }
+
+    ControlMessage setInjectText(String text) {
+        setEmpty(TYPE_INJECT_TEXT);
+        this.text = text;
+        return this;
+    }
+
+    ControlMessage setInjectTouchEvent(int action, long pointerId, int x, int y, int screenWidth, int screenHeight, float pressure, int buttons) {
+        setEmpty(TYPE_INJECT_TOUCH_EVENT);
+        this.action = action;
+        this.pointerId = pointerId;
+        setPosition(x, y, screenWidth, screenHeight);
+        this.pressure = pressure;
+        this.buttons = buttons;
+        return this;
+    }
+
+    ControlMessage setInjectScrollEvent(int x, int y, int screenWidth, int screenHeight, int hScroll, int vScroll) {
+        setEmpty(TYPE_INJECT_SCROLL_EVENT);
+        setPosition(x, y, screenWidth, screenHeight);
+        this.hScroll = hScroll;
+        this.vScroll = vScroll;
+        return this;
+    }
+
+    ControlMessage setBackOrScreenOn(int action) {
+        setEmpty(TYPE_BACK_OR_SCREEN_ON);
+        this.action = action;
+        return this;
+    }
+
+    ControlMessage setGetClipboard(int copyKey) {
+        setEmpty(TYPE_GET_CLIPBOARD);
+        this.copyKey = copyKey;
+        return this;
+    }
+
+    ControlMessage setSetClipboard(long sequence, String text, boolean paste) {
+        setEmpty(TYPE_SET_CLIPBOARD);
+        this.sequence = sequence;
+        this.text = text;
+        this.paste = paste;
+        return this;
+    }
+
+    ControlMessage setSetScreenPowerMode(int mode) {
+        setEmpty(TYPE_SET_SCREEN_POWER_MODE);
+        this.action = mode;
+        return this;
+    }
+
+    ControlMessage setPing(long timestamp) {
+        setEmpty(TYPE_PING);
+        this.timestamp = timestamp;
+        return this;
+    }
+
+    ControlMessage setStreamStats(long throughput, int queueDelay, int jitter, int skippedFrames) {
+        setEmpty(TYPE_STREAM_STATS);
+        this.throughput = throughput;
+        this.queueDelay = queueDelay;
+        this.jitter = jitter;
+        this.skippedFrames = skippedFrames;
+        return this;
+    }
+
+    ControlMessage setSetVideoSettings(int maxSize, int maxFps) {
+        setEmpty(TYPE_SET_VIDEO_SETTINGS);
+        this.maxSize = maxSize;
+        this.maxFps = maxFps;
+        return this;
+    }
+
+    ControlMessage setEmpty(int type) {
+        this.type = type;
+        // Do not retain the references of a previous message
+        text = null;
+        position = null;
+        return this;
+    }
+
+    private void setPosition(int x, int y, int screenWidth, int screenHeight) {
+        this.x = x;
+        this.y = y;
+        this.screenWidth = screenWidth;
+        this.screenHeight = screenHeight;
     }
 
     public int getType() {
@@ -152,9 +264,28 @@ public final class ControlMessage {
     }
 
     public Position getPosition() {
+        if (position == null) {
+            position = new Position(x, y, screenWidth, screenHeight);
+        }
         return position;
     }
 
+    public int getX() {
+        return x;
+    }
+
+    public int getY() {
+        return y;
+    }
+
+    public int getScreenWidth() {
+        return screenWidth;
+    }
+
+    public int getScreenHeight() {
+        return screenHeight;
+    }
+
     public int getHScroll() {
         return hScroll;
     }
@@ -178,4 +309,32 @@ public final class ControlMessage {
     public long getSequence() {
         return sequence;
     }
+
+    public long getTimestamp() {
+        return timestamp;
+    }
+
+    public long getThroughput() {
+        return throughput;
+    }
+
+    public int getQueueDelay() {
+        return queueDelay;
+    }
+
+    public int getJitter() {
+        return jitter;
+    }
+
+    public int getSkippedFrames() {
+        return skippedFrames;
+    }
+
+    public int getMaxSize() {
+        return maxSize;
+    }
+
+    public int getMaxFps() {
+        return maxFps;
+    }
 }
@@ -15,6 +15,9 @@ public class ControlMessageReader {
     static final int SET_SCREEN_POWER_MODE_PAYLOAD_LENGTH = 1;
     static final int GET_CLIPBOARD_LENGTH = 1;
     static final int SET_CLIPBOARD_FIXED_PAYLOAD_LENGTH = 9;
+    static final int PING_PAYLOAD_LENGTH = 8;
+    static final int STREAM_STATS_PAYLOAD_LENGTH = 14;
+    static final int SET_VIDEO_SETTINGS_PAYLOAD_LENGTH = 4;
 
     private static final int MESSAGE_MAX_SIZE = 1 << 18; // 256k
 
@@ -24,6 +27,9 @@ public class ControlMessageReader {
     private final byte[] rawBuffer = new byte[MESSAGE_MAX_SIZE];
     private final ByteBuffer buffer = ByteBuffer.wrap(rawBuffer);
 
+    // Every message is parsed into this instance, to avoid allocations on the hot path (touch events)
+    private final ControlMessage msg = new ControlMessage();
+
     public ControlMessageReader() {
         // invariant: the buffer is always in "get" mode
         buffer.limit(0);
@@ -33,6 +39,14 @@ public class ControlMessageReader {
         return buffer.remaining() == rawBuffer.length;
     }
 
+    /**
+     * Discard the buffered data (the beginning of a message lost with its connection).
+     */
+    public void reset() {
+        buffer.clear();
+        buffer.limit(0);
+    }
+
     public void readFrom(InputStream input) throws IOException {
         if (isFull()) {
             throw new IllegalStateException("Buffer full, call next() to consume");
@@ -47,6 +61,13 @@ public class ControlMessageReader {
         buffer.flip();
     }
 
+    /**
+     * Parse the next message.
+     * <p>
+     * The returned message is reused: it is only valid until the next call to {@code next()}.
+     *
+     * @return the message, or {@code null} if the buffer does not contain a complete message
+     */
     public ControlMessage next() {
         if (!buffer.hasRemaining()) {
             return null;
@@ -54,60 +75,73 @@ public class ControlMessageReader {
         int savedPosition = buffer.position();
 
         int type = buffer.get();
-        ControlMessage msg;
+        boolean parsed;
         switch (type) {
             case ControlMessage.TYPE_INJECT_KEYCODE:
-                msg = parseInjectKeycode();
+                parsed = parseInjectKeycode();
                 break;
             case ControlMessage.TYPE_INJECT_TEXT:
-                msg = parseInjectText();
+                parsed = parseInjectText();
                 break;
             case ControlMessage.TYPE_INJECT_TOUCH_EVENT:
-                msg = parseInjectTouchEvent();
+                parsed = parseInjectTouchEvent();
                 break;
             case ControlMessage.TYPE_INJECT_SCROLL_EVENT:
-                msg = parseInjectScrollEvent();
+                parsed = parseInjectScrollEvent();
                 break;
             case ControlMessage.TYPE_BACK_OR_SCREEN_ON:
-                msg = parseBackOrScreenOnEvent();
+                parsed = parseBackOrScreenOnEvent();
                 break;
             case ControlMessage.TYPE_GET_CLIPBOARD:
-                msg = parseGetClipboard();
+                parsed = parseGetClipboard();
                 break;
             case ControlMessage.TYPE_SET_CLIPBOARD:
-                msg = parseSetClipboard();
+                parsed = parseSetClipboard();
                 break;
             case ControlMessage.TYPE_SET_SCREEN_POWER_MODE:
-                msg = parseSetScreenPowerMode();
+                parsed = parseSetScreenPowerMode();
+                break;
+            case ControlMessage.TYPE_PING:
+                parsed = parsePing();
+                break;
+            case ControlMessage.TYPE_STREAM_STATS:
+                parsed = parseStreamStats();
+                break;
+            case ControlMessage.TYPE_SET_VIDEO_SETTINGS:
+                parsed = parseSetVideoSettings();
                 break;
             case ControlMessage.TYPE_EXPAND_NOTIFICATION_PANEL:
             case ControlMessage.TYPE_EXPAND_SETTINGS_PANEL:
             case ControlMessage.TYPE_COLLAPSE_PANELS:
             case ControlMessage.TYPE_ROTATE_DEVICE:
-                msg = ControlMessage.createEmpty(type);
+            case ControlMessage.TYPE_REQUEST_KEY_FRAME:
+                msg.setEmpty(type);
+                parsed = true;
                 break;
             default:
                 Ln.w("Unknown event type: " + type);
-                msg = null;
+                parsed = false;
                 break;
         }
 
-        if (msg == null) {
+        if (!parsed) {
             // failure, reset savedPosition
             buffer.position(savedPosition);
+            return null;
         }
         return msg;
     }
 
-    private ControlMessage parseInjectKeycode() {
+    private boolean parseInjectKeycode() {
         if (buffer.remaining() < INJECT_KEYCODE_PAYLOAD_LENGTH) {
-            return null;
+            return false;
         }
         int action = toUnsigned(buffer.get());
         int keycode = buffer.getInt();
         int repeat = buffer.getInt();
         int metaState = buffer.getInt();
-        return ControlMessage.createInjectKeycode(action, keycode, repeat, metaState);
+        msg.setInjectKeycode(action, keycode, repeat, metaState);
+        return true;
     }
 
     private String parseString() {
@@ -124,82 +158,123 @@ public class ControlMessageReader {
         return new String(rawBuffer, position, len, StandardCharsets.UTF_8);
     }
 
-    private ControlMessage parseInjectText() {
+    private boolean parseInjectText() {
         String text = parseString();
         if (text == null) {
-            return null;
+            return false;
         }
-        return ControlMessage.createInjectText(text);
+        msg.setInjectText(text);
+        return true;
     }
 
-    private ControlMessage parseInjectTouchEvent() {
+    private boolean parseInjectTouchEvent() {
         if (buffer.remaining() < INJECT_TOUCH_EVENT_PAYLOAD_LENGTH) {
-            return null;
+            return false;
         }
         int action = toUnsigned(buffer.get());
         long pointerId = buffer.getLong();
-        Position position = readPosition(buffer);
+        int x = buffer.getInt();
+        int y = buffer.getInt();
+        int screenWidth = toUnsigned(buffer.getShort());
+        int screenHeight = toUnsigned(buffer.getShort());
         // 16 bits fixed-point
         int pressureInt = toUnsigned(buffer.getShort());
         // convert it to a float between 0 and 1 (0x1p16f is 2^16 as float)
         float pressure = pressureInt == 0xffff ? 1f : (pressureInt / 0x1p16f);
         int buttons = buffer.getInt();
-        return ControlMessage.createInjectTouchEvent(action, pointerId, position, pressure, buttons);
+        msg.setInjectTouchEvent(action, pointerId, x, y, screenWidth, screenHeight, pressure, buttons);
+        return true;
     }
 
-    private ControlMessage parseInjectScrollEvent() {
+    private boolean parseInjectScrollEvent() {
         if (buffer.remaining() < INJECT_SCROLL_EVENT_PAYLOAD_LENGTH) {
-            return null;
+            return false;
         }
-        Position position = readPosition(buffer);
+        int x = buffer.getInt();
+        int y = buffer.getInt();
+        int screenWidth = toUnsigned(buffer.getShort());
+        int screenHeight = toUnsigned(buffer.getShort());
         int hScroll = buffer.getInt();
         int vScroll = buffer.getInt();
-        return ControlMessage.createInjectScrollEvent(position, hScroll, vScroll);
+        msg.setInjectScrollEvent(x, y, screenWidth, screenHeight, hScroll, vScroll);
+        return true;
     }
 
-    private ControlMessage parseBackOrScreenOnEvent() {
+    private boolean parseBackOrScreenOnEvent() {
         if (buffer.remaining() < BACK_OR_SCREEN_ON_LENGTH) {
-            return null;
+            return false;
         }
         int action = toUnsigned(buffer.get());
-        return ControlMessage.createBackOrScreenOn(action);
+        msg.setBackOrScreenOn(action);
+        return true;
     }
 
-    private ControlMessage parseGetClipboard() {
+    private boolean parseGetClipboard() {
         if (buffer.remaining() < GET_CLIPBOARD_LENGTH) {
-            return null;
+            return false;
         }
         int copyKey = toUnsigned(buffer.get());
-        return ControlMessage.createGetClipboard(copyKey);
+        msg.setGetClipboard(copyKey);
+        return true;
     }
 
-    private ControlMessage parseSetClipboard() {
+    private boolean parseSetClipboard() {
         if (buffer.remaining() < SET_CLIPBOARD_FIXED_PAYLOAD_LENGTH) {
-            return null;
+            return false;
         }
         long sequence = buffer.getLong();
         boolean paste = buffer.get() != 0;
         String text = parseString();
         if (text == null) {
-            return null;
+            return false;
         }
-        return ControlMessage.createSetClipboard(sequence, text, paste);
+        msg.setSetClipboard(sequence, text, paste);
+        return true;
     }
 
-    private ControlMessage parseSetScreenPowerMode() {
+    private boolean parseSetScreenPowerMode() {
         if (buffer.remaining() < SET_SCREEN_POWER_MODE_PAYLOAD_LENGTH) {
-            return null;
+            return false;
         }
         int mode = buffer.get();
-        return ControlMessage.createSetScreenPowerMode(mode);
+        msg.setSetScreenPowerMode(mode);
+        return true;
     }
 
-    private static Position readPosition(ByteBuffer buffer) {
-        int x = buffer.getInt();
-        int y = buffer.getInt();
-        int screenWidth = toUnsigned(buffer.getShort());
-        int screenHeight = toUnsigned(buffer.getShort());
-        return new Position(x, y, screenWidth, screenHeight);
+    private boolean parsePing() {
+        if (buffer.remaining() < PING_PAYLOAD_LENGTH) {
+            return false;
+        }
+        long timestamp = buffer.getLong();
+        msg.setPing(timestamp);
+        return true;
+    }
+
+    private boolean parseStreamStats() {
+        if (buffer.remaining() < STREAM_STATS_PAYLOAD_LENGTH) {
+            return false;
+        }
+        long throughput = toUnsigned(buffer.getInt());
+        // the delays are bounded in practice, clamp them to fit in an int
+        int queueDelay = (int) Math.min(toUnsigned(buffer.getInt()), Integer.MAX_VALUE);
+        int jitter = (int) Math.min(toUnsigned(buffer.getInt()), Integer.MAX_VALUE);
+        int skippedFrames = toUnsigned(buffer.getShort());
+        msg.setStreamStats(throughput, queueDelay, jitter, skippedFrames);
+        return true;
+    }
+
+    private boolean parseSetVideoSettings() {
+        if (buffer.remaining() < SET_VIDEO_SETTINGS_PAYLOAD_LENGTH) {
+            return false;
+        }
+        int maxSize = toUnsigned(buffer.getShort()) & ~7; // multiple of 8
+        int maxFps = toUnsigned(buffer.getShort());
+        msg.setSetVideoSettings(maxSize, maxFps);
+        return true;
+    }
+
+    private static long toUnsigned(int value) {
+        return value & 0xffffffffL;
     }
 
     private static int toUnsigned(short value) {
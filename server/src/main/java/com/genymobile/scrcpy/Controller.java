@@ -22,6 +22,8 @@ public class Controller {
     private final DesktopConnection connection;
     private final DeviceMessageSender sender;
     private final boolean clipboardAutosync;
+    private final BitRateController bitRateController; // may be null
+    private final ScreenEncoder screenEncoder;
 
     private final KeyCharacterMap charMap = KeyCharacterMap.load(KeyCharacterMap.VIRTUAL_KEYBOARD);
 
@@ -32,10 +34,13 @@ public class Controller {
 
     private boolean keepPowerModeOff;
 
-    public Controller(Device device, DesktopConnection connection, boolean clipboardAutosync) {
+    public Controller(Device device, DesktopConnection connection, boolean clipboardAutosync, BitRateController bitRateController,
+            ScreenEncoder screenEncoder) {
         this.device = device;
         this.connection = connection;
         this.clipboardAutosync = clipboardAutosync;
+        this.bitRateController = bitRateController;
+        this.screenEncoder = screenEncoder;
         initPointers();
         sender = new DeviceMessageSender(connection);
     }
@@ -93,12 +98,15 @@ public class Controller {
                 break;
             case ControlMessage.TYPE_INJECT_TOUCH_EVENT:
                 if (device.supportsInputEvents()) {
-                    injectTouch(msg.getAction(), msg.getPointerId(), msg.getPosition(), msg.getPressure(), msg.getButtons());
+                    // Do not call msg.getPosition(), it would allocate for every event
+                    long point = device.getPhysicalPoint(msg.getX(), msg.getY(), msg.getScreenWidth(), msg.getScreenHeight());
+                    injectTouch(msg.getAction(), msg.getPointerId(), point, msg.getPressure(), msg.getButtons());
                 }
                 break;
             case ControlMessage.TYPE_INJECT_SCROLL_EVENT:
                 if (device.supportsInputEvents()) {
-                    injectScroll(msg.getPosition(), msg.getHScroll(), msg.getVScroll());
+                    long point = device.getPhysicalPoint(msg.getX(), msg.getY(), msg.getScreenWidth(), msg.getScreenHeight());
+                    injectScroll(point, msg.getHScroll(), msg.getVScroll());
                 }
                 break;
             case ControlMessage.TYPE_BACK_OR_SCREEN_ON:
@@ -134,6 +142,20 @@ public class Controller {
             case ControlMessage.TYPE_ROTATE_DEVICE:
                 Device.rotateDevice();
                 break;
+            case ControlMessage.TYPE_PING:
+                sender.pushPong(msg.getTimestamp());
+                break;
+            case ControlMessage.TYPE_STREAM_STATS:
+                if (bitRateController != null) {
+                    bitRateController.onStreamStats(msg.getThroughput(), msg.getQueueDelay(), msg.getJitter(), msg.getSkippedFrames());
+                }
+                break;
+            case ControlMessage.TYPE_SET_VIDEO_SETTINGS:
+                screenEncoder.setVideoSettings(msg.getMaxSize(), msg.getMaxFps());
+                break;
+            case ControlMessage.TYPE_REQUEST_KEY_FRAME:
+                screenEncoder.requestKeyFrame();
+                break;
             default:
                 // do nothing
         }
@@ -173,11 +195,13 @@ public class Controller {
         return successCount;
     }
 
-    private boolean injectTouch(int action, long pointerId, Position position, float pressure, int buttons) {
+    /**
+     * @param point the physical point, packed by {@link Point#pack(int, int)} (see {@link Device#getPhysicalPoint(int, int, int, int)})
+     */
+    private boolean injectTouch(int action, long pointerId, long point, float pressure, int buttons) {
         long now = SystemClock.uptimeMillis();
 
-        Point point = device.getPhysicalPoint(position);
-        if (point == null) {
+        if (point == Point.NONE) {
             Ln.w("Ignore touch event, it was generated for a different device size");
             return false;
         }
@@ -188,7 +212,7 @@ public class Controller {
             return false;
         }
         Pointer pointer = pointersState.get(pointerIndex);
-        pointer.setPoint(point);
+        pointer.setPoint(Point.unpackX(point), Point.unpackY(point));
         pointer.setPressure(pressure);
         pointer.setUp(action == MotionEvent.ACTION_UP);
 
@@ -218,13 +242,12 @@ public class Controller {
         MotionEvent event = MotionEvent
                 .obtain(lastTouchDown, now, action, pointerCount, pointerProperties, pointerCoords, 0, buttons, 1f, 1f, DEFAULT_DEVICE_ID, 0, source,
                         0);
-        return device.injectEvent(event, Device.INJECT_MODE_ASYNC);
+        return injectAndRecycle(event);
     }
 
-    private boolean injectScroll(Position position, int hScroll, int vScroll) {
+    private boolean injectScroll(long point, int hScroll, int vScroll) {
         long now = SystemClock.uptimeMillis();
-        Point point = device.getPhysicalPoint(position);
-        if (point == null) {
+        if (point == Point.NONE) {
             // ignore event
             return false;
         }
@@ -233,15 +256,22 @@ public class Controller {
         props.id = 0;
 
         MotionEvent.PointerCoords coords = pointerCoords[0];
-        coords.x = point.getX();
-        coords.y = point.getY();
+        coords.x = Point.unpackX(point);
+        coords.y = Point.unpackY(point);
         coords.setAxisValue(MotionEvent.AXIS_HSCROLL, hScroll);
         coords.setAxisValue(MotionEvent.AXIS_VSCROLL, vScroll);
 
         MotionEvent event = MotionEvent
                 .obtain(lastTouchDown, now, MotionEvent.ACTION_SCROLL, 1, pointerProperties, pointerCoords, 0, 0, 1f, 1f, DEFAULT_DEVICE_ID, 0,
                         InputDevice.SOURCE_MOUSE, 0);
-        return device.injectEvent(event, Device.INJECT_MODE_ASYNC);
+        return injectAndRecycle(event);
+    }
+
+    private boolean injectAndRecycle(MotionEvent event) {
+        // The event is copied (parceled) by the injection, so it may be returned to the pool, to be reused by the next MotionEvent.obtain()
+        boolean ok = device.injectEvent(event, Device.INJECT_MODE_ASYNC);
+        event.recycle();
+        return ok;
     }
 
     /**
@@ -3,12 +3,21 @@ package com.genymobile.scrcpy;
 import android.net.LocalServerSocket;
 import android.net.LocalSocket;
 import android.net.LocalSocketAddress;
+import android.os.SystemClock;
+import android.system.ErrnoException;
+import android.system.Os;
+import android.system.OsConstants;
+import android.system.StructPollfd;
 
 import java.io.Closeable;
 import java.io.FileDescriptor;
+import java.io.FileOutputStream;
 import java.io.IOException;
 import java.io.InputStream;
+import java.io.InterruptedIOException;
 import java.io.OutputStream;
+import java.nio.channels.Channels;
+import java.nio.channels.GatheringByteChannel;
 import java.nio.charset.StandardCharsets;
 
 public final class DesktopConnection implements Closeable {
@@ -17,22 +26,66 @@ public final class DesktopConnection implements Closeable {
 
     private static final String SOCKET_NAME = "scrcpy";
 
-    private final LocalSocket videoSocket;
-    private final FileDescriptor videoFd;
+    private final Device device;
+    private final int resumeTimeout; // ms, 0 if the connection may not be resumed
 
-    private final LocalSocket controlSocket;
-    private final InputStream controlInputStream;
-    private final OutputStream controlOutputStream;
+    // Replaced when the connection is resumed (guarded by this)
+    private Link link;
+    private boolean resuming;
+    private boolean closed;
 
     private final ControlMessageReader reader = new ControlMessageReader();
     private final DeviceMessageWriter writer = new DeviceMessageWriter();
 
-    private DesktopConnection(LocalSocket videoSocket, LocalSocket controlSocket) throws IOException {
-        this.videoSocket = videoSocket;
-        this.controlSocket = controlSocket;
-        controlInputStream = controlSocket.getInputStream();
-        controlOutputStream = controlSocket.getOutputStream();
-        videoFd = videoSocket.getFileDescriptor();
+    /**
+     * The sockets of one connection to the client.
+     */
+    private static final class Link implements Closeable {
+        private final LocalSocket videoSocket;
+        private final FileDescriptor videoFd;
+        private final GatheringByteChannel videoChannel;
+
+        // null if multiplexed (the video socket transmits both the video and the control messages)
+        private final LocalSocket controlSocket;
+        private final InputStream controlInputStream;
+        private final OutputStream controlOutputStream;
+
+        private Link(LocalSocket videoSocket, LocalSocket controlSocket) throws IOException {
+            this.videoSocket = videoSocket;
+            this.controlSocket = controlSocket;
+            videoFd = videoSocket.getFileDescriptor();
+            // The stream does not own the file descriptor, it is not closed
+            GatheringByteChannel socketChannel = new FileOutputStream(videoFd).getChannel();
+            if (controlSocket != null) {
+                videoChannel = socketChannel;
+                controlInputStream = controlSocket.getInputStream();
+                controlOutputStream = controlSocket.getOutputStream();
+            } else {
+                Multiplexer multiplexer = new Multiplexer(videoSocket.getInputStream(), socketChannel);
+                videoChannel = multiplexer.getChannel(Multiplexer.CHANNEL_VIDEO);
+                controlInputStream = multiplexer.getControlInputStream();
+                // each write() is sent as one frame
+                controlOutputStream = Channels.newOutputStream(multiplexer.getChannel(Multiplexer.CHANNEL_CONTROL));
+            }
+        }
+
+        @Override
+        public void close() throws IOException {
+            videoSocket.shutdownInput();
+            videoSocket.shutdownOutput();
+            videoSocket.close();
+            if (controlSocket != null) {
+                controlSocket.shutdownInput();
+                controlSocket.shutdownOutput();
+                controlSocket.close();
+            }
+        }
+    }
+
+    private DesktopConnection(Device device, int resumeTimeout, Link link) {
+        this.device = device;
+        this.resumeTimeout = resumeTimeout;
+        this.link = link;
     }
 
     private static LocalSocket connect(String abstractName) throws IOException {
@@ -41,50 +94,196 @@ public final class DesktopConnection implements Closeable {
         return localSocket;
     }
 
-    public static DesktopConnection open(Device device, boolean tunnelForward) throws IOException {
+    /**
+     * Open the connection to the client.
+     *
+     * @param multiplex     if {@code true}, use a single socket for both the video and the control messages (see {@link Multiplexer})
+     * @param resumeTimeout if positive, on connection failure, wait (at most this delay, in milliseconds) for the client to reconnect; only
+     *                      a multiplexed connection over an "adb forward" tunnel may be resumed
+     */
+    public static DesktopConnection open(Device device, boolean tunnelForward, boolean multiplex, int resumeTimeout) throws IOException {
+        if (resumeTimeout > 0 && (!tunnelForward || !multiplex)) {
+            throw new IllegalArgumentException("Only a multiplexed connection over \"adb forward\" may be resumed");
+        }
+
         LocalSocket videoSocket;
-        LocalSocket controlSocket;
+        LocalSocket controlSocket = null;
         if (tunnelForward) {
             LocalServerSocket localServerSocket = new LocalServerSocket(SOCKET_NAME);
             try {
                 videoSocket = localServerSocket.accept();
                 // send one byte so the client may read() to detect a connection error
                 videoSocket.getOutputStream().write(0);
-                try {
-                    controlSocket = localServerSocket.accept();
-                } catch (IOException | RuntimeException e) {
-                    videoSocket.close();
-                    throw e;
+                if (!multiplex) {
+                    try {
+                        controlSocket = localServerSocket.accept();
+                    } catch (IOException | RuntimeException e) {
+                        videoSocket.close();
+                        throw e;
+                    }
                 }
             } finally {
                 localServerSocket.close();
             }
         } else {
             videoSocket = connect(SOCKET_NAME);
+            if (!multiplex) {
+                try {
+                    controlSocket = connect(SOCKET_NAME);
+                } catch (IOException | RuntimeException e) {
+                    videoSocket.close();
+                    throw e;
+                }
+            }
+        }
+
+        Link link = new Link(videoSocket, controlSocket);
+        DesktopConnection connection = new DesktopConnection(device, resumeTimeout, link);
+        connection.sendDeviceInfo(link);
+        return connection;
+    }
+
+    /**
+     * Accept a new (multiplexed) connection from the client, before the deadline.
+     */
+    private static Link acceptResumed(long deadline) throws IOException {
+        LocalServerSocket localServerSocket = new LocalServerSocket(SOCKET_NAME);
+        try {
+            // accept() has no timeout
+            awaitConnection(localServerSocket, deadline);
+            LocalSocket socket = localServerSocket.accept();
             try {
-                controlSocket = connect(SOCKET_NAME);
+                // send one byte so the client may read() to detect a connection error
+                socket.getOutputStream().write(0);
+                return new Link(socket, null);
             } catch (IOException | RuntimeException e) {
-                videoSocket.close();
+                socket.close();
                 throw e;
             }
+        } finally {
+            localServerSocket.close();
         }
+    }
 
-        DesktopConnection connection = new DesktopConnection(videoSocket, controlSocket);
-        Size videoSize = device.getScreenInfo().getVideoSize();
-        connection.send(Device.getDeviceName(), videoSize.getWidth(), videoSize.getHeight());
-        return connection;
+    private static void awaitConnection(LocalServerSocket localServerSocket, long deadline) throws IOException {
+        StructPollfd pollfd = new StructPollfd();
+        pollfd.fd = localServerSocket.getFileDescriptor();
+        pollfd.events = (short) OsConstants.POLLIN;
+        StructPollfd[] pollfds = {pollfd};
+        while (true) {
+            long timeout = deadline - SystemClock.uptimeMillis();
+            if (timeout <= 0) {
+                throw new IOException("The client did not reconnect");
+            }
+            try {
+                if (Os.poll(pollfds, (int) timeout) > 0) {
+                    return;
+                }
+            } catch (ErrnoException e) {
+                if (e.errno != OsConstants.EINTR) {
+                    throw new IOException(e);
+                }
+            }
+        }
     }
 
+    /**
+     * Wait for the client to reconnect, after a failure of the given link.
+     * <p>
+     * The thread which detects the failure first accepts the new connection, the others wait for it.
+     *
+     * @return the new link
+     * @throws IOException if the connection could not be resumed in time
+     */
+    private Link resume(Link failed) throws IOException {
+        synchronized (this) {
+            while (resuming) {
+                try {
+                    wait();
+                } catch (InterruptedException e) {
+                    throw new InterruptedIOException();
+                }
+            }
+            if (link != failed) {
+                // already resumed by another thread
+                return link;
+            }
+            if (closed) {
+                throw new IOException("Connection closed");
+            }
+            resuming = true;
+        }
+
+        Link resumed = null;
+        boolean ok = false;
+        try {
+            closeQuietly(failed);
+            Ln.i("Connection lost, waiting " + resumeTimeout + " ms for the client to reconnect...");
+            Link accepted = acceptResumed(SystemClock.uptimeMillis() + resumeTimeout);
+            try {
+                sendDeviceInfo(accepted);
+            } catch (IOException e) {
+                closeQuietly(accepted);
+                throw e;
+            }
+            resumed = accepted;
+            Ln.i("Connection resumed");
+        } finally {
+            synchronized (this) {
+                resuming = false;
+                ok = resumed != null && !closed;
+                if (ok) {
+                    link = resumed;
+                } else {
+                    // the failed link is already closed, and will never be replaced
+                    closed = true;
+                }
+                notifyAll();
+            }
+        }
+
+        if (!ok) {
+            // closed meanwhile
+            closeQuietly(resumed);
+            throw new IOException("Connection closed");
+        }
+        return resumed;
+    }
+
+    private static void closeQuietly(Link link) {
+        try {
+            link.close();
+        } catch (IOException e) {
+            // the connection is already broken
+        }
+    }
+
+    private synchronized Link getLink() {
+        return link;
+    }
+
+    @Override
     public void close() throws IOException {
-        videoSocket.shutdownInput();
-        videoSocket.shutdownOutput();
-        videoSocket.close();
-        controlSocket.shutdownInput();
-        controlSocket.shutdownOutput();
-        controlSocket.close();
+        Link current;
+        boolean alreadyClosed;
+        synchronized (this) {
+            alreadyClosed = closed;
+            closed = true;
+            current = link;
+            notifyAll();
+        }
+        if (!alreadyClosed) {
+            current.close();
+        }
     }
 
-    private void send(String deviceName, int width, int height) throws IOException {
+    private void sendDeviceInfo(Link link) throws IOException {
+        Size videoSize = device.getScreenInfo().getVideoSize();
+        // sent before the multiplexed frames, if any
+        send(link, Device.getDeviceName(), videoSize.getWidth(), videoSize.getHeight());
+    }
+
+    private static void send(Link link, String deviceName, int width, int height) throws IOException {
         byte[] buffer = new byte[DEVICE_NAME_FIELD_LENGTH + 4];
 
         byte[] deviceNameBytes = deviceName.getBytes(StandardCharsets.UTF_8);
@@ -96,23 +295,55 @@ public final class DesktopConnection implements Closeable {
         buffer[DEVICE_NAME_FIELD_LENGTH + 1] = (byte) width;
         buffer[DEVICE_NAME_FIELD_LENGTH + 2] = (byte) (height >> 8);
         buffer[DEVICE_NAME_FIELD_LENGTH + 3] = (byte) height;
-        IO.writeFully(videoFd, buffer, 0, buffer.length);
+        IO.writeFully(link.videoFd, buffer, 0, buffer.length);
+    }
+
+    public GatheringByteChannel getVideoChannel() {
+        return getLink().videoChannel;
     }
 
-    public FileDescriptor getVideoFd() {
-        return videoFd;
+    /**
+     * Resume the connection after a failure of the video channel.
+     *
+     * @return the video channel of the new connection
+     */
+    public GatheringByteChannel resumeVideoChannel(GatheringByteChannel failedChannel) throws IOException {
+        Link current = getLink();
+        if (current.videoChannel == failedChannel) {
+            current = resume(current);
+        }
+        return current.videoChannel;
     }
 
     public ControlMessage receiveControlMessage() throws IOException {
         ControlMessage msg = reader.next();
         while (msg == null) {
-            reader.readFrom(controlInputStream);
+            Link current = getLink();
+            try {
+                reader.readFrom(current.controlInputStream);
+            } catch (IOException e) {
+                if (resumeTimeout <= 0) {
+                    throw e;
+                }
+                resume(current);
+                // the beginning of a message may have been lost with the previous connection
+                reader.reset();
+            }
             msg = reader.next();
         }
         return msg;
     }
 
     public void sendDeviceMessage(DeviceMessage msg) throws IOException {
-        writer.writeTo(msg, controlOutputStream);
+        Link current = getLink();
+        try {
+            writer.writeTo(msg, current.controlOutputStream);
+        } catch (IOException e) {
+            if (resumeTimeout <= 0) {
+                throw e;
+            }
+            // send it to the new connection
+            writer.writeTo(msg, resume(current).controlOutputStream);
+        }
     }
 }
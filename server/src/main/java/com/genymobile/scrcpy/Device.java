@@ -127,11 +127,25 @@ public final class Device {
         return screenInfo;
     }
 
+    /**
+     * Change the max size of the video (the encoder must be restarted to apply it).
+     */
+    public synchronized void setMaxSize(int maxSize) {
+        screenInfo = screenInfo.withMaxSize(maxSize);
+    }
+
     public int getLayerStack() {
         return layerStack;
     }
 
-    public Point getPhysicalPoint(Position position) {
+    /**
+     * Convert a position in the video (of size {@code screenWidth}x{@code screenHeight}) to a point on the physical screen.
+     * <p>
+     * It is called for every touch and scroll event, so it takes primitives and returns a packed point, without allocation.
+     *
+     * @return the point packed by {@link Point#pack(int, int)}, or {@link Point#NONE} if the event was generated for another video size
+     */
+    public long getPhysicalPoint(int x, int y, int screenWidth, int screenHeight) {
         // it hides the field on purpose, to read it with a lock
         @SuppressWarnings("checkstyle:HiddenField")
         ScreenInfo screenInfo = getScreenInfo(); // read with synchronization
@@ -141,19 +155,20 @@ public final class Device {
 
         int reverseVideoRotation = screenInfo.getReverseVideoRotation();
         // reverse the video rotation to apply the events
-        Position devicePosition = position.rotate(reverseVideoRotation);
+        long devicePoint = Point.rotate(x, y, screenWidth, screenHeight, reverseVideoRotation);
+        boolean swapped = reverseVideoRotation % 2 != 0;
+        int deviceWidth = swapped ? screenHeight : screenWidth;
+        int deviceHeight = swapped ? screenWidth : screenHeight;
 
-        Size clientVideoSize = devicePosition.getScreenSize();
-        if (!unlockedVideoSize.equals(clientVideoSize)) {
+        if (deviceWidth != unlockedVideoSize.getWidth() || deviceHeight != unlockedVideoSize.getHeight()) {
             // The client sends a click relative to a video with wrong dimensions,
             // the device may have been rotated since the event was generated, so ignore the event
-            return null;
+            return Point.NONE;
         }
         Rect contentRect = screenInfo.getContentRect();
-        Point point = devicePosition.getPoint();
-        int convertedX = contentRect.left + point.getX() * contentRect.width() / unlockedVideoSize.getWidth();
-        int convertedY = contentRect.top + point.getY() * contentRect.height() / unlockedVideoSize.getHeight();
-        return new Point(convertedX, convertedY);
+        int convertedX = contentRect.left + Point.unpackX(devicePoint) * contentRect.width() / deviceWidth;
+        int convertedY = contentRect.top + Point.unpackY(devicePoint) * contentRect.height() / deviceHeight;
+        return Point.pack(convertedX, convertedY);
     }
 
     public static String getDeviceName() {
@@ -4,12 +4,14 @@ public final class DeviceMessage {
 
     public static final int TYPE_CLIPBOARD = 0;
     public static final int TYPE_ACK_CLIPBOARD = 1;
+    public static final int TYPE_PONG = 2;
 
     public static final long SEQUENCE_INVALID = ControlMessage.SEQUENCE_INVALID;
 
     private int type;
     private String text;
     private long sequence;
+    private long timestamp;
 
     private DeviceMessage() {
     }
@@ -28,6 +30,13 @@ public final class DeviceMessage {
         return event;
     }
 
+    public static DeviceMessage createPong(long timestamp) {
+        DeviceMessage event = new DeviceMessage();
+        event.type = TYPE_PONG;
+        event.timestamp = timestamp;
+        return event;
+    }
+
     public int getType() {
         return type;
     }
@@ -39,4 +48,8 @@ public final class DeviceMessage {
     public long getSequence() {
         return sequence;
     }
+
+    public long getTimestamp() {
+        return timestamp;
+    }
 }
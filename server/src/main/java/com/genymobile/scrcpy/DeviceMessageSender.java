@@ -4,12 +4,18 @@ import java.io.IOException;
 
 public final class DeviceMessageSender {
 
+    // pongs are not coalesced (each one is a latency sample), but the number of pending pongs is bounded
+    private static final int MAX_PENDING_PONGS = 16;
+
     private final DesktopConnection connection;
 
     private String clipboardText;
 
     private long ack;
 
+    private final long[] pongs = new long[MAX_PENDING_PONGS];
+    private int pongCount;
+
     public DeviceMessageSender(DesktopConnection connection) {
         this.connection = connection;
     }
@@ -24,12 +30,23 @@ public final class DeviceMessageSender {
         notify();
     }
 
+    public synchronized void pushPong(long timestamp) {
+        if (pongCount == pongs.length) {
+            Ln.w("Too many pending pongs, pong dropped");
+            return;
+        }
+        pongs[pongCount++] = timestamp;
+        notify();
+    }
+
     public void loop() throws IOException, InterruptedException {
+        long[] pendingPongs = new long[MAX_PENDING_PONGS];
         while (true) {
             String text;
             long sequence;
+            int pendingPongCount;
             synchronized (this) {
-                while (ack == DeviceMessage.SEQUENCE_INVALID && clipboardText == null) {
+                while (ack == DeviceMessage.SEQUENCE_INVALID && clipboardText == null && pongCount == 0) {
                     wait();
                 }
                 text = clipboardText;
@@ -37,8 +54,17 @@ public final class DeviceMessageSender {
 
                 sequence = ack;
                 ack = DeviceMessage.SEQUENCE_INVALID;
+
+                pendingPongCount = pongCount;
+                System.arraycopy(pongs, 0, pendingPongs, 0, pongCount);
+                pongCount = 0;
             }
 
+            // send the pongs first, they are used to measure the latency
+            for (int i = 0; i < pendingPongCount; ++i) {
+                DeviceMessage event = DeviceMessage.createPong(pendingPongs[i]);
+                connection.sendDeviceMessage(event);
+            }
             if (sequence != DeviceMessage.SEQUENCE_INVALID) {
                 DeviceMessage event = DeviceMessage.createAckClipboard(sequence);
                 connection.sendDeviceMessage(event);
@@ -0,0 +1,98 @@
+package com.genymobile.scrcpy;
+
+import android.media.MediaCodec;
+
+import java.nio.ByteBuffer;
+
+/**
+ * Select the encoded frames to send, between the encoder output and the socket.
+ * <p>
+ * The encoder may produce more frames than necessary: {@code max-fps-to-encoder} is private before Android 10 (and ignored by some
+ * devices), and on static content the encoder repeats the last frame (see {@code KEY_REPEAT_PREVIOUS_FRAME_AFTER}).
+ * <p>
+ * To enforce the max fps, only the non-reference frames are dropped, so that the decoding of the following frames is not broken.
+ * <p>
+ * Once the repeated frames do not refine the picture anymore, they are tiny frames of identical size, with all the macroblocks skipped. They
+ * are suppressed, except one per keepalive period, but only if they are non-reference frames: a size match does not prove that a frame
+ * does not change the picture (a blinking caret also produces tiny frames of identical size), and dropping a reference frame would break
+ * the decoding of all the following frames until the next key frame.
+ */
+public final class FramePacer {
+
+    private static final long NO_PTS = -1;
+
+    // On static content, send a repeated frame at least once per period
+    private static final long KEEPALIVE_PERIOD_US = 1_000_000;
+
+    // A frame with all the macroblocks skipped is a few dozen bytes at 1080p, and a hundred bytes at 4K
+    private static final int MAX_REPEATED_FRAME_SIZE = 256;
+
+    private final long repeatDelayUs;
+    private long minIntervalUs;
+
+    private long lastFramePts = NO_PTS;
+    private int lastFrameSize;
+    private long lastSentPts = NO_PTS;
+
+    /**
+     * @param repeatDelayUs the delay after which the encoder repeats the last frame
+     * @param maxFps        the max frame rate, or 0 if unlimited
+     */
+    public FramePacer(long repeatDelayUs, int maxFps) {
+        this.repeatDelayUs = repeatDelayUs;
+        setMaxFps(maxFps);
+    }
+
+    public synchronized void setMaxFps(int maxFps) {
+        minIntervalUs = maxFps > 0 ? 1_000_000 / maxFps : 0;
+    }
+
+    /**
+     * Forget the previous frames (on encoder restart).
+     */
+    public synchronized void reset() {
+        lastFramePts = NO_PTS;
+        lastSentPts = NO_PTS;
+    }
+
+    /**
+     * Indicate whether a packet must be sent.
+     *
+     * @param data  the packet data (between position and limit), not consumed
+     * @param pts   the presentation timestamp, in microseconds
+     * @param flags the {@code MediaCodec.BUFFER_FLAG_*} flags
+     */
+    public synchronized boolean accept(ByteBuffer data, long pts, int flags) {
+        if ((flags & (MediaCodec.BUFFER_FLAG_CODEC_CONFIG | MediaCodec.BUFFER_FLAG_END_OF_STREAM)) != 0) {
+            // not a frame
+            return true;
+        }
+
+        int size = data.remaining();
+        boolean repeated = isRepeated(pts, size);
+        lastFramePts = pts;
+        lastFrameSize = size;
+
+        if ((flags & MediaCodec.BUFFER_FLAG_KEY_FRAME) == 0 && lastSentPts != NO_PTS && !Packet.isReference(data)) {
+            long elapsed = pts - lastSentPts;
+            if (repeated && elapsed < KEEPALIVE_PERIOD_US) {
+                return false;
+            }
+            // tolerate some jitter in the capture timestamps, so that a frame captured slightly early is not dropped
+            if (minIntervalUs > 0 && elapsed < minIntervalUs - minIntervalUs / 8) {
+                return false;
+            }
+        }
+
+        lastSentPts = pts;
+        return true;
+    }
+
+    private boolean isRepeated(long pts, int size) {
+        if (lastFramePts == NO_PTS || size != lastFrameSize || size > MAX_REPEATED_FRAME_SIZE) {
+            return false;
+        }
+        // a repeated frame is produced only if no new frame is received during the repeat delay
+        return pts - lastFramePts >= repeatDelayUs - repeatDelayUs / 8;
+    }
+}
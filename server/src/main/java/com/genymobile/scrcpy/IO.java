@@ -7,6 +7,8 @@ import android.system.OsConstants;
 import java.io.FileDescriptor;
 import java.io.IOException;
 import java.nio.ByteBuffer;
+import java.nio.channels.GatheringByteChannel;
+import java.nio.channels.WritableByteChannel;
 
 public final class IO {
     private IO() {
@@ -37,4 +39,36 @@ public final class IO {
     public static void writeFully(FileDescriptor fd, byte[] buffer, int offset, int len) throws IOException {
         writeFully(fd, ByteBuffer.wrap(buffer, offset, len));
     }
+
+    public static void writeFully(WritableByteChannel channel, ByteBuffer buffer) throws IOException {
+        while (buffer.hasRemaining()) {
+            channel.write(buffer);
+        }
+    }
+
+    /**
+     * Write the remaining bytes of all the buffers, in order.
+     * <p>
+     * The buffers are written together (with a single {@code writev()} for a {@link java.nio.channels.FileChannel}), so that a small header
+     * followed by a payload does not require one syscall each. Their positions are updated.
+     */
+    public static void writeFully(GatheringByteChannel channel, ByteBuffer[] buffers) throws IOException {
+        writeFully(channel, buffers, 0, buffers.length);
+    }
+
+    public static void writeFully(GatheringByteChannel channel, ByteBuffer[] buffers, int offset, int length) throws IOException {
+        // A write may be partial, for example if the socket buffer is full
+        while (hasRemaining(buffers, offset, length)) {
+            channel.write(buffers, offset, length);
+        }
+    }
+
+    private static boolean hasRemaining(ByteBuffer[] buffers, int offset, int length) {
+        for (int i = offset; i < offset + length; ++i) {
+            if (buffers[i].hasRemaining()) {
+                return true;
+            }
+        }
+        return false;
+    }
 }
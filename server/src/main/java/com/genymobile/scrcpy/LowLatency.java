@@ -0,0 +1,111 @@
+package com.genymobile.scrcpy;
+
+import android.media.MediaCodecInfo;
+import android.media.MediaFormat;
+import android.os.Build;
+
+/**
+ * Configure an encoder for the lowest latency, among the features it supports.
+ * <p>
+ * The options already present in the format (set explicitly by the user via codec options) are not overwritten.
+ */
+public final class LowLatency {
+
+    private static final int ENCODING_LATENCY = 1; // in frames
+    private static final int PRIORITY_REALTIME = 0;
+    private static final int INTRA_REFRESH_PERIOD = 60; // in frames
+
+    private LowLatency() {
+        // not instantiable
+    }
+
+    public static void configure(MediaFormat format, MediaCodecInfo codecInfo) {
+        MediaCodecInfo.CodecCapabilities capabilities = codecInfo.getCapabilitiesForType(MediaFormat.MIMETYPE_VIDEO_AVC);
+
+        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.O) {
+            // do not queue frames in the encoder
+            setIfAbsent(format, MediaFormat.KEY_LATENCY, ENCODING_LATENCY);
+        } else {
+            skip(MediaFormat.KEY_LATENCY, "requires Android 8");
+        }
+
+        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.M) {
+            setIfAbsent(format, MediaFormat.KEY_PRIORITY, PRIORITY_REALTIME);
+        } else {
+            skip(MediaFormat.KEY_PRIORITY, "requires Android 6");
+        }
+
+        if (Build.VERSION.SDK_INT < Build.VERSION_CODES.R) {
+            skip(MediaFormat.KEY_LOW_LATENCY, "requires Android 11");
+        } else if (!capabilities.isFeatureSupported(MediaCodecInfo.CodecCapabilities.FEATURE_LowLatency)) {
+            skip(MediaFormat.KEY_LOW_LATENCY, "not supported by the encoder");
+        } else {
+            setIfAbsent(format, MediaFormat.KEY_LOW_LATENCY, 1);
+        }
+
+        if (Build.VERSION.SDK_INT < Build.VERSION_CODES.N) {
+            skip(MediaFormat.KEY_INTRA_REFRESH_PERIOD, "requires Android 7");
+        } else if (!capabilities.isFeatureSupported(MediaCodecInfo.CodecCapabilities.FEATURE_IntraRefresh)) {
+            skip(MediaFormat.KEY_INTRA_REFRESH_PERIOD, "not supported by the encoder");
+        } else {
+            // refresh the picture progressively instead of sending large key frames
+            setIfAbsent(format, MediaFormat.KEY_INTRA_REFRESH_PERIOD, INTRA_REFRESH_PERIOD);
+        }
+
+        configureBaselineProfile(format, capabilities);
+
+        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.Q) {
+            // B-frames would delay the output until the next reference frame
+            setIfAbsent(format, MediaFormat.KEY_MAX_B_FRAMES, 0);
+        } else {
+            skip(MediaFormat.KEY_MAX_B_FRAMES, "requires Android 10");
+        }
+    }
+
+    private static void configureBaselineProfile(MediaFormat format, MediaCodecInfo.CodecCapabilities capabilities) {
+        if (format.containsKey(MediaFormat.KEY_PROFILE)) {
+            skip(MediaFormat.KEY_PROFILE, "set by codec options");
+            return;
+        }
+
+        // The baseline profiles have no B-frames; prefer the constrained one (a subset supported by all decoders)
+        MediaCodecInfo.CodecProfileLevel profileLevel = findProfile(capabilities, MediaCodecInfo.CodecProfileLevel.AVCProfileConstrainedBaseline);
+        if (profileLevel == null) {
+            profileLevel = findProfile(capabilities, MediaCodecInfo.CodecProfileLevel.AVCProfileBaseline);
+        }
+        if (profileLevel == null) {
+            skip(MediaFormat.KEY_PROFILE, "baseline profile not supported by the encoder");
+            return;
+        }
+
+        setIfAbsent(format, MediaFormat.KEY_PROFILE, profileLevel.profile);
+        // some encoders ignore the profile if the level is not set
+        setIfAbsent(format, MediaFormat.KEY_LEVEL, profileLevel.level);
+    }
+
+    /**
+     * Return the highest level supported for the given profile, or {@code null} if the profile is not supported.
+     */
+    private static MediaCodecInfo.CodecProfileLevel findProfile(MediaCodecInfo.CodecCapabilities capabilities, int profile) {
+        MediaCodecInfo.CodecProfileLevel result = null;
+        for (MediaCodecInfo.CodecProfileLevel profileLevel : capabilities.profileLevels) {
+            if (profileLevel.profile == profile && (result == null || profileLevel.level > result.level)) {
+                result = profileLevel;
+            }
+        }
+        return result;
+    }
+
+    private static void setIfAbsent(MediaFormat format, String key, int value) {
+        if (format.containsKey(key)) {
+            skip(key, "set by codec options");
+            return;
+        }
+        format.setInteger(key, value);
+        Ln.i("Low latency option applied: " + key + " = " + value);
+    }
+
+    private static void skip(String key, String reason) {
+        Ln.d("Low latency option not applied: " + key + " (" + reason + ")");
+    }
+}
@@ -0,0 +1,188 @@
+package com.genymobile.scrcpy;
+
+import java.io.EOFException;
+import java.io.IOException;
+import java.io.InputStream;
+import java.nio.ByteBuffer;
+import java.nio.channels.GatheringByteChannel;
+import java.util.Arrays;
+
+/**
+ * Multiplex the video and control streams over a single socket.
+ * <p>
+ * The data is sent in frames: a 5-byte header (the channel id, then the payload length) followed by the payload. The stream of a channel
+ * is the concatenation of the payloads of its frames.
+ * <p>
+ * The video and the device messages are written from different threads. Each frame is written at once, so the frames are never
+ * interleaved.
+ */
+public final class Multiplexer {
+
+    public static final int CHANNEL_VIDEO = 0;
+    public static final int CHANNEL_CONTROL = 1;
+
+    private static final int HEADER_LENGTH = 5;
+
+    private final InputStream input;
+    private final GatheringByteChannel output;
+    // Direct, so that it is not copied to a temporary direct buffer on every write
+    private final ByteBuffer header = ByteBuffer.allocateDirect(HEADER_LENGTH);
+    // Reused for every frame (protected by the lock): the header followed by the payload buffers
+    private ByteBuffer[] frameBuffers = {header, null};
+
+    public Multiplexer(InputStream input, GatheringByteChannel output) {
+        this.input = input;
+        this.output = output;
+    }
+
+    /**
+     * Return a channel writing one frame per {@code write()} call.
+     */
+    public GatheringByteChannel getChannel(int channel) {
+        return new FrameChannel(channel);
+    }
+
+    /**
+     * Return the stream of the control channel (the only channel sent by the client).
+     */
+    public InputStream getControlInputStream() {
+        return new ControlInputStream();
+    }
+
+    private synchronized long writeFrame(int channel, ByteBuffer src) throws IOException {
+        frameBuffers[1] = src;
+        return writeFrameBuffers(channel, 1);
+    }
+
+    private synchronized long writeFrame(int channel, ByteBuffer[] srcs, int offset, int length) throws IOException {
+        if (frameBuffers.length < length + 1) {
+            frameBuffers = new ByteBuffer[length + 1];
+            frameBuffers[0] = header;
+        }
+        System.arraycopy(srcs, offset, frameBuffers, 1, length);
+        return writeFrameBuffers(channel, length);
+    }
+
+    /**
+     * Write the header followed by {@code frameBuffers[1..count]}. The caller must hold the lock.
+     */
+    private long writeFrameBuffers(int channel, int count) throws IOException {
+        try {
+            long total = 0;
+            for (int i = 1; i <= count; ++i) {
+                total += frameBuffers[i].remaining();
+            }
+            if (total > Integer.MAX_VALUE) {
+                throw new IOException("Frame too large: " + total);
+            }
+
+            header.clear();
+            header.put((byte) channel);
+            header.putInt((int) total);
+            header.flip();
+
+            IO.writeFully(output, frameBuffers, 0, count + 1);
+            return total;
+        } finally {
+            // do not retain the buffers of the caller
+            Arrays.fill(frameBuffers, 1, count + 1, null);
+        }
+    }
+
+    private final class FrameChannel implements GatheringByteChannel {
+        private final int id;
+
+        private FrameChannel(int id) {
+            this.id = id;
+        }
+
+        @Override
+        public int write(ByteBuffer src) throws IOException {
+            return (int) writeFrame(id, src);
+        }
+
+        @Override
+        public long write(ByteBuffer[] srcs) throws IOException {
+            return writeFrame(id, srcs, 0, srcs.length);
+        }
+
+        @Override
+        public long write(ByteBuffer[] srcs, int offset, int length) throws IOException {
+            return writeFrame(id, srcs, offset, length);
+        }
+
+        @Override
+        public boolean isOpen() {
+            return output.isOpen();
+        }
+
+        @Override
+        public void close() {
+            // the socket is closed by its owner
+        }
+    }
+
+    private final class ControlInputStream extends InputStream {
+        private final byte[] headerBytes = new byte[HEADER_LENGTH];
+        // remaining length of the current frame payload
+        private int remaining;
+
+        @Override
+        public int read() throws IOException {
+            byte[] b = new byte[1];
+            int r = read(b, 0, 1);
+            return r == -1 ? -1 : b[0] & 0xff;
+        }
+
+        @Override
+        public int read(byte[] b, int off, int len) throws IOException {
+            if (len == 0) {
+                return 0;
+            }
+
+            // skip the empty frames
+            while (remaining == 0) {
+                if (!readHeader()) {
+                    return -1;
+                }
+            }
+
+            int r = input.read(b, off, Math.min(len, remaining));
+            if (r == -1) {
+                throw new EOFException("Truncated multiplexed frame");
+            }
+            remaining -= r;
+            return r;
+        }
+
+        /**
+         * Read the next frame header.
+         *
+         * @return {@code false} on end of stream (between two frames)
+         */
+        private boolean readHeader() throws IOException {
+            int head = 0;
+            while (head < HEADER_LENGTH) {
+                int r = input.read(headerBytes, head, HEADER_LENGTH - head);
+                if (r == -1) {
+                    if (head == 0) {
+                        return false;
+                    }
+                    throw new EOFException("Truncated multiplexed frame header");
+                }
+                head += r;
+            }
+
+            int channel = headerBytes[0] & 0xff;
+            if (channel != CHANNEL_CONTROL) {
+                throw new IOException("Unexpected multiplexed channel: " + channel);
+            }
+
+            remaining = ByteBuffer.wrap(headerBytes, 1, 4).getInt();
+            if (remaining < 0) {
+                throw new IOException("Invalid multiplexed frame length: " + (remaining & 0xffffffffL));
+            }
+            return true;
+        }
+    }
+}
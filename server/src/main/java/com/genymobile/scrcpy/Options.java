@@ -8,9 +8,15 @@ public class Options {
     private Ln.Level logLevel = Ln.Level.DEBUG;
     private int maxSize;
     private int bitRate = 8000000;
+    private int minBitRate; // 0 if the bit-rate is not adaptive
+    private int maxBitRate;
     private int maxFps;
     private int lockVideoOrientation = -1;
     private boolean tunnelForward;
+    private boolean multiplex;
+    private int resumeTimeout; // ms, 0 to disable resume
+    private int udpPort; // 0 to send the video over the connection
+    private String udpToken; // the client must send it in its "hello" datagram
     private Rect crop;
     private boolean sendFrameMeta = true; // send PTS so that the client may record properly
     private boolean control = true;
@@ -19,6 +25,7 @@ public class Options {
     private boolean stayAwake;
     private List<CodecOption> codecOptions;
     private String encoderName;
+    private boolean lowLatency;
     private boolean powerOffScreenOnClose;
     private boolean clipboardAutosync = true;
 
@@ -46,6 +53,22 @@ public class Options {
         this.bitRate = bitRate;
     }
 
+    public int getMinBitRate() {
+        return minBitRate;
+    }
+
+    public void setMinBitRate(int minBitRate) {
+        this.minBitRate = minBitRate;
+    }
+
+    public int getMaxBitRate() {
+        return maxBitRate;
+    }
+
+    public void setMaxBitRate(int maxBitRate) {
+        this.maxBitRate = maxBitRate;
+    }
+
     public int getMaxFps() {
         return maxFps;
     }
@@ -70,6 +93,38 @@ public class Options {
         this.tunnelForward = tunnelForward;
     }
 
+    public boolean getMultiplex() {
+        return multiplex;
+    }
+
+    public void setMultiplex(boolean multiplex) {
+        this.multiplex = multiplex;
+    }
+
+    public int getResumeTimeout() {
+        return resumeTimeout;
+    }
+
+    public void setResumeTimeout(int resumeTimeout) {
+        this.resumeTimeout = resumeTimeout;
+    }
+
+    public int getUdpPort() {
+        return udpPort;
+    }
+
+    public void setUdpPort(int udpPort) {
+        this.udpPort = udpPort;
+    }
+
+    public String getUdpToken() {
+        return udpToken;
+    }
+
+    public void setUdpToken(String udpToken) {
+        this.udpToken = udpToken;
+    }
+
     public Rect getCrop() {
         return crop;
     }
@@ -134,6 +189,14 @@ public class Options {
         this.encoderName = encoderName;
     }
 
+    public boolean getLowLatency() {
+        return lowLatency;
+    }
+
+    public void setLowLatency(boolean lowLatency) {
+        this.lowLatency = lowLatency;
+    }
+
     public void setPowerOffScreenOnClose(boolean powerOffScreenOnClose) {
         this.powerOffScreenOnClose = powerOffScreenOnClose;
     }
@@ -0,0 +1,94 @@
+package com.genymobile.scrcpy;
+
+import android.media.MediaCodec;
+
+import java.nio.ByteBuffer;
+
+/**
+ * Encoded packet copied from a codec output buffer, so that the codec buffer can be released immediately.
+ * <p>
+ * The packets are recycled (see {@link PacketQueue}), their data buffer is reused.
+ */
+public final class Packet {
+
+    private static final int NAL_TYPE_SLICE = 1;
+    private static final int NAL_TYPE_IDR_SLICE = 5;
+
+    private ByteBuffer data;
+    private long presentationTimeUs;
+    private int flags; // MediaCodec.BUFFER_FLAG_*
+    private boolean reference;
+
+    /**
+     * Copy the remaining bytes of {@code src}.
+     */
+    public void set(ByteBuffer src, long presentationTimeUs, int flags) {
+        int size = src.remaining();
+        if (data == null || data.capacity() < size) {
+            // with some margin, the following packets are probably larger
+            data = ByteBuffer.allocateDirect(size + size / 2);
+        }
+        data.clear();
+        data.put(src);
+        data.flip();
+        this.presentationTimeUs = presentationTimeUs;
+        this.flags = flags;
+        reference = isReference(data);
+    }
+
+    public ByteBuffer getData() {
+        return data;
+    }
+
+    public long getPresentationTimeUs() {
+        return presentationTimeUs;
+    }
+
+    public int getFlags() {
+        return flags;
+    }
+
+    public boolean isConfig() {
+        return (flags & MediaCodec.BUFFER_FLAG_CODEC_CONFIG) != 0;
+    }
+
+    public boolean isKeyFrame() {
+        return (flags & MediaCodec.BUFFER_FLAG_KEY_FRAME) != 0;
+    }
+
+    public boolean isEndOfStream() {
+        return (flags & MediaCodec.BUFFER_FLAG_END_OF_STREAM) != 0;
+    }
+
+    /**
+     * Indicate whether other frames may depend on this one.
+     * <p>
+     * A non-reference frame may be dropped without breaking the decoding of the following frames.
+     */
+    public boolean isReference() {
+        return reference;
+    }
+
+    /**
+     * Read the {@code nal_ref_idc} of the first slice of an H.264 (Annex B) packet.
+     * <p>
+     * Return true if no slice is found (to never drop a packet by mistake).
+     */
+    static boolean isReference(ByteBuffer buffer) {
+        int start = buffer.position();
+        int end = buffer.limit();
+        for (int i = start; i + 3 < end; ++i) {
+            // start code 00 00 01 (possibly preceded by another 00)
+            if (buffer.get(i) == 0 && buffer.get(i + 1) == 0 && buffer.get(i + 2) == 1) {
+                int header = buffer.get(i + 3) & 0xff;
+                int type = header & 0x1f;
+                if (type == NAL_TYPE_SLICE || type == NAL_TYPE_IDR_SLICE) {
+                    int refIdc = (header >> 5) & 3;
+                    return refIdc != 0;
+                }
+                i += 2;
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,155 @@
+package com.genymobile.scrcpy;
+
+import java.io.IOException;
+import java.util.ArrayDeque;
+import java.util.Iterator;
+
+/**
+ * Bounded queue of encoded packets, from the codec callback thread to the writer thread.
+ * <p>
+ * Under pressure (the writer is blocked by the socket), the non-reference frames are dropped first. If this is not sufficient, all the
+ * queued frames are dropped, and the following frames are dropped until the next key frame (which must be requested to the encoder).
+ * <p>
+ * The config packets are never dropped.
+ */
+public final class PacketQueue {
+
+    private final int capacity;
+    private final ArrayDeque<Packet> queue = new ArrayDeque<>();
+    private final ArrayDeque<Packet> pool = new ArrayDeque<>();
+
+    private boolean waitingForKeyFrame;
+    private int droppedCount;
+    private IOException error;
+
+    public PacketQueue(int capacity) {
+        this.capacity = capacity;
+    }
+
+    /**
+     * Return an empty packet to be pushed, recycled if possible.
+     */
+    public synchronized Packet obtain() {
+        Packet packet = pool.pollFirst();
+        return packet != null ? packet : new Packet();
+    }
+
+    public synchronized void recycle(Packet packet) {
+        pool.addFirst(packet);
+    }
+
+    private void drop(Packet packet) {
+        ++droppedCount;
+        recycle(packet);
+    }
+
+    /**
+     * Push a packet, possibly dropping some frames.
+     *
+     * @return {@code true} if the stream is broken until the next key frame, which must be requested
+     */
+    public synchronized boolean push(Packet packet) {
+        if (packet.isConfig() || packet.isEndOfStream()) {
+            enqueue(packet);
+            return false;
+        }
+
+        if (waitingForKeyFrame) {
+            if (!packet.isKeyFrame()) {
+                // the frame depends on dropped frames
+                drop(packet);
+                return false;
+            }
+            waitingForKeyFrame = false;
+        }
+
+        if (queue.size() >= capacity) {
+            if (!packet.isReference()) {
+                drop(packet);
+                return false;
+            }
+
+            dropFrames(false);
+            if (queue.size() >= capacity) {
+                // the frames must be dropped up to the next key frame
+                dropFrames(true);
+                if (!packet.isKeyFrame()) {
+                    drop(packet);
+                    waitingForKeyFrame = true;
+                    return true;
+                }
+            }
+        }
+
+        enqueue(packet);
+        return false;
+    }
+
+    private void enqueue(Packet packet) {
+        queue.addLast(packet);
+        notify();
+    }
+
+    /**
+     * Drop the queued frames (but not the config packets).
+     *
+     * @param references {@code true} to drop the reference frames too
+     */
+    private void dropFrames(boolean references) {
+        Iterator<Packet> it = queue.iterator();
+        while (it.hasNext()) {
+            Packet packet = it.next();
+            if (!packet.isConfig() && !packet.isEndOfStream() && (references || !packet.isReference())) {
+                it.remove();
+                drop(packet);
+            }
+        }
+    }
+
+    /**
+     * Wait for the next packet.
+     * <p>
+     * The packet must be recycled once written.
+     */
+    public synchronized Packet take() throws IOException, InterruptedException {
+        while (queue.isEmpty() && error == null) {
+            wait();
+        }
+        if (error != null) {
+            throw error;
+        }
+        return queue.pollFirst();
+    }
+
+    /**
+     * Make the writer fail (on encoder error).
+     */
+    public synchronized void fail(IOException e) {
+        error = e;
+        notify();
+    }
+
+    /**
+     * Drop all the queued packets (on encoder restart).
+     */
+    public synchronized void clear() {
+        for (Packet packet : queue) {
+            recycle(packet);
+        }
+        queue.clear();
+        waitingForKeyFrame = false;
+    }
+
+    /**
+     * Return the number of frames dropped since the last call.
+     */
+    public synchronized int consumeDroppedCount() {
+        int count = droppedCount;
+        droppedCount = 0;
+        return count;
+    }
+
+    synchronized int size() {
+        return queue.size();
+    }
+}
@@ -3,6 +3,12 @@ package com.genymobile.scrcpy;
 import java.util.Objects;
 
 public class Point {
+
+    /**
+     * A packed value which is never a valid point (see {@link #pack(int, int)}).
+     */
+    public static final long NONE = Long.MIN_VALUE;
+
     private final int x;
     private final int y;
 
@@ -19,6 +25,39 @@ public class Point {
         return y;
     }
 
+    /**
+     * Pack the coordinates of a point into a long, to return a point from a method called for every input event without allocation.
+     */
+    public static long pack(int x, int y) {
+        return (long) x << 32 | y & 0xffffffffL;
+    }
+
+    public static int unpackX(long packed) {
+        return (int) (packed >> 32);
+    }
+
+    public static int unpackY(long packed) {
+        return (int) packed;
+    }
+
+    /**
+     * Rotate a point in a screen of the given size, like {@link Position#rotate(int)}, but without allocation.
+     *
+     * @return the rotated point, packed by {@link #pack(int, int)}
+     */
+    public static long rotate(int x, int y, int screenWidth, int screenHeight, int rotation) {
+        switch (rotation) {
+            case 1:
+                return pack(screenHeight - y, x);
+            case 2:
+                return pack(screenWidth - x, screenHeight - y);
+            case 3:
+                return pack(y, screenWidth - x);
+            default:
+                return pack(x, y);
+        }
+    }
+
     @Override
     public boolean equals(Object o) {
         if (this == o) {
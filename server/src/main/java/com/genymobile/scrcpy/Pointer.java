@@ -12,7 +12,8 @@ public class Pointer {
      */
     private final int localId;
 
-    private Point point;
+    private int x;
+    private int y;
     private float pressure;
     private boolean up;
 
@@ -29,12 +30,17 @@ public class Pointer {
         return localId;
     }
 
-    public Point getPoint() {
-        return point;
+    public int getX() {
+        return x;
     }
 
-    public void setPoint(Point point) {
-        this.point = point;
+    public int getY() {
+        return y;
+    }
+
+    public void setPoint(int x, int y) {
+        this.x = x;
+        this.y = y;
     }
 
     public float getPressure() {
@@ -2,67 +2,106 @@ package com.genymobile.scrcpy;
 
 import android.view.MotionEvent;
 
-import java.util.ArrayList;
-import java.util.List;
-
 public class PointersState {
 
     public static final int MAX_POINTERS = 10;
 
-    private final List<Pointer> pointers = new ArrayList<>();
+    // The map from pointer id to index uses open addressing with linear probing: its capacity (a power of 2) is large enough to keep the
+    // probe sequences short
+    private static final int MAP_BITS = 5;
+    private static final int MAP_CAPACITY = 1 << MAP_BITS;
+    private static final int MAP_MASK = MAP_CAPACITY - 1;
+    private static final int MAP_EMPTY = -1;
 
-    private int indexOf(long id) {
-        for (int i = 0; i < pointers.size(); ++i) {
-            Pointer pointer = pointers.get(i);
-            if (pointer.getId() == id) {
-                return i;
-            }
+    private final Pointer[] pointers = new Pointer[MAX_POINTERS];
+    private int count;
+
+    // Bit i is set if the local id i is used
+    private int usedLocalIds;
+
+    private final long[] mapIds = new long[MAP_CAPACITY];
+    private final int[] mapIndexes = new int[MAP_CAPACITY];
+
+    public PointersState() {
+        for (int i = 0; i < MAP_CAPACITY; ++i) {
+            mapIndexes[i] = MAP_EMPTY;
         }
-        return -1;
     }
 
-    private boolean isLocalIdAvailable(int localId) {
-        for (int i = 0; i < pointers.size(); ++i) {
-            Pointer pointer = pointers.get(i);
-            if (pointer.getLocalId() == localId) {
-                return false;
-            }
+    private static int hash(long id) {
+        // Fibonacci hashing, the client pointer ids may be close to each other
+        int h = (int) (id ^ (id >>> 32));
+        return (h * 0x9E3779B9) >>> (32 - MAP_BITS);
+    }
+
+    /**
+     * Return the map slot containing {@code id}, or the empty slot where it would be inserted.
+     */
+    private int findSlot(long id) {
+        int slot = hash(id);
+        while (mapIndexes[slot] != MAP_EMPTY && mapIds[slot] != id) {
+            slot = (slot + 1) & MAP_MASK;
         }
-        return true;
+        return slot;
     }
 
-    private int nextUnusedLocalId() {
-        for (int localId = 0; localId < MAX_POINTERS; ++localId) {
-            if (isLocalIdAvailable(localId)) {
-                return localId;
+    private void mapRemove(long id) {
+        int hole = findSlot(id);
+        if (mapIndexes[hole] == MAP_EMPTY) {
+            return;
+        }
+
+        // Move back the following entries of the probe sequence, so that no lookup stops at the hole
+        int slot = hole;
+        while (true) {
+            slot = (slot + 1) & MAP_MASK;
+            if (mapIndexes[slot] == MAP_EMPTY) {
+                break;
+            }
+            int home = hash(mapIds[slot]);
+            if (((slot - home) & MAP_MASK) >= ((slot - hole) & MAP_MASK)) {
+                // the hole is between the home slot of the entry and its current slot
+                mapIds[hole] = mapIds[slot];
+                mapIndexes[hole] = mapIndexes[slot];
+                hole = slot;
             }
         }
-        return -1;
+        mapIndexes[hole] = MAP_EMPTY;
     }
 
     public Pointer get(int index) {
-        return pointers.get(index);
+        if (index >= count) {
+            throw new IndexOutOfBoundsException("Index: " + index + ", size: " + count);
+        }
+        return pointers[index];
+    }
+
+    public int size() {
+        return count;
     }
 
     public int getPointerIndex(long id) {
-        int index = indexOf(id);
-        if (index != -1) {
+        int slot = findSlot(id);
+        if (mapIndexes[slot] != MAP_EMPTY) {
             // already exists, return it
-            return index;
+            return mapIndexes[slot];
         }
-        if (pointers.size() >= MAX_POINTERS) {
+        if (count >= MAX_POINTERS) {
             // it's full
             return -1;
         }
-        // id 0 is reserved for mouse events
-        int localId = nextUnusedLocalId();
-        if (localId == -1) {
-            throw new AssertionError("pointers.size() < maxFingers implies that a local id is available");
+        // use the lowest local id available
+        int localId = Integer.numberOfTrailingZeros(~usedLocalIds);
+        if (localId >= MAX_POINTERS) {
+            throw new AssertionError("count < MAX_POINTERS implies that a local id is available");
         }
-        Pointer pointer = new Pointer(id, localId);
-        pointers.add(pointer);
-        // return the index of the pointer
-        return pointers.size() - 1;
+        usedLocalIds |= 1 << localId;
+
+        int index = count++;
+        pointers[index] = new Pointer(id, localId);
+        mapIds[slot] = id;
+        mapIndexes[slot] = index;
+        return index;
     }
 
     /**
@@ -73,31 +112,44 @@ public class PointersState {
      * @return The number of items initialized (the number of pointers).
      */
     public int update(MotionEvent.PointerProperties[] props, MotionEvent.PointerCoords[] coords) {
-        int count = pointers.size();
-        for (int i = 0; i < count; ++i) {
-            Pointer pointer = pointers.get(i);
+        int pointerCount = count;
+        for (int i = 0; i < pointerCount; ++i) {
+            Pointer pointer = pointers[i];
 
             // id 0 is reserved for mouse events
             props[i].id = pointer.getLocalId();
 
-            Point point = pointer.getPoint();
-            coords[i].x = point.getX();
-            coords[i].y = point.getY();
+            coords[i].x = pointer.getX();
+            coords[i].y = pointer.getY();
             coords[i].pressure = pointer.getPressure();
         }
         cleanUp();
-        return count;
+        return pointerCount;
     }
 
     /**
      * Remove all pointers which are UP.
+     * <p>
+     * The remaining pointers keep their order.
      */
-    private void cleanUp() {
-        for (int i = pointers.size() - 1; i >= 0; --i) {
-            Pointer pointer = pointers.get(i);
+    void cleanUp() {
+        int kept = 0;
+        for (int i = 0; i < count; ++i) {
+            Pointer pointer = pointers[i];
             if (pointer.isUp()) {
-                pointers.remove(i);
+                mapRemove(pointer.getId());
+                usedLocalIds &= ~(1 << pointer.getLocalId());
+            } else {
+                if (kept != i) {
+                    pointers[kept] = pointer;
+                    mapIndexes[findSlot(pointer.getId())] = kept;
+                }
+                ++kept;
             }
         }
+        for (int i = kept; i < count; ++i) {
+            pointers[i] = null;
+        }
+        count = kept;
     }
 }
@@ -0,0 +1,231 @@
+package com.genymobile.scrcpy;
+
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.util.Arrays;
+
+/**
+ * Packetize the H.264 stream in RTP packets (RFC 3550), protected by XOR FEC packets.
+ * <p>
+ * The NAL units are sent in single NAL unit packets, or fragmented in FU-A packets (RFC 6184). All the packets of an encoder output buffer
+ * (a frame or the codec config) have the same timestamp (the PTS at 90kHz), and the marker bit is set on the last one.
+ * <p>
+ * After every {@code fecGroupSize} media packets, and after the last packet of a buffer, a FEC packet (with a distinct payload type and its
+ * own sequence numbers) contains the XOR of the protected blocks (marker, payload length and payload) of the group, so that the client can
+ * repair a single loss in the group. Its payload is the sequence number of the first protected packet (2 bytes), the number of protected
+ * packets (1 byte), a reserved byte, then the XOR of the blocks.
+ */
+public final class RtpPacketizer {
+
+    public interface DatagramSink {
+        void send(byte[] data, int length) throws IOException;
+    }
+
+    public static final int PAYLOAD_TYPE_H264 = 96;
+    public static final int PAYLOAD_TYPE_FEC = 97;
+
+    public static final int HEADER_LENGTH = 12;
+    public static final int FEC_HEADER_LENGTH = 4;
+    public static final int FEC_BLOCK_HEADER_LENGTH = 3;
+    public static final int MAX_PAYLOAD_LENGTH = 1400;
+    public static final int MAX_DATAGRAM_LENGTH = HEADER_LENGTH + FEC_HEADER_LENGTH + FEC_BLOCK_HEADER_LENGTH + MAX_PAYLOAD_LENGTH;
+
+    public static final long NO_PTS = -1;
+
+    private static final int NAL_TYPE_FU_A = 28;
+    private static final int FU_HEADER_LENGTH = 2;
+
+    private final DatagramSink sink;
+    private final int fecGroupSize; // 0 to disable FEC
+    private final int ssrc;
+
+    private final byte[] packet = new byte[MAX_DATAGRAM_LENGTH];
+    private final byte[] fecPacket = new byte[MAX_DATAGRAM_LENGTH];
+
+    private int seq;
+    private int fecSeq;
+    private int timestamp;
+
+    // The current FEC group
+    private int fecBaseSeq;
+    private int fecCount;
+    private int fecBlockLength;
+
+    public RtpPacketizer(DatagramSink sink, int fecGroupSize, int ssrc) {
+        if (fecGroupSize < 0 || fecGroupSize > 255) {
+            throw new IllegalArgumentException("Invalid FEC group size: " + fecGroupSize);
+        }
+        this.sink = sink;
+        this.fecGroupSize = fecGroupSize;
+        this.ssrc = ssrc;
+    }
+
+    /**
+     * Packetize an encoder output buffer (in Annex B format), without consuming it.
+     *
+     * @param pts the presentation timestamp in microseconds, or {@link #NO_PTS} for the codec config (sent with the previous timestamp)
+     */
+    public void packetize(ByteBuffer buffer, long pts) throws IOException {
+        if (pts != NO_PTS) {
+            // 90kHz, wraps around
+            timestamp = (int) (pts * 9 / 100);
+        }
+
+        ByteBuffer data = buffer.duplicate();
+        int end = data.limit();
+
+        // Each NAL unit is sent once the next one is found, to know which one is the last
+        int nalStart = -1;
+        int nalEnd = -1;
+        int startCode = findStartCode(data, data.position(), end);
+        while (startCode != -1) {
+            int nextNalStart = startCode + 3;
+            int nextStartCode = findStartCode(data, nextNalStart, end);
+            int nextNalEnd = nextStartCode != -1 ? nextStartCode : end;
+            // remove the trailing zeros (the first byte of a 4-byte start code)
+            while (nextNalEnd > nextNalStart && data.get(nextNalEnd - 1) == 0) {
+                --nextNalEnd;
+            }
+            if (nextNalEnd > nextNalStart) {
+                if (nalStart != -1) {
+                    sendNal(data, nalStart, nalEnd, false);
+                }
+                nalStart = nextNalStart;
+                nalEnd = nextNalEnd;
+            }
+            startCode = nextStartCode;
+        }
+
+        if (nalStart != -1) {
+            sendNal(data, nalStart, nalEnd, true);
+        }
+
+        // a FEC group never spans several buffers, so that a loss can be repaired without waiting for the next frame
+        flushFec();
+    }
+
+    /**
+     * Return the index of the next start code (00 00 01) in {@code [from, end)}, or -1.
+     */
+    private static int findStartCode(ByteBuffer data, int from, int end) {
+        int i = from;
+        while (i + 2 < end) {
+            int third = data.get(i + 2) & 0xff;
+            if (third > 1) {
+                // no start code may begin at i, i+1 or i+2
+                i += 3;
+            } else {
+                if (third == 1 && data.get(i) == 0 && data.get(i + 1) == 0) {
+                    return i;
+                }
+                ++i;
+            }
+        }
+        return -1;
+    }
+
+    private void sendNal(ByteBuffer data, int start, int end, boolean last) throws IOException {
+        int length = end - start;
+        if (length <= MAX_PAYLOAD_LENGTH) {
+            // single NAL unit packet
+            data.position(start);
+            data.get(packet, HEADER_LENGTH, length);
+            sendMedia(length, last);
+            return;
+        }
+
+        // fragmentation unit (FU-A), the NAL unit header is split into the FU indicator and the FU header
+        int nalHeader = data.get(start);
+        int offset = start + 1;
+        boolean first = true;
+        while (offset < end) {
+            int chunk = Math.min(end - offset, MAX_PAYLOAD_LENGTH - FU_HEADER_LENGTH);
+            boolean lastFragment = offset + chunk == end;
+
+            int fuHeader = nalHeader & 0x1f;
+            if (first) {
+                fuHeader |= 0x80;
+            }
+            if (lastFragment) {
+                fuHeader |= 0x40;
+            }
+            packet[HEADER_LENGTH] = (byte) ((nalHeader & 0xe0) | NAL_TYPE_FU_A);
+            packet[HEADER_LENGTH + 1] = (byte) fuHeader;
+            data.position(offset);
+            data.get(packet, HEADER_LENGTH + FU_HEADER_LENGTH, chunk);
+            sendMedia(FU_HEADER_LENGTH + chunk, last && lastFragment);
+
+            offset += chunk;
+            first = false;
+        }
+    }
+
+    private void sendMedia(int payloadLength, boolean marker) throws IOException {
+        writeHeader(packet, PAYLOAD_TYPE_H264, marker, seq);
+        if (fecGroupSize > 0) {
+            addToFecGroup(payloadLength, marker);
+        }
+        seq = (seq + 1) & 0xffff;
+
+        sink.send(packet, HEADER_LENGTH + payloadLength);
+
+        if (fecCount == fecGroupSize) {
+            flushFec();
+        }
+    }
+
+    private void addToFecGroup(int payloadLength, boolean marker) {
+        if (fecCount == 0) {
+            fecBaseSeq = seq;
+            fecBlockLength = 0;
+            Arrays.fill(fecPacket, (byte) 0);
+        }
+
+        int offset = HEADER_LENGTH + FEC_HEADER_LENGTH;
+        if (marker) {
+            fecPacket[offset] ^= 1;
+        }
+        fecPacket[offset + 1] ^= (byte) (payloadLength >> 8);
+        fecPacket[offset + 2] ^= (byte) payloadLength;
+        offset += FEC_BLOCK_HEADER_LENGTH;
+        for (int i = 0; i < payloadLength; ++i) {
+            fecPacket[offset + i] ^= packet[HEADER_LENGTH + i];
+        }
+
+        fecBlockLength = Math.max(fecBlockLength, FEC_BLOCK_HEADER_LENGTH + payloadLength);
+        ++fecCount;
+    }
+
+    private void flushFec() throws IOException {
+        if (fecCount == 0) {
+            return;
+        }
+
+        writeHeader(fecPacket, PAYLOAD_TYPE_FEC, false, fecSeq);
+        fecSeq = (fecSeq + 1) & 0xffff;
+
+        fecPacket[HEADER_LENGTH] = (byte) (fecBaseSeq >> 8);
+        fecPacket[HEADER_LENGTH + 1] = (byte) fecBaseSeq;
+        fecPacket[HEADER_LENGTH + 2] = (byte) fecCount;
+        fecPacket[HEADER_LENGTH + 3] = 0; // reserved
+        int length = HEADER_LENGTH + FEC_HEADER_LENGTH + fecBlockLength;
+        fecCount = 0;
+
+        sink.send(fecPacket, length);
+    }
+
+    private void writeHeader(byte[] buffer, int payloadType, boolean marker, int sequenceNumber) {
+        buffer[0] = (byte) 0x80; // version 2, no padding, no extension, no CSRC
+        buffer[1] = (byte) (marker ? 0x80 | payloadType : payloadType);
+        buffer[2] = (byte) (sequenceNumber >> 8);
+        buffer[3] = (byte) sequenceNumber;
+        buffer[4] = (byte) (timestamp >> 24);
+        buffer[5] = (byte) (timestamp >> 16);
+        buffer[6] = (byte) (timestamp >> 8);
+        buffer[7] = (byte) timestamp;
+        buffer[8] = (byte) (ssrc >> 24);
+        buffer[9] = (byte) (ssrc >> 16);
+        buffer[10] = (byte) (ssrc >> 8);
+        buffer[11] = (byte) ssrc;
+    }
+}
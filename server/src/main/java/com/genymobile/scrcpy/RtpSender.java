@@ -0,0 +1,106 @@
+package com.genymobile.scrcpy;
+
+import android.media.MediaCodec;
+
+import java.io.Closeable;
+import java.io.IOException;
+import java.net.DatagramPacket;
+import java.net.DatagramSocket;
+import java.nio.ByteBuffer;
+import java.nio.charset.StandardCharsets;
+import java.security.MessageDigest;
+import java.util.Arrays;
+import java.util.Random;
+
+/**
+ * Send the video stream to the client over UDP (see {@link RtpPacketizer}).
+ * <p>
+ * The client address is not known in advance (and it may be behind a NAT), so the client sends a "hello" datagram first, and the stream is
+ * sent to its source address.
+ * <p>
+ * Any host on the network may send a datagram, so the "hello" must contain the token received from the client on the command line (over
+ * adb), otherwise it is ignored.
+ */
+public final class RtpSender implements Closeable, RtpPacketizer.DatagramSink {
+
+    private static final String HELLO_PREFIX = "scrcpy";
+    private static final int HELLO_TIMEOUT = 10000; // ms
+
+    private static final int FEC_GROUP_SIZE = 10;
+
+    private final DatagramSocket socket;
+    private final byte[] hello;
+    private final RtpPacketizer packetizer;
+    private final DatagramPacket datagram = new DatagramPacket(new byte[0], 0);
+
+    // The last codec config, sent again before each key frame (the client may have lost it)
+    private ByteBuffer config;
+    private boolean configJustSent;
+
+    private RtpSender(DatagramSocket socket, String token) {
+        this.socket = socket;
+        hello = (HELLO_PREFIX + token).getBytes(StandardCharsets.US_ASCII);
+        packetizer = new RtpPacketizer(this, FEC_GROUP_SIZE, new Random().nextInt());
+    }
+
+    /**
+     * Open the UDP socket.
+     * <p>
+     * It must be open before the client sends its "hello" datagram, otherwise the datagram would be lost.
+     *
+     * @param token the secret the client must send in its "hello" datagram
+     */
+    public static RtpSender open(int port, String token) throws IOException {
+        if (token == null || token.isEmpty()) {
+            throw new IllegalArgumentException("A token is required to stream over UDP");
+        }
+        return new RtpSender(new DatagramSocket(port), token);
+    }
+
+    /**
+     * Wait for the "hello" datagram of the client (containing the token), and send the stream to its source address.
+     */
+    public void awaitClient() throws IOException {
+        byte[] buffer = new byte[hello.length + 1];
+        DatagramPacket packet = new DatagramPacket(buffer, buffer.length);
+        socket.setSoTimeout(HELLO_TIMEOUT);
+        do {
+            packet.setLength(buffer.length);
+            socket.receive(packet);
+            // Compare in constant time, not to leak the token
+        } while (!MessageDigest.isEqual(Arrays.copyOf(buffer, packet.getLength()), hello));
+        socket.setSoTimeout(0);
+        socket.connect(packet.getSocketAddress());
+        Ln.i("Streaming video over UDP to " + packet.getSocketAddress());
+    }
+
+    /**
+     * Send an encoder output buffer, without consuming it.
+     *
+     * @param pts the presentation timestamp in microseconds (ignored for the codec config)
+     */
+    public void send(long pts, int flags, ByteBuffer codecBuffer) throws IOException {
+        boolean isConfig = (flags & MediaCodec.BUFFER_FLAG_CODEC_CONFIG) != 0;
+        if (isConfig) {
+            config = ByteBuffer.allocate(codecBuffer.remaining());
+            config.put(codecBuffer.duplicate());
+            config.flip();
+        } else if ((flags & MediaCodec.BUFFER_FLAG_KEY_FRAME) != 0 && config != null && !configJustSent) {
+            packetizer.packetize(config, RtpPacketizer.NO_PTS);
+        }
+
+        packetizer.packetize(codecBuffer, isConfig ? RtpPacketizer.NO_PTS : pts);
+        configJustSent = isConfig;
+    }
+
+    @Override
+    public void send(byte[] data, int length) throws IOException {
+        datagram.setData(data, 0, length);
+        socket.send(datagram);
+    }
+
+    @Override
+    public void close() {
+        socket.close();
+    }
+}
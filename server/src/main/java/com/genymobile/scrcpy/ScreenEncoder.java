@@ -8,12 +8,15 @@ import android.media.MediaCodecInfo;
 import android.media.MediaCodecList;
 import android.media.MediaFormat;
 import android.os.Build;
+import android.os.Bundle;
+import android.os.Handler;
+import android.os.HandlerThread;
 import android.os.IBinder;
 import android.view.Surface;
 
-import java.io.FileDescriptor;
 import java.io.IOException;
 import java.nio.ByteBuffer;
+import java.nio.channels.GatheringByteChannel;
 import java.util.ArrayList;
 import java.util.Arrays;
 import java.util.List;
@@ -21,28 +24,69 @@ import java.util.concurrent.atomic.AtomicBoolean;
 
 public class ScreenEncoder implements Device.RotationListener {
 
+    /**
+     * Provide a new channel when the connection to the client is lost.
+     */
+    public interface ChannelResumer {
+        /**
+         * Wait for the client to reconnect.
+         *
+         * @param failedChannel the channel which failed
+         * @return the channel of the new connection
+         * @throws IOException if the connection could not be resumed
+         */
+        GatheringByteChannel resume(GatheringByteChannel failedChannel) throws IOException;
+    }
+
     private static final int DEFAULT_I_FRAME_INTERVAL = 10; // seconds
     private static final int REPEAT_FRAME_DELAY_US = 100_000; // repeat after 100ms
     private static final String KEY_MAX_FPS_TO_ENCODER = "max-fps-to-encoder";
 
     private static final int NO_PTS = -1;
 
+    // Packets waiting to be written to the socket (in asynchronous mode)
+    private static final int PACKET_QUEUE_CAPACITY = 8;
+
     private final AtomicBoolean rotationChanged = new AtomicBoolean();
-    private final ByteBuffer headerBuffer = ByteBuffer.allocate(12);
+    private final AtomicBoolean videoSettingsChanged = new AtomicBoolean();
+    private final AtomicBoolean connectionResumed = new AtomicBoolean();
+    private final AtomicBoolean keyFrameRequested = new AtomicBoolean();
+    // Direct, so that it is not copied to a temporary direct buffer on every write
+    private final ByteBuffer headerBuffer = ByteBuffer.allocateDirect(12);
+    // The header and the codec buffer, written together
+    private final ByteBuffer[] packetBuffers = new ByteBuffer[2];
+    private final PacketQueue packetQueue = new PacketQueue(PACKET_QUEUE_CAPACITY);
+    private final FramePacer framePacer;
+
+    private GatheringByteChannel channel;
+    private ChannelResumer channelResumer; // may be null
+    private RtpSender rtpSender; // may be null
 
     private String encoderName;
     private List<CodecOption> codecOptions;
     private int bitRate;
+    private final BitRateController bitRateController; // may be null
     private int maxFps;
     private boolean sendFrameMeta;
+    private boolean lowLatency;
     private long ptsOrigin;
+    // when the last encoding session stopped, to measure the reconfiguration time (0 on the first session)
+    private long reconfigureStartNanos;
+
+    // requested from the controller thread, applied on encoder restart
+    private int pendingMaxSize;
+    private int pendingMaxFps;
 
-    public ScreenEncoder(boolean sendFrameMeta, int bitRate, int maxFps, List<CodecOption> codecOptions, String encoderName) {
+    public ScreenEncoder(boolean sendFrameMeta, int bitRate, BitRateController bitRateController, int maxFps, List<CodecOption> codecOptions,
+            String encoderName, boolean lowLatency) {
         this.sendFrameMeta = sendFrameMeta;
-        this.bitRate = bitRate;
+        this.bitRate = bitRateController != null ? bitRateController.getInitialBitRate() : bitRate;
+        this.bitRateController = bitRateController;
         this.maxFps = maxFps;
+        this.framePacer = new FramePacer(REPEAT_FRAME_DELAY_US, maxFps);
         this.codecOptions = codecOptions;
         this.encoderName = encoderName;
+        this.lowLatency = lowLatency;
     }
 
     @Override
@@ -50,11 +94,63 @@ public class ScreenEncoder implements Device.RotationListener {
         rotationChanged.set(true);
     }
 
+    /**
+     * Resume the stream over a new connection if the channel fails (instead of stopping).
+     */
+    public void setChannelResumer(ChannelResumer channelResumer) {
+        this.channelResumer = channelResumer;
+    }
+
+    /**
+     * Send the video over UDP instead of the channel (which is then unused).
+     */
+    public void setRtpSender(RtpSender rtpSender) {
+        this.rtpSender = rtpSender;
+    }
+
+    /**
+     * Request a key frame, for example when the client could not recover from a packet loss.
+     */
+    public void requestKeyFrame() {
+        keyFrameRequested.set(true);
+    }
+
     public boolean consumeRotationChange() {
         return rotationChanged.getAndSet(false);
     }
 
-    public void streamScreen(Device device, FileDescriptor fd) throws IOException {
+    /**
+     * Request to restart the encoder with a new max size and max fps, the same way as on rotation.
+     */
+    public void setVideoSettings(int maxSize, int maxFps) {
+        synchronized (this) {
+            pendingMaxSize = maxSize;
+            pendingMaxFps = maxFps;
+        }
+        videoSettingsChanged.set(true);
+    }
+
+    private MediaFormat applyVideoSettings(Device device, MediaCodec codec) {
+        int maxSize;
+        synchronized (this) {
+            maxSize = pendingMaxSize;
+            maxFps = pendingMaxFps;
+        }
+        device.setMaxSize(maxSize);
+        framePacer.setMaxFps(maxFps);
+        Ln.i("Video settings changed: max size " + maxSize + ", max fps " + maxFps);
+        return createFormat(codec);
+    }
+
+    private MediaFormat createFormat(MediaCodec codec) {
+        MediaFormat format = createFormat(bitRate, maxFps, codecOptions);
+        if (lowLatency) {
+            LowLatency.configure(format, codec.getCodecInfo());
+        }
+        return format;
+    }
+
+    public void streamScreen(Device device, GatheringByteChannel channel) throws IOException {
         Workarounds.prepareMainLooper();
         if (Build.BRAND.equalsIgnoreCase("meizu")) {
             // <https://github.com/Genymobile/scrcpy/issues/240>
@@ -62,94 +158,304 @@ public class ScreenEncoder implements Device.RotationListener {
             Workarounds.fillAppInfo();
         }
 
-        internalStreamScreen(device, fd);
+        this.channel = channel;
+        internalStreamScreen(device);
     }
 
-    private void internalStreamScreen(Device device, FileDescriptor fd) throws IOException {
-        MediaFormat format = createFormat(bitRate, maxFps, codecOptions);
+    private void internalStreamScreen(Device device) throws IOException {
         device.setRotationListener(this);
         boolean alive;
+        // The codec and the display are kept across the reconfigurations (on rotation or on video settings change), only the codec
+        // configuration and the display surface change
+        MediaCodec codec = createCodec(encoderName);
+        MediaFormat format = createFormat(codec);
+        IBinder display = createDisplay();
+
+        // Since Android 6, the output buffers are received on a dedicated thread, and written to the socket by the current thread, so
+        // that a slow socket does not stall the encoder
+        boolean async = Build.VERSION.SDK_INT >= Build.VERSION_CODES.M;
+        HandlerThread callbackThread = null;
+        Handler callbackHandler = null;
+        MediaCodec.Callback callback = null;
+        if (async) {
+            callbackThread = new HandlerThread("encoder");
+            callbackThread.start();
+            callbackHandler = new Handler(callbackThread.getLooper());
+            callback = new EncoderCallback();
+        }
+
         try {
             do {
-                MediaCodec codec = createCodec(encoderName);
-                IBinder display = createDisplay();
+                if (videoSettingsChanged.getAndSet(false)) {
+                    format = applyVideoSettings(device, codec);
+                }
                 ScreenInfo screenInfo = device.getScreenInfo();
                 Rect contentRect = screenInfo.getContentRect();
                 // include the locked video orientation
-                Rect videoRect = screenInfo.getVideoSize().toRect();
+                Size videoSize = screenInfo.getVideoSize();
+                Rect videoRect = videoSize.toRect();
                 // does not include the locked video orientation
                 Rect unlockedVideoRect = screenInfo.getUnlockedVideoSize().toRect();
                 int videoRotation = screenInfo.getVideoRotation();
                 int layerStack = device.getLayerStack();
 
                 setSize(format, videoRect.width(), videoRect.height());
-                configure(codec, format);
-                Surface surface = codec.createInputSurface();
-                setDisplaySurface(display, surface, videoRotation, contentRect, unlockedVideoRect, layerStack);
-                codec.start();
+                if (bitRateController != null) {
+                    // restart at the current adapted bit-rate
+                    bitRateController.consumeBitRateChange();
+                    format.setInteger(MediaFormat.KEY_BIT_RATE, bitRateController.getBitRate());
+                }
+                framePacer.reset();
+                Surface surface = null;
                 try {
-                    alive = encode(codec, fd);
+                    if (async) {
+                        // must be set before configure(), after each reset()
+                        codec.setCallback(callback, callbackHandler);
+                    }
+                    configure(codec, format);
+                    surface = codec.createInputSurface();
+                    setDisplaySurface(display, surface, videoRotation, contentRect, unlockedVideoRect, layerStack);
+                    codec.start();
+                    if (reconfigureStartNanos != 0) {
+                        Ln.i("Encoder reconfigured in " + formatElapsedMs(reconfigureStartNanos));
+                    }
+
+                    if (async) {
+                        alive = encodeAsync(codec, device, display, videoSize);
+                    } else {
+                        alive = encode(codec, device, display, videoSize);
+                    }
+                    reconfigureStartNanos = System.nanoTime();
                     // do not call stop() on exception, it would trigger an IllegalStateException
                     codec.stop();
                 } finally {
-                    destroyDisplay(display);
-                    codec.release();
-                    surface.release();
+                    // back to the uninitialized state, so that the codec can be configured again
+                    codec.reset();
+                    packetQueue.clear();
+                    if (surface != null) {
+                        surface.release();
+                    }
                 }
             } while (alive);
         } finally {
             device.setRotationListener(null);
+            destroyDisplay(display);
+            codec.release();
+            if (callbackThread != null) {
+                callbackThread.quit();
+            }
         }
     }
 
-    private boolean encode(MediaCodec codec, FileDescriptor fd) throws IOException {
+    private static String formatElapsedMs(long startNanos) {
+        float elapsedMs = (System.nanoTime() - startNanos) / 1_000_000f;
+        return elapsedMs + " ms";
+    }
+
+    /**
+     * Return true if the encoder must be restarted.
+     * <p>
+     * A rotation which does not change the video size (by 180°) only updates the display projection.
+     */
+    private boolean mustRestart(Device device, IBinder display, Size videoSize) {
+        if (videoSettingsChanged.get()) {
+            return true;
+        }
+        if (connectionResumed.getAndSet(false)) {
+            // the new connection must start with a config packet and a key frame
+            return true;
+        }
+        if (!consumeRotationChange()) {
+            return false;
+        }
+
+        long start = System.nanoTime();
+        ScreenInfo screenInfo = device.getScreenInfo();
+        if (!screenInfo.getVideoSize().equals(videoSize)) {
+            // must restart encoding with new size
+            return true;
+        }
+
+        setDisplayProjection(display, screenInfo.getVideoRotation(), screenInfo.getContentRect(), screenInfo.getUnlockedVideoSize().toRect());
+        Ln.i("Display projection updated in " + formatElapsedMs(start));
+        return false;
+    }
+
+    private boolean encode(MediaCodec codec, Device device, IBinder display, Size videoSize) throws IOException {
         boolean eof = false;
         MediaCodec.BufferInfo bufferInfo = new MediaCodec.BufferInfo();
 
-        while (!consumeRotationChange() && !eof) {
+        while (!mustRestart(device, display, videoSize) && !eof) {
             int outputBufferId = codec.dequeueOutputBuffer(bufferInfo, -1);
             eof = (bufferInfo.flags & MediaCodec.BUFFER_FLAG_END_OF_STREAM) != 0;
             try {
-                if (consumeRotationChange()) {
-                    // must restart encoding with new size
+                if (mustRestart(device, display, videoSize)) {
                     break;
                 }
                 if (outputBufferId >= 0) {
                     ByteBuffer codecBuffer = codec.getOutputBuffer(outputBufferId);
 
-                    if (sendFrameMeta) {
-                        writeFrameMeta(fd, bufferInfo, codecBuffer.remaining());
+                    if (framePacer.accept(codecBuffer, bufferInfo.presentationTimeUs, bufferInfo.flags)) {
+                        write(bufferInfo.presentationTimeUs, bufferInfo.flags, codecBuffer);
                     }
-
-                    IO.writeFully(fd, codecBuffer);
                 }
             } finally {
                 if (outputBufferId >= 0) {
                     codec.releaseOutputBuffer(outputBufferId, false);
                 }
             }
+
+            if (bitRateController != null) {
+                applyBitRateChange(codec);
+            }
+            if (keyFrameRequested.getAndSet(false)) {
+                requestKeyFrame(codec);
+            }
         }
 
         return !eof;
     }
 
-    private void writeFrameMeta(FileDescriptor fd, MediaCodec.BufferInfo bufferInfo, int packetSize) throws IOException {
-        headerBuffer.clear();
+    private boolean encodeAsync(MediaCodec codec, Device device, IBinder display, Size videoSize) throws IOException {
+        boolean eof = false;
+
+        while (!mustRestart(device, display, videoSize) && !eof) {
+            Packet packet;
+            try {
+                packet = packetQueue.take();
+            } catch (InterruptedException e) {
+                Thread.currentThread().interrupt();
+                return false;
+            }
+
+            try {
+                eof = packet.isEndOfStream();
+                if (mustRestart(device, display, videoSize)) {
+                    break;
+                }
+                write(packet.getPresentationTimeUs(), packet.getFlags(), packet.getData());
+            } finally {
+                packetQueue.recycle(packet);
+            }
+
+            int dropped = packetQueue.consumeDroppedCount();
+            if (dropped > 0) {
+                Ln.d("Dropped " + dropped + " frame(s), the socket is too slow");
+            }
+
+            if (bitRateController != null) {
+                applyBitRateChange(codec);
+            }
+            if (keyFrameRequested.getAndSet(false)) {
+                requestKeyFrame(codec);
+            }
+        }
+
+        return !eof;
+    }
+
+    private final class EncoderCallback extends MediaCodec.Callback {
+        @Override
+        public void onInputBufferAvailable(MediaCodec codec, int index) {
+            // the input is a surface
+        }
+
+        @Override
+        public void onOutputBufferAvailable(MediaCodec codec, int index, MediaCodec.BufferInfo bufferInfo) {
+            try {
+                ByteBuffer codecBuffer = codec.getOutputBuffer(index);
+                if (!framePacer.accept(codecBuffer, bufferInfo.presentationTimeUs, bufferInfo.flags)) {
+                    codec.releaseOutputBuffer(index, false);
+                    return;
+                }
+
+                Packet packet = packetQueue.obtain();
+                packet.set(codecBuffer, bufferInfo.presentationTimeUs, bufferInfo.flags);
+                // released immediately, without waiting for the socket
+                codec.releaseOutputBuffer(index, false);
+
+                if (packetQueue.push(packet)) {
+                    requestKeyFrame(codec);
+                }
+            } catch (IllegalStateException e) {
+                // the codec is being stopped (on restart)
+            }
+        }
+
+        @Override
+        public void onError(MediaCodec codec, MediaCodec.CodecException e) {
+            packetQueue.fail(new IOException("Encoder error", e));
+        }
+
+        @Override
+        public void onOutputFormatChanged(MediaCodec codec, MediaFormat format) {
+            // the config packet contains the new format
+        }
+    }
 
-        long pts;
-        if ((bufferInfo.flags & MediaCodec.BUFFER_FLAG_CODEC_CONFIG) != 0) {
-            pts = NO_PTS; // non-media data packet
-        } else {
-            if (ptsOrigin == 0) {
-                ptsOrigin = bufferInfo.presentationTimeUs;
+    private static void requestKeyFrame(MediaCodec codec) {
+        Bundle params = new Bundle();
+        params.putInt(MediaCodec.PARAMETER_KEY_REQUEST_SYNC_FRAME, 0);
+        codec.setParameters(params);
+        Ln.d("Key frame requested");
+    }
+
+    private void applyBitRateChange(MediaCodec codec) {
+        int newBitRate = bitRateController.consumeBitRateChange();
+        if (newBitRate != 0) {
+            Bundle params = new Bundle();
+            params.putInt(MediaCodec.PARAMETER_KEY_VIDEO_BITRATE, newBitRate);
+            codec.setParameters(params);
+            Ln.d("Bit-rate adapted: " + newBitRate);
+        }
+    }
+
+    private void write(long presentationTimeUs, int flags, ByteBuffer codecBuffer) throws IOException {
+        if (rtpSender != null) {
+            rtpSender.send(computePts(presentationTimeUs, flags), flags, codecBuffer);
+            return;
+        }
+
+        try {
+            if (sendFrameMeta) {
+                writePacket(presentationTimeUs, flags, codecBuffer);
+            } else {
+                IO.writeFully(channel, codecBuffer);
+            }
+        } catch (IOException e) {
+            if (channelResumer == null) {
+                throw e;
             }
-            pts = bufferInfo.presentationTimeUs - ptsOrigin;
+            // the packet is lost, the encoder is restarted once the client has reconnected
+            channel = channelResumer.resume(channel);
+            connectionResumed.set(true);
         }
+    }
 
-        headerBuffer.putLong(pts);
-        headerBuffer.putInt(packetSize);
+    private void writePacket(long presentationTimeUs, int flags, ByteBuffer codecBuffer) throws IOException {
+        headerBuffer.clear();
+        headerBuffer.putLong(computePts(presentationTimeUs, flags));
+        headerBuffer.putInt(codecBuffer.remaining());
         headerBuffer.flip();
-        IO.writeFully(fd, headerBuffer);
+
+        packetBuffers[0] = headerBuffer;
+        packetBuffers[1] = codecBuffer;
+        try {
+            IO.writeFully(channel, packetBuffers);
+        } finally {
+            // do not retain the codec buffer (or the packet buffer), it is released
+            packetBuffers[1] = null;
+        }
+    }
+
+    private long computePts(long presentationTimeUs, int flags) {
+        if ((flags & MediaCodec.BUFFER_FLAG_CODEC_CONFIG) != 0) {
+            return NO_PTS; // non-media data packet
+        }
+        if (ptsOrigin == 0) {
+            ptsOrigin = presentationTimeUs;
+        }
+        return presentationTimeUs - ptsOrigin;
     }
 
     private static MediaCodecInfo[] listEncoders() {
@@ -238,6 +544,15 @@ public class ScreenEncoder implements Device.RotationListener {
         format.setInteger(MediaFormat.KEY_HEIGHT, height);
     }
 
+    private static void setDisplayProjection(IBinder display, int orientation, Rect deviceRect, Rect displayRect) {
+        SurfaceControl.openTransaction();
+        try {
+            SurfaceControl.setDisplayProjection(display, orientation, deviceRect, displayRect);
+        } finally {
+            SurfaceControl.closeTransaction();
+        }
+    }
+
     private static void setDisplaySurface(IBinder display, Surface surface, int orientation, Rect deviceRect, Rect displayRect, int layerStack) {
         SurfaceControl.openTransaction();
         try {
@@ -80,6 +80,12 @@ public final class ScreenInfo {
         return new ScreenInfo(newContentRect, newUnlockedVideoSize, newDeviceRotation, lockedVideoOrientation);
     }
 
+    public ScreenInfo withMaxSize(int maxSize) {
+        // the content rect is already expressed in the current device rotation, like the unlocked video size
+        Size newUnlockedVideoSize = computeVideoSize(contentRect.width(), contentRect.height(), maxSize);
+        return new ScreenInfo(contentRect, newUnlockedVideoSize, deviceRotation, lockedVideoOrientation);
+    }
+
     public static ScreenInfo computeScreenInfo(DisplayInfo displayInfo, Rect crop, int maxSize, int lockedVideoOrientation) {
         int rotation = displayInfo.getRotation();
 
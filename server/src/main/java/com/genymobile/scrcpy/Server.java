@@ -7,6 +7,7 @@ import android.os.BatteryManager;
 import android.os.Build;
 
 import java.io.IOException;
+import java.nio.channels.GatheringByteChannel;
 import java.util.List;
 import java.util.Locale;
 
@@ -67,14 +68,32 @@ public final class Server {
 
         boolean tunnelForward = options.isTunnelForward();
 
-        try (DesktopConnection connection = DesktopConnection.open(device, tunnelForward)) {
-            ScreenEncoder screenEncoder = new ScreenEncoder(options.getSendFrameMeta(), options.getBitRate(), options.getMaxFps(), codecOptions,
-                    options.getEncoderName());
+        int resumeTimeout = options.getResumeTimeout();
+        int udpPort = options.getUdpPort();
+        // The UDP socket is open before the connection, so that it is ready when the client sends its "hello" datagram
+        try (RtpSender rtpSender = udpPort != 0 ? RtpSender.open(udpPort, options.getUdpToken()) : null;
+                DesktopConnection connection = DesktopConnection.open(device, tunnelForward, options.getMultiplex(), resumeTimeout)) {
+            BitRateController bitRateController = null;
+            if (options.getMinBitRate() > 0) {
+                bitRateController = new BitRateController(options.getBitRate(), options.getMinBitRate(), options.getMaxBitRate());
+            }
+
+            ScreenEncoder screenEncoder = new ScreenEncoder(options.getSendFrameMeta(), options.getBitRate(), bitRateController, options.getMaxFps(),
+                    codecOptions, options.getEncoderName(), options.getLowLatency());
+            if (resumeTimeout > 0) {
+                screenEncoder.setChannelResumer(new ScreenEncoder.ChannelResumer() {
+                    @Override
+                    public GatheringByteChannel resume(GatheringByteChannel failedChannel) throws IOException {
+                        return connection.resumeVideoChannel(failedChannel);
+                    }
+                });
+            }
 
             Thread controllerThread = null;
             Thread deviceMessageSenderThread = null;
             if (options.getControl()) {
-                final Controller controller = new Controller(device, connection, options.getClipboardAutosync());
+                final Controller controller = new Controller(device, connection, options.getClipboardAutosync(), bitRateController,
+                        screenEncoder);
 
                 // asynchronous
                 controllerThread = startController(controller);
@@ -89,8 +108,13 @@ public final class Server {
             }
 
             try {
+                if (rtpSender != null) {
+                    rtpSender.awaitClient();
+                    screenEncoder.setRtpSender(rtpSender);
+                }
+
                 // synchronous
-                screenEncoder.streamScreen(device, connection.getVideoFd());
+                screenEncoder.streamScreen(device, connection.getVideoChannel());
             } catch (IOException e) {
                 // this is expected on close
                 Ln.d("Screen streaming stopped");
@@ -183,6 +207,14 @@ public final class Server {
                     int bitRate = Integer.parseInt(value);
                     options.setBitRate(bitRate);
                     break;
+                case "min_bit_rate":
+                    int minBitRate = Integer.parseInt(value);
+                    options.setMinBitRate(minBitRate);
+                    break;
+                case "max_bit_rate":
+                    int maxBitRate = Integer.parseInt(value);
+                    options.setMaxBitRate(maxBitRate);
+                    break;
                 case "max_fps":
                     int maxFps = Integer.parseInt(value);
                     options.setMaxFps(maxFps);
@@ -195,6 +227,21 @@ public final class Server {
                     boolean tunnelForward = Boolean.parseBoolean(value);
                     options.setTunnelForward(tunnelForward);
                     break;
+                case "multiplex":
+                    boolean multiplex = Boolean.parseBoolean(value);
+                    options.setMultiplex(multiplex);
+                    break;
+                case "resume_timeout":
+                    int resumeTimeout = Integer.parseInt(value);
+                    options.setResumeTimeout(resumeTimeout);
+                    break;
+                case "udp_port":
+                    int udpPort = Integer.parseInt(value);
+                    options.setUdpPort(udpPort);
+                    break;
+                case "udp_token":
+                    options.setUdpToken(value);
+                    break;
                 case "crop":
                     Rect crop = parseCrop(value);
                     options.setCrop(crop);
@@ -228,6 +275,10 @@ public final class Server {
                         options.setEncoderName(value);
                     }
                     break;
+                case "low_latency":
+                    boolean lowLatency = Boolean.parseBoolean(value);
+                    options.setLowLatency(lowLatency);
+                    break;
                 case "power_off_on_close":
                     boolean powerOffScreenOnClose = Boolean.parseBoolean(value);
                     options.setPowerOffScreenOnClose(powerOffScreenOnClose);
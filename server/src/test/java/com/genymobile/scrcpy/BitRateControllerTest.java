@@ -0,0 +1,109 @@
+package com.genymobile.scrcpy;
+
+import org.junit.Assert;
+import org.junit.Test;
+
+public class BitRateControllerTest {
+
+    private static final int MIN_BIT_RATE = 1_000_000;
+    private static final int MAX_BIT_RATE = 16_000_000;
+    private static final int REPORT_INTERVAL_US = 500_000;
+    private static final int REPORTS = 400;
+
+    /**
+     * Simulate a link throttled to {@code capacity} bits/s, with a network queue in front of it, fed at the bit-rate of the encoder.
+     *
+     * @return the bit-rates applied after each report
+     */
+    private static int[] simulateThrottledLink(BitRateController controller, long capacity) {
+        int[] bitRates = new int[REPORTS];
+        int bitRate = controller.getInitialBitRate();
+        double queueBits = 0;
+        for (int i = 0; i < REPORTS; ++i) {
+            double sentBits = bitRate * (REPORT_INTERVAL_US / 1e6);
+            double maxOutBits = capacity * (REPORT_INTERVAL_US / 1e6);
+            double outBits = Math.min(queueBits + sentBits, maxOutBits);
+            queueBits += sentBits - outBits;
+
+            long throughput = (long) (outBits / 8 / (REPORT_INTERVAL_US / 1e6));
+            int queueDelay = (int) (queueBits / capacity * 1e6);
+            controller.onStreamStats(throughput, queueDelay, 0, 0);
+
+            int newBitRate = controller.consumeBitRateChange();
+            if (newBitRate != 0) {
+                bitRate = newBitRate;
+            }
+            Assert.assertEquals(controller.getBitRate(), bitRate);
+            Assert.assertTrue(bitRate >= MIN_BIT_RATE);
+            Assert.assertTrue(bitRate <= MAX_BIT_RATE);
+            bitRates[i] = bitRate;
+        }
+        return bitRates;
+    }
+
+    private static double averageOfSecondHalf(int[] values) {
+        long sum = 0;
+        for (int i = values.length / 2; i < values.length; ++i) {
+            sum += values[i];
+        }
+        return (double) sum / (values.length - values.length / 2);
+    }
+
+    @Test
+    public void testConvergeToCapacity() {
+        long[] capacities = {2_000_000, 4_000_000, 10_000_000};
+        for (long capacity : capacities) {
+            BitRateController controller = new BitRateController(8_000_000, MIN_BIT_RATE, MAX_BIT_RATE);
+            int[] bitRates = simulateThrottledLink(controller, capacity);
+
+            // once converged, oscillate just below the capacity
+            double average = averageOfSecondHalf(bitRates);
+            Assert.assertTrue("average " + average + " for capacity " + capacity, average > capacity * 0.8);
+            Assert.assertTrue("average " + average + " for capacity " + capacity, average < capacity);
+        }
+    }
+
+    @Test
+    public void testBounds() {
+        // the capacity is below the minimal bit-rate
+        BitRateController controller = new BitRateController(8_000_000, MIN_BIT_RATE, MAX_BIT_RATE);
+        int[] bitRates = simulateThrottledLink(controller, 500_000);
+        Assert.assertEquals(MIN_BIT_RATE, bitRates[REPORTS - 1]);
+
+        // the capacity is above the maximal bit-rate
+        controller = new BitRateController(8_000_000, MIN_BIT_RATE, MAX_BIT_RATE);
+        bitRates = simulateThrottledLink(controller, 50_000_000);
+        Assert.assertEquals(MAX_BIT_RATE, bitRates[REPORTS - 1]);
+
+        // the initial bit-rate is clamped
+        controller = new BitRateController(50_000_000, MIN_BIT_RATE, MAX_BIT_RATE);
+        Assert.assertEquals(MAX_BIT_RATE, controller.getInitialBitRate());
+    }
+
+    @Test
+    public void testNoIncreaseIfUnused() {
+        BitRateController controller = new BitRateController(4_000_000, MIN_BIT_RATE, MAX_BIT_RATE);
+        // static screen: the encoder produces much less than the bit-rate
+        for (int i = 0; i < 10; ++i) {
+            controller.onStreamStats(10_000, 0, 0, 0);
+        }
+        Assert.assertEquals(0, controller.consumeBitRateChange());
+        Assert.assertEquals(4_000_000, controller.getBitRate());
+    }
+
+    @Test
+    public void testDecreaseOnSkippedFrames() {
+        BitRateController controller = new BitRateController(4_000_000, MIN_BIT_RATE, MAX_BIT_RATE);
+        // the client receives everything, but could not decode fast enough
+        controller.onStreamStats(500_000, 0, 0, 20);
+        Assert.assertEquals(3_400_000, controller.consumeBitRateChange());
+    }
+
+    @Test
+    public void testJitterIsNotCongestion() {
+        BitRateController controller = new BitRateController(4_000_000, MIN_BIT_RATE, MAX_BIT_RATE);
+        // the queue delay is explained by the jitter
+        controller.onStreamStats(500_000, 40_000, 25_000, 0);
+        Assert.assertEquals(4_400_000, controller.consumeBitRateChange());
+    }
+}
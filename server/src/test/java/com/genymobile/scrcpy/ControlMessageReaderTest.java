@@ -3,12 +3,14 @@ package com.genymobile.scrcpy;
 import android.view.KeyEvent;
 import android.view.MotionEvent;
 import org.junit.Assert;
+import org.junit.Assume;
 import org.junit.Test;
 
 import java.io.ByteArrayInputStream;
 import java.io.ByteArrayOutputStream;
 import java.io.DataOutputStream;
 import java.io.IOException;
+import java.lang.management.ManagementFactory;
 import java.nio.charset.StandardCharsets;
 import java.util.Arrays;
 
@@ -115,6 +117,61 @@ public class ControlMessageReaderTest {
         Assert.assertEquals(MotionEvent.BUTTON_PRIMARY, event.getButtons());
     }
 
+    @Test
+    public void testDispatchTouchEventsWithoutAllocation() throws IOException {
+        java.lang.management.ThreadMXBean bean = ManagementFactory.getThreadMXBean();
+        Assume.assumeTrue(bean instanceof com.sun.management.ThreadMXBean);
+        com.sun.management.ThreadMXBean threadBean = (com.sun.management.ThreadMXBean) bean;
+        Assume.assumeTrue(threadBean.isThreadAllocatedMemorySupported());
+        threadBean.setThreadAllocatedMemoryEnabled(true);
+
+        final int count = 1000;
+        ControlMessageReader reader = new ControlMessageReader();
+        PointersState pointersState = new PointersState();
+
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        for (int i = 0; i < count; ++i) {
+            dos.writeByte(ControlMessage.TYPE_INJECT_TOUCH_EVENT);
+            dos.writeByte(MotionEvent.ACTION_MOVE);
+            dos.writeLong(-42); // pointer id
+            dos.writeInt(i);
+            dos.writeInt(200);
+            dos.writeShort(1080);
+            dos.writeShort(1920);
+            dos.writeShort(0xffff); // pressure
+            dos.writeInt(MotionEvent.BUTTON_PRIMARY);
+        }
+        reader.readFrom(new ByteArrayInputStream(bos.toByteArray()));
+
+        long threadId = Thread.currentThread().getId();
+        long before = threadBean.getThreadAllocatedBytes(threadId);
+        int parsed = 0;
+        long sum = 0;
+        ControlMessage event = reader.next();
+        while (event != null) {
+            ++parsed;
+            // Dispatch like Controller, with a rotation by 90 degrees (the conversion by the Device and the injection require Android)
+            long point = Point.rotate(event.getX(), event.getY(), event.getScreenWidth(), event.getScreenHeight(), 1);
+            int pointerIndex = pointersState.getPointerIndex(event.getPointerId());
+            Pointer pointer = pointersState.get(pointerIndex);
+            pointer.setPoint(Point.unpackX(point), Point.unpackY(point));
+            pointer.setPressure(event.getPressure());
+            pointer.setUp(event.getAction() == MotionEvent.ACTION_UP);
+            pointersState.cleanUp();
+            sum += pointer.getY();
+            event = reader.next();
+        }
+        long allocated = threadBean.getThreadAllocatedBytes(threadId) - before;
+
+        Assert.assertEquals(count, parsed);
+        // After the rotation, y is the original x
+        Assert.assertEquals((long) count * (count - 1) / 2, sum);
+        Assert.assertEquals(1, pointersState.size());
+        // A few bytes may be allocated by the measurement itself, but not one object per message
+        Assert.assertTrue("Allocated " + allocated + " bytes for " + count + " messages", allocated < count);
+    }
+
     @Test
     public void testParseScrollEvent() throws IOException {
         ControlMessageReader reader = new ControlMessageReader();
@@ -319,6 +376,93 @@ public class ControlMessageReaderTest {
         Assert.assertEquals(ControlMessage.TYPE_ROTATE_DEVICE, event.getType());
     }
 
+    @Test
+    public void testParseRequestKeyFrame() throws IOException {
+        ControlMessageReader reader = new ControlMessageReader();
+
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        dos.writeByte(ControlMessage.TYPE_REQUEST_KEY_FRAME);
+
+        byte[] packet = bos.toByteArray();
+
+        reader.readFrom(new ByteArrayInputStream(packet));
+        ControlMessage event = reader.next();
+
+        Assert.assertEquals(ControlMessage.TYPE_REQUEST_KEY_FRAME, event.getType());
+    }
+
+    @Test
+    public void testParsePing() throws IOException {
+        ControlMessageReader reader = new ControlMessageReader();
+
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        dos.writeByte(ControlMessage.TYPE_PING);
+        dos.writeLong(0x0102030405060708L);
+
+        byte[] packet = bos.toByteArray();
+
+        // The message type (1 byte) does not count
+        Assert.assertEquals(ControlMessageReader.PING_PAYLOAD_LENGTH, packet.length - 1);
+
+        reader.readFrom(new ByteArrayInputStream(packet));
+        ControlMessage event = reader.next();
+
+        Assert.assertEquals(ControlMessage.TYPE_PING, event.getType());
+        Assert.assertEquals(0x0102030405060708L, event.getTimestamp());
+    }
+
+    @Test
+    public void testParseStreamStats() throws IOException {
+        ControlMessageReader reader = new ControlMessageReader();
+
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        dos.writeByte(ControlMessage.TYPE_STREAM_STATS);
+        dos.writeInt(0xF0000000); // throughput, larger than Integer.MAX_VALUE
+        dos.writeInt(25000); // queue delay
+        dos.writeInt(3000); // jitter
+        dos.writeShort(0xFFFF); // skipped frames
+
+        byte[] packet = bos.toByteArray();
+
+        // The message type (1 byte) does not count
+        Assert.assertEquals(ControlMessageReader.STREAM_STATS_PAYLOAD_LENGTH, packet.length - 1);
+
+        reader.readFrom(new ByteArrayInputStream(packet));
+        ControlMessage event = reader.next();
+
+        Assert.assertEquals(ControlMessage.TYPE_STREAM_STATS, event.getType());
+        Assert.assertEquals(0xF0000000L, event.getThroughput());
+        Assert.assertEquals(25000, event.getQueueDelay());
+        Assert.assertEquals(3000, event.getJitter());
+        Assert.assertEquals(0xFFFF, event.getSkippedFrames());
+    }
+
+    @Test
+    public void testParseSetVideoSettings() throws IOException {
+        ControlMessageReader reader = new ControlMessageReader();
+
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        dos.writeByte(ControlMessage.TYPE_SET_VIDEO_SETTINGS);
+        dos.writeShort(1283); // max size, rounded to a multiple of 8
+        dos.writeShort(60); // max fps
+
+        byte[] packet = bos.toByteArray();
+
+        // The message type (1 byte) does not count
+        Assert.assertEquals(ControlMessageReader.SET_VIDEO_SETTINGS_PAYLOAD_LENGTH, packet.length - 1);
+
+        reader.readFrom(new ByteArrayInputStream(packet));
+        ControlMessage event = reader.next();
+
+        Assert.assertEquals(ControlMessage.TYPE_SET_VIDEO_SETTINGS, event.getType());
+        Assert.assertEquals(1280, event.getMaxSize());
+        Assert.assertEquals(60, event.getMaxFps());
+    }
+
     @Test
     public void testMultiEvents() throws IOException {
         ControlMessageReader reader = new ControlMessageReader();
@@ -400,4 +544,33 @@ public class ControlMessageReaderTest {
         Assert.assertEquals(5, event.getRepeat());
         Assert.assertEquals(KeyEvent.META_CTRL_ON, event.getMetaState());
     }
+
+    @Test
+    public void testResetDiscardsPartialEvent() throws IOException {
+        ControlMessageReader reader = new ControlMessageReader();
+
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        // the beginning of an event, lost with its connection
+        dos.writeByte(ControlMessage.TYPE_INJECT_KEYCODE);
+        dos.writeByte(KeyEvent.ACTION_DOWN);
+        reader.readFrom(new ByteArrayInputStream(bos.toByteArray()));
+        Assert.assertNull(reader.next());
+
+        reader.reset();
+
+        bos.reset();
+        dos.writeByte(ControlMessage.TYPE_INJECT_KEYCODE);
+        dos.writeByte(KeyEvent.ACTION_UP);
+        dos.writeInt(KeyEvent.KEYCODE_ENTER);
+        dos.writeInt(0); // repeat
+        dos.writeInt(0); // meta state
+        reader.readFrom(new ByteArrayInputStream(bos.toByteArray()));
+
+        ControlMessage event = reader.next();
+        Assert.assertEquals(ControlMessage.TYPE_INJECT_KEYCODE, event.getType());
+        Assert.assertEquals(KeyEvent.ACTION_UP, event.getAction());
+        Assert.assertEquals(KeyEvent.KEYCODE_ENTER, event.getKeycode());
+        Assert.assertNull(reader.next());
+    }
 }
@@ -0,0 +1,130 @@
+package com.genymobile.scrcpy;
+
+import android.media.MediaCodec;
+
+import org.junit.Assert;
+import org.junit.Test;
+
+import java.nio.ByteBuffer;
+
+public class FramePacerTest {
+
+    private static final long REPEAT_DELAY_US = 100_000;
+
+    private static ByteBuffer createFrame(boolean reference, int size) {
+        byte[] data = new byte[size];
+        data[2] = 1; // start code 00 00 01
+        data[3] = reference ? (byte) 0x41 : (byte) 0x01; // P-slice
+        return ByteBuffer.wrap(data);
+    }
+
+    private static ByteBuffer createKeyFrame() {
+        return ByteBuffer.wrap(new byte[] {0, 0, 1, 0x65, 42, 42, 42, 42});
+    }
+
+    @Test
+    public void testMaxFps() {
+        FramePacer pacer = new FramePacer(REPEAT_DELAY_US, 30);
+        int sent = 0;
+        // 60 fps during 1 second, every other frame is a non-reference frame
+        for (int i = 0; i < 60; ++i) {
+            long pts = i * 1_000_000L / 60;
+            if (pacer.accept(createFrame(i % 2 == 0, 5000), pts, 0)) {
+                ++sent;
+            }
+        }
+        Assert.assertEquals(30, sent);
+    }
+
+    @Test
+    public void testMaxFpsNeverDropsReferenceFrames() {
+        FramePacer pacer = new FramePacer(REPEAT_DELAY_US, 30);
+        for (int i = 0; i < 60; ++i) {
+            long pts = i * 1_000_000L / 60;
+            Assert.assertTrue(pacer.accept(createFrame(true, 5000), pts, 0));
+        }
+    }
+
+    @Test
+    public void testMaxFpsTolerance() {
+        FramePacer pacer = new FramePacer(REPEAT_DELAY_US, 30);
+        Assert.assertTrue(pacer.accept(createFrame(false, 5000), 0, 0));
+        // captured 1ms early
+        Assert.assertTrue(pacer.accept(createFrame(false, 5000), 32_333, 0));
+        Assert.assertFalse(pacer.accept(createFrame(false, 5000), 48_000, 0));
+    }
+
+    @Test
+    public void testNoMaxFps() {
+        FramePacer pacer = new FramePacer(REPEAT_DELAY_US, 0);
+        for (int i = 0; i < 120; ++i) {
+            long pts = i * 1_000_000L / 120;
+            Assert.assertTrue(pacer.accept(createFrame(false, 5000), pts, 0));
+        }
+    }
+
+    @Test
+    public void testSuppressRepeatedFrames() {
+        FramePacer pacer = new FramePacer(REPEAT_DELAY_US, 0);
+        Assert.assertTrue(pacer.accept(createKeyFrame(), 0, MediaCodec.BUFFER_FLAG_KEY_FRAME));
+        // the first repeated frames refine the picture
+        Assert.assertTrue(pacer.accept(createFrame(true, 3000), 100_000, 0));
+        Assert.assertTrue(pacer.accept(createFrame(true, 800), 200_000, 0));
+        Assert.assertTrue(pacer.accept(createFrame(false, 40), 300_000, 0));
+
+        // then the picture does not change anymore
+        int sent = 0;
+        for (long pts = 400_000; pts <= 10_300_000; pts += REPEAT_DELAY_US) {
+            if (pacer.accept(createFrame(false, 40), pts, 0)) {
+                ++sent;
+            }
+        }
+        // one keepalive frame per second
+        Assert.assertEquals(10, sent);
+
+        // the content changes
+        Assert.assertTrue(pacer.accept(createFrame(true, 2000), 10_416_000, 0));
+    }
+
+    @Test
+    public void testRepeatedReferenceFramesAlwaysSent() {
+        FramePacer pacer = new FramePacer(REPEAT_DELAY_US, 0);
+        Assert.assertTrue(pacer.accept(createKeyFrame(), 0, MediaCodec.BUFFER_FLAG_KEY_FRAME));
+        // tiny frames of identical size may still change the picture (e.g. a blinking caret), the following frames reference them
+        for (long pts = 100_000; pts <= 10_000_000; pts += REPEAT_DELAY_US) {
+            Assert.assertTrue(pacer.accept(createFrame(true, 40), pts, 0));
+        }
+    }
+
+    @Test
+    public void testSmallChangesAreNotRepeatedFrames() {
+        FramePacer pacer = new FramePacer(REPEAT_DELAY_US, 0);
+        Assert.assertTrue(pacer.accept(createFrame(true, 40), 0, 0));
+        // same size, but produced before the repeat delay: not a repeated frame
+        Assert.assertTrue(pacer.accept(createFrame(true, 40), 16_000, 0));
+        Assert.assertTrue(pacer.accept(createFrame(true, 40), 32_000, 0));
+        // different size
+        Assert.assertTrue(pacer.accept(createFrame(true, 44), 132_000, 0));
+    }
+
+    @Test
+    public void testConfigAndKeyFramesAlwaysSent() {
+        FramePacer pacer = new FramePacer(REPEAT_DELAY_US, 1);
+        ByteBuffer config = ByteBuffer.wrap(new byte[] {0, 0, 1, 0x67, 42});
+        Assert.assertTrue(pacer.accept(config, 0, MediaCodec.BUFFER_FLAG_CODEC_CONFIG));
+        Assert.assertTrue(pacer.accept(createKeyFrame(), 0, MediaCodec.BUFFER_FLAG_KEY_FRAME));
+        Assert.assertTrue(pacer.accept(createKeyFrame(), 10_000, MediaCodec.BUFFER_FLAG_KEY_FRAME));
+        Assert.assertFalse(pacer.accept(createFrame(false, 5000), 20_000, 0));
+        Assert.assertTrue(pacer.accept(config, 20_000, MediaCodec.BUFFER_FLAG_CODEC_CONFIG));
+    }
+
+    @Test
+    public void testReset() {
+        FramePacer pacer = new FramePacer(REPEAT_DELAY_US, 1);
+        Assert.assertTrue(pacer.accept(createFrame(false, 5000), 0, 0));
+        Assert.assertFalse(pacer.accept(createFrame(false, 5000), 10_000, 0));
+        // after a restart, the first frame is sent
+        pacer.reset();
+        Assert.assertTrue(pacer.accept(createFrame(false, 5000), 20_000, 0));
+    }
+}
@@ -0,0 +1,134 @@
+package com.genymobile.scrcpy;
+
+import org.junit.Assert;
+import org.junit.Test;
+
+import java.io.ByteArrayOutputStream;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.channels.GatheringByteChannel;
+import java.nio.channels.Pipe;
+
+public class IOTest {
+
+    /**
+     * Channel writing at most a few bytes per call, to simulate partial writes.
+     */
+    private static final class SlowChannel implements GatheringByteChannel {
+        private static final int MAX_WRITE_SIZE = 7;
+
+        private final ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        private int writeCount;
+
+        @Override
+        public long write(ByteBuffer[] srcs, int offset, int length) {
+            ++writeCount;
+            int total = 0;
+            for (int i = offset; i < offset + length && total < MAX_WRITE_SIZE; ++i) {
+                ByteBuffer src = srcs[i];
+                while (src.hasRemaining() && total < MAX_WRITE_SIZE) {
+                    bos.write(src.get());
+                    ++total;
+                }
+            }
+            return total;
+        }
+
+        @Override
+        public long write(ByteBuffer[] srcs) {
+            return write(srcs, 0, srcs.length);
+        }
+
+        @Override
+        public int write(ByteBuffer src) {
+            return (int) write(new ByteBuffer[] {src});
+        }
+
+        @Override
+        public boolean isOpen() {
+            return true;
+        }
+
+        @Override
+        public void close() {
+            // nothing to do
+        }
+    }
+
+    private static ByteBuffer createHeader(int payloadSize) {
+        ByteBuffer header = ByteBuffer.allocateDirect(12);
+        header.putLong(0x0102030405060708L);
+        header.putInt(payloadSize);
+        header.flip();
+        return header;
+    }
+
+    private static byte[] createPayload(int size) {
+        byte[] payload = new byte[size];
+        for (int i = 0; i < size; ++i) {
+            payload[i] = (byte) i;
+        }
+        return payload;
+    }
+
+    private static void assertPacket(byte[] payload, byte[] written) {
+        Assert.assertEquals(12 + payload.length, written.length);
+        ByteBuffer buffer = ByteBuffer.wrap(written);
+        Assert.assertEquals(0x0102030405060708L, buffer.getLong());
+        Assert.assertEquals(payload.length, buffer.getInt());
+        for (byte b : payload) {
+            Assert.assertEquals(b, buffer.get());
+        }
+    }
+
+    @Test
+    public void testGatherWritePartial() throws IOException {
+        byte[] payload = createPayload(100);
+        ByteBuffer[] buffers = {createHeader(payload.length), ByteBuffer.wrap(payload)};
+
+        SlowChannel channel = new SlowChannel();
+        IO.writeFully(channel, buffers);
+
+        Assert.assertFalse(buffers[0].hasRemaining());
+        Assert.assertFalse(buffers[1].hasRemaining());
+        // 112 bytes, 7 bytes per write
+        Assert.assertEquals(16, channel.writeCount);
+        assertPacket(payload, channel.bos.toByteArray());
+    }
+
+    @Test
+    public void testGatherWritePipe() throws Exception {
+        // larger than the pipe capacity, so that the writes are partial
+        final byte[] payload = createPayload(1 << 20);
+        ByteBuffer directPayload = ByteBuffer.allocateDirect(payload.length);
+        directPayload.put(payload);
+        directPayload.flip();
+        ByteBuffer[] buffers = {createHeader(payload.length), directPayload};
+
+        final Pipe pipe = Pipe.open();
+        final ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        Thread reader = new Thread(new Runnable() {
+            @Override
+            public void run() {
+                ByteBuffer buffer = ByteBuffer.allocate(4096);
+                try {
+                    while (pipe.source().read(buffer) != -1) {
+                        bos.write(buffer.array(), 0, buffer.position());
+                        buffer.clear();
+                    }
+                } catch (IOException e) {
+                    throw new AssertionError(e);
+                }
+            }
+        });
+        reader.start();
+
+        IO.writeFully(pipe.sink(), buffers);
+        pipe.sink().close();
+        reader.join();
+
+        Assert.assertFalse(buffers[0].hasRemaining());
+        Assert.assertFalse(buffers[1].hasRemaining());
+        assertPacket(payload, bos.toByteArray());
+    }
+}
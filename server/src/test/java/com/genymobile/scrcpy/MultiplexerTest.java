@@ -0,0 +1,190 @@
+package com.genymobile.scrcpy;
+
+import org.junit.After;
+import org.junit.Assert;
+import org.junit.Before;
+import org.junit.Test;
+
+import java.io.ByteArrayOutputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.EOFException;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+import java.net.InetAddress;
+import java.net.InetSocketAddress;
+import java.nio.ByteBuffer;
+import java.nio.channels.Channels;
+import java.nio.channels.GatheringByteChannel;
+import java.nio.channels.ServerSocketChannel;
+import java.nio.channels.SocketChannel;
+import java.nio.charset.StandardCharsets;
+
+public class MultiplexerTest {
+
+    private SocketChannel deviceSocket;
+    private SocketChannel clientSocket;
+    private Multiplexer multiplexer;
+
+    @Before
+    public void setUp() throws IOException {
+        // a connected pair of local sockets
+        try (ServerSocketChannel server = ServerSocketChannel.open()) {
+            server.bind(new InetSocketAddress(InetAddress.getLoopbackAddress(), 0));
+            clientSocket = SocketChannel.open(server.getLocalAddress());
+            deviceSocket = server.accept();
+        }
+        multiplexer = new Multiplexer(deviceSocket.socket().getInputStream(), deviceSocket);
+    }
+
+    @After
+    public void tearDown() throws IOException {
+        deviceSocket.close();
+        clientSocket.close();
+    }
+
+    private void sendFromClient(int channel, byte[] payload) throws IOException {
+        DataOutputStream out = new DataOutputStream(clientSocket.socket().getOutputStream());
+        out.writeByte(channel);
+        out.writeInt(payload.length);
+        out.write(payload);
+    }
+
+    @Test
+    public void testWriteFramesFromSeveralThreads() throws Exception {
+        final int frameCount = 200;
+        final GatheringByteChannel videoChannel = multiplexer.getChannel(Multiplexer.CHANNEL_VIDEO);
+        final OutputStream controlOutput = Channels.newOutputStream(multiplexer.getChannel(Multiplexer.CHANNEL_CONTROL));
+
+        Thread videoThread = new Thread(new Runnable() {
+            @Override
+            public void run() {
+                try {
+                    for (int i = 0; i < frameCount; ++i) {
+                        // a meta header and a packet, written together
+                        ByteBuffer meta = ByteBuffer.allocate(12);
+                        meta.putLong(i).putInt(1000).flip();
+                        ByteBuffer packet = ByteBuffer.allocate(1000);
+                        IO.writeFully(videoChannel, new ByteBuffer[] {meta, packet});
+                    }
+                } catch (IOException e) {
+                    throw new AssertionError(e);
+                }
+            }
+        });
+        Thread controlThread = new Thread(new Runnable() {
+            @Override
+            public void run() {
+                try {
+                    for (int i = 0; i < frameCount; ++i) {
+                        controlOutput.write(("msg" + i + ";").getBytes(StandardCharsets.UTF_8));
+                    }
+                } catch (IOException e) {
+                    throw new AssertionError(e);
+                }
+            }
+        });
+        videoThread.start();
+        controlThread.start();
+
+        // Behave like the client: demultiplex the frames
+        DataInputStream in = new DataInputStream(clientSocket.socket().getInputStream());
+        ByteArrayOutputStream control = new ByteArrayOutputStream();
+        int videoFrames = 0;
+        while (videoFrames < frameCount || control.size() < expectedControl(frameCount).length()) {
+            int channel = in.readUnsignedByte();
+            int length = in.readInt();
+            byte[] payload = new byte[length];
+            in.readFully(payload);
+            if (channel == Multiplexer.CHANNEL_VIDEO) {
+                Assert.assertEquals(1012, length);
+                ByteBuffer meta = ByteBuffer.wrap(payload);
+                Assert.assertEquals(videoFrames, meta.getLong());
+                Assert.assertEquals(1000, meta.getInt());
+                ++videoFrames;
+            } else {
+                Assert.assertEquals(Multiplexer.CHANNEL_CONTROL, channel);
+                control.write(payload);
+            }
+        }
+
+        videoThread.join();
+        controlThread.join();
+        Assert.assertEquals(expectedControl(frameCount), control.toString("UTF-8"));
+    }
+
+    private static String expectedControl(int count) {
+        StringBuilder builder = new StringBuilder();
+        for (int i = 0; i < count; ++i) {
+            builder.append("msg").append(i).append(';');
+        }
+        return builder.toString();
+    }
+
+    @Test
+    public void testWriteFramesOfVariousSizes() throws IOException {
+        GatheringByteChannel channel = multiplexer.getChannel(Multiplexer.CHANNEL_VIDEO);
+        ByteBuffer[] srcs = {ByteBuffer.wrap(new byte[] {1, 2}), ByteBuffer.wrap(new byte[] {3}), ByteBuffer.wrap(new byte[] {4, 5, 6})};
+        IO.writeFully(channel, srcs);
+        // the buffers of the previous frame must not be written again
+        srcs[0].rewind();
+        channel.write(ByteBuffer.wrap(new byte[] {7}));
+        srcs[1].rewind();
+        srcs[2].rewind();
+        IO.writeFully(channel, srcs, 1, 2);
+
+        DataInputStream in = new DataInputStream(clientSocket.socket().getInputStream());
+        byte[][] expectedPayloads = {{1, 2, 3, 4, 5, 6}, {7}, {3, 4, 5, 6}};
+        for (byte[] expected : expectedPayloads) {
+            Assert.assertEquals(Multiplexer.CHANNEL_VIDEO, in.readUnsignedByte());
+            byte[] payload = new byte[in.readInt()];
+            in.readFully(payload);
+            Assert.assertArrayEquals(expected, payload);
+        }
+    }
+
+    @Test
+    public void testReadControlStream() throws IOException {
+        sendFromClient(Multiplexer.CHANNEL_CONTROL, new byte[] {1, 2, 3});
+        // empty frames are valid
+        sendFromClient(Multiplexer.CHANNEL_CONTROL, new byte[0]);
+        sendFromClient(Multiplexer.CHANNEL_CONTROL, new byte[] {4, 5, 6, 7, 8});
+        clientSocket.shutdownOutput();
+
+        InputStream input = multiplexer.getControlInputStream();
+        byte[] buffer = new byte[16];
+        int head = 0;
+        int r = 0;
+        while (r != -1) {
+            head += r;
+            r = input.read(buffer, head, buffer.length - head);
+        }
+        Assert.assertEquals(8, head);
+        for (int i = 0; i < 8; ++i) {
+            Assert.assertEquals(i + 1, buffer[i]);
+        }
+    }
+
+    @Test(expected = IOException.class)
+    public void testUnexpectedChannel() throws IOException {
+        sendFromClient(Multiplexer.CHANNEL_VIDEO, new byte[] {1, 2, 3});
+        multiplexer.getControlInputStream().read(new byte[16], 0, 16);
+    }
+
+    @Test(expected = EOFException.class)
+    public void testTruncatedFrame() throws IOException {
+        DataOutputStream out = new DataOutputStream(clientSocket.socket().getOutputStream());
+        out.writeByte(Multiplexer.CHANNEL_CONTROL);
+        out.writeInt(10);
+        out.write(new byte[] {1, 2, 3});
+        clientSocket.shutdownOutput();
+
+        InputStream input = multiplexer.getControlInputStream();
+        byte[] buffer = new byte[16];
+        int r = 0;
+        while (r != -1) {
+            r = input.read(buffer, 0, buffer.length);
+        }
+    }
+}
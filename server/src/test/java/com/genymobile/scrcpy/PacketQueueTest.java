@@ -0,0 +1,160 @@
+package com.genymobile.scrcpy;
+
+import android.media.MediaCodec;
+
+import org.junit.Assert;
+import org.junit.Test;
+
+import java.io.IOException;
+import java.nio.ByteBuffer;
+
+public class PacketQueueTest {
+
+    // NAL headers: nal_ref_idc in bits 5-6, nal_unit_type in bits 0-4
+    private static final byte NAL_IDR = 0x65;
+    private static final byte NAL_REFERENCE_SLICE = 0x41;
+    private static final byte NAL_NON_REFERENCE_SLICE = 0x01;
+    private static final byte NAL_SPS = 0x67;
+
+    private static Packet createPacket(PacketQueue queue, long pts, int flags, byte nalHeader) {
+        ByteBuffer data = ByteBuffer.wrap(new byte[] {0, 0, 0, 1, nalHeader, 42, 42, 42});
+        Packet packet = queue.obtain();
+        packet.set(data, pts, flags);
+        return packet;
+    }
+
+    private static Packet createFrame(PacketQueue queue, long pts, boolean reference) {
+        return createPacket(queue, pts, 0, reference ? NAL_REFERENCE_SLICE : NAL_NON_REFERENCE_SLICE);
+    }
+
+    private static Packet createKeyFrame(PacketQueue queue, long pts) {
+        return createPacket(queue, pts, MediaCodec.BUFFER_FLAG_KEY_FRAME, NAL_IDR);
+    }
+
+    private static long takePts(PacketQueue queue) throws Exception {
+        Packet packet = queue.take();
+        long pts = packet.getPresentationTimeUs();
+        queue.recycle(packet);
+        return pts;
+    }
+
+    @Test
+    public void testReferenceFrameDetection() {
+        Assert.assertTrue(Packet.isReference(ByteBuffer.wrap(new byte[] {0, 0, 0, 1, NAL_IDR, 1})));
+        Assert.assertTrue(Packet.isReference(ByteBuffer.wrap(new byte[] {0, 0, 1, NAL_REFERENCE_SLICE, 1})));
+        Assert.assertFalse(Packet.isReference(ByteBuffer.wrap(new byte[] {0, 0, 1, NAL_NON_REFERENCE_SLICE, 1})));
+        // the slice is after a SEI (nal_unit_type 6)
+        Assert.assertFalse(Packet.isReference(ByteBuffer.wrap(new byte[] {0, 0, 1, 0x06, 5, 0, 0, 1, NAL_NON_REFERENCE_SLICE, 1})));
+        // no slice, considered as a reference
+        Assert.assertTrue(Packet.isReference(ByteBuffer.wrap(new byte[] {1, 2, 3})));
+    }
+
+    @Test
+    public void testNoPressure() throws Exception {
+        PacketQueue queue = new PacketQueue(4);
+        for (int i = 0; i < 100; ++i) {
+            Assert.assertFalse(queue.push(createFrame(queue, i, i % 2 == 0)));
+            Assert.assertEquals(i, takePts(queue));
+        }
+        Assert.assertEquals(0, queue.consumeDroppedCount());
+    }
+
+    @Test
+    public void testDropNonReferenceFrames() throws Exception {
+        PacketQueue queue = new PacketQueue(4);
+        queue.push(createKeyFrame(queue, 0));
+        queue.push(createFrame(queue, 1, false));
+        queue.push(createFrame(queue, 2, true));
+        queue.push(createFrame(queue, 3, false));
+
+        // full, the incoming non-reference frame is dropped
+        Assert.assertFalse(queue.push(createFrame(queue, 4, false)));
+        Assert.assertEquals(4, queue.size());
+
+        // full, the queued non-reference frames are dropped to make room for a reference frame
+        Assert.assertFalse(queue.push(createFrame(queue, 5, true)));
+        Assert.assertEquals(3, queue.size());
+        Assert.assertEquals(3, queue.consumeDroppedCount());
+
+        Assert.assertEquals(0, takePts(queue));
+        Assert.assertEquals(2, takePts(queue));
+        Assert.assertEquals(5, takePts(queue));
+    }
+
+    @Test
+    public void testWaitForKeyFrame() throws Exception {
+        PacketQueue queue = new PacketQueue(4);
+        queue.push(createPacket(queue, 0, MediaCodec.BUFFER_FLAG_CODEC_CONFIG, NAL_SPS));
+        queue.push(createKeyFrame(queue, 0));
+        queue.push(createFrame(queue, 1, true));
+        queue.push(createFrame(queue, 2, true));
+
+        // only reference frames: all the frames are dropped, a key frame must be requested
+        Assert.assertTrue(queue.push(createFrame(queue, 3, true)));
+        // the config packet is kept
+        Assert.assertEquals(1, queue.size());
+
+        // the next frames are dropped until the key frame, which is requested only once
+        Assert.assertFalse(queue.push(createFrame(queue, 4, true)));
+        Assert.assertFalse(queue.push(createFrame(queue, 5, false)));
+        Assert.assertEquals(1, queue.size());
+
+        Assert.assertFalse(queue.push(createKeyFrame(queue, 6)));
+        Assert.assertFalse(queue.push(createFrame(queue, 7, true)));
+        Assert.assertEquals(3, queue.size());
+        Assert.assertEquals(6, queue.consumeDroppedCount());
+
+        Packet config = queue.take();
+        Assert.assertTrue(config.isConfig());
+        queue.recycle(config);
+        Assert.assertEquals(6, takePts(queue));
+        Assert.assertEquals(7, takePts(queue));
+    }
+
+    @Test
+    public void testSlowWriter() throws Exception {
+        final PacketQueue queue = new PacketQueue(8);
+        final int frameCount = 1000;
+
+        // the writer is slower than the encoder, the encoder must never be blocked
+        Thread writer = new Thread(new Runnable() {
+            @Override
+            public void run() {
+                try {
+                    long lastPts = -1;
+                    while (lastPts != frameCount - 1) {
+                        Packet packet = queue.take();
+                        long pts = packet.getPresentationTimeUs();
+                        Assert.assertTrue(pts > lastPts);
+                        lastPts = pts;
+                        queue.recycle(packet);
+                        Thread.sleep(1);
+                    }
+                } catch (IOException | InterruptedException e) {
+                    throw new AssertionError(e);
+                }
+            }
+        });
+        writer.start();
+
+        int keyFrameRequests = 0;
+        for (int i = 0; i < frameCount; ++i) {
+            Packet packet = i % 100 == 0 || i == frameCount - 1 ? createKeyFrame(queue, i) : createFrame(queue, i, i % 3 != 0);
+            if (queue.push(packet)) {
+                ++keyFrameRequests;
+            }
+            Assert.assertTrue(queue.size() <= 8);
+        }
+
+        writer.join();
+        Assert.assertTrue(queue.consumeDroppedCount() > 0);
+        Assert.assertTrue(keyFrameRequests <= 10);
+    }
+
+    @Test(expected = IOException.class)
+    public void testFail() throws Exception {
+        PacketQueue queue = new PacketQueue(4);
+        queue.fail(new IOException("Encoder error"));
+        queue.take();
+    }
+}
@@ -0,0 +1,30 @@
+package com.genymobile.scrcpy;
+
+import org.junit.Assert;
+import org.junit.Test;
+
+public class PointTest {
+
+    @Test
+    public void testPack() {
+        int[] values = {0, 1, -1, 1920, Integer.MAX_VALUE, Integer.MIN_VALUE};
+        for (int x : values) {
+            for (int y : values) {
+                long packed = Point.pack(x, y);
+                Assert.assertEquals(x, Point.unpackX(packed));
+                Assert.assertEquals(y, Point.unpackY(packed));
+            }
+        }
+    }
+
+    @Test
+    public void testRotateLikePosition() {
+        Position position = new Position(100, 200, 1080, 1920);
+        for (int rotation = 0; rotation < 4; ++rotation) {
+            Point expected = position.rotate(rotation).getPoint();
+            long rotated = Point.rotate(100, 200, 1080, 1920, rotation);
+            Assert.assertEquals(expected.getX(), Point.unpackX(rotated));
+            Assert.assertEquals(expected.getY(), Point.unpackY(rotated));
+        }
+    }
+}
@@ -0,0 +1,125 @@
+package com.genymobile.scrcpy;
+
+import org.junit.Assert;
+import org.junit.Test;
+
+import java.util.ArrayList;
+import java.util.List;
+import java.util.Random;
+
+public class PointersStateTest {
+
+    @Test
+    public void testPointerIndexes() {
+        PointersState pointersState = new PointersState();
+
+        Assert.assertEquals(0, pointersState.getPointerIndex(42));
+        Assert.assertEquals(1, pointersState.getPointerIndex(-1));
+        Assert.assertEquals(0, pointersState.getPointerIndex(42));
+        Assert.assertEquals(2, pointersState.size());
+        Assert.assertEquals(0, pointersState.get(0).getLocalId());
+        Assert.assertEquals(1, pointersState.get(1).getLocalId());
+
+        pointersState.get(0).setUp(true);
+        pointersState.cleanUp();
+
+        // the remaining pointer is moved to index 0, but keeps its local id
+        Assert.assertEquals(1, pointersState.size());
+        Assert.assertEquals(0, pointersState.getPointerIndex(-1));
+        Assert.assertEquals(1, pointersState.get(0).getLocalId());
+
+        // the lowest local id is reused
+        Assert.assertEquals(1, pointersState.getPointerIndex(7));
+        Assert.assertEquals(0, pointersState.get(1).getLocalId());
+    }
+
+    @Test
+    public void testTooManyPointers() {
+        PointersState pointersState = new PointersState();
+        for (int i = 0; i < PointersState.MAX_POINTERS; ++i) {
+            Assert.assertEquals(i, pointersState.getPointerIndex(i << 8));
+        }
+        Assert.assertEquals(-1, pointersState.getPointerIndex(1));
+        // existing pointers are still found
+        Assert.assertEquals(3, pointersState.getPointerIndex(3 << 8));
+    }
+
+    @Test
+    public void testManyFingersStress() {
+        // Compare against a naive implementation (linear scans), with random fingers going down and up
+        Random random = new Random(42);
+        PointersState pointersState = new PointersState();
+        List<Pointer> expected = new ArrayList<>();
+
+        // ids colliding in the map (same low bits, or differing only in high bits) are likely to be selected
+        long[] ids = new long[40];
+        for (int i = 0; i < ids.length; ++i) {
+            switch (i % 4) {
+                case 0:
+                    ids[i] = i;
+                    break;
+                case 1:
+                    ids[i] = (long) i << 32;
+                    break;
+                case 2:
+                    ids[i] = -i;
+                    break;
+                default:
+                    ids[i] = random.nextLong();
+                    break;
+            }
+        }
+
+        for (int iteration = 0; iteration < 100000; ++iteration) {
+            long id = ids[random.nextInt(ids.length)];
+            int index = pointersState.getPointerIndex(id);
+
+            int expectedIndex = -1;
+            for (int i = 0; i < expected.size(); ++i) {
+                if (expected.get(i).getId() == id) {
+                    expectedIndex = i;
+                    break;
+                }
+            }
+            if (expectedIndex == -1 && expected.size() < PointersState.MAX_POINTERS) {
+                expectedIndex = expected.size();
+                expected.add(new Pointer(id, lowestUnusedLocalId(expected)));
+            }
+            Assert.assertEquals(expectedIndex, index);
+            Assert.assertEquals(expected.size(), pointersState.size());
+
+            if (index != -1) {
+                Pointer pointer = pointersState.get(index);
+                Assert.assertEquals(id, pointer.getId());
+                Assert.assertEquals(expected.get(index).getLocalId(), pointer.getLocalId());
+                if (random.nextInt(3) == 0) {
+                    pointer.setUp(true);
+                    expected.remove(index);
+                }
+            }
+
+            // like update(), after each event
+            pointersState.cleanUp();
+            Assert.assertEquals(expected.size(), pointersState.size());
+            for (int i = 0; i < expected.size(); ++i) {
+                Assert.assertEquals(expected.get(i).getId(), pointersState.get(i).getId());
+                Assert.assertEquals(i, pointersState.getPointerIndex(expected.get(i).getId()));
+            }
+        }
+    }
+
+    private static int lowestUnusedLocalId(List<Pointer> pointers) {
+        for (int localId = 0; ; ++localId) {
+            boolean used = false;
+            for (Pointer pointer : pointers) {
+                if (pointer.getLocalId() == localId) {
+                    used = true;
+                    break;
+                }
+            }
+            if (!used) {
+                return localId;
+            }
+        }
+    }
+}
@@ -0,0 +1,175 @@
+package com.genymobile.scrcpy;
+
+import org.junit.Assert;
+import org.junit.Test;
+
+import java.io.ByteArrayOutputStream;
+import java.nio.ByteBuffer;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+
+public class RtpPacketizerTest {
+
+    private static final class CollectingSink implements RtpPacketizer.DatagramSink {
+        private final List<byte[]> datagrams = new ArrayList<>();
+
+        @Override
+        public void send(byte[] data, int length) {
+            datagrams.add(Arrays.copyOf(data, length));
+        }
+    }
+
+    private static byte[] nal(int type, int length) {
+        byte[] nal = new byte[length];
+        nal[0] = (byte) (0x60 | type);
+        for (int i = 1; i < length; ++i) {
+            // never 0, so that it contains no start code
+            nal[i] = (byte) (1 + i % 255);
+        }
+        return nal;
+    }
+
+    private static ByteBuffer annexB(byte[]... nals) {
+        ByteArrayOutputStream out = new ByteArrayOutputStream();
+        for (byte[] nal : nals) {
+            out.write(0);
+            out.write(0);
+            out.write(0);
+            out.write(1);
+            out.write(nal, 0, nal.length);
+        }
+        return ByteBuffer.wrap(out.toByteArray());
+    }
+
+    private static int getSeq(byte[] datagram) {
+        return (datagram[2] & 0xff) << 8 | (datagram[3] & 0xff);
+    }
+
+    private static int getPayloadType(byte[] datagram) {
+        return datagram[1] & 0x7f;
+    }
+
+    private static boolean getMarker(byte[] datagram) {
+        return (datagram[1] & 0x80) != 0;
+    }
+
+    private static byte[] getPayload(byte[] datagram) {
+        return Arrays.copyOfRange(datagram, RtpPacketizer.HEADER_LENGTH, datagram.length);
+    }
+
+    @Test
+    public void testSingleNalUnits() throws Exception {
+        CollectingSink sink = new CollectingSink();
+        RtpPacketizer packetizer = new RtpPacketizer(sink, 0, 0x12345678);
+
+        byte[] sps = nal(7, 20);
+        byte[] pps = nal(8, 5);
+        ByteBuffer buffer = annexB(sps, pps);
+        packetizer.packetize(buffer, RtpPacketizer.NO_PTS);
+
+        // the buffer is not consumed
+        Assert.assertEquals(0, buffer.position());
+
+        Assert.assertEquals(2, sink.datagrams.size());
+        byte[] first = sink.datagrams.get(0);
+        byte[] second = sink.datagrams.get(1);
+
+        Assert.assertEquals(0x80, first[0] & 0xff);
+        Assert.assertEquals(RtpPacketizer.PAYLOAD_TYPE_H264, getPayloadType(first));
+        Assert.assertFalse(getMarker(first));
+        Assert.assertTrue(getMarker(second));
+        Assert.assertEquals(0, getSeq(first));
+        Assert.assertEquals(1, getSeq(second));
+        Assert.assertEquals(0x12, first[8]);
+        Assert.assertEquals(0x78, first[11]);
+
+        Assert.assertArrayEquals(sps, getPayload(first));
+        Assert.assertArrayEquals(pps, getPayload(second));
+    }
+
+    @Test
+    public void testTimestamp() throws Exception {
+        CollectingSink sink = new CollectingSink();
+        RtpPacketizer packetizer = new RtpPacketizer(sink, 0, 0);
+
+        packetizer.packetize(annexB(nal(5, 10)), 1_000_000);
+        // the config packet has the timestamp of the previous frame
+        packetizer.packetize(annexB(nal(7, 10)), RtpPacketizer.NO_PTS);
+
+        for (byte[] datagram : sink.datagrams) {
+            ByteBuffer header = ByteBuffer.wrap(datagram);
+            Assert.assertEquals(90000, header.getInt(4));
+        }
+    }
+
+    @Test
+    public void testFragmentation() throws Exception {
+        CollectingSink sink = new CollectingSink();
+        RtpPacketizer packetizer = new RtpPacketizer(sink, 0, 0);
+
+        byte[] idr = nal(5, 3000);
+        packetizer.packetize(annexB(idr), 0);
+
+        // 2999 bytes after the NAL unit header, at most 1398 per fragment
+        Assert.assertEquals(3, sink.datagrams.size());
+
+        ByteArrayOutputStream reassembled = new ByteArrayOutputStream();
+        reassembled.write(idr[0]);
+        for (int i = 0; i < 3; ++i) {
+            byte[] payload = getPayload(sink.datagrams.get(i));
+            // FU indicator: the NRI of the NAL unit, and the FU-A type
+            Assert.assertEquals(0x60 | 28, payload[0] & 0xff);
+            // FU header: start and end bits, and the NAL unit type
+            int expectedFuHeader = 5 | (i == 0 ? 0x80 : 0) | (i == 2 ? 0x40 : 0);
+            Assert.assertEquals(expectedFuHeader, payload[1] & 0xff);
+            Assert.assertEquals(i == 2, getMarker(sink.datagrams.get(i)));
+            reassembled.write(payload, 2, payload.length - 2);
+        }
+
+        Assert.assertArrayEquals(idr, reassembled.toByteArray());
+    }
+
+    @Test
+    public void testFec() throws Exception {
+        CollectingSink sink = new CollectingSink();
+        RtpPacketizer packetizer = new RtpPacketizer(sink, 2, 0);
+
+        byte[] nal1 = nal(1, 100);
+        byte[] nal2 = nal(1, 40);
+        byte[] nal3 = nal(1, 60);
+        packetizer.packetize(annexB(nal1, nal2, nal3), 0);
+
+        // media, media, FEC, media, FEC (the group is flushed at the end of the buffer)
+        Assert.assertEquals(5, sink.datagrams.size());
+        int[] expectedTypes = {96, 96, 97, 96, 97};
+        for (int i = 0; i < expectedTypes.length; ++i) {
+            Assert.assertEquals(expectedTypes[i], getPayloadType(sink.datagrams.get(i)));
+        }
+
+        byte[] fec1 = getPayload(sink.datagrams.get(2));
+        Assert.assertEquals(0, (fec1[0] & 0xff) << 8 | (fec1[1] & 0xff)); // base seq
+        Assert.assertEquals(2, fec1[2]); // count
+        Assert.assertEquals(RtpPacketizer.FEC_HEADER_LENGTH + RtpPacketizer.FEC_BLOCK_HEADER_LENGTH + 100, fec1.length);
+
+        byte[] fec2 = getPayload(sink.datagrams.get(4));
+        Assert.assertEquals(2, (fec2[0] & 0xff) << 8 | (fec2[1] & 0xff));
+        Assert.assertEquals(1, fec2[2]);
+        Assert.assertEquals(1, getSeq(sink.datagrams.get(4)));
+
+        // recover the first packet from the second one and the FEC packet
+        byte[] block = Arrays.copyOfRange(fec1, RtpPacketizer.FEC_HEADER_LENGTH, fec1.length);
+        byte[] payload2 = getPayload(sink.datagrams.get(1));
+        block[1] ^= (byte) (payload2.length >> 8);
+        block[2] ^= (byte) payload2.length;
+        for (int i = 0; i < payload2.length; ++i) {
+            block[RtpPacketizer.FEC_BLOCK_HEADER_LENGTH + i] ^= payload2[i];
+        }
+
+        Assert.assertEquals(0, block[0]);
+        int length = (block[1] & 0xff) << 8 | (block[2] & 0xff);
+        Assert.assertEquals(100, length);
+        byte[] recovered = Arrays.copyOfRange(block, RtpPacketizer.FEC_BLOCK_HEADER_LENGTH, RtpPacketizer.FEC_BLOCK_HEADER_LENGTH + length);
+        Assert.assertArrayEquals(nal1, recovered);
+    }
+}